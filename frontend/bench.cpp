@@ -0,0 +1,642 @@
+// bench.cpp
+
+// Copyright (C) 2011-2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// This program measures the rendering cost of the bytecode created by
+// `TTF_autohint'.  It hints the input font, then loads every glyph at
+// every PPEM value of the hinting range with FreeType's TrueType bytecode
+// interpreter.  For comparison, the same is done with hinting switched
+// off and with FreeType's auto-hinter applied to the input font; the
+// difference to the unhinted loading time is the cost of hinting alone.
+// Glyphs are not rasterized, since the scan converter's run time doesn't
+// depend on the hints.  Additionally, the execution cost of the `prep' table is
+// measured, which runs after every change of the PPEM value.
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <gethrxtime.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+#include <ttfautohint.h>
+
+
+using namespace std;
+
+
+// the default number of glyphs listed in the report
+#define BENCH_NUM_HEAVIEST 10
+
+
+enum
+{
+  MODE_UNHINTED,
+  MODE_AUTOHINTER,
+  MODE_BYTECODE,
+  NUM_MODES
+};
+
+static const char* mode_names[NUM_MODES] =
+{
+  "unhinted",
+  "auto-hinter",
+  "ttfautohint"
+};
+
+
+typedef struct Glyph_Data_
+{
+  long idx;
+  long sfnt_idx;
+  xtime_t time[NUM_MODES]; // loading time, summed up over all PPEM values
+  unsigned long ins_len; // size of the glyph's bytecode
+} Glyph_Data;
+
+
+static bool
+heavier(const Glyph_Data& a,
+        const Glyph_Data& b)
+{
+  return a.time[MODE_BYTECODE] - a.time[MODE_UNHINTED]
+         > b.time[MODE_BYTECODE] - b.time[MODE_UNHINTED];
+}
+
+
+static void
+show_help(bool is_error)
+{
+  FILE* handle = is_error ? stderr : stdout;
+
+  fprintf(handle,
+"Usage: ttfautohint-bench [OPTION]... IN-FILE\n"
+"Measure the rendering cost of hints created by ttfautohint.\n"
+"\n"
+"IN-FILE gets processed with ttfautohint; all glyphs of the result\n"
+"are then loaded with FreeType's bytecode interpreter for every PPEM\n"
+"value in the hinting range.  For comparison, the timings for unhinted\n"
+"loading and for FreeType's auto-hinter are shown also; hinting times\n"
+"are given relative to unhinted loading and exclude rasterization.\n"
+"Finally, the cost of running the `prep' table for a new PPEM value is\n"
+"measured.\n"
+"\n");
+
+  fprintf(handle,
+"Options:\n"
+"  -h, --help                 display this help and exit\n"
+"  -l, --hinting-range-min=N  the minimum PPEM value for hint sets\n"
+"                             (default: %d)\n"
+"  -n, --num-glyphs=N         list the N glyphs with the most expensive\n"
+"                             bytecode (default: %d)\n"
+"  -r, --hinting-range-max=N  the maximum PPEM value for hint sets\n"
+"                             (default: %d)\n"
+"  -t, --iterations=N         load everything N times (default: 1)\n"
+"  -V, --version              print version information and exit\n"
+"  -x, --x-height-snapping-exceptions=STRING\n"
+"                             specify a comma-separated list of\n"
+"                             x-height snapping exceptions, which get\n"
+"                             tested in the `prep' table\n"
+"\n",
+          TA_HINTING_RANGE_MIN, BENCH_NUM_HEAVIEST, TA_HINTING_RANGE_MAX);
+
+  fprintf(handle,
+"FreeType doesn't provide the number of executed bytecode instructions;\n"
+"the size of each glyph's bytecode (in bytes) is shown instead.\n"
+"\n"
+"Report bugs to: freetype-devel@nongnu.org\n"
+"ttfautohint home page: <http://www.freetype.org/ttfautohint>\n");
+
+  if (is_error)
+    exit(EXIT_FAILURE);
+  else
+    exit(EXIT_SUCCESS);
+}
+
+
+static void
+show_version()
+{
+  fprintf(stdout,
+"ttfautohint-bench " VERSION "\n"
+"Copyright (C) 2011-2012 Werner Lemberg <wl@gnu.org>.\n"
+"License: FreeType License (FTL) or GNU GPLv2.\n"
+"This is free software: you are free to change and redistribute it.\n"
+"There is NO WARRANTY, to the extent permitted by law.\n");
+
+  exit(EXIT_SUCCESS);
+}
+
+
+static unsigned long
+get_ushort(const FT_Byte* p)
+{
+  return ((unsigned long)p[0] << 8) | p[1];
+}
+
+
+static unsigned long
+get_ulong(const FT_Byte* p)
+{
+  return ((unsigned long)p[0] << 24)
+         | ((unsigned long)p[1] << 16)
+         | ((unsigned long)p[2] << 8)
+         | p[3];
+}
+
+
+static FT_Byte*
+load_table(FT_Face face,
+           FT_ULong tag,
+           FT_ULong* len)
+{
+  *len = 0;
+  if (FT_Load_Sfnt_Table(face, tag, 0, NULL, len))
+    return NULL;
+
+  FT_Byte* buf = (FT_Byte*)malloc(*len);
+  if (!buf)
+    return NULL;
+
+  if (FT_Load_Sfnt_Table(face, tag, 0, buf, len))
+  {
+    free(buf);
+    return NULL;
+  }
+
+  return buf;
+}
+
+
+// get the size of the bytecode for all glyphs in `face';
+// glyphs without or with invalid data get value zero
+
+static void
+get_instruction_lengths(FT_Face face,
+                        Glyph_Data* glyphs)
+{
+  TT_Header* head = (TT_Header*)FT_Get_Sfnt_Table(face, ft_sfnt_head);
+  if (!head)
+    return;
+
+  FT_ULong loca_len;
+  FT_ULong glyf_len;
+  FT_Byte* loca = load_table(face, TTAG_loca, &loca_len);
+  FT_Byte* glyf = load_table(face, TTAG_glyf, &glyf_len);
+  if (!loca || !glyf)
+    goto Exit;
+
+  for (long i = 0; i < face->num_glyphs; i++)
+  {
+    unsigned long start, end;
+
+    if (head->Index_To_Loc_Format)
+    {
+      if ((unsigned long)(i + 2) * 4 > loca_len)
+        break;
+      start = get_ulong(loca + i * 4);
+      end = get_ulong(loca + i * 4 + 4);
+    }
+    else
+    {
+      if ((unsigned long)(i + 2) * 2 > loca_len)
+        break;
+      start = get_ushort(loca + i * 2) * 2;
+      end = get_ushort(loca + i * 2 + 2) * 2;
+    }
+
+    if (end > glyf_len || start + 10 > end)
+      continue;
+
+    const FT_Byte* p = glyf + start;
+    const FT_Byte* limit = glyf + end;
+    short num_contours = (short)get_ushort(p);
+
+    p += 10;
+
+    if (num_contours >= 0)
+    {
+      p += 2 * num_contours;
+      if (p + 2 > limit)
+        continue;
+    }
+    else
+    {
+      // skip the components
+      unsigned long flags = 0;
+
+      do
+      {
+        // a truncated glyph has no instructions
+        if (p + 4 > limit)
+        {
+          flags = 0;
+          break;
+        }
+        flags = get_ushort(p);
+        p += 4;
+
+        p += (flags & 0x0001) ? 4 : 2; // ARGS_ARE_WORDS
+        if (flags & 0x0008) // WE_HAVE_A_SCALE
+          p += 2;
+        else if (flags & 0x0040) // WE_HAVE_AN_XY_SCALE
+          p += 4;
+        else if (flags & 0x0080) // WE_HAVE_A_2X2
+          p += 8;
+      } while (flags & 0x0020); // MORE_COMPONENTS
+
+      if (!(flags & 0x0100) // WE_HAVE_INSTRUCTIONS
+          || p + 2 > limit)
+        continue;
+    }
+
+    glyphs[i].ins_len = get_ushort(p);
+  }
+
+Exit:
+  free(loca);
+  free(glyf);
+}
+
+
+// load all glyphs of `face' in the given PPEM range without rasterizing
+// them, adding the elapsed time for each glyph to `glyphs'
+
+static FT_Error
+load_glyphs(FT_Face face,
+              FT_Int32 load_flags,
+              int ppem_min,
+              int ppem_max,
+              Glyph_Data* glyphs,
+              int mode)
+{
+  FT_Error error;
+
+  for (int ppem = ppem_min; ppem <= ppem_max; ppem++)
+  {
+    error = FT_Set_Pixel_Sizes(face, ppem, ppem);
+    if (error)
+      return error;
+
+    for (long i = 0; i < face->num_glyphs; i++)
+    {
+      xtime_t start = gethrxtime();
+
+      error = FT_Load_Glyph(face, i, load_flags);
+      if (error)
+        return error;
+
+      glyphs[i].time[mode] += gethrxtime() - start;
+    }
+  }
+
+  return 0;
+}
+
+
+// measure the execution time of the `prep' table for all PPEM values in
+// the given range; FreeType runs it while loading the first glyph after a
+// size change, so we subtract the time needed to load the same glyph again
+
+static FT_Error
+run_prep(FT_Face face,
+         int ppem_min,
+         int ppem_max,
+         xtime_t* prep_time)
+{
+  FT_Error error;
+
+  for (int ppem = ppem_min; ppem <= ppem_max; ppem++)
+  {
+    xtime_t start = gethrxtime();
+
+    error = FT_Set_Pixel_Sizes(face, ppem, ppem);
+    if (error)
+      return error;
+    error = FT_Load_Glyph(face, 0, FT_LOAD_NO_AUTOHINT);
+    if (error)
+      return error;
+
+    xtime_t first = gethrxtime() - start;
+
+    start = gethrxtime();
+
+    error = FT_Load_Glyph(face, 0, FT_LOAD_NO_AUTOHINT);
+    if (error)
+      return error;
+
+    xtime_t second = gethrxtime() - start;
+
+    if (first > second)
+      *prep_time += first - second;
+  }
+
+  return 0;
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  int hinting_range_min = TA_HINTING_RANGE_MIN;
+  int hinting_range_max = TA_HINTING_RANGE_MAX;
+  int num_heaviest = BENCH_NUM_HEAVIEST;
+  int iterations = 1;
+  const char* x_height_snapping_exceptions_string = "";
+
+  while (1)
+  {
+    static struct option long_options[] =
+    {
+      {"help", no_argument, NULL, 'h'},
+      {"hinting-range-max", required_argument, NULL, 'r'},
+      {"hinting-range-min", required_argument, NULL, 'l'},
+      {"iterations", required_argument, NULL, 't'},
+      {"num-glyphs", required_argument, NULL, 'n'},
+      {"version", no_argument, NULL, 'V'},
+      {"x-height-snapping-exceptions", required_argument, NULL, 'x'},
+
+      {NULL, 0, NULL, 0}
+    };
+
+    int option_index;
+    int c = getopt_long_only(argc, argv, "hl:n:r:t:Vx:",
+                             long_options, &option_index);
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+    case 'h':
+      show_help(false);
+      break;
+
+    case 'l':
+      hinting_range_min = atoi(optarg);
+      break;
+
+    case 'n':
+      num_heaviest = atoi(optarg);
+      break;
+
+    case 'r':
+      hinting_range_max = atoi(optarg);
+      break;
+
+    case 't':
+      iterations = atoi(optarg);
+      break;
+
+    case 'V':
+      show_version();
+      break;
+
+    case 'x':
+      x_height_snapping_exceptions_string = optarg;
+      break;
+
+    default:
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (hinting_range_min < 2)
+  {
+    fprintf(stderr, "The hinting range minimum must be at least 2\n");
+    exit(EXIT_FAILURE);
+  }
+  if (hinting_range_max < hinting_range_min)
+  {
+    fprintf(stderr, "The hinting range maximum must not be smaller"
+                    " than the minimum (%d)\n",
+                    hinting_range_min);
+    exit(EXIT_FAILURE);
+  }
+  if (iterations < 1)
+  {
+    fprintf(stderr, "The number of iterations must be at least 1\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (argc - optind != 1)
+    show_help(true);
+
+  const char* in_name = argv[optind];
+  FILE* in = fopen(in_name, "rb");
+  if (!in)
+  {
+    fprintf(stderr, "The following error occurred while opening font `%s':\n"
+                    "\n"
+                    "  %s\n",
+                    in_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  // we need the input font in memory for the auto-hinter
+  vector<FT_Byte> in_buf;
+  FT_Byte chunk[4096];
+  size_t len;
+
+  while ((len = fread(chunk, 1, sizeof (chunk), in)) > 0)
+    in_buf.insert(in_buf.end(), chunk, chunk + len);
+  fclose(in);
+
+  if (in_buf.empty())
+  {
+    fprintf(stderr, "Font `%s' is empty\n", in_name);
+    exit(EXIT_FAILURE);
+  }
+
+  char* out_buf = NULL;
+  size_t out_len = 0;
+  const unsigned char* error_string;
+
+  xtime_t hinting_time = gethrxtime();
+
+  TA_Error error =
+    TTF_autohint("in-buffer, in-buffer-len, out-buffer, out-buffer-len,"
+                 "hinting-range-min, hinting-range-max,"
+                 "x-height-snapping-exceptions,"
+                 "error-string",
+                 (const char*)&in_buf[0], in_buf.size(), &out_buf, &out_len,
+                 hinting_range_min, hinting_range_max,
+                 x_height_snapping_exceptions_string,
+                 &error_string);
+  if (error)
+  {
+    fprintf(stderr, "Error code `0x%02x' while autohinting font:\n"
+                    "  %s\n", error, error_string);
+    exit(EXIT_FAILURE);
+  }
+
+  hinting_time = gethrxtime() - hinting_time;
+
+  FT_Library library;
+  if (FT_Init_FreeType(&library))
+  {
+    fprintf(stderr, "Can't initialize FreeType\n");
+    exit(EXIT_FAILURE);
+  }
+
+  vector<Glyph_Data> glyphs;
+  xtime_t totals[NUM_MODES] = {0, 0, 0};
+  xtime_t prep_time = 0;
+  long num_sfnts = 1;
+
+  for (long sfnt_idx = 0; sfnt_idx < num_sfnts; sfnt_idx++)
+  {
+    FT_Face in_face;
+    FT_Face out_face;
+
+    if (FT_New_Memory_Face(library, &in_buf[0], in_buf.size(),
+                           sfnt_idx, &in_face)
+        || FT_New_Memory_Face(library, (FT_Byte*)out_buf, out_len,
+                              sfnt_idx, &out_face))
+    {
+      fprintf(stderr, "Can't open subfont %ld\n", sfnt_idx);
+      exit(EXIT_FAILURE);
+    }
+
+    num_sfnts = out_face->num_faces;
+
+    vector<Glyph_Data> sfnt_glyphs(out_face->num_glyphs);
+    for (long i = 0; i < out_face->num_glyphs; i++)
+    {
+      sfnt_glyphs[i].idx = i;
+      sfnt_glyphs[i].sfnt_idx = sfnt_idx;
+      for (int mode = 0; mode < NUM_MODES; mode++)
+        sfnt_glyphs[i].time[mode] = 0;
+      sfnt_glyphs[i].ins_len = 0;
+    }
+
+    get_instruction_lengths(out_face, &sfnt_glyphs[0]);
+
+    for (int iter = 0; iter < iterations; iter++)
+    {
+      if (load_glyphs(out_face, FT_LOAD_NO_HINTING,
+                      hinting_range_min, hinting_range_max,
+                      &sfnt_glyphs[0], MODE_UNHINTED)
+          || load_glyphs(in_face, FT_LOAD_FORCE_AUTOHINT,
+                         hinting_range_min, hinting_range_max,
+                         &sfnt_glyphs[0], MODE_AUTOHINTER)
+          || load_glyphs(out_face, FT_LOAD_NO_AUTOHINT,
+                         hinting_range_min, hinting_range_max,
+                         &sfnt_glyphs[0], MODE_BYTECODE))
+      {
+        fprintf(stderr, "Can't load glyphs of subfont %ld\n", sfnt_idx);
+        exit(EXIT_FAILURE);
+      }
+
+      if (run_prep(out_face, hinting_range_min, hinting_range_max,
+                   &prep_time))
+      {
+        fprintf(stderr, "Can't run `prep' table of subfont %ld\n",
+                        sfnt_idx);
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    for (long i = 0; i < out_face->num_glyphs; i++)
+      for (int mode = 0; mode < NUM_MODES; mode++)
+        totals[mode] += sfnt_glyphs[i].time[mode];
+
+    glyphs.insert(glyphs.end(), sfnt_glyphs.begin(), sfnt_glyphs.end());
+
+    FT_Done_Face(in_face);
+    FT_Done_Face(out_face);
+  }
+
+  FT_Done_FreeType(library);
+  free(out_buf);
+
+  // all times are reported in microseconds per loading of a glyph
+  // (or a glyph set) at a single PPEM value; hinting times are the
+  // loading times minus the unhinted loading time
+  double num_loads = (double)iterations
+                          * (hinting_range_max - hinting_range_min + 1);
+  double num_glyphs = (double)glyphs.size();
+
+  printf("font `%s': %ld glyph(s) in %ld subfont(s)\n"
+         "hinting range: %d-%d PPEM, %d iteration(s)\n"
+         "ttfautohint processing time: %.1fms\n"
+         "\n",
+         in_name, (long)glyphs.size(), num_sfnts,
+         hinting_range_min, hinting_range_max, iterations,
+         hinting_time / 1e6);
+
+  printf("average loading time per glyph and PPEM value"
+         " (without rasterization):\n");
+  for (int mode = 0; mode < NUM_MODES; mode++)
+    printf("  %-12s %9.2fus\n",
+           mode_names[mode],
+           totals[mode] / 1e3 / num_loads / num_glyphs);
+  printf("average hinting time per glyph and PPEM value:\n");
+  for (int mode = MODE_AUTOHINTER; mode < NUM_MODES; mode++)
+    printf("  %-12s %9.2fus\n",
+           mode_names[mode],
+           (double)(totals[mode] - totals[MODE_UNHINTED])
+             / 1e3 / num_loads / num_glyphs);
+  if (totals[MODE_UNHINTED])
+    printf("bytecode overhead compared to unhinted loading: %.1f%%\n",
+           100.0 * (totals[MODE_BYTECODE] - totals[MODE_UNHINTED])
+             / totals[MODE_UNHINTED]);
+  if (totals[MODE_AUTOHINTER] > totals[MODE_UNHINTED])
+    printf("bytecode hinting cost relative to the auto-hinter: %.1f%%\n",
+           100.0 * (totals[MODE_BYTECODE] - totals[MODE_UNHINTED])
+             / (totals[MODE_AUTOHINTER] - totals[MODE_UNHINTED]));
+  printf("average `prep' execution time per subfont and PPEM value:"
+         " %.2fus\n",
+         prep_time / 1e3 / num_loads / num_sfnts);
+  printf("\n");
+
+  if (num_heaviest > (int)glyphs.size())
+    num_heaviest = (int)glyphs.size();
+  if (num_heaviest <= 0)
+    exit(EXIT_SUCCESS);
+
+  partial_sort(glyphs.begin(), glyphs.begin() + num_heaviest, glyphs.end(),
+               heavier);
+
+  printf("glyphs with the most expensive bytecode"
+         " (hinting times in us per PPEM value):\n"
+         "\n"
+         "  subfont   glyph  ttfautohint  auto-hinter  unhinted load"
+         "  bytecode size\n");
+  for (int i = 0; i < num_heaviest; i++)
+  {
+    Glyph_Data* g = &glyphs[i];
+
+    printf("  %7ld  %6ld  %11.2f  %11.2f  %13.2f  %13lu\n",
+           g->sfnt_idx, g->idx,
+           (double)(g->time[MODE_BYTECODE] - g->time[MODE_UNHINTED])
+             / 1e3 / num_loads,
+           (double)(g->time[MODE_AUTOHINTER] - g->time[MODE_UNHINTED])
+             / 1e3 / num_loads,
+           g->time[MODE_UNHINTED] / 1e3 / num_loads,
+           g->ins_len);
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+// end of bench.cpp
@@ -0,0 +1,617 @@
+// daemon.cpp
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// The daemon mode of `ttfautohint'.
+//
+// A client sends its command line, its current directory, and the value
+// of `SOURCE_DATE_EPOCH' to the daemon; its standard input, output, and
+// error are passed as file descriptors along with it.  The daemon forks a
+// fixed number of long-lived worker processes which accept the
+// connections.  A worker handles the command line exactly as a normal
+// invocation does, but it keeps the FreeType library, the memory pool, and
+// the glyph cache of the ttfautohint library between jobs; only the
+// client's file descriptors, current directory, and environment get set up
+// for every job.  It then sends the exit code back to the client, which
+// thus behaves exactly like the program itself.  If a worker dies, the
+// daemon starts a new one.
+//
+// The socket is only accessible to the user running the daemon, and both
+// sides check that the process at the other end of a connection runs under
+// the same user.
+
+#include <config.h>
+
+#ifdef HAVE_UNIX_SOCKETS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "daemon.h"
+
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0
+#endif
+
+// an upper limit for the size of a request (the command line arguments)
+#define DAEMON_MAX_REQUEST (1 << 22)
+
+// the number of file descriptors passed to the daemon
+#define DAEMON_NUM_FDS 3
+
+
+using namespace std;
+
+
+// the socket the workers accept connections on,
+// and the connection of a worker's current job
+static int listen_fd = -1;
+static int job_conn = -1;
+
+// the reading end of a pipe whose writing end only the daemon holds;
+// it signals end-of-file to the workers if the daemon is gone
+static int daemon_fd = -1;
+
+// a worker's own standard output and error, restored after every job
+static int saved_fds[DAEMON_NUM_FDS] = {-1, -1, -1};
+
+
+static bool
+write_all(int fd,
+          const void* buf,
+          size_t len)
+{
+  const char* p = (const char*)buf;
+
+  while (len)
+  {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    p += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+
+static bool
+read_all(int fd,
+         void* buf,
+         size_t len)
+{
+  char* p = (char*)buf;
+
+  while (len)
+  {
+    ssize_t n = read(fd, p, len);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (!n)
+      return false;
+
+    p += n;
+    len -= n;
+  }
+
+  return true;
+}
+
+
+static bool
+set_address(struct sockaddr_un* addr,
+            const char* socket_name)
+{
+  if (strlen(socket_name) >= sizeof (addr->sun_path))
+    return false;
+
+  memset(addr, 0, sizeof (struct sockaddr_un));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, socket_name);
+
+  return true;
+}
+
+
+// check whether the process at the other end of a connection
+// runs under our (effective) user
+
+static bool
+is_same_user(int fd)
+{
+  uid_t uid;
+
+#ifdef HAVE_GETPEEREID
+  gid_t gid;
+
+  if (getpeereid(fd, &uid, &gid) < 0)
+    return false;
+#elif defined(SO_PEERCRED)
+  struct ucred cred;
+  socklen_t len = sizeof (cred);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    return false;
+  uid = cred.uid;
+#else
+  // without a way to check the user, we trust nobody
+  (void)fd;
+  (void)uid;
+  return false;
+#endif
+
+  return uid == geteuid();
+}
+
+
+// return a connected socket or -1 if there is no daemon
+// (a daemon running under another user doesn't count)
+
+static int
+daemon_connect(const char* socket_name)
+{
+  struct sockaddr_un addr;
+
+  if (!set_address(&addr, socket_name))
+    return -1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  if (connect(fd, (struct sockaddr*)&addr, sizeof (addr)) < 0
+      || !is_same_user(fd))
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+// a request starts with its length, which gets sent together with the
+// client's file descriptors for standard input, output, and error
+
+typedef union Control_Buffer_
+{
+  struct cmsghdr align;
+  char buf[CMSG_SPACE(DAEMON_NUM_FDS * sizeof (int))];
+} Control_Buffer;
+
+
+static bool
+send_request(int fd,
+             const string& request)
+{
+  unsigned int len = request.size();
+  int fds[DAEMON_NUM_FDS] = {0, 1, 2};
+
+  struct iovec iov;
+  struct msghdr msg;
+  Control_Buffer control;
+
+  iov.iov_base = &len;
+  iov.iov_len = sizeof (len);
+
+  memset(&msg, 0, sizeof (msg));
+  memset(&control, 0, sizeof (control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof (fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof (fds));
+
+  if (sendmsg(fd, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof (len))
+    return false;
+
+  return write_all(fd, request.data(), len);
+}
+
+
+static bool
+receive_request(int fd,
+                string& request,
+                int* fds)
+{
+  unsigned int len;
+
+  struct iovec iov;
+  struct msghdr msg;
+  Control_Buffer control;
+  ssize_t n;
+
+  iov.iov_base = &len;
+  iov.iov_len = sizeof (len);
+
+  memset(&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  do
+    n = recvmsg(fd, &msg, 0);
+  while (n < 0 && errno == EINTR);
+
+  struct cmsghdr* cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (!cmsg
+      || cmsg->cmsg_level != SOL_SOCKET
+      || cmsg->cmsg_type != SCM_RIGHTS
+      || cmsg->cmsg_len != CMSG_LEN(DAEMON_NUM_FDS * sizeof (int)))
+    return false;
+
+  memcpy(fds, CMSG_DATA(cmsg), DAEMON_NUM_FDS * sizeof (int));
+
+  if (n < (ssize_t)sizeof (len)
+      && !read_all(fd, (char*)&len + n, sizeof (len) - n))
+    return false;
+
+  // the request consists of NUL-terminated strings
+  if (!len || len > DAEMON_MAX_REQUEST)
+    return false;
+
+  request.resize(len);
+  if (!read_all(fd, &request[0], len))
+    return false;
+
+  return request[len - 1] == '\0';
+}
+
+
+void
+daemon_forward(int argc,
+               char** argv)
+{
+  const char* socket_name = getenv(DAEMON_SOCKET_VARIABLE);
+  if (!socket_name || !*socket_name)
+    return;
+
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof (cwd)))
+    return;
+
+  // the request holds the current directory, the value of
+  // `SOURCE_DATE_EPOCH' (prefixed with `=' to distinguish an empty value
+  // from an unset variable), and the command line arguments
+  string request;
+
+  request.append(cwd);
+  request += '\0';
+
+  const char* epoch = getenv("SOURCE_DATE_EPOCH");
+  if (epoch)
+  {
+    request += '=';
+    request.append(epoch);
+  }
+  request += '\0';
+
+  for (int i = 0; i < argc; i++)
+  {
+    request.append(argv[i]);
+    request += '\0';
+  }
+
+  if (request.size() > DAEMON_MAX_REQUEST)
+    return;
+
+  // without a daemon, we do the work ourselves
+  int fd = daemon_connect(socket_name);
+  if (fd < 0)
+    return;
+
+  // the daemon only starts a job after having received the complete
+  // request, so we can still fall back to local processing
+  if (!send_request(fd, request))
+  {
+    close(fd);
+    return;
+  }
+
+  int exit_code;
+  if (!read_all(fd, &exit_code, sizeof (exit_code)))
+  {
+    fprintf(stderr, "Lost connection to the daemon at socket `%s'\n",
+                    socket_name);
+    exit(EXIT_FAILURE);
+  }
+
+  close(fd);
+  exit(exit_code);
+}
+
+
+// set up a job from a client's connection; if this fails, the connection
+// is closed and false is returned
+
+static bool
+start_job(int conn,
+          vector<string>& job_args)
+{
+  string request;
+  int fds[DAEMON_NUM_FDS] = {-1, -1, -1};
+
+  if (!receive_request(conn, request, fds))
+  {
+    for (int i = 0; i < DAEMON_NUM_FDS; i++)
+      if (fds[i] >= 0)
+        close(fds[i]);
+    close(conn);
+    return false;
+  }
+
+  vector<string> strings;
+  size_t start = 0;
+
+  while (start < request.size())
+  {
+    size_t end = request.find('\0', start);
+
+    strings.push_back(request.substr(start, end - start));
+    start = end + 1;
+  }
+
+  // we need the directory, `SOURCE_DATE_EPOCH', and `argv[0]' at least
+  if (strings.size() < 3)
+  {
+    for (int i = 0; i < DAEMON_NUM_FDS; i++)
+      close(fds[i]);
+    close(conn);
+    return false;
+  }
+
+  // the standard descriptors are always open (see `daemon_serve'),
+  // so the passed ones are never among them
+  for (int i = 0; i < DAEMON_NUM_FDS; i++)
+  {
+    dup2(fds[i], i);
+    close(fds[i]);
+  }
+
+  job_conn = conn;
+
+  if (chdir(strings[0].c_str()) < 0)
+  {
+    fprintf(stderr, "The following error occurred"
+                    " while changing to directory `%s':\n"
+                    "\n"
+                    "  %s\n",
+                    strings[0].c_str(), strerror(errno));
+    daemon_finish_job(EXIT_FAILURE);
+    return false;
+  }
+
+  if (strings[1].empty())
+    unsetenv("SOURCE_DATE_EPOCH");
+  else
+    setenv("SOURCE_DATE_EPOCH", strings[1].c_str() + 1, 1);
+
+  job_args.assign(strings.begin() + 2, strings.end());
+  return true;
+}
+
+
+void
+daemon_accept_job(vector<string>& job_args)
+{
+  for (;;)
+  {
+    struct pollfd fds[2];
+
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = daemon_fd;
+    fds[1].events = POLLIN;
+
+    if (poll(fds, 2, -1) < 0 && errno != EINTR)
+      exit(EXIT_FAILURE);
+
+    if (fds[1].revents)
+      exit(EXIT_SUCCESS);
+    if (!(fds[0].revents & POLLIN))
+      continue;
+
+    // the socket is non-blocking since another worker
+    // might have taken the connection in the meantime
+    int conn = accept(listen_fd, NULL, NULL);
+    if (conn < 0)
+    {
+      if (errno == EINTR
+          || errno == ECONNABORTED
+          || errno == EAGAIN
+          || errno == EWOULDBLOCK)
+        continue;
+
+      fprintf(stderr, "The following error occurred"
+                      " while waiting for connections:\n"
+                      "\n"
+                      "  %s\n",
+                      strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    // other users must not run jobs (and get our file descriptors)
+    if (!is_same_user(conn))
+    {
+      close(conn);
+      continue;
+    }
+
+    // some systems let the connection inherit `O_NONBLOCK'
+    fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) & ~O_NONBLOCK);
+
+    if (start_job(conn, job_args))
+      return;
+  }
+}
+
+
+void
+daemon_finish_job(int exit_code)
+{
+  fflush(stdout);
+  fflush(stderr);
+
+  // forget about input the job hasn't consumed
+  // (this also resets the end-of-file indicator)
+  if (!freopen("/dev/null", "rb", stdin))
+    exit(EXIT_FAILURE);
+
+  // release the client's descriptors
+  for (int i = 1; i < DAEMON_NUM_FDS; i++)
+    dup2(saved_fds[i], i);
+  clearerr(stdout);
+  clearerr(stderr);
+
+  write_all(job_conn, &exit_code, sizeof (exit_code));
+  close(job_conn);
+  job_conn = -1;
+}
+
+
+void
+daemon_serve(const char* socket_name,
+             int workers)
+{
+  struct sockaddr_un addr;
+
+  if (!set_address(&addr, socket_name))
+  {
+    fprintf(stderr, "Socket name `%s' is too long\n", socket_name);
+    exit(EXIT_FAILURE);
+  }
+
+  // don't steal the socket of a running daemon,
+  // and don't remove anything but a socket
+  int fd = daemon_connect(socket_name);
+  if (fd >= 0)
+  {
+    close(fd);
+    fprintf(stderr, "A daemon is already listening at socket `%s'\n",
+                    socket_name);
+    exit(EXIT_FAILURE);
+  }
+
+  // the workers redirect the standard descriptors for every job; to
+  // avoid that a socket or a passed descriptor ends up as one of them,
+  // they must be open
+  for (int i = 0; i < DAEMON_NUM_FDS; i++)
+    if (fcntl(i, F_GETFD) < 0
+        && open("/dev/null", O_RDWR) != i)
+      exit(EXIT_FAILURE);
+
+  struct stat st;
+  if (!lstat(socket_name, &st) && S_ISSOCK(st.st_mode))
+    unlink(socket_name);
+
+  // the socket gets mode 0600 so that only we can connect
+  mode_t old_mask = umask(0177);
+
+  int pipe_fds[2];
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0
+      || bind(listen_fd, (struct sockaddr*)&addr, sizeof (addr)) < 0
+      || listen(listen_fd, SOMAXCONN) < 0
+      || fcntl(listen_fd, F_SETFL, O_NONBLOCK) < 0
+      || pipe(pipe_fds) < 0)
+  {
+    fprintf(stderr, "The following error occurred"
+                    " while creating socket `%s':\n"
+                    "\n"
+                    "  %s\n",
+                    socket_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  umask(old_mask);
+
+  if (!workers)
+  {
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = num_cpus > 0 ? num_cpus : 1;
+  }
+
+  int active = 0;
+
+  for (;;)
+  {
+    // start the workers, replacing the ones which have died
+    // (for example, because a job has crashed)
+    while (active < workers)
+    {
+      pid_t pid = fork();
+      if (!pid)
+      {
+        close(pipe_fds[1]);
+        daemon_fd = pipe_fds[0];
+
+        for (int i = 1; i < DAEMON_NUM_FDS; i++)
+          saved_fds[i] = fcntl(i, F_DUPFD, DAEMON_NUM_FDS);
+        return;
+      }
+
+      if (pid < 0)
+      {
+        // try again later
+        if (!active)
+          sleep(1);
+        break;
+      }
+
+      active++;
+    }
+
+    if (!active)
+      continue;
+
+    pid_t pid = waitpid(-1, NULL, 0);
+
+    if (pid > 0)
+      active--;
+    else if (errno == ECHILD)
+      active = 0;
+  }
+}
+
+#endif // HAVE_UNIX_SOCKETS
+
+// end of daemon.cpp
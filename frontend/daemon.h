@@ -0,0 +1,69 @@
+// daemon.h
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include <config.h>
+
+#include <vector>
+#include <string>
+
+
+#ifdef HAVE_UNIX_SOCKETS
+
+// the environment variable which holds the socket name for clients
+#define DAEMON_SOCKET_VARIABLE "TTFAUTOHINT_DAEMON"
+
+
+// Listen on Unix domain socket `socket_name' (created with mode 0600) and
+// start `workers' long-lived worker processes (value 0 means the number of
+// available processors), replacing workers which die.  This function only
+// returns in a worker, which then processes one job after another with
+// `daemon_accept_job' and `daemon_finish_job'.  On errors, the program
+// gets aborted.
+
+void
+daemon_serve(const char* socket_name,
+             int workers);
+
+
+// Wait in a worker for the next job of a client running under the same
+// user as the daemon; `job_args' receives the client's command line
+// arguments.  The client's standard input, output, and error are already
+// redirected, and the current directory is the client's one.
+
+void
+daemon_accept_job(std::vector<std::string>& job_args);
+
+
+// Send `exit_code' to the client of the current job and restore the
+// worker's standard input, output, and error.
+
+void
+daemon_finish_job(int exit_code);
+
+
+// If environment variable `TTFAUTOHINT_DAEMON' is set and a daemon
+// listens on the given socket, let it process our command line and exit
+// with its exit code.  Otherwise, simply return.
+
+void
+daemon_forward(int argc,
+               char** argv);
+
+#endif // HAVE_UNIX_SOCKETS
+
+#endif // __DAEMON_H__
+
+// end of daemon.h
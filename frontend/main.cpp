@@ -39,6 +39,8 @@
 #  include "maingui.h"
 #else
 #  include "info.h"
+#  include "daemon.h"
+#  include "watch.h"
 #endif
 
 #include <ttfautohint.h>
@@ -61,7 +63,79 @@
 using namespace std;
 
 
+#if !defined(BUILD_GUI) && defined(HAVE_UNIX_SOCKETS)
+// set in a long-lived daemon worker which processes the clients' jobs;
+// the context keeps the FreeType library, the memory pool, and the glyph
+// cache of the library between jobs
+static bool is_daemon_job = false;
+static vector<string> daemon_job_args;
+static TA_Context* daemon_context = NULL;
+
+// thrown by `job_exit' to end a job of a daemon worker
+struct Job_Exit
+{
+  int exit_code;
+};
+#endif
+
+
+// exit the program, or end the current job of a daemon worker
+
+static void
+job_exit(int exit_code)
+{
+#if !defined(BUILD_GUI) && defined(HAVE_UNIX_SOCKETS)
+  if (is_daemon_job)
+  {
+    Job_Exit e = {exit_code};
+    throw e;
+  }
+#endif
+
+  exit(exit_code);
+}
+
+
 #ifndef BUILD_GUI
+// the resources acquired while processing the command line; a daemon
+// worker gets them released by the destructor even if a job ends early
+
+struct Job_Resources
+{
+  FILE* in;
+  FILE* out;
+  number_range* x_height_snapping_exceptions;
+  char* shard_buf;
+  TA_Glyph_Cache* glyph_cache;
+  int watch_fd;
+
+  Job_Resources()
+  : in(NULL),
+    out(NULL),
+    x_height_snapping_exceptions(NULL),
+    shard_buf(NULL),
+    glyph_cache(NULL),
+    watch_fd(-1)
+  {
+  }
+
+  ~Job_Resources()
+  {
+    if (in && in != stdin)
+      fclose(in);
+    if (out && out != stdout)
+      fclose(out);
+
+    number_set_free(x_height_snapping_exceptions);
+    free(shard_buf);
+    TTF_autohint_glyph_cache_free(glyph_cache);
+
+    if (watch_fd >= 0)
+      close(watch_fd);
+  }
+};
+
+
 extern "C" {
 
 typedef struct Progress_Data_
@@ -72,6 +146,25 @@ typedef struct Progress_Data_
 } Progress_Data;
 
 
+typedef struct Bound_Data_
+{
+  int max_bound;
+  long max_glyph_idx;
+  long max_sfnt;
+} Bound_Data;
+
+typedef struct Budget_Data_
+{
+  long budget;
+  unsigned long num_glyphs; // glyphs exceeding the budget
+  unsigned long num_over; // glyphs still exceeding it after merging
+  long saved;
+  int max_deviation;
+  long max_glyph_idx;
+  long max_sfnt;
+} Budget_Data;
+
+
 int
 progress(long curr_idx,
          long num_glyphs,
@@ -112,10 +205,100 @@ progress(long curr_idx,
   return 0;
 }
 
+
+void
+limit(long glyph_idx,
+      long curr_sfnt,
+      int limit,
+      void* user)
+{
+  Progress_Data* data = (Progress_Data*)user;
+  const char* reason;
+
+  switch (limit)
+  {
+  case TA_LIMIT_POINTS:
+    reason = "too many points";
+    break;
+  case TA_LIMIT_SEGMENTS:
+    reason = "too many segments";
+    break;
+  case TA_LIMIT_GLYPH_TIME:
+    reason = "glyph time limit exceeded";
+    break;
+  default:
+    reason = "font time limit exceeded";
+  }
+
+  if (data->last_sfnt >= 0)
+    fprintf(stderr, "\n  subfont %ld, glyph %ld: %s, only scaled\n   ",
+                    curr_sfnt + 1, glyph_idx, reason);
+  else
+    fprintf(stderr, "\n  glyph %ld: %s, only scaled\n   ",
+                    glyph_idx, reason);
+}
+
+
+void
+bound(long glyph_idx,
+      long curr_sfnt,
+      int bound,
+      void* user)
+{
+  Bound_Data* data = (Bound_Data*)user;
+
+  if (bound > data->max_bound)
+  {
+    data->max_bound = bound;
+    data->max_glyph_idx = glyph_idx;
+    data->max_sfnt = curr_sfnt;
+  }
+}
+
+
+void
+budget(long glyph_idx,
+       long curr_sfnt,
+       long old_len,
+       long new_len,
+       int deviation,
+       void* user)
+{
+  Budget_Data* data = (Budget_Data*)user;
+
+  data->num_glyphs++;
+  if (new_len > data->budget)
+    data->num_over++;
+  data->saved += old_len - new_len;
+
+  if (deviation > data->max_deviation)
+  {
+    data->max_deviation = deviation;
+    data->max_glyph_idx = glyph_idx;
+    data->max_sfnt = curr_sfnt;
+  }
+}
+
 } // extern "C"
 #endif // !BUILD_GUI
 
 
+#if !defined(BUILD_GUI) && defined(HAVE_INOTIFY)
+// wait for the next change of the input font in watch mode
+
+static void
+wait_for_change(int watch_fd,
+                const char* file_name)
+{
+  if (!watch_wait(watch_fd, file_name))
+  {
+    fprintf(stderr, "Can't watch font `%s' any longer\n", file_name);
+    job_exit(EXIT_FAILURE);
+  }
+}
+#endif
+
+
 #ifdef CONSOLE_OUTPUT
 static void
 show_help(bool
@@ -159,12 +342,48 @@ show_help(bool
   fprintf(handle,
 "Options:\n"
 #ifndef BUILD_GUI
+#  ifdef HAVE_UNIX_SOCKETS
+"      --daemon=SOCKET        process the jobs of clients connecting to\n"
+"                             Unix domain socket SOCKET\n"
+"      --daemon-workers=N     let the daemon run N workers, processing\n"
+"                             up to N jobs in parallel\n"
+"                             (default: 0, the number of processors)\n"
+#  endif
 "      --debug                print debugging information\n"
 #endif
 "  -c, --components           hint glyph components separately\n"
+"  -d, --device-metrics       recompute `hdmx', `LTSH', and `VDMX' tables\n"
 "  -f, --latin-fallback       set fallback script to latin\n"
+#ifndef BUILD_GUI
+"      --exact-maxp           compute exact `maxp' limits by analyzing\n"
+"                             the bytecode (slower)\n"
+"      --font-time-limit=MS   only scale remaining glyphs after MS\n"
+"                             milliseconds (default: 0, no limit)\n"
+#endif
 "  -G, --hinting-limit=N      switch off hinting above this PPEM value\n"
 "                             (default: %d); value 0 means no limit\n"
+#ifndef BUILD_GUI
+"      --glyph-max-points=N   only scale glyphs with more than N points\n"
+"                             (default: 0, no limit)\n"
+"      --glyph-max-segments=N only scale glyphs with more than N segments\n"
+"                             (default: 0, no limit)\n"
+"      --glyph-size-budget=N  merge similar hint sets of glyphs whose\n"
+"                             bytecode exceeds N bytes\n"
+"                             (default: 0, no budget)\n"
+"      --glyph-size-budget-deviation=N\n"
+"                             the maximum change of a point position\n"
+"                             caused by merging, in 1/64th pixel\n"
+"                             (default: %d)\n"
+"      --glyph-time-limit=MS  only scale a glyph if hinting it takes\n"
+"                             more than MS milliseconds\n"
+"                             (default: 0, no limit)\n"
+"      --hinting-convergence=N\n"
+"                             stop hinting a glyph at larger PPEM values\n"
+"                             if its hints haven't changed for N sizes\n"
+"                             (default: 0, hint the whole range)\n"
+"      --hinting-sizes=S      only hint PPEM values in number set S\n"
+"                             (default: all values of the hinting range)\n"
+#endif
 "  -h, --help                 display this help and exit\n"
 #ifdef BUILD_GUI
 "      --help-all             show Qt and X11 specific options also\n"
@@ -172,16 +391,52 @@ show_help(bool
 "  -i, --ignore-restrictions  override font license restrictions\n"
 "  -l, --hinting-range-min=N  the minimum PPEM value for hint sets\n"
 "                             (default: %d)\n"
+#ifndef BUILD_GUI
+"      --memory-limit=N       abort if more than N MByte are needed\n"
+"                             (default: 0, no limit)\n"
+"      --merge-shards=FILE    assemble the output font from the\n"
+"                             (concatenated) shards in FILE\n"
+#endif
 "  -n, --no-info              don't add ttfautohint info\n"
 "                             to the version string(s) in the `name' table\n"
+#ifndef BUILD_GUI
+"      --output-format=F      write output font in format F, which is\n"
+"                             either `sfnt', `woff', or `woff2'\n"
+"                             (default: same format as input font)\n"
+#endif
 "  -p, --pre-hinting          apply original hints in advance\n",
-          TA_HINTING_LIMIT, TA_HINTING_RANGE_MIN);
+          TA_HINTING_LIMIT,
+#ifndef BUILD_GUI
+          TA_GLYPH_SIZE_BUDGET_DEVIATION,
+#endif
+          TA_HINTING_RANGE_MIN);
   fprintf(handle,
+#ifndef BUILD_GUI
+"      --pre-hinting-size=N   apply original hints at N PPEM\n"
+"                             (default: 0, the em-size in font units)\n"
+#endif
 "  -r, --hinting-range-max=N  the maximum PPEM value for hint sets\n"
 "                             (default: %d)\n"
+#ifndef BUILD_GUI
+"      --reproducible         don't use the current time as the font's\n"
+"                             modification time stamp; instead, use\n"
+"                             `SOURCE_DATE_EPOCH' or keep the input value\n"
+"      --shard=N-M            only hint glyphs N to M-1 and output a shard\n"
+"                             instead of a font\n"
+"      --streaming            write hinted glyphs directly to the output\n"
+"                             file to reduce memory consumption\n"
+#endif
 "  -s, --symbol               input is symbol font\n"
+#ifndef BUILD_GUI
+"      --threads=N            hint up to N subfonts of a TTC in parallel\n"
+"                             (default: 0, no threads)\n"
+#endif
 "  -v, --verbose              show progress information\n"
 "  -V, --version              print version information and exit\n"
+#if !defined(BUILD_GUI) && defined(HAVE_INOTIFY)
+"      --watch                after processing, wait for changes of IN-FILE\n"
+"                             and update OUT-FILE, hinting changed glyphs only\n"
+#endif
 "  -w, --strong-stem-width=S  use strong stem width routine for modes S,\n"
 "                             where S is a string of up to three letters\n"
 "                             with possible values `g' for grayscale,\n"
@@ -252,6 +507,12 @@ show_help(bool
   }
 #endif // BUILD_GUI
 
+#if !defined(BUILD_GUI) && defined(HAVE_UNIX_SOCKETS)
+  fprintf(handle,
+"If environment variable `" DAEMON_SOCKET_VARIABLE "' is set to the socket\n"
+"of a running daemon, the daemon processes the command line instead.\n"
+"\n");
+#endif
   fprintf(handle,
 "The program accepts both TTF and TTC files as input.\n"
 "Use option -i only if you have a legal permission to modify the font.\n"
@@ -278,9 +539,9 @@ show_help(bool
 "ttfautohint home page: <http://www.freetype.org/ttfautohint>\n");
 
   if (is_error)
-    exit(EXIT_FAILURE);
+    job_exit(EXIT_FAILURE);
   else
-    exit(EXIT_SUCCESS);
+    job_exit(EXIT_SUCCESS);
 }
 
 
@@ -298,14 +559,14 @@ show_version()
 "This is free software: you are free to change and redistribute it.\n"
 "There is NO WARRANTY, to the extent permitted by law.\n");
 
-  exit(EXIT_SUCCESS);
+  job_exit(EXIT_SUCCESS);
 }
 #endif // CONSOLE_OUTPUT
 
 
-int
-main(int argc,
-     char** argv)
+static int
+autohint(int argc,
+         char** argv)
 {
   int hinting_range_min = 0;
   int hinting_range_max = 0;
@@ -327,15 +588,61 @@ main(int argc,
   bool no_info = false;
   int latin_fallback = 0; // leave it as int; this probably gets extended
   bool symbol = false;
+  bool device_metrics = false;
 
   const char* x_height_snapping_exceptions_string = NULL;
   bool have_x_height_snapping_exceptions_string = false;
 
 #ifndef BUILD_GUI
+  Job_Resources job;
+
   bool debug = false;
 
+#  ifdef HAVE_UNIX_SOCKETS
+  const char* daemon_socket = NULL;
+  int daemon_workers = 0;
+#  endif
+  TA_Context* context = NULL;
+
   TA_Progress_Func progress_func = NULL;
   TA_Info_Func info_func = info;
+  TA_Limit_Func limit_func = NULL;
+  TA_Bound_Func bound_func = NULL;
+  TA_Budget_Func budget_func = NULL;
+
+  const char* hinting_sizes_string = "";
+  int hinting_convergence = 0;
+  unsigned int output_format = 0;
+  bool reproducible = false;
+  unsigned char output_hash[TA_OUTPUT_HASH_LEN];
+  unsigned long duplicate_glyphs = 0;
+
+  bool streaming = false;
+  int memory_limit = 0;
+  bool exact_maxp = false;
+
+  int threads = 0;
+  int pre_hinting_size = 0;
+
+  TA_Glyph_Cache*& glyph_cache = job.glyph_cache;
+  unsigned long cached_glyphs = 0;
+#  ifdef HAVE_INOTIFY
+  bool watch = false;
+  int& watch_fd = job.watch_fd;
+#  endif
+
+  unsigned int shard_first = 0;
+  unsigned int shard_last = 0;
+  const char* merge_shards_file = NULL;
+  char*& shard_buf = job.shard_buf;
+  size_t shard_len = 0;
+
+  int glyph_max_points = 0;
+  int glyph_max_segments = 0;
+  int glyph_time_limit = 0;
+  int font_time_limit = 0;
+  int glyph_size_budget = 0;
+  int glyph_size_budget_deviation = TA_GLYPH_SIZE_BUDGET_DEVIATION;
 #endif
 
   // make GNU, Qt, and X11 command line options look the same;
@@ -353,7 +660,27 @@ main(int argc,
     {
       PASS_THROUGH = CHAR_MAX + 1,
       HELP_ALL_OPTION,
-      DEBUG_OPTION
+      DAEMON_OPTION,
+      DAEMON_WORKERS_OPTION,
+      DEBUG_OPTION,
+      EXACT_MAXP_OPTION,
+      FONT_TIME_LIMIT_OPTION,
+      GLYPH_MAX_POINTS_OPTION,
+      GLYPH_MAX_SEGMENTS_OPTION,
+      GLYPH_SIZE_BUDGET_OPTION,
+      GLYPH_SIZE_BUDGET_DEVIATION_OPTION,
+      GLYPH_TIME_LIMIT_OPTION,
+      HINTING_CONVERGENCE_OPTION,
+      HINTING_SIZES_OPTION,
+      MEMORY_LIMIT_OPTION,
+      MERGE_SHARDS_OPTION,
+      OUTPUT_FORMAT_OPTION,
+      PRE_HINTING_SIZE_OPTION,
+      REPRODUCIBLE_OPTION,
+      SHARD_OPTION,
+      STREAMING_OPTION,
+      THREADS_OPTION,
+      WATCH_OPTION
     };
 
     static struct option long_options[] =
@@ -366,20 +693,63 @@ main(int argc,
       // ttfautohint options
       {"components", no_argument, NULL, 'c'},
 #ifndef BUILD_GUI
+#  ifdef HAVE_UNIX_SOCKETS
+      {"daemon", required_argument, NULL, DAEMON_OPTION},
+      {"daemon-workers", required_argument, NULL, DAEMON_WORKERS_OPTION},
+#  endif
       {"debug", no_argument, NULL, DEBUG_OPTION},
+#endif
+      {"device-metrics", no_argument, NULL, 'd'},
+#ifndef BUILD_GUI
+      {"exact-maxp", no_argument, NULL, EXACT_MAXP_OPTION},
+      {"font-time-limit", required_argument, NULL, FONT_TIME_LIMIT_OPTION},
+      {"glyph-max-points", required_argument, NULL, GLYPH_MAX_POINTS_OPTION},
+      {"glyph-max-segments", required_argument, NULL,
+       GLYPH_MAX_SEGMENTS_OPTION},
+      {"glyph-size-budget", required_argument, NULL,
+       GLYPH_SIZE_BUDGET_OPTION},
+      {"glyph-size-budget-deviation", required_argument, NULL,
+       GLYPH_SIZE_BUDGET_DEVIATION_OPTION},
+      {"glyph-time-limit", required_argument, NULL, GLYPH_TIME_LIMIT_OPTION},
 #endif
       {"hinting-limit", required_argument, NULL, 'G'},
+#ifndef BUILD_GUI
+      {"hinting-convergence", required_argument, NULL,
+       HINTING_CONVERGENCE_OPTION},
+      {"hinting-sizes", required_argument, NULL, HINTING_SIZES_OPTION},
+#endif
       {"hinting-range-max", required_argument, NULL, 'r'},
       {"hinting-range-min", required_argument, NULL, 'l'},
       {"ignore-restrictions", no_argument, NULL, 'i'},
       {"increase-x-height", required_argument, NULL, 'x'},
       {"latin-fallback", no_argument, NULL, 'f'},
+#ifndef BUILD_GUI
+      {"memory-limit", required_argument, NULL, MEMORY_LIMIT_OPTION},
+      {"merge-shards", required_argument, NULL, MERGE_SHARDS_OPTION},
+#endif
       {"no-info", no_argument, NULL, 'n'},
+#ifndef BUILD_GUI
+      {"output-format", required_argument, NULL, OUTPUT_FORMAT_OPTION},
+#endif
       {"pre-hinting", no_argument, NULL, 'p'},
+#ifndef BUILD_GUI
+      {"pre-hinting-size", required_argument, NULL, PRE_HINTING_SIZE_OPTION},
+#endif
+#ifndef BUILD_GUI
+      {"reproducible", no_argument, NULL, REPRODUCIBLE_OPTION},
+      {"shard", required_argument, NULL, SHARD_OPTION},
+      {"streaming", no_argument, NULL, STREAMING_OPTION},
+#endif
       {"strong-stem-width", required_argument, NULL, 'w'},
       {"symbol", no_argument, NULL, 's'},
+#ifndef BUILD_GUI
+      {"threads", required_argument, NULL, THREADS_OPTION},
+#endif
       {"verbose", no_argument, NULL, 'v'},
       {"version", no_argument, NULL, 'V'},
+#if !defined(BUILD_GUI) && defined(HAVE_INOTIFY)
+      {"watch", no_argument, NULL, WATCH_OPTION},
+#endif
       {"windows-compatibility", no_argument, NULL, 'W'},
       {"x-height-snapping-exceptions", required_argument, NULL, 'X'},
 
@@ -413,7 +783,7 @@ main(int argc,
     };
 
     int option_index;
-    int c = getopt_long_only(argc, argv, "cfG:hil:npr:stVvw:Wx:X:",
+    int c = getopt_long_only(argc, argv, "cdfG:hil:npr:stVvw:Wx:X:",
                              long_options, &option_index);
     if (c == -1)
       break;
@@ -424,6 +794,10 @@ main(int argc,
       hint_with_components = false;
       break;
 
+    case 'd':
+      device_metrics = true;
+      break;
+
     case 'f':
       latin_fallback = 1;
       break;
@@ -468,6 +842,9 @@ main(int argc,
     case 'v':
 #ifndef BUILD_GUI
       progress_func = progress;
+      limit_func = limit;
+      bound_func = bound;
+      budget_func = budget;
 #endif
       break;
 
@@ -498,9 +875,111 @@ main(int argc,
       break;
 
 #ifndef BUILD_GUI
+#  ifdef HAVE_UNIX_SOCKETS
+    case DAEMON_OPTION:
+      daemon_socket = optarg;
+      break;
+
+    case DAEMON_WORKERS_OPTION:
+      daemon_workers = atoi(optarg);
+      break;
+#  endif
+
     case DEBUG_OPTION:
       debug = true;
       break;
+
+    case EXACT_MAXP_OPTION:
+      exact_maxp = true;
+      break;
+
+    case FONT_TIME_LIMIT_OPTION:
+      font_time_limit = atoi(optarg);
+      break;
+
+    case GLYPH_MAX_POINTS_OPTION:
+      glyph_max_points = atoi(optarg);
+      break;
+
+    case GLYPH_MAX_SEGMENTS_OPTION:
+      glyph_max_segments = atoi(optarg);
+      break;
+
+    case GLYPH_SIZE_BUDGET_OPTION:
+      glyph_size_budget = atoi(optarg);
+      break;
+
+    case GLYPH_SIZE_BUDGET_DEVIATION_OPTION:
+      glyph_size_budget_deviation = atoi(optarg);
+      break;
+
+    case GLYPH_TIME_LIMIT_OPTION:
+      glyph_time_limit = atoi(optarg);
+      break;
+
+    case HINTING_CONVERGENCE_OPTION:
+      hinting_convergence = atoi(optarg);
+      break;
+
+    case HINTING_SIZES_OPTION:
+      hinting_sizes_string = optarg;
+      break;
+
+    case MEMORY_LIMIT_OPTION:
+      memory_limit = atoi(optarg);
+      break;
+
+    case MERGE_SHARDS_OPTION:
+      merge_shards_file = optarg;
+      break;
+
+    case OUTPUT_FORMAT_OPTION:
+      if (!strcmp(optarg, "sfnt"))
+        output_format = TA_FORMAT_SFNT;
+      else if (!strcmp(optarg, "woff"))
+        output_format = TA_FORMAT_WOFF;
+      else if (!strcmp(optarg, "woff2"))
+        output_format = TA_FORMAT_WOFF2;
+      else
+      {
+        fprintf(stderr, "Invalid output format `%s'"
+                        " for option `--output-format'\n",
+                        optarg);
+        job_exit(EXIT_FAILURE);
+      }
+      break;
+
+    case PRE_HINTING_SIZE_OPTION:
+      pre_hinting_size = atoi(optarg);
+      break;
+
+    case REPRODUCIBLE_OPTION:
+      reproducible = true;
+      break;
+
+    case SHARD_OPTION:
+      if (sscanf(optarg, "%u-%u", &shard_first, &shard_last) != 2
+          || shard_last <= shard_first)
+      {
+        fprintf(stderr, "Invalid glyph range `%s' for option `--shard'\n",
+                        optarg);
+        job_exit(EXIT_FAILURE);
+      }
+      break;
+
+    case STREAMING_OPTION:
+      streaming = true;
+      break;
+
+    case THREADS_OPTION:
+      threads = atoi(optarg);
+      break;
+
+#  ifdef HAVE_INOTIFY
+    case WATCH_OPTION:
+      watch = true;
+      break;
+#  endif
 #endif
 
 #ifdef BUILD_GUI
@@ -525,7 +1004,7 @@ main(int argc,
       }
 
     default:
-      exit(EXIT_FAILURE);
+      job_exit(EXIT_FAILURE);
     }
   }
 
@@ -542,36 +1021,107 @@ main(int argc,
 
 #ifndef BUILD_GUI
 
+#  ifdef HAVE_UNIX_SOCKETS
+  // all other options are ignored in daemon mode
+  if (daemon_socket)
+  {
+    if (is_daemon_job)
+    {
+      fprintf(stderr, "Option `--daemon' can't be used by a client\n");
+      job_exit(EXIT_FAILURE);
+    }
+    if (daemon_workers < 0)
+    {
+      fprintf(stderr, "The number of daemon workers must not be negative\n");
+      job_exit(EXIT_FAILURE);
+    }
+
+    // the workers inherit the context
+    daemon_context = TTF_autohint_context_new();
+    if (!daemon_context)
+    {
+      fprintf(stderr, "Can't allocate memory for the daemon workers\n");
+      job_exit(EXIT_FAILURE);
+    }
+
+    daemon_serve(daemon_socket, daemon_workers);
+
+    // we are now in a long-lived worker process
+    is_daemon_job = true;
+    return EXIT_SUCCESS;
+  }
+
+  context = daemon_context;
+#  endif
+
   if (!isatty(fileno(stderr)) && !debug)
     setvbuf(stderr, (char*)NULL, _IONBF, BUFSIZ);
 
   if (hinting_range_min < 2)
   {
     fprintf(stderr, "The hinting range minimum must be at least 2\n");
-    exit(EXIT_FAILURE);
+    job_exit(EXIT_FAILURE);
   }
   if (hinting_range_max < hinting_range_min)
   {
     fprintf(stderr, "The hinting range maximum must not be smaller"
                     " than the minimum (%d)\n",
                     hinting_range_min);
-    exit(EXIT_FAILURE);
+    job_exit(EXIT_FAILURE);
   }
   if (hinting_limit != 0 && hinting_limit < hinting_range_max)
   {
     fprintf(stderr, "A non-zero hinting limit must not be smaller"
                     " than the hinting range maximum (%d)\n",
                     hinting_range_max);
-    exit(EXIT_FAILURE);
+    job_exit(EXIT_FAILURE);
   }
   if (increase_x_height != 0 && increase_x_height < 6)
   {
     fprintf(stderr, "A non-zero x height increase limit"
                     " must be larger than or equal to 6\n");
-    exit(EXIT_FAILURE);
+    job_exit(EXIT_FAILURE);
+  }
+  if (glyph_max_points < 0
+      || glyph_max_segments < 0
+      || glyph_time_limit < 0
+      || font_time_limit < 0)
+  {
+    fprintf(stderr, "Glyph and font limits must not be negative\n");
+    job_exit(EXIT_FAILURE);
+  }
+  if (memory_limit < 0)
+  {
+    fprintf(stderr, "The memory limit must not be negative\n");
+    job_exit(EXIT_FAILURE);
+  }
+  if (hinting_convergence < 0)
+  {
+    fprintf(stderr, "The hinting convergence value must not be negative\n");
+    job_exit(EXIT_FAILURE);
+  }
+  if (glyph_size_budget < 0 || glyph_size_budget_deviation < 0)
+  {
+    fprintf(stderr, "The glyph size budget values must not be negative\n");
+    job_exit(EXIT_FAILURE);
+  }
+  if (threads < 0)
+  {
+    fprintf(stderr, "The number of threads must not be negative\n");
+    job_exit(EXIT_FAILURE);
+  }
+  if (pre_hinting_size < 0 || pre_hinting_size > 16384)
+  {
+    fprintf(stderr, "The pre-hinting size must be in the range 0-16384\n");
+    job_exit(EXIT_FAILURE);
   }
 
+#ifdef BUILD_GUI
   number_range* x_height_snapping_exceptions = NULL;
+#else
+  number_range*& x_height_snapping_exceptions =
+    job.x_height_snapping_exceptions;
+#endif
 
   if (have_x_height_snapping_exceptions_string)
   {
@@ -603,16 +1153,127 @@ main(int argc,
                         x_height_snapping_exceptions_string,
                         s - x_height_snapping_exceptions_string + 1, "^");
       }
-      exit(EXIT_FAILURE);
+
+      // this is an error code, not a number set
+      x_height_snapping_exceptions = NULL;
+      job_exit(EXIT_FAILURE);
+    }
+  }
+
+#ifndef BUILD_GUI
+  {
+    number_range* hinting_sizes = NULL;
+    const char* s;
+
+
+    s = number_set_parse(hinting_sizes_string,
+                         &hinting_sizes,
+                         hinting_range_min, hinting_range_max);
+    if (*s)
+    {
+      if (hinting_sizes == NUMBERSET_ALLOCATION_ERROR)
+        fprintf(stderr, "Allocation error while scanning hinting sizes\n");
+      else
+        fprintf(stderr, "Invalid hinting sizes"
+                        " (must be within the range %d-%d):\n"
+                        "  \"%s\"\n"
+                        "   %*s\n",
+                        hinting_range_min, hinting_range_max,
+                        hinting_sizes_string,
+                        int(s - hinting_sizes_string + 1), "^");
+      job_exit(EXIT_FAILURE);
+    }
+
+    number_set_free(hinting_sizes);
+  }
+
+  if (shard_last && merge_shards_file)
+  {
+    fprintf(stderr, "Options `--shard' and `--merge-shards'"
+                    " are mutually exclusive\n");
+    job_exit(EXIT_FAILURE);
+  }
+
+  if (streaming && (shard_last || merge_shards_file || device_metrics))
+  {
+    fprintf(stderr, "Option `--streaming' can't be used together with"
+                    " `--shard', `--merge-shards', or `--device-metrics'\n");
+    job_exit(EXIT_FAILURE);
+  }
+
+  if (reproducible && (glyph_time_limit || font_time_limit))
+  {
+    fprintf(stderr, "Option `--reproducible' can't be used together with"
+                    " `--glyph-time-limit' or `--font-time-limit'\n");
+    job_exit(EXIT_FAILURE);
+  }
+
+  if (merge_shards_file)
+  {
+    FILE* shards = fopen(merge_shards_file, "rb");
+    long len = -1;
+
+
+    if (shards
+        && !fseek(shards, 0, SEEK_END)
+        && (len = ftell(shards)) > 0
+        && !fseek(shards, 0, SEEK_SET))
+    {
+      shard_buf = (char*)malloc(len);
+      if (shard_buf)
+        shard_len = fread(shard_buf, 1, len, shards);
     }
+
+    if (!shard_len || shard_len != (size_t)len)
+    {
+      fprintf(stderr, "Can't read shard file `%s'\n", merge_shards_file);
+      if (shards)
+        fclose(shards);
+      job_exit(EXIT_FAILURE);
+    }
+
+    fclose(shards);
   }
+#endif
 
   int num_args = argc - optind;
 
   if (num_args > 2)
     show_help(false, true);
 
-  FILE* in;
+#  ifdef HAVE_INOTIFY
+  if (watch)
+  {
+    if (num_args != 2)
+    {
+      fprintf(stderr, "Option `--watch' needs an input and an output file\n");
+      job_exit(EXIT_FAILURE);
+    }
+
+    // start watching before the first run to not miss any change
+    watch_fd = watch_init(argv[optind]);
+    if (watch_fd < 0)
+    {
+      fprintf(stderr, "The following error occurred while watching font `%s':\n"
+                      "\n"
+                      "  %s\n",
+                      argv[optind], strerror(errno));
+      job_exit(EXIT_FAILURE);
+    }
+
+    glyph_cache = TTF_autohint_glyph_cache_new();
+    if (!glyph_cache)
+    {
+      fprintf(stderr, "Can't allocate memory for the glyph cache\n");
+      job_exit(EXIT_FAILURE);
+    }
+  }
+
+  // in watch mode, we come back here after every change of the input font
+Watch_Again:
+#  endif
+
+  FILE*& in = job.in;
   if (num_args > 0)
   {
     in = fopen(argv[optind], "rb");
@@ -622,7 +1283,14 @@ main(int argc,
                       "\n"
                       "  %s\n",
                       argv[optind], strerror(errno));
-      exit(EXIT_FAILURE);
+#  ifdef HAVE_INOTIFY
+      if (watch)
+      {
+        wait_for_change(watch_fd, argv[optind]);
+        goto Watch_Again;
+      }
+#  endif
+      job_exit(EXIT_FAILURE);
     }
   }
   else
@@ -632,13 +1300,13 @@ main(int argc,
     in = stdin;
   }
 
-  FILE* out;
+  FILE*& out = job.out;
   if (num_args > 1)
   {
     if (!strcmp(argv[optind], argv[optind + 1]))
     {
       fprintf(stderr, "Input and output file names must not be identical\n");
-      exit(EXIT_FAILURE);
+      job_exit(EXIT_FAILURE);
     }
 
     out = fopen(argv[optind + 1], "wb");
@@ -648,7 +1316,7 @@ main(int argc,
                       "\n"
                       "  %s\n",
                       argv[optind + 1], strerror(errno));
-      exit(EXIT_FAILURE);
+      job_exit(EXIT_FAILURE);
     }
   }
   else
@@ -658,8 +1326,17 @@ main(int argc,
     out = stdout;
   }
 
+  // we must be able to go back to the start of the output font
+  if (streaming && ftell(out) < 0)
+  {
+    fprintf(stderr, "Option `--streaming' needs a seekable output file\n");
+    job_exit(EXIT_FAILURE);
+  }
+
   const unsigned char* error_string;
   Progress_Data progress_data = {-1, 1, 0};
+  Bound_Data bound_data = {0, 0, 0};
+  Budget_Data budget_data = {glyph_size_budget, 0, 0, 0, 0, 0, 0};
   Info_Data info_data;
 
   if (no_info)
@@ -704,6 +1381,7 @@ main(int argc,
   TA_Error error =
     TTF_autohint("in-file, out-file,"
                  "hinting-range-min, hinting-range-max, hinting-limit,"
+                 "hinting-sizes, hinting-convergence,"
                  "gray-strong-stem-width, gdi-cleartype-strong-stem-width,"
                  "dw-cleartype-strong-stem-width,"
                  "error-string,"
@@ -713,9 +1391,20 @@ main(int argc,
                  "pre-hinting, hint-with-components,"
                  "increase-x-height, x-height-snapping-exceptions,"
                  "fallback-script, symbol,"
-                 "debug",
+                 "device-metrics, output-format, reproducible, output-hash,"
+                 "duplicate-glyphs, streaming, memory-limit, exact-maxp,"
+                 "shard-first, shard-last, shard-buffer, shard-buffer-len,"
+                 "glyph-max-points, glyph-max-segments,"
+                 "glyph-time-limit, font-time-limit,"
+                 "limit-callback, limit-callback-data,"
+                 "bound-callback, bound-callback-data,"
+                 "glyph-size-budget, glyph-size-budget-deviation,"
+                 "budget-callback, budget-callback-data,"
+                 "glyph-cache, cached-glyphs, context,"
+                 "pre-hinting-size, threads, debug",
                  in, out,
                  hinting_range_min, hinting_range_max, hinting_limit,
+                 hinting_sizes_string, (unsigned int)hinting_convergence,
                  gray_strong_stem_width, gdi_cleartype_strong_stem_width,
                  dw_cleartype_strong_stem_width,
                  &error_string,
@@ -725,6 +1414,20 @@ main(int argc,
                  pre_hinting, hint_with_components,
                  increase_x_height, x_height_snapping_exceptions_string,
                  latin_fallback, symbol,
+                 device_metrics, output_format, reproducible,
+                 streaming ? NULL : output_hash,
+                 &duplicate_glyphs, streaming,
+                 (size_t)memory_limit * 1024 * 1024, exact_maxp,
+                 shard_first, shard_last, shard_buf, shard_len,
+                 glyph_max_points, glyph_max_segments,
+                 glyph_time_limit, font_time_limit,
+                 limit_func, &progress_data,
+                 bound_func, &bound_data,
+                 (unsigned int)glyph_size_budget,
+                 (unsigned int)glyph_size_budget_deviation,
+                 budget_func, &budget_data,
+                 glyph_cache, &cached_glyphs, context,
+                 (unsigned int)pre_hinting_size, (unsigned int)threads,
                  debug);
 
   if (!no_info)
@@ -733,8 +1436,6 @@ main(int argc,
     free(info_data.data_wide);
   }
 
-  number_set_free(x_height_snapping_exceptions);
-
   if (error)
   {
     if (error == TA_Err_Invalid_FreeType_Version)
@@ -744,7 +1445,7 @@ main(int argc,
     else if (error == TA_Err_Invalid_Font_Type)
       fprintf(stderr,
               "This font is not a valid font"
-                " in SFNT format with TrueType outlines.\n"
+                " in SFNT, WOFF, or WOFF2 format with TrueType outlines.\n"
               "In particular, CFF outlines are not supported.\n");
     else if (error == TA_Err_Already_Processed)
       fprintf(stderr,
@@ -771,17 +1472,97 @@ main(int argc,
       fprintf(stderr,
               "Error code `0x%02x' while autohinting font:\n"
               "  %s\n", error, error_string);
-    exit(EXIT_FAILURE);
+
+#  ifdef HAVE_INOTIFY
+    // the font editor might have saved an incomplete font
+    if (watch)
+    {
+      fclose(in);
+      fclose(out);
+      in = NULL;
+      out = NULL;
+
+      wait_for_change(watch_fd, argv[optind]);
+      goto Watch_Again;
+    }
+#  endif
+    job_exit(EXIT_FAILURE);
+  }
+
+  if (progress_func)
+  {
+    // in streaming mode, the output font is never completely in memory
+    if (!streaming)
+    {
+      fprintf(stderr, "output SHA-256: ");
+      for (int i = 0; i < TA_OUTPUT_HASH_LEN; i++)
+        fprintf(stderr, "%02x", output_hash[i]);
+      fprintf(stderr, "\n");
+    }
+
+    if (duplicate_glyphs)
+      fprintf(stderr, "%lu duplicate glyphs hinted only once\n",
+              duplicate_glyphs);
+    if (cached_glyphs)
+      fprintf(stderr, "%lu unchanged glyphs taken from the glyph cache\n",
+              cached_glyphs);
+
+    // this helps find a sensible value for `--hinting-range-max'
+    if (bound_data.max_bound)
+    {
+      if (progress_data.last_sfnt >= 0)
+        fprintf(stderr, "largest effective hinting range maximum: %d"
+                        " (subfont %ld, glyph %ld)\n",
+                bound_data.max_bound,
+                bound_data.max_sfnt + 1, bound_data.max_glyph_idx);
+      else
+        fprintf(stderr, "largest effective hinting range maximum: %d"
+                        " (glyph %ld)\n",
+                bound_data.max_bound, bound_data.max_glyph_idx);
+    }
+
+    if (budget_data.num_glyphs)
+    {
+      fprintf(stderr, "glyph size budget: %lu glyphs exceeded %ld bytes,"
+                      " %ld bytes saved by merging hint sets\n",
+              budget_data.num_glyphs, budget_data.budget,
+              budget_data.saved);
+      if (budget_data.num_over)
+        fprintf(stderr, "  %lu glyphs are still larger\n",
+                budget_data.num_over);
+      if (budget_data.max_deviation)
+      {
+        if (progress_data.last_sfnt >= 0)
+          fprintf(stderr, "  largest point deviation: %.2fpx"
+                          " (subfont %ld, glyph %ld)\n",
+                  budget_data.max_deviation / 64.0,
+                  budget_data.max_sfnt + 1, budget_data.max_glyph_idx);
+        else
+          fprintf(stderr, "  largest point deviation: %.2fpx"
+                          " (glyph %ld)\n",
+                  budget_data.max_deviation / 64.0,
+                  budget_data.max_glyph_idx);
+      }
+    }
   }
 
   if (in != stdin)
     fclose(in);
   if (out != stdout)
     fclose(out);
+  in = NULL;
+  out = NULL;
 
-  exit(EXIT_SUCCESS);
+#  ifdef HAVE_INOTIFY
+  if (watch)
+  {
+    wait_for_change(watch_fd, argv[optind]);
+    goto Watch_Again;
+  }
+#  endif
 
-  return 0; // never reached
+  // `job' releases the remaining resources
+  return EXIT_SUCCESS;
 
 #else // BUILD_GUI
 
@@ -811,4 +1592,46 @@ main(int argc,
 #endif // BUILD_GUI
 }
 
+
+int
+main(int argc,
+     char** argv)
+{
+#if !defined(BUILD_GUI) && defined(HAVE_UNIX_SOCKETS)
+  // let a running daemon do the work if possible
+  daemon_forward(argc, argv);
+
+  int exit_code = autohint(argc, argv);
+  if (!is_daemon_job)
+    return exit_code;
+
+  // in daemon mode, `autohint' only returns in a worker process,
+  // which processes the clients' jobs one after another
+  for (;;)
+  {
+    daemon_accept_job(daemon_job_args);
+
+    vector<char*> job_argv;
+    for (size_t i = 0; i < daemon_job_args.size(); i++)
+      job_argv.push_back(const_cast<char*>(daemon_job_args[i].c_str()));
+    job_argv.push_back(NULL);
+
+    optind = 0; // reinitialize `getopt_long_only'
+
+    try
+    {
+      exit_code = autohint(daemon_job_args.size(), &job_argv[0]);
+    }
+    catch (Job_Exit& e)
+    {
+      exit_code = e.exit_code;
+    }
+
+    daemon_finish_job(exit_code);
+  }
+#else
+  return autohint(argc, argv);
+#endif
+}
+
 // end of main.cpp
@@ -21,6 +21,7 @@
 
 #include "info.h"
 #include "maingui.h"
+#include "preview.h"
 
 #include <ttfautohint.h>
 
@@ -37,6 +38,11 @@
 #endif
 
 
+// the time in milliseconds the preview waits for further option changes
+// before starting a new hinting run
+#define PREVIEW_DELAY 100
+
+
 Main_GUI::Main_GUI(int range_min,
                    int range_max,
                    int limit,
@@ -70,6 +76,19 @@ Main_GUI::Main_GUI(int range_min,
 {
   x_height_snapping_exceptions = NULL;
 
+  preview_pool = new QThreadPool(this);
+  preview_pool->setMaxThreadCount(1);
+  preview_timer = new QTimer(this);
+  preview_timer->setSingleShot(true);
+  preview_timer->setInterval(PREVIEW_DELAY);
+  preview_job = NULL;
+  preview_pending = false;
+  // without a glyph cache or a preview state,
+  // the preview still works, just slower
+  glyph_cache = TTF_autohint_glyph_cache_new();
+  preview = TTF_autohint_preview_new();
+  preview_subfont = 0;
+
   create_layout();
   create_connections();
   create_actions();
@@ -92,6 +111,8 @@ Main_GUI::Main_GUI(int range_min,
 Main_GUI::~Main_GUI()
 {
   number_set_free(x_height_snapping_exceptions);
+  TTF_autohint_preview_free(preview);
+  TTF_autohint_glyph_cache_free(glyph_cache);
 }
 
 
@@ -100,6 +121,51 @@ Main_GUI::~Main_GUI()
 void
 Main_GUI::closeEvent(QCloseEvent* event)
 {
+  if (!jobs.isEmpty())
+  {
+    int ret = QMessageBox::warning(
+                this,
+                "TTFautohint",
+                tr("%n font(s) still being processed.\n"
+                   "Cancel and exit?", "", jobs.size()),
+                QMessageBox::Yes | QMessageBox::No,
+                QMessageBox::No);
+    if (ret == QMessageBox::No)
+    {
+      event->ignore();
+      return;
+    }
+
+    QMap<Hinting_Job*, QProgressDialog*>::const_iterator it;
+
+    for (it = jobs.constBegin(); it != jobs.constEnd(); it++)
+      it.key()->cancel();
+    QThreadPool::globalInstance()->waitForDone();
+
+    // signal `finished' doesn't get delivered anymore
+    for (it = jobs.constBegin(); it != jobs.constEnd(); it++)
+    {
+      Hinting_Job* job = it.key();
+
+      if (job->error && QFile::exists(job->output_name))
+        remove(qPrintable(job->output_name));
+
+      delete it.value();
+      delete job;
+    }
+    jobs.clear();
+  }
+
+  // a running preview job still uses the glyph cache and the preview state
+  if (preview_job)
+  {
+    preview_job->cancel();
+    preview_pool->waitForDone();
+
+    delete preview_job;
+    preview_job = NULL;
+  }
+
   write_settings();
   event->accept();
 }
@@ -435,6 +501,8 @@ Main_GUI::open_files(const QString& input_name,
   *out = fopen(qPrintable(output_name), "wb");
   if (!*out)
   {
+    fclose(*in);
+
     strerror_r(errno, buf, buf_len);
     QMessageBox::warning(
       this,
@@ -453,14 +521,6 @@ Main_GUI::open_files(const QString& input_name,
 
 extern "C" {
 
-struct GUI_Progress_Data
-{
-  long last_sfnt;
-  bool begin;
-  QProgressDialog* dialog;
-};
-
-
 int
 gui_progress(long curr_idx,
              long num_glyphs,
@@ -468,56 +528,301 @@ gui_progress(long curr_idx,
              long num_sfnts,
              void* user)
 {
-  GUI_Progress_Data* data = (GUI_Progress_Data*)user;
+  Hinting_Job* job = (Hinting_Job*)user;
+
+  return job->report_progress(curr_idx, num_glyphs, curr_sfnt, num_sfnts);
+}
 
-  if (num_sfnts > 1 && curr_sfnt != data->last_sfnt)
+} // extern "C"
+
+
+Hinting_Job::Hinting_Job(const QString& in_name,
+                         FILE* in,
+                         const QString& out_name,
+                         FILE* out,
+                         const Info_Data& idata,
+                         bool with_info,
+                         bool ignore,
+                         const QByteArray& snapping)
+: input_name(in_name),
+  output_name(out_name),
+  info_data(idata),
+  have_info(with_info),
+  ignore_restrictions(ignore),
+  snapping_string(snapping),
+  error(TA_Err_Ok),
+  input(in),
+  output(out),
+  canceled(0),
+  last_sfnt(-1),
+  last_value(0),
+  step(1)
+{
+  // we delete the job ourselves after evaluating the result
+  setAutoDelete(false);
+}
+
+
+Hinting_Job::~Hinting_Job()
+{
+  free(info_data.data);
+  free(info_data.data_wide);
+}
+
+
+// this function gets called from the GUI thread
+
+void
+Hinting_Job::cancel()
+{
+  canceled = 1;
+}
+
+
+// this function and the following one get called from a worker thread
+
+int
+Hinting_Job::report_progress(long curr_idx,
+                             long num_glyphs,
+                             long curr_sfnt,
+                             long num_sfnts)
+{
+  if (curr_sfnt != last_sfnt)
   {
-    data->dialog->setLabelText(QCoreApplication::translate(
-                                 "GuiProgress",
-                                 "Auto-hinting subfont %1 of %2"
-                                 " with %3 glyphs...")
-                               .arg(curr_sfnt + 1)
-                               .arg(num_sfnts)
-                               .arg(num_glyphs));
-
-    if (curr_sfnt + 1 == num_sfnts)
-    {
-      data->dialog->setAutoReset(true);
-      data->dialog->setAutoClose(true);
-    }
+    if (num_sfnts > 1)
+      emit label_changed(QCoreApplication::translate(
+                           "GuiProgress",
+                           "Auto-hinting subfont %1 of %2"
+                           " with %3 glyphs...")
+                         .arg(curr_sfnt + 1)
+                         .arg(num_sfnts)
+                         .arg(num_glyphs));
     else
-    {
-      data->dialog->setAutoReset(false);
-      data->dialog->setAutoClose(false);
-    }
-
-    data->last_sfnt = curr_sfnt;
-    data->begin = true;
+      emit label_changed(QCoreApplication::translate(
+                           "GuiProgress",
+                           "Auto-hinting %1 glyphs...")
+                         .arg(num_glyphs));
+    emit maximum_changed(num_glyphs - 1);
+
+    // signals are queued for the GUI thread,
+    // so we only report about every percent
+    step = num_glyphs / 100;
+    if (step < 1)
+      step = 1;
+
+    last_sfnt = curr_sfnt;
+    last_value = -step;
   }
 
-  if (data->begin)
+  if (curr_idx - last_value >= step || curr_idx + 1 == num_glyphs)
   {
-    if (num_sfnts == 1)
-      data->dialog->setLabelText(QCoreApplication::translate(
-                                   "GuiProgress",
-                                   "Auto-hinting %1 glyphs...")
-                                 .arg(num_glyphs));
-    data->dialog->setMaximum(num_glyphs - 1);
-
-    data->begin = false;
+    emit value_changed(curr_idx);
+    last_value = curr_idx;
   }
 
-  data->dialog->setValue(curr_idx);
-
-  if (data->dialog->wasCanceled())
+  if (canceled)
     return 1;
 
   return 0;
 }
 
+
+void
+Hinting_Job::run()
+{
+  const unsigned char* error_str = NULL;
+  TA_Info_Func info_func = NULL;
+
+  if (have_info)
+    info_func = info;
+
+  if (canceled)
+    error = TA_Err_Canceled;
+  else
+    error =
+      TTF_autohint("in-file, out-file,"
+                   "hinting-range-min, hinting-range-max,"
+                   "hinting-limit,"
+                   "gray-strong-stem-width,"
+                   "gdi-cleartype-strong-stem-width,"
+                   "dw-cleartype-strong-stem-width,"
+                   "error-string,"
+                   "progress-callback, progress-callback-data,"
+                   "info-callback, info-callback-data,"
+                   "ignore-restrictions,"
+                   "windows-compatibility,"
+                   "pre-hinting,"
+                   "hint-with-components,"
+                   "increase-x-height,"
+                   "x-height-snapping-exceptions,"
+                   "fallback-script, symbol",
+                   input, output,
+                   info_data.hinting_range_min, info_data.hinting_range_max,
+                   info_data.hinting_limit,
+                   info_data.gray_strong_stem_width,
+                   info_data.gdi_cleartype_strong_stem_width,
+                   info_data.dw_cleartype_strong_stem_width,
+                   &error_str,
+                   gui_progress, this,
+                   info_func, &info_data,
+                   ignore_restrictions,
+                   info_data.windows_compatibility,
+                   info_data.pre_hinting,
+                   info_data.hint_with_components,
+                   info_data.increase_x_height,
+                   snapping_string.constData(),
+                   info_data.latin_fallback, info_data.symbol);
+
+  if (error_str)
+    error_string = (const char*)error_str;
+
+  fclose(input);
+  fclose(output);
+
+  emit finished();
+}
+
+
+extern "C" {
+
+int
+gui_preview_progress(long,
+                     long,
+                     long,
+                     long,
+                     void* user)
+{
+  Preview_Job* job = (Preview_Job*)user;
+
+  return job->check_canceled();
+}
+
 } // extern "C"
 
 
+Preview_Job::Preview_Job(const QByteArray& in,
+                         const Info_Data& idata,
+                         const QByteArray& snapping,
+                         const QByteArray& glyphs,
+                         TA_Glyph_Cache* cache,
+                         TA_Preview* state,
+                         bool complete)
+: input(in),
+  info_data(idata),
+  snapping_string(snapping),
+  glyphs_string(glyphs),
+  glyph_cache(cache),
+  preview(state),
+  full(complete),
+  error(TA_Err_Ok),
+  canceled(0)
+{
+  // we delete the job ourselves after evaluating the result
+  setAutoDelete(false);
+}
+
+
+// this function gets called from the GUI thread
+
+void
+Preview_Job::cancel()
+{
+  canceled = 1;
+}
+
+
+// this function and the following one get called from a worker thread
+
+int
+Preview_Job::check_canceled()
+{
+  if (canceled)
+    return 1;
+
+  return 0;
+}
+
+
+void
+Preview_Job::run()
+{
+  const unsigned char* error_str = NULL;
+  char* out_buf = NULL;
+  size_t out_len = 0;
+
+  // since the preview doesn't create a font file,
+  // we always ignore the font's license restrictions
+  if (canceled)
+    error = TA_Err_Canceled;
+  else if (!full)
+  {
+    // only the options of `TA_Variant' may differ from the complete run
+    TA_Variant variant;
+
+    variant.gray_strong_stem_width = info_data.gray_strong_stem_width;
+    variant.gdi_cleartype_strong_stem_width =
+      info_data.gdi_cleartype_strong_stem_width;
+    variant.dw_cleartype_strong_stem_width =
+      info_data.dw_cleartype_strong_stem_width;
+    variant.windows_compatibility = info_data.windows_compatibility;
+    variant.increase_x_height = info_data.increase_x_height;
+    variant.x_height_snapping_exceptions = snapping_string.constData();
+    variant.info_callback_data = NULL;
+    variant.out_buffer = NULL;
+    variant.out_buffer_len = 0;
+
+    error = TTF_autohint_preview_update(preview, &variant,
+                                        glyphs_string.constData(),
+                                        this, &error_str);
+    out_buf = variant.out_buffer;
+    out_len = variant.out_buffer_len;
+  }
+  else
+    error =
+      TTF_autohint("in-buffer, in-buffer-len, out-buffer, out-buffer-len,"
+                   "hinting-range-min, hinting-range-max,"
+                   "hinting-limit,"
+                   "gray-strong-stem-width,"
+                   "gdi-cleartype-strong-stem-width,"
+                   "dw-cleartype-strong-stem-width,"
+                   "error-string,"
+                   "progress-callback, progress-callback-data,"
+                   "ignore-restrictions,"
+                   "windows-compatibility,"
+                   "pre-hinting,"
+                   "hint-with-components,"
+                   "increase-x-height,"
+                   "x-height-snapping-exceptions,"
+                   "fallback-script, symbol,"
+                   "glyph-cache, hint-glyphs, preview",
+                   input.constData(), (size_t)input.size(),
+                   &out_buf, &out_len,
+                   info_data.hinting_range_min, info_data.hinting_range_max,
+                   info_data.hinting_limit,
+                   info_data.gray_strong_stem_width,
+                   info_data.gdi_cleartype_strong_stem_width,
+                   info_data.dw_cleartype_strong_stem_width,
+                   &error_str,
+                   gui_preview_progress, this,
+                   true,
+                   info_data.windows_compatibility,
+                   info_data.pre_hinting,
+                   info_data.hint_with_components,
+                   info_data.increase_x_height,
+                   snapping_string.constData(),
+                   info_data.latin_fallback, info_data.symbol,
+                   glyph_cache, glyphs_string.constData(), preview);
+
+  if (error_str)
+    error_string = (const char*)error_str;
+  if (!error)
+    output = QByteArray(out_buf, out_len);
+  free(out_buf);
+
+  emit finished();
+}
+
+
 // return value 1 indicates a retry
 
 int
@@ -629,59 +934,147 @@ Main_GUI::handle_error(TA_Error error,
 }
 
 
-void
-Main_GUI::run()
+// the input and output files of a new job
+// must not be used by a queued or running job
+
+int
+Main_GUI::check_jobs(const QString& input_name,
+                     const QString& output_name)
 {
-  statusBar()->clearMessage();
+  QMap<Hinting_Job*, QProgressDialog*>::const_iterator it;
 
-  QString input_name = QDir::fromNativeSeparators(input_line->text());
-  QString output_name = QDir::fromNativeSeparators(output_line->text());
-  if (!check_filenames(input_name, output_name))
-    return;
+  for (it = jobs.constBegin(); it != jobs.constEnd(); it++)
+  {
+    Hinting_Job* job = it.key();
+    QString name;
+
+    if (job->output_name == input_name || job->output_name == output_name)
+      name = job->output_name;
+    else if (job->input_name == output_name)
+      name = job->input_name;
+    else
+      continue;
+
+    QMessageBox::warning(
+      this,
+      "TTFautohint",
+      tr("The file %1 is still being processed.")
+         .arg(QUOTE_STRING(QDir::toNativeSeparators(name))),
+      QMessageBox::Ok,
+      QMessageBox::Ok);
+    return 0;
+  }
 
+  return 1;
+}
+
+
+// `info_data' must already contain the data for the `name' table
+// (if any), which is then owned by the job
+
+void
+Main_GUI::start_job(const QString& input_name,
+                    const QString& output_name,
+                    const Info_Data& info_data,
+                    bool have_info,
+                    bool ignore,
+                    const QByteArray& snapping_string)
+{
   // we need C file descriptors for communication with TTF_autohint
   FILE* input;
   FILE* output;
 
-again:
   if (!open_files(input_name, &input, output_name, &output))
+  {
+    free(info_data.data);
+    free(info_data.data_wide);
     return;
+  }
 
-  QProgressDialog dialog;
-  dialog.setCancelButtonText(tr("Cancel"));
-  dialog.setMinimumDuration(1000);
-  dialog.setWindowModality(Qt::WindowModal);
+  Hinting_Job* job = new Hinting_Job(input_name, input,
+                                     output_name, output,
+                                     info_data, have_info, ignore,
+                                     snapping_string);
+
+  QProgressDialog* dialog = new QProgressDialog(this);
+  dialog->setWindowTitle(QDir::toNativeSeparators(input_name));
+  dialog->setLabelText(tr("Waiting..."));
+  dialog->setCancelButtonText(tr("Cancel"));
+  dialog->setMinimumDuration(1000);
+  dialog->setWindowModality(Qt::NonModal);
+  dialog->setAutoReset(false);
+  dialog->setAutoClose(false);
+
+  connect(job, SIGNAL(label_changed(QString)), dialog,
+          SLOT(setLabelText(QString)));
+  connect(job, SIGNAL(maximum_changed(int)), dialog,
+          SLOT(setMaximum(int)));
+  connect(job, SIGNAL(value_changed(int)), dialog,
+          SLOT(setValue(int)));
+  connect(dialog, SIGNAL(canceled()), job,
+          SLOT(cancel()));
+  connect(job, SIGNAL(finished()), this,
+          SLOT(finish_job()));
+
+  jobs.insert(job, dialog);
+
+  // the global thread pool uses as many threads as we have CPU cores;
+  // further jobs get queued
+  QThreadPool::globalInstance()->start(job);
+
+  statusBar()->showMessage(tr("Auto-hinting %n font(s)...", "",
+                              jobs.size()));
+}
 
-  const unsigned char* error_string;
-  TA_Info_Func info_func = info;
-  GUI_Progress_Data gui_progress_data = {-1, true, &dialog};
-  Info_Data info_data;
 
-  info_data.data = NULL; // must be deallocated after use
-  info_data.data_wide = NULL; // must be deallocated after use
-  info_data.data_len = 0;
-  info_data.data_wide_len = 0;
+// fill `info_data' with the current values of the GUI's options
 
-  info_data.hinting_range_min = min_box->value();
-  info_data.hinting_range_max = max_box->value();
-  info_data.hinting_limit = no_limit_box->isChecked()
-                            ? 0
-                            : limit_box->value();
+void
+Main_GUI::get_options(Info_Data* info_data)
+{
+  info_data->data = NULL; // owned by the job
+  info_data->data_wide = NULL; // owned by the job
+  info_data->data_len = 0;
+  info_data->data_wide_len = 0;
+
+  info_data->hinting_range_min = min_box->value();
+  info_data->hinting_range_max = max_box->value();
+  info_data->hinting_limit = no_limit_box->isChecked()
+                             ? 0
+                             : limit_box->value();
+
+  info_data->gray_strong_stem_width = gray_box->isChecked();
+  info_data->gdi_cleartype_strong_stem_width = gdi_box->isChecked();
+  info_data->dw_cleartype_strong_stem_width = dw_box->isChecked();
+
+  info_data->increase_x_height = no_increase_box->isChecked()
+                                 ? 0
+                                 : increase_box->value();
+  info_data->x_height_snapping_exceptions = x_height_snapping_exceptions;
+
+  info_data->windows_compatibility = wincomp_box->isChecked();
+  info_data->pre_hinting = pre_box->isChecked();
+  info_data->hint_with_components = hint_box->isChecked();
+  info_data->latin_fallback = fallback_box->currentIndex();
+  info_data->symbol = symbol_box->isChecked();
+}
 
-  info_data.gray_strong_stem_width = gray_box->isChecked();
-  info_data.gdi_cleartype_strong_stem_width = gdi_box->isChecked();
-  info_data.dw_cleartype_strong_stem_width = dw_box->isChecked();
 
-  info_data.increase_x_height = no_increase_box->isChecked()
-                                ? 0
-                                : increase_box->value();
-  info_data.x_height_snapping_exceptions = x_height_snapping_exceptions;
+void
+Main_GUI::run()
+{
+  statusBar()->clearMessage();
 
-  info_data.windows_compatibility = wincomp_box->isChecked();
-  info_data.pre_hinting = pre_box->isChecked();
-  info_data.hint_with_components = hint_box->isChecked();
-  info_data.latin_fallback = fallback_box->currentIndex();
-  info_data.symbol = symbol_box->isChecked();
+  QString input_name = QDir::fromNativeSeparators(input_line->text());
+  QString output_name = QDir::fromNativeSeparators(output_line->text());
+  if (!check_filenames(input_name, output_name))
+    return;
+  if (!check_jobs(input_name, output_name))
+    return;
+
+  Info_Data info_data;
+
+  get_options(&info_data);
 
   if (info_box->isChecked())
   {
@@ -703,61 +1096,222 @@ again:
         QMessageBox::Ok,
         QMessageBox::Ok);
   }
+
+  // the number set might change while the job is running;
+  // it is only needed for `build_version_string'
+  info_data.x_height_snapping_exceptions = NULL;
+
+  start_job(input_name, output_name,
+            info_data, info_box->isChecked(), ignore_restrictions,
+            snapping_line->text().toLocal8Bit());
+}
+
+
+void
+Main_GUI::finish_job()
+{
+  // the job might already be deleted if we are closing the window,
+  // so we don't dereference the pointer before checking it
+  Hinting_Job* job = static_cast<Hinting_Job*>(sender());
+  if (!jobs.contains(job))
+    return;
+
+  delete jobs.take(job);
+
+  if (job->error)
+  {
+    if (handle_error(job->error,
+                     (const unsigned char*)job->error_string.constData(),
+                     job->output_name))
+    {
+      // the new job takes over the `name' table data
+      Info_Data info_data = job->info_data;
+
+      job->info_data.data = NULL;
+      job->info_data.data_wide = NULL;
+
+      start_job(job->input_name, job->output_name,
+                info_data, job->have_info, ignore_restrictions,
+                job->snapping_string);
+    }
+  }
   else
-    info_func = NULL;
-
-  QByteArray snapping_string = snapping_line->text().toLocal8Bit();
-
-  TA_Error error =
-    TTF_autohint("in-file, out-file,"
-                 "hinting-range-min, hinting-range-max,"
-                 "hinting-limit,"
-                 "gray-strong-stem-width,"
-                 "gdi-cleartype-strong-stem-width,"
-                 "dw-cleartype-strong-stem-width,"
-                 "error-string,"
-                 "progress-callback, progress-callback-data,"
-                 "info-callback, info-callback-data,"
-                 "ignore-restrictions,"
-                 "windows-compatibility,"
-                 "pre-hinting,"
-                 "hint-with-components,"
-                 "increase-x-height,"
-                 "x-height-snapping-exceptions,"
-                 "fallback-script, symbol",
-                 input, output,
-                 info_data.hinting_range_min, info_data.hinting_range_max,
-                 info_data.hinting_limit,
-                 info_data.gray_strong_stem_width,
-                 info_data.gdi_cleartype_strong_stem_width,
-                 info_data.dw_cleartype_strong_stem_width,
-                 &error_string,
-                 gui_progress, &gui_progress_data,
-                 info_func, &info_data,
-                 ignore_restrictions,
-                 info_data.windows_compatibility,
-                 info_data.pre_hinting,
-                 info_data.hint_with_components,
-                 info_data.increase_x_height,
-                 snapping_string.constData(),
-                 info_data.latin_fallback, info_data.symbol);
+    statusBar()->showMessage(
+      tr("Auto-hinting of %1 finished.")
+         .arg(QUOTE_STRING(QDir::toNativeSeparators(job->input_name))));
 
-  if (info_box->isChecked())
+  job->deleteLater();
+}
+
+
+void
+Main_GUI::check_ppem()
+{
+  preview_area->set_ppem(ppem_box->value());
+}
+
+
+// option changes often come in bursts (for example, while typing),
+// so we wait a bit before hinting again
+
+void
+Main_GUI::schedule_preview()
+{
+  preview_timer->start();
+}
+
+
+void
+Main_GUI::start_preview()
+{
+  // start again as soon as the running job has finished
+  if (preview_job)
   {
-    free(info_data.data);
-    free(info_data.data_wide);
+    preview_pending = true;
+    preview_job->cancel();
+    return;
   }
 
-  fclose(input);
-  fclose(output);
+  QString input_name = QDir::fromNativeSeparators(input_line->text());
+  QFileInfo info(input_name);
+  if (input_name.isEmpty() || !info.isFile())
+  {
+    preview_area->clear();
+    return;
+  }
 
-  if (error)
+  // read the input font only if it has changed
+  if (input_name != preview_input_name
+      || info.lastModified() != preview_input_time)
   {
-    if (handle_error(error, error_string, output_name))
-      goto again;
+    QFile file(input_name);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+      preview_area->clear();
+      return;
+    }
+
+    preview_input = file.readAll();
+    preview_input_name = input_name;
+    preview_input_time = info.lastModified();
+    preview_key.clear();
+
+    // the subfont index of the previous font is meaningless
+    preview_subfont = 0;
+    if (!preview_area->set_input(preview_input, preview_subfont))
+    {
+      subfont_box->setEnabled(false);
+      preview_area->clear();
+      return;
+    }
+
+    int num_subfonts = preview_area->get_num_subfonts();
+
+    // we don't want a new preview run from signal `valueChanged'
+    subfont_box->blockSignals(true);
+    subfont_box->setRange(0, num_subfonts - 1);
+    subfont_box->setValue(0);
+    subfont_box->blockSignals(false);
+    subfont_box->setEnabled(num_subfonts > 1);
+  }
+  else if (subfont_box->value() != preview_subfont)
+  {
+    // the output font contains all subfonts,
+    // so we only have to map the characters again
+    preview_subfont = subfont_box->value();
+    if (!preview_area->set_input(preview_input, preview_subfont))
+    {
+      preview_area->clear();
+      return;
+    }
+  }
+
+  QByteArray glyphs_string = preview_area->set_text(preview_line->text());
+  if (glyphs_string.isEmpty())
+  {
+    preview_area->clear();
+    return;
+  }
+
+  Info_Data info_data;
+
+  get_options(&info_data);
+  // only needed for `build_version_string'
+  info_data.x_height_snapping_exceptions = NULL;
+
+  // in contrast to the text in `snapping_line',
+  // the parsed number set is always valid
+  char* s = number_set_show(x_height_snapping_exceptions, 6, 0x7FFF);
+  QByteArray snapping_string(s);
+  free(s);
+
+  // the options which `TTF_autohint_preview_update' can't change;
+  // the input font is covered by clearing the key after reading it
+  QByteArray key;
+
+  key += QByteArray::number(info_data.hinting_range_min) + ' ';
+  key += QByteArray::number(info_data.hinting_range_max) + ' ';
+  key += QByteArray::number(info_data.hinting_limit) + ' ';
+  key += QByteArray::number(info_data.pre_hinting) + ' ';
+  key += QByteArray::number(info_data.hint_with_components) + ' ';
+  key += QByteArray::number(info_data.latin_fallback) + ' ';
+  key += QByteArray::number(info_data.symbol);
+
+  // a complete run analyzes the whole font, which is slow for large fonts
+  bool full = !preview || key != preview_key;
+  if (full)
+    preview_key = key;
+
+  preview_job = new Preview_Job(preview_input, info_data,
+                                snapping_string, glyphs_string,
+                                glyph_cache, preview, full);
+  connect(preview_job, SIGNAL(finished()), this,
+          SLOT(finish_preview()));
+
+  preview_pool->start(preview_job);
+}
+
+
+void
+Main_GUI::finish_preview()
+{
+  // the job might already be deleted if we are closing the window,
+  // so we don't dereference the pointer before checking it
+  Preview_Job* job = static_cast<Preview_Job*>(sender());
+  if (!job || job != preview_job)
+    return;
+
+  preview_job = NULL;
+
+  // the font kept by a complete run refers to its input data, which thus
+  // must stay valid; the previous data is no longer used at this point
+  if (job->full)
+    preview_state_input = job->input;
+
+  // a canceled update can be repeated; otherwise, we need a complete run
+  if (job->error
+      && (job->full || job->error != TA_Err_Canceled))
+    preview_key.clear();
+
+  if (!job->error)
+    preview_area->set_output(job->output);
+  else if (job->error != TA_Err_Canceled)
+  {
+    // we don't want message boxes while the user is changing options
+    preview_area->clear();
+    statusBar()->showMessage(
+      tr("No preview: error code 0x%1 while autohinting font: %2")
+         .arg(job->error, 2, 16, QLatin1Char('0'))
+         .arg(QString::fromLocal8Bit(job->error_string.constData())));
+  }
+
+  job->deleteLater();
+
+  if (preview_pending)
+  {
+    preview_pending = false;
+    start_preview();
   }
-  else
-    statusBar()->showMessage(tr("Auto-hinting finished."));
 }
 
 
@@ -996,6 +1550,54 @@ Main_GUI::create_layout()
                                + tr("&Run")
                                + "    "); // make label wider
 
+  //
+  // preview
+  //
+  QLabel* preview_label = new QLabel(tr("Pre&view Text:"));
+  preview_line = new QLineEdit;
+  preview_label->setBuddy(preview_line);
+  preview_label->setToolTip(
+    tr("The characters shown in the preview,"
+       " hinted with the current options."
+       "  Only these glyphs get hinted,"
+       " so the preview gets updated quickly even for very large fonts."));
+
+  QLabel* ppem_label = new QLabel(tr("Preview Si&ze:"));
+  ppem_box = new QSpinBox;
+  ppem_label->setBuddy(ppem_box);
+  ppem_label->setToolTip(
+    tr("The PPEM value used for the preview."
+       "  Changing it doesn't need a new hinting run."));
+  ppem_box->setRange(2, 200);
+
+  QLabel* subfont_label = new QLabel(tr("Preview Su&bfont:"));
+  subfont_box = new QSpinBox;
+  subfont_label->setBuddy(subfont_box);
+  subfont_label->setToolTip(
+    tr("The index of the subfont shown in the preview"
+       " if the input font is a TrueType collection."));
+  subfont_box->setRange(0, 0);
+  subfont_box->setEnabled(false);
+
+  preview_area = new Preview_Area;
+  preview_area->setToolTip(
+    tr("The preview text, rendered by FreeType"
+       " with the bytecode created by <b>TTFautohint</b>:"
+       " in real size at the top, magnified below,"
+       " together with the pixel grid and the baseline (red)."));
+
+  // layout
+  QGridLayout* preview_layout = new QGridLayout;
+
+  preview_layout->addWidget(preview_label, 0, 0, Qt::AlignRight);
+  preview_layout->addWidget(preview_line, 0, 1);
+  preview_layout->addWidget(ppem_label, 1, 0, Qt::AlignRight);
+  preview_layout->addWidget(ppem_box, 1, 1, Qt::AlignLeft);
+  preview_layout->addWidget(subfont_label, 2, 0, Qt::AlignRight);
+  preview_layout->addWidget(subfont_box, 2, 1, Qt::AlignLeft);
+  preview_layout->addWidget(preview_area, 3, 0, 1, -1);
+  preview_layout->setRowStretch(3, 1);
+
   //
   // the whole gui
   //
@@ -1063,9 +1665,18 @@ Main_GUI::create_layout()
 
   gui_layout->addWidget(run_button, row++, 1, Qt::AlignRight);
 
+  // the options to the left, the preview to the right
+  QHBoxLayout* main_layout = new QHBoxLayout;
+  QFrame* vline = new QFrame;
+  vline->setFrameShape(QFrame::VLine);
+
+  main_layout->addLayout(gui_layout);
+  main_layout->addWidget(vline);
+  main_layout->addLayout(preview_layout, 1);
+
   // create dummy widget to register layout
   QWidget* main_widget = new QWidget;
-  main_widget->setLayout(gui_layout);
+  main_widget->setLayout(main_layout);
   setCentralWidget(main_widget);
   setWindowTitle("TTFautohint");
 }
@@ -1109,6 +1720,51 @@ Main_GUI::create_connections()
 
   connect(run_button, SIGNAL(clicked()), this,
           SLOT(run()));
+
+  // all options which influence the bytecode update the preview
+  connect(input_line, SIGNAL(textChanged(QString)), this,
+          SLOT(schedule_preview()));
+  connect(preview_line, SIGNAL(textChanged(QString)), this,
+          SLOT(schedule_preview()));
+  connect(subfont_box, SIGNAL(valueChanged(int)), this,
+          SLOT(schedule_preview()));
+
+  connect(min_box, SIGNAL(valueChanged(int)), this,
+          SLOT(schedule_preview()));
+  connect(max_box, SIGNAL(valueChanged(int)), this,
+          SLOT(schedule_preview()));
+  connect(fallback_box, SIGNAL(currentIndexChanged(int)), this,
+          SLOT(schedule_preview()));
+  connect(limit_box, SIGNAL(valueChanged(int)), this,
+          SLOT(schedule_preview()));
+  connect(no_limit_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(increase_box, SIGNAL(valueChanged(int)), this,
+          SLOT(schedule_preview()));
+  connect(no_increase_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(snapping_line, SIGNAL(editingFinished()), this,
+          SLOT(schedule_preview()));
+
+  connect(wincomp_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(pre_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(hint_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(symbol_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(gray_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(gdi_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+  connect(dw_box, SIGNAL(clicked()), this,
+          SLOT(schedule_preview()));
+
+  connect(preview_timer, SIGNAL(timeout()), this,
+          SLOT(start_preview()));
+  connect(ppem_box, SIGNAL(valueChanged(int)), this,
+          SLOT(check_ppem()));
 }
 
 
@@ -1193,6 +1849,9 @@ Main_GUI::set_defaults()
 
   run_button->setEnabled(false);
 
+  preview_line->setText("Hamburgefonstiv");
+  ppem_box->setValue(16);
+
   check_min();
   check_max();
   check_limit();
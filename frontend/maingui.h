@@ -19,24 +19,126 @@
 #include <QtGui>
 #include "ddlineedit.h"
 #include "ttlineedit.h"
+#include "preview.h"
 
 #include <stdio.h>
 #include <ttfautohint.h>
 #include <numberset.h>
 
+#include "info.h"
+
 class QAction;
 class QButtonGroup;
 class QCheckBox;
 class QComboBox;
 class QFile;
 class QLabel;
+class QLineEdit;
 class QLocale;
 class QMenu;
 class QPushButton;
 class QSpinBox;
+class QThreadPool;
+class QTimer;
 
 class Drag_Drop_Line_Edit;
 class Tooltip_Line_Edit;
+class Preview_Area;
+
+// A single call to `TTF_autohint', executed by a thread of the global
+// thread pool.  The job owns the file handles and the `name' table data
+// of `info_data'.  Progress gets reported via signals, which are
+// delivered to the GUI thread.
+class Hinting_Job
+: public QObject,
+  public QRunnable
+{
+  Q_OBJECT
+
+public:
+  Hinting_Job(const QString&, FILE*,
+              const QString&, FILE*,
+              const Info_Data&, bool, bool,
+              const QByteArray&);
+  ~Hinting_Job();
+
+  void run();
+  int report_progress(long, long, long, long);
+
+  QString input_name;
+  QString output_name;
+  Info_Data info_data;
+  bool have_info;
+  bool ignore_restrictions;
+  QByteArray snapping_string;
+
+  // valid after signal `finished' has been emitted
+  TA_Error error;
+  QByteArray error_string;
+
+public slots:
+  void cancel();
+
+signals:
+  void label_changed(const QString&);
+  void maximum_changed(int);
+  void value_changed(int);
+  void finished();
+
+private:
+  FILE* input;
+  FILE* output;
+  QAtomicInt canceled;
+
+  long last_sfnt;
+  int last_value;
+  int step;
+};
+
+// A call to `TTF_autohint' for the preview, hinting only the glyphs
+// given in `glyphs_string' (with option `hint-glyphs').  Input and output
+// are held in memory.  If `full' is not set, the font analyzed by a
+// previous job is taken from `preview', and only the glyphs get hinted
+// again (with `TTF_autohint_preview_update').  The glyph cache and the
+// preview state are owned by the GUI; at most one preview job may run at
+// a time.
+class Preview_Job
+: public QObject,
+  public QRunnable
+{
+  Q_OBJECT
+
+public:
+  Preview_Job(const QByteArray&,
+              const Info_Data&,
+              const QByteArray&, const QByteArray&,
+              TA_Glyph_Cache*, TA_Preview*, bool);
+
+  void run();
+  int check_canceled();
+
+  QByteArray input;
+  Info_Data info_data;
+  QByteArray snapping_string;
+  QByteArray glyphs_string;
+  TA_Glyph_Cache* glyph_cache;
+  TA_Preview* preview;
+  bool full;
+
+  // valid after signal `finished' has been emitted
+  TA_Error error;
+  QByteArray error_string;
+  QByteArray output;
+
+public slots:
+  void cancel();
+
+signals:
+  void finished();
+
+private:
+  QAtomicInt canceled;
+};
 
 class Main_GUI
 : public QMainWindow
@@ -69,6 +171,11 @@ private slots:
   void clear_status_bar();
   void check_run();
   void run();
+  void finish_job();
+  void check_ppem();
+  void schedule_preview();
+  void start_preview();
+  void finish_preview();
 
 private:
   int hinting_range_min;
@@ -98,10 +205,39 @@ private:
   void read_settings();
   void write_settings();
 
+  void get_options(Info_Data*);
   int check_filenames(const QString&, const QString&);
+  int check_jobs(const QString&, const QString&);
   int open_files(const QString&, FILE**, const QString&, FILE**);
+  void start_job(const QString&, const QString&,
+                 const Info_Data&, bool, bool,
+                 const QByteArray&);
   int handle_error(TA_Error, const unsigned char*, QString);
 
+  // all jobs which are either queued or running,
+  // together with their progress dialogs
+  QMap<Hinting_Job*, QProgressDialog*> jobs;
+
+  // the preview runs in a thread pool of its own
+  // so that it doesn't have to wait for hinting jobs
+  QThreadPool* preview_pool;
+  QTimer* preview_timer;
+  Preview_Job* preview_job;
+  bool preview_pending;
+  TA_Glyph_Cache* glyph_cache;
+
+  // the font analyzed by the last complete preview run, together with
+  // its input data (which must stay valid) and the options it depends
+  // on; `preview_key' is empty if there is no such font
+  TA_Preview* preview;
+  QByteArray preview_key;
+  QByteArray preview_state_input;
+
+  QString preview_input_name;
+  QDateTime preview_input_time;
+  QByteArray preview_input;
+  int preview_subfont;
+
   QMenu* file_menu;
   QMenu* help_menu;
 
@@ -138,6 +274,11 @@ private:
 
   QPushButton* run_button;
 
+  QLineEdit* preview_line;
+  QSpinBox* ppem_box;
+  QSpinBox* subfont_box;
+  Preview_Area* preview_area;
+
   QAction* exit_act;
   QAction* about_act;
   QAction* about_Qt_act;
@@ -0,0 +1,358 @@
+// preview.cpp
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// Derived class `Preview_Area' is QWidget which renders a string of
+// glyphs with the bytecode created by TTFautohint, similar to `ftgrid':
+// at the top, the glyphs are shown in their real size, below, they are
+// magnified to fill the widget, together with the pixel grid and the
+// baseline.  Characters are mapped to glyph indices with the input font,
+// and the glyphs are rendered with the (partially) hinted output font; for
+// TTCs, both fonts use the same subfont.
+
+#include <config.h>
+
+#include "preview.h"
+
+
+// the space around the rendered glyphs, in pixels
+#define PREVIEW_MARGIN 10
+
+// the magnification at which we start to draw the pixel grid
+#define PREVIEW_GRID_ZOOM 4
+
+
+Preview_Area::Preview_Area(QWidget* parent)
+: QWidget(parent),
+  input_face(NULL),
+  output_face(NULL),
+  subfont(0),
+  ppem(16),
+  baseline(0)
+{
+  if (FT_Init_FreeType(&library))
+    library = NULL;
+
+  setMinimumSize(400, 200);
+  setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+
+Preview_Area::~Preview_Area()
+{
+  if (input_face)
+    FT_Done_Face(input_face);
+  if (output_face)
+    FT_Done_Face(output_face);
+  if (library)
+    FT_Done_FreeType(library);
+}
+
+
+// return false if `data' is not a font FreeType can handle
+// or if it doesn't contain subfont `index'
+
+bool
+Preview_Area::set_input(const QByteArray& data,
+                        int index)
+{
+  if (input_face)
+  {
+    FT_Done_Face(input_face);
+    input_face = NULL;
+  }
+
+  input_data = data;
+  subfont = index;
+  if (!library
+      || FT_New_Memory_Face(library,
+                            (const FT_Byte*)input_data.constData(),
+                            input_data.size(), subfont, &input_face))
+  {
+    input_face = NULL;
+    return false;
+  }
+
+  // FreeType doesn't select a symbol character map automatically
+  if (!input_face->charmap)
+    FT_Select_Charmap(input_face, FT_ENCODING_MS_SYMBOL);
+
+  return true;
+}
+
+
+// for TTCs, the number of subfonts; otherwise 1
+
+int
+Preview_Area::get_num_subfonts()
+{
+  if (!input_face)
+    return 0;
+
+  return input_face->num_faces;
+}
+
+
+// map `text' to glyph indices and return them as a number set,
+// to be used for option `hint-glyphs'
+
+QByteArray
+Preview_Area::set_text(const QString& text)
+{
+  glyph_indices.clear();
+
+  if (input_face)
+  {
+    QVector<uint> chars = text.toUcs4();
+    bool symbol = input_face->charmap
+                  && input_face->charmap->encoding == FT_ENCODING_MS_SYMBOL;
+
+    for (int i = 0; i < chars.size(); i++)
+    {
+      FT_UInt idx = FT_Get_Char_Index(input_face, chars[i]);
+
+      // symbol fonts usually map their glyphs to the Private Use Area
+      if (!idx && symbol && chars[i] < 0x100)
+        idx = FT_Get_Char_Index(input_face, 0xF000 + chars[i]);
+
+      glyph_indices.append(idx);
+    }
+  }
+
+  // number sets must be in ascending order
+  QVector<FT_UInt> sorted = glyph_indices;
+  qSort(sorted);
+
+  QByteArray number_set;
+  for (int i = 0; i < sorted.size(); i++)
+  {
+    if (i && sorted[i] == sorted[i - 1])
+      continue;
+
+    if (!number_set.isEmpty())
+      number_set += ", ";
+    number_set += QByteArray::number(sorted[i]);
+  }
+
+  return number_set;
+}
+
+
+// return false if `data' is not a font FreeType can handle
+
+bool
+Preview_Area::set_output(const QByteArray& data)
+{
+  if (output_face)
+  {
+    FT_Done_Face(output_face);
+    output_face = NULL;
+  }
+
+  output_data = data;
+  if (!library
+      || FT_New_Memory_Face(library,
+                            (const FT_Byte*)output_data.constData(),
+                            output_data.size(), subfont, &output_face))
+    output_face = NULL;
+
+  render();
+  update();
+
+  return output_face != NULL;
+}
+
+
+// the bytecode covers all sizes, so no new hinting run is needed
+
+void
+Preview_Area::set_ppem(int size)
+{
+  ppem = size;
+
+  render();
+  update();
+}
+
+
+void
+Preview_Area::clear()
+{
+  if (output_face)
+  {
+    FT_Done_Face(output_face);
+    output_face = NULL;
+  }
+  output_data.clear();
+
+  image = QImage();
+  update();
+}
+
+
+// a rendered glyph, positioned relative to the pen position
+
+typedef struct Preview_Glyph_
+{
+  QImage bitmap;
+  int left;
+  int top;
+  int advance;
+} Preview_Glyph;
+
+
+void
+Preview_Area::render()
+{
+  image = QImage();
+
+  if (!output_face || glyph_indices.isEmpty())
+    return;
+
+  if (FT_Set_Pixel_Sizes(output_face, ppem, ppem))
+    return;
+
+  FT_Size_Metrics* metrics = &output_face->size->metrics;
+  int ascender = (metrics->ascender + 63) >> 6;
+  int descender = (-metrics->descender + 63) >> 6;
+
+  QVector<Preview_Glyph> glyphs;
+  int min_left = 0;
+  int width = 0;
+
+  for (int i = 0; i < glyph_indices.size(); i++)
+  {
+    // we want to see the result of TTFautohint's bytecode,
+    // never that of FreeType's autohinter
+    if (FT_Load_Glyph(output_face, glyph_indices[i],
+                      FT_LOAD_RENDER | FT_LOAD_NO_AUTOHINT))
+      continue;
+
+    FT_GlyphSlot slot = output_face->glyph;
+    FT_Bitmap* bitmap = &slot->bitmap;
+    Preview_Glyph glyph;
+
+    glyph.left = slot->bitmap_left;
+    glyph.top = slot->bitmap_top;
+    glyph.advance = (slot->advance.x + 32) >> 6;
+
+    glyph.bitmap = QImage(bitmap->width, bitmap->rows, QImage::Format_RGB32);
+    for (int y = 0; y < (int)bitmap->rows; y++)
+    {
+      const unsigned char* row = bitmap->buffer + y * bitmap->pitch;
+
+      for (int x = 0; x < (int)bitmap->width; x++)
+      {
+        int gray;
+
+        if (bitmap->pixel_mode == FT_PIXEL_MODE_MONO)
+          gray = (row[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+        else
+          gray = row[x] * 255 / (bitmap->num_grays - 1);
+
+        glyph.bitmap.setPixel(x, y, qRgb(255 - gray, 255 - gray, 255 - gray));
+      }
+    }
+
+    // accents might exceed the font's ascender and descender
+    if (glyph.top > ascender)
+      ascender = glyph.top;
+    if ((int)bitmap->rows - glyph.top > descender)
+      descender = bitmap->rows - glyph.top;
+    if (width + glyph.left < min_left)
+      min_left = width + glyph.left;
+
+    width += glyph.advance;
+    glyphs.append(glyph);
+  }
+
+  if (glyphs.isEmpty())
+    return;
+
+  // the last glyph's bitmap might exceed its advance width
+  int pen_x = -min_left;
+  int image_width = pen_x + width;
+
+  for (int i = 0; i < glyphs.size(); i++)
+  {
+    int right = pen_x + glyphs[i].left + glyphs[i].bitmap.width();
+
+    if (right > image_width)
+      image_width = right;
+    pen_x += glyphs[i].advance;
+  }
+
+  if (image_width <= 0 || ascender + descender <= 0)
+    return;
+
+  image = QImage(image_width, ascender + descender, QImage::Format_RGB32);
+  image.fill(qRgb(255, 255, 255));
+  baseline = ascender;
+
+  QPainter painter(&image);
+  // white is the background, so we simply multiply
+  painter.setCompositionMode(QPainter::CompositionMode_Multiply);
+
+  pen_x = -min_left;
+  for (int i = 0; i < glyphs.size(); i++)
+  {
+    painter.drawImage(pen_x + glyphs[i].left,
+                      baseline - glyphs[i].top,
+                      glyphs[i].bitmap);
+    pen_x += glyphs[i].advance;
+  }
+}
+
+
+void
+Preview_Area::paintEvent(QPaintEvent*)
+{
+  QPainter painter(this);
+
+  painter.fillRect(rect(), Qt::white);
+
+  if (image.isNull())
+    return;
+
+  // the glyphs in real size
+  painter.drawImage(PREVIEW_MARGIN, PREVIEW_MARGIN, image);
+
+  // the magnified glyphs; without `SmoothPixmapTransform',
+  // each pixel simply becomes a square
+  int top = 2 * PREVIEW_MARGIN + image.height();
+  int zoom = qMin((width() - 2 * PREVIEW_MARGIN) / image.width(),
+                  (height() - top - PREVIEW_MARGIN) / image.height());
+  if (zoom < 1)
+    return;
+
+  QRect target(PREVIEW_MARGIN, top,
+               image.width() * zoom, image.height() * zoom);
+  painter.drawImage(target, image);
+
+  if (zoom >= PREVIEW_GRID_ZOOM)
+  {
+    painter.setPen(QColor(192, 192, 224));
+
+    for (int x = 0; x <= image.width(); x++)
+      painter.drawLine(target.left() + x * zoom, target.top(),
+                       target.left() + x * zoom, target.bottom());
+    for (int y = 0; y <= image.height(); y++)
+      painter.drawLine(target.left(), target.top() + y * zoom,
+                       target.right(), target.top() + y * zoom);
+  }
+
+  painter.setPen(Qt::red);
+  painter.drawLine(target.left(), target.top() + baseline * zoom,
+                   target.right(), target.top() + baseline * zoom);
+}
+
+// end of preview.cpp
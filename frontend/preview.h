@@ -0,0 +1,64 @@
+// preview.h
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef __PREVIEW_H__
+#define __PREVIEW_H__
+
+#include <config.h>
+
+#include <QtGui>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+class Preview_Area
+: public QWidget
+{
+  Q_OBJECT
+
+public:
+  Preview_Area(QWidget* = 0);
+  ~Preview_Area();
+
+  bool set_input(const QByteArray&, int);
+  int get_num_subfonts();
+  QByteArray set_text(const QString&);
+  bool set_output(const QByteArray&);
+  void set_ppem(int);
+  void clear();
+
+protected:
+  void paintEvent(QPaintEvent*);
+
+private:
+  FT_Library library;
+
+  // FreeType accesses the font data while a face is open
+  QByteArray input_data;
+  FT_Face input_face;
+  QByteArray output_data;
+  FT_Face output_face;
+
+  QVector<FT_UInt> glyph_indices;
+  int subfont; // the face index in both input and output
+  int ppem;
+
+  QImage image; // the rendered glyphs at 1:1 scale
+  int baseline; // the vertical position of the baseline in `image'
+
+  void render();
+};
+
+#endif // __PREVIEW_H__
+
+// end of preview.h
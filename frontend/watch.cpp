@@ -0,0 +1,158 @@
+// watch.cpp
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// Watching the input font for option `--watch'.
+//
+// Font editors often save a file by writing a temporary file and renaming
+// it afterwards, which removes the original file (and any watch on it).
+// We thus watch the directory and filter the events by file name.
+
+#include <config.h>
+
+#ifdef HAVE_INOTIFY
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/inotify.h>
+
+#include <string>
+
+#include "watch.h"
+
+
+// the time in milliseconds to wait for more events after a change,
+// so that a file written in several steps gets processed only once
+#define WATCH_SETTLE_TIME 100
+
+
+using namespace std;
+
+
+static string
+base_name(const char* file_name)
+{
+  const char* p = strrchr(file_name, '/');
+
+  return p ? p + 1 : file_name;
+}
+
+
+int
+watch_init(const char* file_name)
+{
+  const char* p = strrchr(file_name, '/');
+  string dir_name;
+
+  if (!p)
+    dir_name = ".";
+  else if (p == file_name)
+    dir_name = "/";
+  else
+    dir_name.assign(file_name, p - file_name);
+
+  int fd = inotify_init();
+  if (fd < 0)
+    return -1;
+
+  if (inotify_add_watch(fd, dir_name.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+
+// read the pending events and check whether one of them refers to
+// `name'; return -1 on error
+
+static int
+read_events(int watch_fd,
+            const string& name)
+{
+  // the union assures proper alignment of the events
+  union
+  {
+    struct inotify_event event;
+    char buf[4096];
+  } events;
+
+  ssize_t len;
+
+  do
+    len = read(watch_fd, events.buf, sizeof (events.buf));
+  while (len < 0 && errno == EINTR);
+
+  if (len <= 0)
+    return -1;
+
+  int found = 0;
+  char* p = events.buf;
+
+  while (p < events.buf + len)
+  {
+    struct inotify_event* event = (struct inotify_event*)p;
+
+    if (event->len && name == event->name)
+      found = 1;
+
+    p += sizeof (struct inotify_event) + event->len;
+  }
+
+  return found;
+}
+
+
+bool
+watch_wait(int watch_fd,
+           const char* file_name)
+{
+  string name = base_name(file_name);
+  int ret;
+
+  do
+    ret = read_events(watch_fd, name);
+  while (!ret);
+
+  if (ret < 0)
+    return false;
+
+  // collect further events belonging to the same change
+  for (;;)
+  {
+    struct pollfd pfd;
+
+    pfd.fd = watch_fd;
+    pfd.events = POLLIN;
+
+    ret = poll(&pfd, 1, WATCH_SETTLE_TIME);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      break;
+
+    if (read_events(watch_fd, name) < 0)
+      return false;
+  }
+
+  return true;
+}
+
+#endif // HAVE_INOTIFY
+
+// end of watch.cpp
@@ -0,0 +1,41 @@
+// watch.h
+
+// Copyright (C) 2012 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef __WATCH_H__
+#define __WATCH_H__
+
+#include <config.h>
+
+
+#ifdef HAVE_INOTIFY
+
+// Start watching file `file_name' for changes.  Return a file descriptor
+// for `watch_wait', or -1 on error.
+
+int
+watch_init(const char* file_name);
+
+
+// Wait until the watched file has been written and closed, or replaced by
+// another file (which most programs do while saving).  Return false on
+// error.
+
+bool
+watch_wait(int watch_fd,
+           const char* file_name);
+
+#endif // HAVE_INOTIFY
+
+#endif // __WATCH_H__
+
+// end of watch.h
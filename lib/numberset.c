@@ -22,6 +22,12 @@
 #include <numberset.h>
 
 
+/* The functions in this file don't use ttfautohint's memory management */
+/* (`ta_mem_alloc' and friends): they are also called by the frontends  */
+/* without a `FONT' object, and the caller frees the returned data with */
+/* `free', as documented in `numberset.h'.                              */
+
+
 const char*
 number_set_parse(const char* s,
                  number_range** number_set,
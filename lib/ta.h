@@ -23,6 +23,8 @@
 #include FT_TRUETYPE_TABLES_H
 #include FT_TRUETYPE_TAGS_H
 
+#include "tamemory.h"
+#include "tacache.h"
 #include "taloader.h"
 #include "taglobal.h"
 #include "tadummy.h"
@@ -120,6 +122,14 @@ typedef struct GLYPH_
                         /* (after walking recursively over all subglyphs) */
 
   FT_UShort num_composite_contours; /* after recursion */
+  FT_UShort num_composite_points; /* after recursion */
+
+  TA_CacheEntry* cache_entry; /* the glyph's entry in the glyph cache */
+
+  /* the value passed to the bound callback; */
+  /* valid if `have_bound' is set */
+  FT_Bool have_bound;
+  FT_UInt bound;
 } GLYPH;
 
 /* a representation of the data in the `glyf' table */
@@ -138,6 +148,12 @@ typedef struct glyf_Data_
   FT_ULong cvt_idx;
   FT_ULong fpgm_idx;
   FT_ULong prep_idx;
+
+  /* the `maxp' values computed by `TA_sfnt_compute_bytecode_limits' */
+  FT_Bool have_limits;
+  FT_UShort max_storage;
+  FT_UShort max_stack_elements;
+  FT_UShort max_twilight_points;
 } glyf_Data;
 
 /* an SFNT table */
@@ -183,6 +199,15 @@ typedef struct SFNT_
   FT_UShort max_twilight_points;
   FT_UShort max_instructions;
   FT_UShort max_components;
+
+  /* data saved by `TA_font_save_variant_state': */
+  /* a copy of the unmodified `name' table and the upper bounds */
+  /* which get replaced by `TA_sfnt_compute_bytecode_limits' */
+  FT_Byte* variant_name_buf;
+  FT_ULong variant_name_len;
+  FT_UShort variant_max_storage;
+  FT_UShort variant_max_stack_elements;
+  FT_UShort variant_max_twilight_points;
 } SFNT;
 
 /* our font object */
@@ -192,10 +217,16 @@ struct FONT_
 
   FT_Byte* in_buf;
   size_t in_len;
+  FT_UInt in_format; /* the input's container format (`TA_FORMAT_XXX') */
 
   FT_Byte* out_buf;
   size_t out_len;
 
+  /* in streaming mode, the output font gets written directly */
+  /* to this file, starting at file position `out_start' */
+  FILE* out_file;
+  long out_start;
+
   SFNT* sfnts;
   FT_Long num_sfnts;
 
@@ -209,13 +240,59 @@ struct FONT_
 
   TA_LoaderRec loader[1]; /* the interface to the autohinter */
 
+  /* all allocations go through this object; */
+  /* the copies of this structure used by worker threads */
+  /* (see `tathread.c') share it */
+  TA_Memory memory;
+  TA_MemoryRec memory_rec;
+  TA_Memory_Stats* memory_stats;
+
+  /* if set, `memory' and `lib' belong to this context */
+  TA_Context* context;
+
+  /* WOFF and WOFF2 data of the input font, */
+  /* to be preserved if we output WOFF or WOFF2 also */
+  FT_UShort woff_major_version;
+  FT_UShort woff_minor_version;
+  FT_Byte* woff_meta_buf; /* uncompressed extended metadata */
+  FT_ULong woff_meta_len;
+  FT_Byte* woff_priv_buf;
+  FT_ULong woff_priv_len;
+
+  /* the start time in milliseconds, needed for `font_time_limit' */
+  FT_ULong start_time;
+
+  /* tables with an index equal to or larger than this value */
+  /* get created anew for each variant */
+  FT_ULong variant_num_tables;
+  /* if set, keep the glyph bytecode of the previous run */
+  FT_Bool reuse_glyph_hints;
+
+  /* the number of glyphs which got the bytecode of an identical glyph */
+  FT_ULong num_duplicate_glyphs;
+
+  /* the glyph cache of the caller (if any), and the number of glyphs */
+  /* whose bytecode has been taken from it */
+  TA_Glyph_Cache* glyph_cache;
+  FT_ULong num_cached_glyphs;
+
   /* configuration options */
   TA_Progress_Func progress;
   void* progress_data;
   TA_Info_Func info;
   void* info_data;
+  TA_Limit_Func limit;
+  void* limit_data;
+  TA_Bound_Func bound;
+  void* bound_data;
+  TA_Budget_Func budget;
+  void* budget_data;
   FT_UInt hinting_range_min;
   FT_UInt hinting_range_max;
+  number_range* hinting_sizes;
+  FT_UInt hinting_convergence;
+  FT_UInt glyph_size_budget;
+  FT_UInt glyph_size_budget_deviation;
   FT_UInt hinting_limit;
   FT_UInt increase_x_height;
   number_range* x_height_snapping_exceptions;
@@ -224,14 +301,51 @@ struct FONT_
   FT_Bool dw_cleartype_strong_stem_width;
   FT_Bool windows_compatibility;
   FT_Bool pre_hinting;
+  FT_UInt pre_hinting_size;
   FT_Bool hint_with_components;
   FT_Bool ignore_restrictions;
   FT_UInt fallback_script;
   FT_Bool symbol;
+  FT_Bool device_metrics;
+  FT_Bool exact_maxp;
+  FT_UInt output_format;
+  FT_Bool reproducible;
+  FT_Bool streaming;
+  FT_UInt threads;
+  FT_UInt shard_first;
+  FT_UInt shard_last;
+  const FT_Byte* shard_buf;
+  size_t shard_len;
+  number_range* hint_glyphs;
+  FT_UInt glyph_max_points;
+  FT_UInt glyph_max_segments;
+  FT_ULong glyph_time_limit;
+  FT_ULong font_time_limit;
   FT_Bool debug;
 };
 
 
+/* the state kept between `TTF_autohint' with option `preview' */
+/* and calls of `TTF_autohint_preview_update' */
+
+struct TA_Preview_
+{
+  FONT* font; /* NULL if there is no state */
+  const char* in_buf; /* the caller's input buffer (if any) */
+  TA_Glyph_Cache* glyph_cache; /* the caller's glyph cache (if any) */
+};
+
+
+/* the state kept between calls of `TTF_autohint' with option `context' */
+
+struct TA_Context_
+{
+  TA_MemoryRec memory_rec; /* always with a pool */
+  FT_Library lib;
+  TA_Glyph_Cache* glyph_cache;
+};
+
+
 #include "tatables.h"
 #include "tabytecode.h"
 
@@ -242,6 +356,12 @@ TA_get_error_message(FT_Error error);
 void
 TA_get_current_time(FT_ULong* high,
                     FT_ULong* low);
+FT_Bool
+TA_get_source_date_epoch(FT_ULong* high,
+                         FT_ULong* low);
+
+FT_ULong
+TA_get_milliseconds(void);
 
 FT_Byte*
 TA_build_push(FT_Byte* bufp,
@@ -251,6 +371,12 @@ TA_build_push(FT_Byte* bufp,
               FT_Bool optimize);
 
 FT_Error
+TA_new_library(TA_Memory memory,
+               FT_Library* alibrary);
+FT_Error
+TA_font_new_library(FONT* font,
+                    FT_Library* alibrary);
+FT_Error
 TA_font_init(FONT* font);
 void
 TA_font_unload(FONT* font,
@@ -263,6 +389,13 @@ TA_font_file_read(FONT* font,
 FT_Error
 TA_font_file_write(FONT* font,
                    FILE* out_file);
+FT_Error
+TA_font_stream_write(FONT* font,
+                     const FT_Byte* buf,
+                     FT_ULong len);
+FT_Error
+TA_font_stream_seek(FONT* font,
+                    FT_ULong offset);
 
 FT_Error
 TA_sfnt_build_glyph_instructions(SFNT* sfnt,
@@ -274,11 +407,18 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
                                FONT* font);
 
 FT_Error
+TA_sfnt_compute_global_hints(SFNT* sfnt,
+                             FONT* font);
+FT_Error
 TA_sfnt_build_cvt_table(SFNT* sfnt,
                         FONT* font);
 
 FT_Error
-TA_table_build_DSIG(FT_Byte** DSIG);
+TA_font_build_device_tables(FONT* font);
+
+FT_Error
+TA_table_build_DSIG(FT_Byte** DSIG,
+                    FONT* font);
 
 FT_Error
 TA_sfnt_build_fpgm_table(SFNT* sfnt,
@@ -295,9 +435,25 @@ FT_Error
 TA_sfnt_build_glyf_table(SFNT* sfnt,
                          FONT* font);
 FT_Error
+TA_font_set_pre_hinting_size(FONT* font,
+                             FT_Face face);
+FT_Error
+TA_sfnt_pre_hint_glyphs(SFNT* sfnt,
+                        FONT* font,
+                        FT_Face face,
+                        FT_Long first,
+                        FT_Long last);
+FT_Error
 TA_sfnt_create_glyf_data(SFNT* sfnt,
                          FONT* font);
 FT_Error
+TA_glyph_decode_outline(TA_Memory memory,
+                        GLYPH* glyph,
+                        FT_Outline* outline);
+void
+TA_glyph_free_outline(TA_Memory memory,
+                      FT_Outline* outline);
+FT_Error
 TA_sfnt_handle_coverage(SFNT* sfnt,
                         FONT* font);
 void
@@ -309,6 +465,12 @@ TA_sfnt_copy_master_coverage(SFNT* sfnt,
                              FONT* font);
 #endif
 
+FT_Error
+TA_font_build_shard(FONT* font);
+FT_Error
+TA_sfnt_merge_shards(SFNT* sfnt,
+                     FONT* font);
+
 FT_Error
 TA_sfnt_update_GPOS_table(SFNT* sfnt,
                           FONT* font);
@@ -321,6 +483,10 @@ FT_Error
 TA_sfnt_build_loca_table(SFNT* sfnt,
                          FONT* font);
 
+FT_Error
+TA_sfnt_compute_bytecode_limits(SFNT* sfnt,
+                                FONT* font);
+
 FT_Error
 TA_sfnt_update_maxp_table(SFNT* sfnt,
                           FONT* font);
@@ -345,10 +511,72 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
                          FT_Int do_complete);
 FT_Error
 TA_font_build_TTF(FONT* font);
+FT_Error
+TA_font_start_TTF_stream(FONT* font);
+FT_Error
+TA_font_finish_TTF_stream(FONT* font);
 
 FT_Error
 TA_font_build_TTC(FONT* font);
 
+FT_Error
+TA_sfnt_pre_hint_glyf_data(SFNT* sfnt,
+                           FONT* font);
+FT_Error
+TA_font_build_glyf_tables(FONT* font);
+
+FT_Error
+TA_font_start_glyph_cache(FONT* font);
+void
+TA_font_finish_glyph_cache(FONT* font);
+FT_Error
+TA_sfnt_build_cached_glyph_instructions(SFNT* sfnt,
+                                        FONT* font,
+                                        FT_Long idx);
+FT_Bool
+TA_glyph_get_cached_limits(FONT* font,
+                           GLYPH* glyph,
+                           FT_ULong* max_storage,
+                           FT_ULong* max_stack_elements,
+                           FT_ULong* max_twilight_points);
+void
+TA_glyph_set_cached_limits(FONT* font,
+                           GLYPH* glyph,
+                           FT_ULong max_storage,
+                           FT_ULong max_stack_elements,
+                           FT_ULong max_twilight_points);
+
+FT_Error
+TA_font_save_variant_state(FONT* font);
+void
+TA_font_drop_glyph_hints(FONT* font);
+FT_Error
+TA_font_setup_variant(FONT* font,
+                      TA_Variant* variant);
+
+FT_Error
+TA_font_build_tables(FONT* font);
+FT_Error
+TA_font_build_output(FONT* font);
+
+void
+TA_preview_keep(TA_Preview* preview,
+                FONT* font,
+                const char* in_buf);
+void
+TA_preview_release(TA_Preview* preview);
+
+void
+TA_context_attach(TA_Context* context,
+                  FONT* font,
+                  size_t memory_limit);
+
+FT_Error
+TA_font_unwrap_WOFF(FONT* font,
+                    FT_Bool free_in_buf);
+FT_Error
+TA_font_wrap_WOFF(FONT* font);
+
 #endif /* __TA_H__ */
 
 /* end of ta.h */
@@ -41,6 +41,15 @@ typedef struct Hints_Record_
   FT_UInt buf_len;
 } Hints_Record;
 
+/* a PPEM value at which the action or point hints records change; */
+/* this data is only collected if there is a glyph size budget */
+typedef struct Hints_Boundary_
+{
+  FT_UInt size;
+  FT_ULong displacements; /* offset of the boundary's three vectors */
+                          /* in the displacement buffer */
+} Hints_Boundary;
+
 typedef struct Recorder_
 {
   FONT* font;
@@ -252,7 +261,7 @@ TA_sfnt_build_glyph_segments(SFNT* sfnt,
   /* collect all arguments temporarily in an array (in reverse order) */
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and NPUSHW, respectively */
-  args = (FT_UInt*)malloc(num_args * sizeof (FT_UInt));
+  args = (FT_UInt*)ta_mem_alloc(font->memory, num_args * sizeof (FT_UInt));
   if (!args)
     return NULL;
 
@@ -375,7 +384,7 @@ TA_sfnt_build_glyph_segments(SFNT* sfnt,
   if (num_stack_elements > sfnt->max_stack_elements)
     sfnt->max_stack_elements = num_stack_elements;
 
-  free(args);
+  ta_mem_free(font->memory, args);
 
   return bufp;
 }
@@ -406,7 +415,7 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
   /* collect all arguments temporarily in an array (in reverse order) */
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and NPUSHW, respectively */
-  args = (FT_UInt*)malloc(num_args * sizeof (FT_UInt));
+  args = (FT_UInt*)ta_mem_alloc(font->memory, num_args * sizeof (FT_UInt));
   if (!args)
     return NULL;
 
@@ -468,7 +477,7 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
   if (num_stack_elements > sfnt->max_stack_elements)
     sfnt->max_stack_elements = num_stack_elements;
 
-  free(args);
+  ta_mem_free(font->memory, args);
 
   return bufp;
 }
@@ -476,11 +485,9 @@ TA_sfnt_build_glyph_scaler(SFNT* sfnt,
 
 static FT_Byte*
 TA_font_build_subglyph_shifter(FONT* font,
+                               glyf_Data* data,
                                FT_Byte* bufp)
 {
-  FT_Face face = font->loader->face;
-  FT_GlyphSlot glyph = face->glyph;
-
   TA_GlyphLoader gloader = font->loader->gloader;
 
   TA_SubGlyph subglyphs = gloader->base.subglyphs;
@@ -492,7 +499,7 @@ TA_font_build_subglyph_shifter(FONT* font,
 
   for (subglyph = subglyphs; subglyph < subglyph_limit; subglyph++)
   {
-    FT_Error error;
+    GLYPH* glyph;
 
     FT_UShort flags = subglyph->flags;
     FT_Pos y_offset = subglyph->arg2;
@@ -500,11 +507,14 @@ TA_font_build_subglyph_shifter(FONT* font,
     FT_Int num_contours;
 
 
-    /* load subglyph to get the number of contours */
-    error = FT_Load_Glyph(face, subglyph->index, FT_LOAD_NO_SCALE);
-    if (error)
+    if ((FT_UInt)subglyph->index >= data->num_glyphs)
       return NULL;
-    num_contours = glyph->outline.n_contours;
+
+    /* the number of contours of composite subglyphs */
+    /* has been computed while splitting the `glyf' table */
+    glyph = &data->glyphs[subglyph->index];
+    num_contours = glyph->num_components ? glyph->num_composite_contours
+                                         : glyph->num_contours;
 
     /* nothing to do if there is a point-to-point alignment */
     if (!(flags & FT_SUBGLYPH_FLAG_ARGS_ARE_XY_VALUES))
@@ -518,9 +528,6 @@ TA_font_build_subglyph_shifter(FONT* font,
     if (!num_contours)
       goto End;
 
-    /* note that calling `FT_Load_Glyph' without FT_LOAD_NO_RECURSE */
-    /* ensures that composite subglyphs are represented as simple glyphs */
-
     if (num_contours > 0xFF
         || curr_contour > 0xFF)
     {
@@ -842,7 +849,8 @@ TA_hints_record_is_different(Hints_Record* hints_records,
 
 
 static FT_Error
-TA_add_hints_record(Hints_Record** hints_records,
+TA_add_hints_record(TA_Memory memory,
+                    Hints_Record** hints_records,
                     FT_UInt* num_hints_records,
                     FT_Byte* start,
                     Hints_Record hints_record)
@@ -857,7 +865,7 @@ TA_add_hints_record(Hints_Record** hints_records,
 
   /* now fill the structure completely */
   hints_record.buf_len = buf_len;
-  hints_record.buf = (FT_Byte*)malloc(buf_len);
+  hints_record.buf = (FT_Byte*)ta_mem_alloc(memory, buf_len);
   if (!hints_record.buf)
     return FT_Err_Out_Of_Memory;
 
@@ -865,11 +873,12 @@ TA_add_hints_record(Hints_Record** hints_records,
 
   (*num_hints_records)++;
   hints_records_new =
-    (Hints_Record*)realloc(*hints_records, *num_hints_records
-                                           * sizeof (Hints_Record));
+    (Hints_Record*)ta_mem_realloc(memory,
+                                  *hints_records, *num_hints_records
+                                                  * sizeof (Hints_Record));
   if (!hints_records_new)
   {
-    free(hints_record.buf);
+    ta_mem_free(memory, hints_record.buf);
     (*num_hints_records)--;
     return FT_Err_Out_Of_Memory;
   }
@@ -1008,16 +1017,208 @@ TA_emit_hints_records(Recorder* recorder,
 
 
 static void
-TA_free_hints_records(Hints_Record* hints_records,
+TA_free_hints_records(TA_Memory memory,
+                      Hints_Record* hints_records,
                       FT_UInt num_hints_records)
 {
   FT_UInt i;
 
 
   for (i = 0; i < num_hints_records; i++)
-    free(hints_records[i].buf);
+    ta_mem_free(memory, hints_records[i].buf);
+
+  ta_mem_free(memory, hints_records);
+}
+
+
+/* the number of bytes `TA_emit_hints_records' needs for a hints record */
+/* which is not the last one (if `optimize' is set) */
+
+static FT_UInt
+TA_hints_record_len(Hints_Record* hints_record)
+{
+  FT_Byte* p;
+  FT_Byte* endp;
+  FT_Bool need_words = 0;
+
+  FT_UInt num_arguments;
+  FT_UInt len;
+
+
+  endp = hints_record->buf + hints_record->buf_len;
+  for (p = hints_record->buf; p < endp; p += 2)
+    if (*p)
+      need_words = 1;
+
+  num_arguments = hints_record->buf_len / 2;
+
+  len = num_arguments * (need_words ? 2 : 1);
+  if (num_arguments % 255 > 8)
+    len += 2;
+  else if (num_arguments % 255)
+    len++;
+  len += 2 * (num_arguments / 255);
+
+  /* MPPEM, PUSHB_1 (or PUSHW_1), LT, IF, ELSE, and EIF */
+  len += (hints_record->size > 0xFF) ? 7 : 6;
+
+  return len;
+}
+
+
+/* remove the hints record starting at `size' (if any), */
+/* returning the number of saved bytes */
+
+static FT_UInt
+TA_remove_hints_record(TA_Memory memory,
+                       Hints_Record* hints_records,
+                       FT_UInt* num_hints_records,
+                       FT_UInt size)
+{
+  FT_UInt i;
+  FT_UInt len;
+
+
+  /* the first record is never removed */
+  for (i = 1; i < *num_hints_records; i++)
+    if (hints_records[i].size == size)
+      break;
+  if (i == *num_hints_records)
+    return 0;
+
+  len = TA_hints_record_len(&hints_records[i]);
+
+  ta_mem_free(memory, hints_records[i].buf);
+  (*num_hints_records)--;
+  memmove(hints_records + i,
+          hints_records + i + 1,
+          (*num_hints_records - i) * sizeof (Hints_Record));
+
+  return len;
+}
+
+
+/*
+ * Merge adjacent hints records to save at least `excess' bytes of
+ * bytecode.  At a boundary, both the action and the point hints records
+ * starting there get removed, thus the records of the previous PPEM value
+ * are used instead.
+ *
+ * To estimate the quality loss, we use the distances between the hinted
+ * and unhinted point positions (in 26.6 format).  For each boundary,
+ * `displacements' holds three vectors of `num_points' elements: the
+ * minimum and maximum distances at all examined sizes using the
+ * boundary's hints, and the distances at the last size for which the
+ * hints have been computed.  Merging a boundary causes a deviation which
+ * is the largest difference between the distances at the sizes which get
+ * the previous hints instead and the distances at the last size for
+ * which the previous hints have been computed.  We always remove the
+ * boundary with the smallest deviation, which must not exceed
+ * `max_deviation' (in 1/64th pixel).
+ *
+ * The return value is the number of removed boundaries; `deviation' is
+ * set to the largest deviation of all merged boundaries.
+ */
 
-  free(hints_records);
+static FT_UInt
+TA_merge_hints_records(TA_Memory memory,
+                       Hints_Boundary* boundaries,
+                       FT_UInt* num_boundaries,
+                       FT_Short* displacements,
+                       FT_UInt num_points,
+                       Hints_Record* action_hints_records,
+                       FT_UInt* num_action_hints_records,
+                       Hints_Record* point_hints_records,
+                       FT_UInt* num_point_hints_records,
+                       FT_UInt excess,
+                       FT_UInt max_deviation,
+                       FT_UInt* deviation)
+{
+  FT_UInt num_merged = 0;
+  FT_UInt saved = 0;
+
+
+  while (saved < excess)
+  {
+    FT_UInt i, n;
+    FT_UInt best = 0;
+    FT_UInt best_error = 0;
+    FT_Short* min;
+    FT_Short* max;
+    FT_Short* prev_min;
+    FT_Short* prev_max;
+
+
+    /* the first boundary is the start of the hinting range */
+    for (i = 1; i < *num_boundaries; i++)
+    {
+      FT_Short* exact = displacements + boundaries[i - 1].displacements
+                        + 2 * num_points;
+      FT_UInt error = 0;
+
+
+      min = displacements + boundaries[i].displacements;
+      max = min + num_points;
+
+      /* the largest difference is found at the extrema */
+      for (n = 0; n < num_points; n++)
+      {
+        FT_UInt diff_min = (FT_UInt)TA_ABS(min[n] - exact[n]);
+        FT_UInt diff_max = (FT_UInt)TA_ABS(max[n] - exact[n]);
+
+
+        if (diff_min > error)
+          error = diff_min;
+        if (diff_max > error)
+          error = diff_max;
+      }
+
+      if (error <= max_deviation
+          && (!best || error < best_error))
+      {
+        best = i;
+        best_error = error;
+      }
+    }
+
+    if (!best)
+      break;
+
+    saved += TA_remove_hints_record(memory,
+                                    action_hints_records,
+                                    num_action_hints_records,
+                                    boundaries[best].size);
+    saved += TA_remove_hints_record(memory,
+                                    point_hints_records,
+                                    num_point_hints_records,
+                                    boundaries[best].size);
+
+    if (best_error > *deviation)
+      *deviation = best_error;
+
+    /* the previous boundary's hints now cover the sizes of both */
+    min = displacements + boundaries[best].displacements;
+    max = min + num_points;
+    prev_min = displacements + boundaries[best - 1].displacements;
+    prev_max = prev_min + num_points;
+
+    for (n = 0; n < num_points; n++)
+    {
+      if (min[n] < prev_min[n])
+        prev_min[n] = min[n];
+      if (max[n] > prev_max[n])
+        prev_max[n] = max[n];
+    }
+
+    (*num_boundaries)--;
+    memmove(boundaries + best,
+            boundaries + best + 1,
+            (*num_boundaries - best) * sizeof (Hints_Boundary));
+
+    num_merged++;
+  }
+
+  return num_merged;
 }
 
 
@@ -1527,8 +1728,9 @@ TA_init_recorder(Recorder* recorder,
       recorder->num_wrap_around_segments++;
 
   recorder->wrap_around_segments =
-    (FT_UShort*)malloc(recorder->num_wrap_around_segments
-                       * sizeof (FT_UShort));
+    (FT_UShort*)ta_mem_alloc(font->memory,
+                             recorder->num_wrap_around_segments
+                             * sizeof (FT_UShort));
   if (!recorder->wrap_around_segments)
     return FT_Err_Out_Of_Memory;
 
@@ -1552,12 +1754,14 @@ TA_init_recorder(Recorder* recorder,
   recorder->num_strong_points = num_strong_points;
 
   recorder->ip_before_points =
-    (FT_UShort*)malloc(num_strong_points * sizeof (FT_UShort));
+    (FT_UShort*)ta_mem_alloc(font->memory,
+                             num_strong_points * sizeof (FT_UShort));
   if (!recorder->ip_before_points)
     return FT_Err_Out_Of_Memory;
 
   recorder->ip_after_points =
-    (FT_UShort*)malloc(num_strong_points * sizeof (FT_UShort));
+    (FT_UShort*)ta_mem_alloc(font->memory,
+                             num_strong_points * sizeof (FT_UShort));
   if (!recorder->ip_after_points)
     return FT_Err_Out_Of_Memory;
 
@@ -1565,14 +1769,16 @@ TA_init_recorder(Recorder* recorder,
   /* however, this value isn't known yet */
   /* (or rather, it can vary between different pixel sizes) */
   recorder->ip_on_point_array =
-    (FT_UShort*)malloc(axis->num_segments
-                       * num_strong_points * sizeof (FT_UShort));
+    (FT_UShort*)ta_mem_alloc(font->memory,
+                             axis->num_segments
+                             * num_strong_points * sizeof (FT_UShort));
   if (!recorder->ip_on_point_array)
     return FT_Err_Out_Of_Memory;
 
   recorder->ip_between_point_array =
-    (FT_UShort*)malloc(axis->num_segments * axis->num_segments
-                       * num_strong_points * sizeof (FT_UShort));
+    (FT_UShort*)ta_mem_alloc(font->memory,
+                             axis->num_segments * axis->num_segments
+                             * num_strong_points * sizeof (FT_UShort));
   if (!recorder->ip_between_point_array)
     return FT_Err_Out_Of_Memory;
 
@@ -1617,12 +1823,126 @@ TA_rewind_recorder(Recorder* recorder,
 static void
 TA_free_recorder(Recorder* recorder)
 {
-  free(recorder->wrap_around_segments);
+  TA_Memory memory = recorder->font->memory;
+
+
+  ta_mem_free(memory, recorder->wrap_around_segments);
 
-  free(recorder->ip_before_points);
-  free(recorder->ip_after_points);
-  free(recorder->ip_on_point_array);
-  free(recorder->ip_between_point_array);
+  ta_mem_free(memory, recorder->ip_before_points);
+  ta_mem_free(memory, recorder->ip_after_points);
+  ta_mem_free(memory, recorder->ip_on_point_array);
+  ta_mem_free(memory, recorder->ip_between_point_array);
+}
+
+
+/* check whether the time budget for the current glyph */
+/* (which started at `start_time') or for the whole font is exhausted; */
+/* return the corresponding `TA_LIMIT_XXX' value in this case */
+
+static int
+TA_font_check_time_limits(FONT* font,
+                          FT_ULong start_time)
+{
+  FT_ULong now;
+
+
+  if (!font->glyph_time_limit && !font->font_time_limit)
+    return 0;
+
+  now = TA_get_milliseconds();
+
+  if (font->font_time_limit
+      && now - font->start_time > font->font_time_limit)
+    return TA_LIMIT_FONT_TIME;
+  if (font->glyph_time_limit
+      && now - start_time > font->glyph_time_limit)
+    return TA_LIMIT_GLYPH_TIME;
+
+  return 0;
+}
+
+
+static void
+TA_sfnt_report_limit(SFNT* sfnt,
+                     FONT* font,
+                     FT_Long idx,
+                     int limit)
+{
+#ifdef DEBUGGING
+  if (font->debug)
+    fprintf(stderr, "glyph %ld: limit %d exceeded, glyph gets scaled only\n",
+                    idx, limit);
+#endif
+
+  if (font->limit)
+    font->limit(idx, sfnt - font->sfnts, limit, font->limit_data);
+}
+
+
+/* check whether the scaling of the glyph just loaded */
+/* with `ta_loader_load_glyph' can still change qualitatively */
+/* for sizes larger than `size' */
+
+static FT_Bool
+TA_font_scaling_is_stable(FONT* font,
+                          FT_UInt size)
+{
+  TA_ScriptMetrics metrics = font->loader->metrics;
+  TA_AxisHints axis = &font->loader->hints.axis[TA_DIMENSION_VERT];
+  TA_LatinAxis latin;
+  FT_Pos threshold;
+  number_range* range;
+  FT_UInt nn;
+
+
+  /* we only know the details of the latin module */
+  if (metrics->clazz != &ta_latin_script_class)
+    return 0;
+
+  /* a blue zone gets deactivated if it is taller than 3/4px, */
+  /* and it stays inactive for all larger sizes; */
+  /* flat blue zones (without overshoot) are always active */
+  latin = &((TA_LatinMetrics)metrics)->axis[TA_DIMENSION_VERT];
+
+  /* an edge is never assigned to a blue zone */
+  /* if its distance is larger than this value */
+  /* (cf. `ta_latin_hints_compute_blue_edges') */
+  threshold = ((TA_LatinMetrics)metrics)->units_per_em / 40;
+
+  for (nn = 0; nn < latin->blue_count; nn++)
+  {
+    TA_LatinBlue blue = &latin->blues[nn];
+    FT_Int ee;
+
+
+    if (!(blue->flags & TA_LATIN_BLUE_ACTIVE)
+        || blue->ref.org == blue->shoot.org)
+      continue;
+
+    /* the deactivation only matters if the glyph uses this zone */
+    for (ee = 0; ee < axis->num_edges; ee++)
+    {
+      FT_Pos fpos = axis->edges[ee].fpos;
+
+
+      if (TA_ABS(fpos - blue->ref.org) <= threshold
+          || TA_ABS(fpos - blue->shoot.org) <= threshold)
+        return 0;
+    }
+  }
+
+  /* the rounding of the x height depends on those options */
+  if (font->increase_x_height
+      && size < font->increase_x_height)
+    return 0;
+
+  for (range = font->x_height_snapping_exceptions;
+       range;
+       range = range->next)
+    if ((FT_UInt)range->end > size)
+      return 0;
+
+  return 1;
 }
 
 
@@ -1658,6 +1978,27 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   FT_Int32 load_flags;
   FT_UInt size;
 
+  FT_Outline outline;
+  FT_Bool have_outline = 0;
+
+  FT_ULong start_time = 0;
+  int limit = 0;
+
+  FT_UInt prev_size = 0;
+  FT_UInt record_size;
+
+  FT_UInt bound = 0;
+  FT_UInt num_unchanged = 0;
+
+  /* data for the glyph size budget */
+  Hints_Boundary* boundaries = NULL;
+  FT_UInt num_boundaries = 0;
+  FT_Short* displacements = NULL;
+  FT_ULong displacements_size = 0; /* allocated number of elements */
+  FT_UInt num_points = 0; /* the number of points per displacement vector */
+  FT_UInt budget_len = 0; /* the bytecode length before merging */
+  FT_UInt budget_deviation = 0;
+
   FT_Byte* pos[3];
 
 #ifdef TA_DEBUG
@@ -1665,6 +2006,15 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
 #endif
 
 
+  if (font->glyph_time_limit)
+    start_time = TA_get_milliseconds();
+
+  /* we might jump to `Err' before `TA_init_recorder' gets called */
+  memset(&recorder, 0, sizeof (Recorder));
+  recorder.font = font;
+
+  glyph->have_bound = 0;
+
   /* XXX: right now, we abuse this flag to control */
   /*      the global behaviour of the auto-hinter */
   load_flags = 1 << 29; /* vertical hinting only */
@@ -1713,7 +2063,7 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   /* to hold all of the created bytecode instructions; */
   /* later on it gets reallocated to its real size */
   ins_len = hints->num_points * 1000;
-  ins_buf = (FT_Byte*)malloc(ins_len);
+  ins_buf = (FT_Byte*)ta_mem_alloc(font->memory, ins_len);
   if (!ins_buf)
     return FT_Err_Out_Of_Memory;
 
@@ -1724,7 +2074,7 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   /* handle composite glyph */
   if (font->loader->gloader->base.num_subglyphs)
   {
-    bufp = TA_font_build_subglyph_shifter(font, ins_buf);
+    bufp = TA_font_build_subglyph_shifter(font, data, ins_buf);
     if (!bufp)
     {
       error = FT_Err_Out_Of_Memory;
@@ -1734,8 +2084,27 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
     goto Done1;
   }
 
+  /* check the complexity limits; */
+  /* this must be done before `TA_init_recorder' */
+  /* which allocates arrays depending on the glyph's complexity */
+  limit = TA_font_check_time_limits(font, start_time);
+  if (!limit
+      && font->glyph_max_points
+      && (FT_UInt)hints->num_points > font->glyph_max_points)
+    limit = TA_LIMIT_POINTS;
+  if (!limit
+      && font->glyph_max_segments
+      && (FT_UInt)hints->axis[TA_DIMENSION_VERT].num_segments
+           > font->glyph_max_segments)
+    limit = TA_LIMIT_SEGMENTS;
+
+  if (limit)
+    TA_sfnt_report_limit(sfnt, font, idx, limit);
+
   /* only scale the glyph if the dummy hinter has been used */
-  if (font->loader->metrics->clazz == &ta_dummy_script_class)
+  /* or if we have exceeded a limit */
+  if (font->loader->metrics->clazz == &ta_dummy_script_class
+      || limit)
   {
     /* since `TA_init_recorder' hasn't been called yet, */
     /* we manually initialize the `font' and `glyph' fields */
@@ -1756,6 +2125,23 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   if (error)
     goto Err;
 
+  if (font->glyph_size_budget)
+  {
+    FT_ULong range = font->hinting_range_max - font->hinting_range_min + 1;
+
+
+    num_points = (FT_UInt)hints->num_points;
+
+    boundaries = (Hints_Boundary*)ta_mem_alloc(font->memory,
+                                               range
+                                               * sizeof (Hints_Boundary));
+    if (!boundaries)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+  }
+
   /* loop over a large range of pixel sizes */
   /* to find hints records which get pushed onto the bytecode stack */
 
@@ -1784,16 +2170,47 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
                                     TA_hints_recorder,
                                     (void*)&recorder);
 
+  /* the unscaled outline is the same for all sizes, */
+  /* so we decode it only once (if possible) */
+  if (!font->pre_hinting
+      && !TA_glyph_decode_outline(font->memory, glyph, &outline))
+  {
+    have_outline = 1;
+    ta_loader_register_outline(font->loader, (FT_UInt)idx, &outline);
+  }
+
   for (size = font->hinting_range_min;
        size <= font->hinting_range_max;
        size++)
   {
+    FT_Bool changed = 0;
 #ifdef DEBUGGING
     int have_dumps = 0;
 #endif
 
 
-    TA_rewind_recorder(&recorder, ins_buf, size);
+    /* only handle sizes given by `hinting-sizes' (if set) */
+    if (font->hinting_sizes
+        && !number_set_is_element(font->hinting_sizes, (int)size))
+      continue;
+
+    /* give up if we are running out of time */
+    limit = TA_font_check_time_limits(font, start_time);
+    if (limit)
+    {
+      TA_sfnt_report_limit(sfnt, font, idx, limit);
+      break;
+    }
+
+    /* for sizes between two hinted sizes we want the nearest record; */
+    /* since `TA_emit_hints_records' selects a record for all PPEM */
+    /* values larger than or equal to the record's size, we assign */
+    /* the midpoint between the previous hinted size and `size' */
+    /* (this is a no-op for a contiguous range of sizes) */
+    record_size = prev_size ? (prev_size + size + 1) / 2 : size;
+    prev_size = size;
+
+    TA_rewind_recorder(&recorder, ins_buf, record_size);
 
     error = FT_Set_Pixel_Sizes(face, size, size);
     if (error)
@@ -1845,11 +2262,14 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
       }
 #endif
 
-      error = TA_add_hints_record(&action_hints_records,
+      error = TA_add_hints_record(font->memory,
+                                  &action_hints_records,
                                   &num_action_hints_records,
                                   ins_buf, recorder.hints_record);
       if (error)
         goto Err;
+
+      changed = 1;
     }
 
     /* now handle point records */
@@ -1894,17 +2314,130 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
       }
 #endif
 
-      error = TA_add_hints_record(&point_hints_records,
+      error = TA_add_hints_record(font->memory,
+                                  &point_hints_records,
                                   &num_point_hints_records,
                                   ins_buf, recorder.hints_record);
       if (error)
         goto Err;
+
+      changed = 1;
+    }
+
+    if (changed)
+    {
+      bound = record_size;
+      num_unchanged = 0;
+    }
+    else
+      num_unchanged++;
+
+    /* for the glyph size budget, we collect the hinted point positions */
+    /* (relative to the unhinted ones) per boundary; */
+    /* the memory thus grows with the number of hints records only */
+    if (boundaries && (changed || num_boundaries))
+    {
+      FT_Short* min;
+      FT_Short* max;
+      FT_Short* exact;
+      FT_UInt i;
+
+
+      if (changed)
+      {
+        FT_ULong offset = (FT_ULong)num_boundaries * 3 * num_points;
+
+
+        if (offset + 3 * num_points > displacements_size)
+        {
+          FT_ULong size_new = 2 * displacements_size;
+          FT_Short* displacements_new;
+
+
+          if (size_new < offset + 3 * num_points)
+            size_new = offset + 3 * num_points;
+
+          displacements_new = (FT_Short*)ta_mem_realloc(
+                                font->memory,
+                                displacements,
+                                size_new * sizeof (FT_Short));
+          if (!displacements_new)
+          {
+            error = FT_Err_Out_Of_Memory;
+            goto Err;
+          }
+          displacements = displacements_new;
+          displacements_size = size_new;
+        }
+
+        boundaries[num_boundaries].size = record_size;
+        boundaries[num_boundaries].displacements = offset;
+        num_boundaries++;
+      }
+
+      min = displacements + boundaries[num_boundaries - 1].displacements;
+      max = min + num_points;
+      exact = max + num_points;
+
+      for (i = 0; i < num_points; i++)
+      {
+        TA_Point point = &hints->points[i];
+        FT_Pos displacement = point->y - point->oy;
+        FT_Short d;
+
+
+        if (displacement > 0x7FFF)
+          displacement = 0x7FFF;
+        else if (displacement < -0x7FFF)
+          displacement = -0x7FFF;
+        d = (FT_Short)displacement;
+
+        if (changed || d < min[i])
+          min[i] = d;
+        if (changed || d > max[i])
+          max[i] = d;
+        exact[i] = d;
+      }
+    }
+
+    /* stop if the hints have converged */
+    if (font->hinting_convergence
+        && num_unchanged >= font->hinting_convergence
+        && TA_font_scaling_is_stable(font, size))
+    {
+#ifdef DEBUGGING
+      if (font->debug)
+        fprintf(stderr, "hints converged at size %d, stopping\n\n", bound);
+#endif
+      break;
     }
   }
 
-  if (num_action_hints_records == 1 && !action_hints_records[0].num_actions)
+  /* glyphs which reuse this bytecode (duplicates and cached glyphs) */
+  /* get the same bound reported */
+  if (!limit)
   {
-    /* since we only have a single empty record we just scale the glyph */
+    glyph->have_bound = 1;
+    glyph->bound = bound;
+
+    if (font->bound)
+      font->bound(idx, sfnt - font->sfnts, (int)bound, font->bound_data);
+  }
+
+  if (have_outline)
+  {
+    ta_loader_register_outline(font->loader, 0, NULL);
+    TA_glyph_free_outline(font->memory, &outline);
+    have_outline = 0;
+  }
+
+Emit:
+  if (limit
+      || (num_action_hints_records == 1
+          && !action_hints_records[0].num_actions))
+  {
+    /* since we only have a single empty record */
+    /* (or we have to abandon the hints) we just scale the glyph */
     bufp = TA_sfnt_build_glyph_scaler(sfnt, &recorder, ins_buf);
     if (!bufp)
     {
@@ -2061,10 +2594,42 @@ Done2:
   while (*p != INS_A0)
     *(p++) = INS_A0;
 
+  /* if the bytecode exceeds the size budget, */
+  /* merge hints records and emit everything again */
+  if (boundaries
+      && (FT_UInt)(bufp - ins_buf) > font->glyph_size_budget)
+  {
+    if (!budget_len)
+      budget_len = (FT_UInt)(bufp - ins_buf);
+
+    if (TA_merge_hints_records(font->memory,
+                               boundaries, &num_boundaries,
+                               displacements, num_points,
+                               action_hints_records,
+                               &num_action_hints_records,
+                               point_hints_records,
+                               &num_point_hints_records,
+                               (FT_UInt)(bufp - ins_buf)
+                                 - font->glyph_size_budget,
+                               font->glyph_size_budget_deviation,
+                               &budget_deviation))
+    {
+      memset(ins_buf, INS_A0, (size_t)(bufp - ins_buf));
+      recorder.num_stack_elements = 0;
+      optimize = 0;
+
+      goto Emit;
+    }
+  }
+
 Done:
-  TA_free_hints_records(action_hints_records, num_action_hints_records);
-  TA_free_hints_records(point_hints_records, num_point_hints_records);
+  TA_free_hints_records(font->memory,
+                        action_hints_records, num_action_hints_records);
+  TA_free_hints_records(font->memory,
+                        point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
+  ta_mem_free(font->memory, boundaries);
+  ta_mem_free(font->memory, displacements);
 
   /* we are done, so reallocate the instruction array to its real size */
   if (*bufp == INS_A0)
@@ -2084,19 +2649,35 @@ Done:
 Done1:
   ins_len = bufp - ins_buf;
 
+  if (budget_len && font->budget)
+    font->budget(idx, sfnt - font->sfnts, (long)budget_len, (long)ins_len,
+                 (int)budget_deviation, font->budget_data);
+
   if (ins_len > sfnt->max_instructions)
     sfnt->max_instructions = ins_len;
 
-  glyph->ins_buf = (FT_Byte*)realloc(ins_buf, ins_len);
+  /* if shrinking the buffer fails we simply keep it */
+  p = (FT_Byte*)ta_mem_realloc(font->memory, ins_buf, ins_len);
+  glyph->ins_buf = p ? p : ins_buf;
   glyph->ins_len = ins_len;
 
   return FT_Err_Ok;
 
 Err:
-  TA_free_hints_records(action_hints_records, num_action_hints_records);
-  TA_free_hints_records(point_hints_records, num_point_hints_records);
+  if (have_outline)
+  {
+    ta_loader_register_outline(font->loader, 0, NULL);
+    TA_glyph_free_outline(font->memory, &outline);
+  }
+
+  TA_free_hints_records(font->memory,
+                        action_hints_records, num_action_hints_records);
+  TA_free_hints_records(font->memory,
+                        point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
-  free(ins_buf);
+  ta_mem_free(font->memory, boundaries);
+  ta_mem_free(font->memory, displacements);
+  ta_mem_free(font->memory, ins_buf);
 
   return error;
 }
@@ -0,0 +1,691 @@
+/* tacache.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * A glyph cache which survives calls of `TTF_autohint'.
+ *
+ * The key of an entry is the glyph's script together with the glyph data
+ * (without instructions); for composite glyphs, the data of all
+ * components is appended recursively.  The value is the created
+ * bytecode, together with the glyph's contribution to the `maxp' upper
+ * bounds collected while emitting bytecode.  If option `exact-maxp' is
+ * set, the exact `maxp' values of the glyph's bytecode get added after
+ * analyzing it, so later runs can skip the analysis also.
+ *
+ * Everything else which influences the bytecode of a glyph, this is, the
+ * `cvt ' tables (holding the blue zones and standard widths of all
+ * scripts), the units per EM, and the relevant options, forms the global
+ * key.  The same data also determines the `prep' table, which the exact
+ * `maxp' values depend on.  If the global key differs from the previous
+ * run, the cache gets emptied before hinting.  After a run, entries not
+ * used by it get removed.
+ *
+ * The cache must live longer than the memory object of a single run, so
+ * it uses the standard C allocation functions directly.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+
+/* the initial number of hash buckets */
+#define TA_CACHE_NUM_BUCKETS 1024
+
+/* limits to avoid an explosion of composite glyph keys */
+#define TA_CACHE_MAX_KEY_LEN (1UL << 20)
+#define TA_CACHE_MAX_DEPTH 32
+
+
+#ifdef HAVE_PTHREAD
+#  define TA_CACHE_LOCK(cache) pthread_mutex_lock(&(cache)->lock)
+#  define TA_CACHE_UNLOCK(cache) pthread_mutex_unlock(&(cache)->lock)
+#else
+#  define TA_CACHE_LOCK(cache) do { } while (0)
+#  define TA_CACHE_UNLOCK(cache) do { } while (0)
+#endif
+
+
+typedef struct Key_Buffer_
+{
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_ULong size;
+
+  /* set on allocation errors and if the key gets too long */
+  FT_Bool invalid;
+} Key_Buffer;
+
+
+static void
+TA_key_append(Key_Buffer* key,
+              TA_Memory memory,
+              const FT_Byte* data,
+              FT_ULong len)
+{
+  if (key->invalid || !len)
+    return;
+
+  if (key->len + len > TA_CACHE_MAX_KEY_LEN)
+  {
+    key->invalid = 1;
+    return;
+  }
+
+  if (key->len + len > key->size)
+  {
+    FT_ULong size = key->size ? key->size : 256;
+    FT_Byte* buf_new;
+
+
+    while (size < key->len + len)
+      size <<= 1;
+
+    buf_new = (FT_Byte*)ta_mem_realloc(memory, key->buf, size);
+    if (!buf_new)
+    {
+      key->invalid = 1;
+      return;
+    }
+
+    key->buf = buf_new;
+    key->size = size;
+  }
+
+  memcpy(key->buf + key->len, data, len);
+  key->len += len;
+}
+
+
+static void
+TA_key_append_ulong(Key_Buffer* key,
+                    TA_Memory memory,
+                    FT_ULong value)
+{
+  FT_Byte buf[4];
+
+
+  buf[0] = (FT_Byte)(value >> 24);
+  buf[1] = (FT_Byte)(value >> 16);
+  buf[2] = (FT_Byte)(value >> 8);
+  buf[3] = (FT_Byte)value;
+
+  TA_key_append(key, memory, buf, 4);
+}
+
+
+static void
+TA_key_append_number_set(Key_Buffer* key,
+                         TA_Memory memory,
+                         number_range* range)
+{
+  number_range* r;
+  FT_ULong num_ranges = 0;
+
+
+  for (r = range; r; r = r->next)
+    num_ranges++;
+
+  TA_key_append_ulong(key, memory, num_ranges);
+
+  for (r = range; r; r = r->next)
+  {
+    TA_key_append_ulong(key, memory, (FT_ULong)r->start);
+    TA_key_append_ulong(key, memory, (FT_ULong)r->end);
+  }
+}
+
+
+/* the composite glyphs form a directed acyclic graph */
+/* (checked while computing the composite glyph data) */
+
+static void
+TA_key_append_glyph(Key_Buffer* key,
+                    TA_Memory memory,
+                    glyf_Data* data,
+                    FT_UShort idx,
+                    FT_UInt depth)
+{
+  GLYPH* glyph = &data->glyphs[idx];
+  FT_ULong len = glyph->len1 + glyph->len2;
+  FT_UShort i;
+
+
+  if (depth > TA_CACHE_MAX_DEPTH)
+  {
+    key->invalid = 1;
+    return;
+  }
+
+  /* the length makes the concatenation of glyph data unambiguous */
+  TA_key_append_ulong(key, memory, len);
+  TA_key_append(key, memory, glyph->buf, len);
+
+  for (i = 0; i < glyph->num_components; i++)
+    TA_key_append_glyph(key, memory, data, glyph->components[i], depth + 1);
+}
+
+
+static void
+TA_font_compute_global_key(FONT* font,
+                           Key_Buffer* key)
+{
+  TA_Memory memory = font->memory;
+  FT_Long i;
+
+
+  TA_key_append_ulong(key, memory, font->hinting_range_min);
+  TA_key_append_ulong(key, memory, font->hinting_range_max);
+  TA_key_append_ulong(key, memory, font->hinting_limit);
+  TA_key_append_ulong(key, memory, font->hinting_convergence);
+  TA_key_append_ulong(key, memory, font->glyph_size_budget);
+  TA_key_append_ulong(key, memory, font->glyph_size_budget_deviation);
+  TA_key_append_ulong(key, memory, font->increase_x_height);
+  TA_key_append_ulong(key, memory, font->gray_strong_stem_width);
+  TA_key_append_ulong(key, memory, font->gdi_cleartype_strong_stem_width);
+  TA_key_append_ulong(key, memory, font->dw_cleartype_strong_stem_width);
+  TA_key_append_ulong(key, memory, font->windows_compatibility);
+  TA_key_append_ulong(key, memory, font->hint_with_components);
+  TA_key_append_ulong(key, memory, font->fallback_script);
+  TA_key_append_ulong(key, memory, font->symbol);
+  TA_key_append_ulong(key, memory, font->glyph_max_points);
+  TA_key_append_ulong(key, memory, font->glyph_max_segments);
+  TA_key_append_number_set(key, memory, font->hinting_sizes);
+  TA_key_append_number_set(key, memory, font->x_height_snapping_exceptions);
+
+  TA_key_append_ulong(key, memory, (FT_ULong)font->num_sfnts);
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+
+
+    TA_key_append_ulong(key, memory, sfnt->face->units_per_EM);
+
+    if (data->cvt_idx == MISSING)
+      TA_key_append_ulong(key, memory, 0);
+    else
+    {
+      SFNT_Table* cvt_table = &font->tables[data->cvt_idx];
+
+
+      TA_key_append_ulong(key, memory, cvt_table->len);
+      TA_key_append(key, memory, cvt_table->buf, cvt_table->len);
+    }
+  }
+}
+
+
+static FT_ULong
+TA_cache_hash(const FT_Byte* buf,
+              FT_ULong len)
+{
+  /* FNV-1a */
+  FT_ULong h = 2166136261UL;
+  FT_ULong i;
+
+
+  for (i = 0; i < len; i++)
+    h = ((h ^ buf[i]) * 16777619UL) & 0xFFFFFFFFUL;
+
+  return h;
+}
+
+
+static TA_CacheEntry*
+TA_cache_find(TA_Glyph_Cache* cache,
+              FT_ULong hash,
+              const FT_Byte* key,
+              FT_ULong key_len)
+{
+  TA_CacheEntry* entry;
+
+
+  for (entry = cache->buckets[hash & cache->mask];
+       entry;
+       entry = entry->next)
+    if (entry->hash == hash
+        && entry->key_len == key_len
+        && !memcmp(entry->buf, key, key_len))
+      return entry;
+
+  return NULL;
+}
+
+
+/* double the number of hash buckets; */
+/* we simply keep the old table if we run out of memory */
+
+static void
+TA_cache_grow(TA_Glyph_Cache* cache)
+{
+  FT_ULong num_buckets = (cache->mask + 1) * 2;
+  TA_CacheEntry** buckets_new;
+  FT_ULong i;
+
+
+  buckets_new = (TA_CacheEntry**)calloc(num_buckets,
+                                        sizeof (TA_CacheEntry*));
+  if (!buckets_new)
+    return;
+
+  for (i = 0; i <= cache->mask; i++)
+  {
+    TA_CacheEntry* entry = cache->buckets[i];
+
+
+    while (entry)
+    {
+      TA_CacheEntry* next = entry->next;
+      FT_ULong b = entry->hash & (num_buckets - 1);
+
+
+      entry->next = buckets_new[b];
+      buckets_new[b] = entry;
+      entry = next;
+    }
+  }
+
+  free(cache->buckets);
+  cache->buckets = buckets_new;
+  cache->mask = num_buckets - 1;
+}
+
+
+/* a failing allocation only means that the glyph doesn't get cached */
+
+static TA_CacheEntry*
+TA_cache_insert(TA_Glyph_Cache* cache,
+                FT_ULong hash,
+                const FT_Byte* key,
+                FT_ULong key_len,
+                GLYPH* glyph,
+                FT_UShort max_storage,
+                FT_UShort max_stack_elements,
+                FT_UShort max_twilight_points)
+{
+  TA_CacheEntry* entry;
+
+
+  /* another thread might have added the same glyph in the meantime */
+  entry = TA_cache_find(cache, hash, key, key_len);
+  if (entry)
+    return entry;
+
+  entry = (TA_CacheEntry*)malloc(sizeof (TA_CacheEntry));
+  if (!entry)
+    return NULL;
+
+  entry->buf = (FT_Byte*)malloc(key_len + glyph->ins_len);
+  if (!entry->buf)
+  {
+    free(entry);
+    return NULL;
+  }
+
+  memcpy(entry->buf, key, key_len);
+  if (glyph->ins_len)
+    memcpy(entry->buf + key_len, glyph->ins_buf, glyph->ins_len);
+
+  entry->hash = hash;
+  entry->generation = cache->generation;
+  entry->key_len = key_len;
+  entry->ins_len = glyph->ins_len;
+  entry->max_storage = max_storage;
+  entry->max_stack_elements = max_stack_elements;
+  entry->max_twilight_points = max_twilight_points;
+  entry->have_limits = 0;
+  entry->have_bound = glyph->have_bound;
+  entry->bound = glyph->bound;
+
+  entry->next = cache->buckets[hash & cache->mask];
+  cache->buckets[hash & cache->mask] = entry;
+  cache->num_entries++;
+
+  if (cache->num_entries > 2 * (cache->mask + 1))
+    TA_cache_grow(cache);
+
+  return entry;
+}
+
+
+/* remove all entries not used by the current run (or all entries) */
+
+static void
+TA_cache_purge(TA_Glyph_Cache* cache,
+               FT_Bool all)
+{
+  FT_ULong i;
+
+
+  for (i = 0; i <= cache->mask; i++)
+  {
+    TA_CacheEntry** link = &cache->buckets[i];
+
+
+    while (*link)
+    {
+      TA_CacheEntry* entry = *link;
+
+
+      if (all || entry->generation != cache->generation)
+      {
+        *link = entry->next;
+        free(entry->buf);
+        free(entry);
+        cache->num_entries--;
+      }
+      else
+        link = &entry->next;
+    }
+  }
+}
+
+
+TA_Glyph_Cache*
+TTF_autohint_glyph_cache_new(void)
+{
+  TA_Glyph_Cache* cache;
+
+
+  cache = (TA_Glyph_Cache*)calloc(1, sizeof (TA_Glyph_Cache));
+  if (!cache)
+    return NULL;
+
+  cache->buckets = (TA_CacheEntry**)calloc(TA_CACHE_NUM_BUCKETS,
+                                           sizeof (TA_CacheEntry*));
+  if (!cache->buckets)
+  {
+    free(cache);
+    return NULL;
+  }
+  cache->mask = TA_CACHE_NUM_BUCKETS - 1;
+
+#ifdef HAVE_PTHREAD
+  if (pthread_mutex_init(&cache->lock, NULL))
+  {
+    free(cache->buckets);
+    free(cache);
+    return NULL;
+  }
+#endif
+
+  return cache;
+}
+
+
+void
+TTF_autohint_glyph_cache_free(TA_Glyph_Cache* cache)
+{
+  if (!cache)
+    return;
+
+  TA_cache_purge(cache, 1);
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_destroy(&cache->lock);
+#endif
+
+  free(cache->buckets);
+  free(cache->global_key);
+  free(cache);
+}
+
+
+/* this must be called after creating the `cvt ' tables */
+/* and before hinting the glyphs */
+
+FT_Error
+TA_font_start_glyph_cache(FONT* font)
+{
+  TA_Glyph_Cache* cache = font->glyph_cache;
+  Key_Buffer key;
+
+
+  memset(&key, 0, sizeof (Key_Buffer));
+  TA_font_compute_global_key(font, &key);
+
+  /* we can still hint without the cache */
+  if (key.invalid)
+  {
+    ta_mem_free(font->memory, key.buf);
+    font->glyph_cache = NULL;
+
+    return FT_Err_Ok;
+  }
+
+  if (key.len != cache->global_key_len
+      || memcmp(key.buf, cache->global_key, key.len))
+  {
+    TA_cache_purge(cache, 1);
+
+    free(cache->global_key);
+    cache->global_key = (FT_Byte*)malloc(key.len);
+    if (!cache->global_key)
+    {
+      cache->global_key_len = 0;
+      ta_mem_free(font->memory, key.buf);
+      return FT_Err_Out_Of_Memory;
+    }
+
+    memcpy(cache->global_key, key.buf, key.len);
+    cache->global_key_len = key.len;
+  }
+
+  ta_mem_free(font->memory, key.buf);
+
+  cache->generation++;
+
+  return FT_Err_Ok;
+}
+
+
+/* this must be called after all glyphs have been hinted successfully; */
+/* if only a subset of the glyphs gets hinted (as for previews), */
+/* we keep the remaining entries for later calls */
+
+void
+TA_font_finish_glyph_cache(FONT* font)
+{
+  if (!font->hint_glyphs)
+    TA_cache_purge(font->glyph_cache, 0);
+}
+
+
+FT_Error
+TA_sfnt_build_cached_glyph_instructions(SFNT* sfnt,
+                                        FONT* font,
+                                        FT_Long idx)
+{
+  TA_Glyph_Cache* cache = font->glyph_cache;
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  /* `idx' is never negative */
+  GLYPH* glyph = &data->glyphs[idx];
+
+  Key_Buffer key;
+  FT_ULong hash;
+  TA_CacheEntry* entry;
+  FT_Bool found = 0;
+
+  FT_UShort max_storage;
+  FT_UShort max_stack_elements;
+  FT_UShort max_twilight_points;
+
+  FT_Error error = FT_Err_Ok;
+
+
+  /* empty glyphs don't need bytecode anyway */
+  if (!cache || !glyph->buf)
+    return TA_sfnt_build_glyph_instructions(sfnt, font, idx);
+
+  memset(&key, 0, sizeof (Key_Buffer));
+  TA_key_append(&key, font->memory, &globals->glyph_scripts[idx], 1);
+  TA_key_append_glyph(&key, font->memory, data, (FT_UShort)idx, 0);
+
+  if (key.invalid)
+  {
+    ta_mem_free(font->memory, key.buf);
+    return TA_sfnt_build_glyph_instructions(sfnt, font, idx);
+  }
+
+  hash = TA_cache_hash(key.buf, key.len);
+
+  TA_CACHE_LOCK(cache);
+
+  entry = TA_cache_find(cache, hash, key.buf, key.len);
+  if (entry)
+  {
+    found = 1;
+    entry->generation = cache->generation;
+    glyph->cache_entry = entry;
+    glyph->have_bound = entry->have_bound;
+    glyph->bound = entry->bound;
+
+    if (entry->ins_len)
+    {
+      glyph->ins_buf = (FT_Byte*)ta_mem_alloc(font->memory, entry->ins_len);
+      if (glyph->ins_buf)
+      {
+        memcpy(glyph->ins_buf, entry->buf + entry->key_len, entry->ins_len);
+        glyph->ins_len = entry->ins_len;
+      }
+      else
+        error = FT_Err_Out_Of_Memory;
+    }
+
+    if (entry->max_storage > sfnt->max_storage)
+      sfnt->max_storage = entry->max_storage;
+    if (entry->max_stack_elements > sfnt->max_stack_elements)
+      sfnt->max_stack_elements = entry->max_stack_elements;
+    if (entry->max_twilight_points > sfnt->max_twilight_points)
+      sfnt->max_twilight_points = entry->max_twilight_points;
+  }
+
+  TA_CACHE_UNLOCK(cache);
+
+  if (found)
+  {
+    font->num_cached_glyphs++;
+
+    if (!error && glyph->have_bound && font->bound)
+      font->bound(idx, sfnt - font->sfnts, (int)glyph->bound,
+                  font->bound_data);
+    goto Exit;
+  }
+
+  /* the upper bounds are maxima, so we can compute */
+  /* the glyph's own values separately and merge them afterwards */
+  max_storage = sfnt->max_storage;
+  max_stack_elements = sfnt->max_stack_elements;
+  max_twilight_points = sfnt->max_twilight_points;
+
+  sfnt->max_storage = 0;
+  sfnt->max_stack_elements = 0;
+  sfnt->max_twilight_points = 0;
+
+  error = TA_sfnt_build_glyph_instructions(sfnt, font, idx);
+
+  if (!error)
+  {
+    TA_CACHE_LOCK(cache);
+    glyph->cache_entry = TA_cache_insert(cache, hash, key.buf, key.len,
+                                         glyph,
+                                         sfnt->max_storage,
+                                         sfnt->max_stack_elements,
+                                         sfnt->max_twilight_points);
+    TA_CACHE_UNLOCK(cache);
+  }
+
+  if (max_storage > sfnt->max_storage)
+    sfnt->max_storage = max_storage;
+  if (max_stack_elements > sfnt->max_stack_elements)
+    sfnt->max_stack_elements = max_stack_elements;
+  if (max_twilight_points > sfnt->max_twilight_points)
+    sfnt->max_twilight_points = max_twilight_points;
+
+Exit:
+  ta_mem_free(font->memory, key.buf);
+
+  return error;
+}
+
+
+/* get the exact `maxp' values of a glyph's bytecode */
+/* if a previous run has stored them in the glyph's cache entry */
+
+FT_Bool
+TA_glyph_get_cached_limits(FONT* font,
+                           GLYPH* glyph,
+                           FT_ULong* max_storage,
+                           FT_ULong* max_stack_elements,
+                           FT_ULong* max_twilight_points)
+{
+  TA_CacheEntry* entry = glyph->cache_entry;
+  FT_Bool have_limits;
+
+
+  if (!entry || !font->glyph_cache)
+    return 0;
+
+  TA_CACHE_LOCK(font->glyph_cache);
+
+  have_limits = entry->have_limits;
+  if (have_limits)
+  {
+    *max_storage = entry->limits_storage;
+    *max_stack_elements = entry->limits_stack_elements;
+    *max_twilight_points = entry->limits_twilight_points;
+  }
+
+  TA_CACHE_UNLOCK(font->glyph_cache);
+
+  return have_limits;
+}
+
+
+void
+TA_glyph_set_cached_limits(FONT* font,
+                           GLYPH* glyph,
+                           FT_ULong max_storage,
+                           FT_ULong max_stack_elements,
+                           FT_ULong max_twilight_points)
+{
+  TA_CacheEntry* entry = glyph->cache_entry;
+
+
+  if (!entry || !font->glyph_cache)
+    return;
+
+  /* such values are invalid anyway */
+  if (max_storage > 0xFFFF
+      || max_stack_elements > 0xFFFF
+      || max_twilight_points > 0xFFFF)
+    return;
+
+  TA_CACHE_LOCK(font->glyph_cache);
+
+  entry->limits_storage = (FT_UShort)max_storage;
+  entry->limits_stack_elements = (FT_UShort)max_stack_elements;
+  entry->limits_twilight_points = (FT_UShort)max_twilight_points;
+  entry->have_limits = 1;
+
+  TA_CACHE_UNLOCK(font->glyph_cache);
+}
+
+/* end of tacache.c */
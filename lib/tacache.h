@@ -0,0 +1,80 @@
+/* tacache.h */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#ifndef __TACACHE_H__
+#define __TACACHE_H__
+
+#include <config.h>
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <ttfautohint.h>
+
+
+typedef struct TA_CacheEntry_
+{
+  struct TA_CacheEntry_* next; /* in the same hash bucket */
+  FT_ULong hash;
+  FT_ULong generation; /* the last run which has used this entry */
+
+  FT_Byte* buf; /* the key, followed by the bytecode */
+  FT_ULong key_len;
+  FT_ULong ins_len;
+
+  /* the glyph's contribution to the upper bounds of the `maxp' values */
+  FT_UShort max_storage;
+  FT_UShort max_stack_elements;
+  FT_UShort max_twilight_points;
+
+  /* the exact values needed by the glyph's bytecode as computed by */
+  /* `TA_sfnt_compute_bytecode_limits'; valid if `have_limits' is set */
+  FT_Bool have_limits;
+  FT_UShort limits_storage;
+  FT_UShort limits_stack_elements;
+  FT_UShort limits_twilight_points;
+
+  /* the value passed to the bound callback; valid if `have_bound' is set */
+  FT_Bool have_bound;
+  FT_UInt bound;
+} TA_CacheEntry;
+
+
+struct TA_Glyph_Cache_
+{
+  /* everything besides the glyph data which influences the bytecode; */
+  /* if it changes, all entries get removed */
+  FT_Byte* global_key;
+  FT_ULong global_key_len;
+
+  FT_ULong generation;
+
+  FT_ULong num_entries;
+  FT_ULong mask; /* number of hash buckets minus one */
+  TA_CacheEntry** buckets;
+
+#ifdef HAVE_PTHREAD
+  /* subfonts can be hinted in parallel */
+  pthread_mutex_t lock;
+#endif
+};
+
+#endif /* __TACACHE_H__ */
+
+/* end of tacache.h */
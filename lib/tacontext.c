@@ -0,0 +1,102 @@
+/* tacontext.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Contexts for long-running processes.
+ *
+ * A program which hints many fonts one after another (for example, the
+ * daemon mode of `ttfautohint') can pass the same `TA_Context' object to
+ * every call of `TTF_autohint'.  The FreeType library, the chunks of the
+ * memory pool, and the glyph cache then survive the calls; only the
+ * `FONT' structure and the accounting of the memory management object
+ * are set up anew for each font.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_MODULE_H
+
+#include "ta.h"
+
+
+TA_Context*
+TTF_autohint_context_new(void)
+{
+  TA_Context* context;
+
+
+  context = (TA_Context*)calloc(1, sizeof (TA_Context));
+  if (!context)
+    return NULL;
+
+  ta_memory_init(&context->memory_rec, NULL, NULL, NULL, NULL, 1, 0);
+
+  if (TA_new_library(&context->memory_rec, &context->lib))
+  {
+    context->lib = NULL;
+    goto Fail;
+  }
+
+  context->glyph_cache = TTF_autohint_glyph_cache_new();
+  if (!context->glyph_cache)
+    goto Fail;
+
+  return context;
+
+Fail:
+  TTF_autohint_context_free(context);
+  return NULL;
+}
+
+
+void
+TTF_autohint_context_free(TA_Context* context)
+{
+  if (!context)
+    return;
+
+  if (context->lib)
+    FT_Done_Library(context->lib);
+  TTF_autohint_glyph_cache_free(context->glyph_cache);
+  ta_memory_done(&context->memory_rec);
+
+  free(context);
+}
+
+
+/* make `font' use the library and the memory management of `context'; */
+/* the statistics only cover the current call (the allocations of the */
+/* library itself, however, are still counted) */
+
+void
+TA_context_attach(TA_Context* context,
+                  FONT* font,
+                  size_t memory_limit)
+{
+  TA_Memory memory = &context->memory_rec;
+
+
+  memory->limit = memory_limit;
+  memset(&memory->stats, 0, sizeof (TA_Memory_Stats));
+  ta_memory_set_phase(memory, TA_PHASE_SETUP);
+
+  font->memory = memory;
+  font->lib = context->lib;
+  font->context = context;
+}
+
+/* end of tacontext.c */
@@ -16,7 +16,7 @@
 #include "ta.h"
 
 
-static FT_Error
+FT_Error
 TA_sfnt_compute_global_hints(SFNT* sfnt,
                              FONT* font)
 {
@@ -111,7 +111,7 @@ TA_table_build_cvt(FT_Byte** cvt,
 
   /* buffer length must be a multiple of four */
   len = (buf_len + 3) & ~3;
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -189,7 +189,7 @@ TA_table_build_cvt(FT_Byte** cvt,
   return FT_Err_Ok;
 
 Err:
-  free(buf);
+  ta_mem_free(font->memory, buf);
   return TA_Err_Hinter_Overflow;
 }
 
@@ -207,12 +207,14 @@ TA_sfnt_build_cvt_table(SFNT* sfnt,
   FT_ULong cvt_len;
 
 
-  error = TA_sfnt_add_table_info(sfnt);
+  error = TA_sfnt_add_table_info(sfnt, font);
   if (error)
     goto Exit;
 
-  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel */
-  if (glyf_table->processed)
+  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel; */
+  /* a previous subfont with the same `glyf' table has already */
+  /* created this table */
+  if (data->cvt_idx != MISSING)
   {
     sfnt->table_infos[sfnt->num_table_infos - 1] = data->cvt_idx;
     goto Exit;
@@ -228,7 +230,7 @@ TA_sfnt_build_cvt_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_cvt, cvt_len, cvt_buf);
   if (error)
-    free(cvt_buf);
+    ta_mem_free(font->memory, cvt_buf);
   else
     data->cvt_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
@@ -0,0 +1,407 @@
+/* tadevice.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* This file builds the `hdmx', `LTSH', and `VDMX' tables.  All three */
+/* tables contain data which depends on the bytecode, so we compute the */
+/* values by running FreeType's bytecode interpreter on the (already */
+/* hinted) output font. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+#include FT_ADVANCES_H
+#include FT_OUTLINE_H
+
+
+/* the largest PPEM value which can be represented */
+/* in `hdmx', `LTSH', and `VDMX' tables */
+#define DEVICE_PPEM_MAX 255
+
+/* the header length of our `VDMX' table, including */
+/* a single ratio record and a single offset */
+#define VDMX_HEADER_LEN (6 + 4 + 2)
+
+
+/* in case of success, `buf' gets linked */
+/* and is eventually freed in `TA_font_unload' */
+
+static FT_Error
+TA_sfnt_add_device_table(SFNT* sfnt,
+                         FONT* font,
+                         FT_ULong tag,
+                         FT_ULong len,
+                         FT_Byte* buf)
+{
+  FT_ULong j;
+  FT_Error error;
+
+
+  error = TA_sfnt_add_table_info(sfnt, font);
+  if (error)
+    return error;
+
+  /* subfonts sharing a `glyf' table get identical data; */
+  /* in this case we reuse the existing SFNT table */
+  for (j = 0; j < font->num_tables; j++)
+  {
+    SFNT_Table* table = &font->tables[j];
+
+
+    if (table->tag == tag
+        && table->len == len
+        && !memcmp(table->buf, buf, len))
+      break;
+  }
+
+  if (j < font->num_tables)
+  {
+    ta_mem_free(font->memory, buf);
+    sfnt->table_infos[sfnt->num_table_infos - 1] = j;
+
+    return TA_Err_Ok;
+  }
+
+  return TA_font_add_table(font,
+                           &sfnt->table_infos[sfnt->num_table_infos - 1],
+                           tag, len, buf);
+}
+
+
+static FT_Error
+TA_face_build_device_tables(FT_Face face,
+                            FONT* font,
+                            FT_Byte** hdmx,
+                            FT_ULong* hdmx_len,
+                            FT_Byte** LTSH,
+                            FT_ULong* LTSH_len,
+                            FT_Byte** VDMX,
+                            FT_ULong* VDMX_len)
+{
+  FT_Long num_glyphs = face->num_glyphs;
+
+  FT_UInt ppem_min = font->hinting_range_min;
+  FT_UInt ppem_max = font->hinting_range_max;
+  FT_UInt LTSH_ppem_max;
+  FT_UInt num_sizes;
+  FT_UInt ppem;
+
+  FT_ULong record_len;
+
+  FT_Byte* hdmx_buf = NULL;
+  FT_Byte* LTSH_buf = NULL;
+  FT_Byte* VDMX_buf = NULL;
+  FT_ULong hdmx_buf_len;
+  FT_ULong LTSH_buf_len;
+  FT_ULong VDMX_buf_len;
+
+  FT_Byte* hdmx_record;
+  FT_Byte* VDMX_record;
+
+  FT_Int32 load_flags;
+  FT_Long i;
+  FT_Error error;
+
+
+  if (ppem_max > DEVICE_PPEM_MAX)
+    ppem_max = DEVICE_PPEM_MAX;
+  num_sizes = ppem_max - ppem_min + 1;
+
+  /* the bytecode hints all sizes up to the hinting limit */
+  /* (using the hints of `hinting-range-max' for larger sizes), */
+  /* so the advance widths can stay non-linear up to that value */
+  LTSH_ppem_max = font->hinting_limit;
+  if (!LTSH_ppem_max || LTSH_ppem_max > DEVICE_PPEM_MAX)
+    LTSH_ppem_max = DEVICE_PPEM_MAX;
+  if (LTSH_ppem_max < ppem_max)
+    LTSH_ppem_max = ppem_max;
+
+  /* legacy rasterizers which use these tables do B/W rendering */
+  load_flags = FT_LOAD_NO_BITMAP
+               | FT_LOAD_NO_AUTOHINT
+               | FT_LOAD_TARGET_MONO;
+
+  /* all buffer lengths must be a multiple of 4 */
+
+  /* `hdmx': 8 bytes header, then one padded record per size */
+  record_len = (2 + num_glyphs + 3) & ~3;
+  hdmx_buf_len = 8 + num_sizes * record_len;
+  hdmx_buf = (FT_Byte*)ta_mem_calloc(font->memory, 1, hdmx_buf_len);
+  if (!hdmx_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  /* `LTSH': 4 bytes header, then one byte per glyph */
+  LTSH_buf_len = (4 + num_glyphs + 3) & ~3;
+  LTSH_buf = (FT_Byte*)ta_mem_calloc(font->memory, 1, LTSH_buf_len);
+  if (!LTSH_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  /* `VDMX': header, a single group header, then 6 bytes per size */
+  VDMX_buf_len = (VDMX_HEADER_LEN + 4 + 6 * num_sizes + 3) & ~3;
+  VDMX_buf = (FT_Byte*)ta_mem_calloc(font->memory, 1, VDMX_buf_len);
+  if (!VDMX_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  /* `hdmx' version is 0 */
+  hdmx_buf[2] = HIGH(num_sizes);
+  hdmx_buf[3] = LOW(num_sizes);
+  hdmx_buf[4] = BYTE1(record_len);
+  hdmx_buf[5] = BYTE2(record_len);
+  hdmx_buf[6] = BYTE3(record_len);
+  hdmx_buf[7] = BYTE4(record_len);
+
+  /* `LTSH' version is 0 */
+  LTSH_buf[2] = HIGH(num_glyphs);
+  LTSH_buf[3] = LOW(num_glyphs);
+
+  /* value 1 means that the glyph always scales linearly */
+  for (i = 0; i < num_glyphs; i++)
+    LTSH_buf[4 + i] = 1;
+
+  /* `VDMX' version 1, one group, one ratio */
+  VDMX_buf[1] = 0x01;
+  VDMX_buf[3] = 0x01;
+  VDMX_buf[5] = 0x01;
+
+  /* the ratio record 0:0:0 (with character set 0) */
+  /* is valid for all aspect ratios */
+
+  /* offset to the group */
+  VDMX_buf[10] = HIGH(VDMX_HEADER_LEN);
+  VDMX_buf[11] = LOW(VDMX_HEADER_LEN);
+
+  /* group header */
+  VDMX_buf[VDMX_HEADER_LEN] = HIGH(num_sizes);
+  VDMX_buf[VDMX_HEADER_LEN + 1] = LOW(num_sizes);
+  VDMX_buf[VDMX_HEADER_LEN + 2] = (FT_Byte)ppem_min;
+  VDMX_buf[VDMX_HEADER_LEN + 3] = (FT_Byte)ppem_max;
+
+  hdmx_record = hdmx_buf + 8;
+  VDMX_record = VDMX_buf + VDMX_HEADER_LEN + 4;
+
+  /* `LTSH' needs all sizes starting with 1ppem, since a glyph might */
+  /* scale linearly only below the hinting range; sizes outside of   */
+  /* `ppem_min' and `ppem_max' are only used for `LTSH'              */
+  for (ppem = 1; ppem <= LTSH_ppem_max; ppem++)
+  {
+    FT_Pos max_width = 0;
+    FT_Pos y_max = 0;
+    FT_Pos y_min = 0;
+
+
+    error = FT_Set_Pixel_Sizes(face, ppem, ppem);
+    if (error)
+      goto Err;
+
+    for (i = 0; i < num_glyphs; i++)
+    {
+      FT_GlyphSlot slot = face->glyph;
+
+      FT_Pos width;
+      FT_Pos linear_width;
+
+
+      /* a glyph which can't be loaded with its bytecode */
+      /* gets its linear advance width */
+      if (FT_Load_Glyph(face, i, load_flags))
+      {
+        FT_Fixed advance;
+
+
+        if (ppem < ppem_min || ppem > ppem_max)
+          continue;
+
+        if (FT_Get_Advance(face, i,
+                           FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP,
+                           &advance))
+          advance = 0;
+
+        width = (advance + 0x8000L) >> 16;
+        if (width > 255)
+          width = 255;
+        if (width > max_width)
+          max_width = width;
+
+        hdmx_record[2 + i] = (FT_Byte)width;
+
+        continue;
+      }
+
+      width = (slot->advance.x + 32) >> 6;
+      linear_width = (slot->linearHoriAdvance + 0x8000L) >> 16;
+
+      /* this is the tolerance given in the OpenType specification: */
+      /* starting with 50ppem, a deviation of 2% is acceptable */
+      if (width != linear_width
+          && (ppem < 50
+              || TA_ABS(width - linear_width) * 50 > linear_width))
+        LTSH_buf[4 + i] = (ppem < 255) ? (FT_Byte)(ppem + 1) : 255;
+
+      if (ppem < ppem_min || ppem > ppem_max)
+        continue;
+
+      if (width > 255)
+        width = 255;
+      if (width > max_width)
+        max_width = width;
+
+      hdmx_record[2 + i] = (FT_Byte)width;
+
+      if (slot->outline.n_points)
+      {
+        FT_BBox cbox;
+
+
+        FT_Outline_Get_CBox(&slot->outline, &cbox);
+
+        if (y_max < (cbox.yMax + 63) >> 6)
+          y_max = (cbox.yMax + 63) >> 6;
+        if (y_min > cbox.yMin >> 6)
+          y_min = cbox.yMin >> 6;
+      }
+    }
+
+    if (ppem < ppem_min || ppem > ppem_max)
+      continue;
+
+    hdmx_record[0] = (FT_Byte)ppem;
+    hdmx_record[1] = (FT_Byte)max_width;
+    hdmx_record += record_len;
+
+    VDMX_record[0] = HIGH(ppem);
+    VDMX_record[1] = LOW(ppem);
+    VDMX_record[2] = HIGH(y_max);
+    VDMX_record[3] = LOW(y_max);
+    VDMX_record[4] = HIGH(y_min);
+    VDMX_record[5] = LOW(y_min);
+    VDMX_record += 6;
+  }
+
+  *hdmx = hdmx_buf;
+  *hdmx_len = 8 + num_sizes * record_len;
+  *LTSH = LTSH_buf;
+  *LTSH_len = 4 + num_glyphs;
+  *VDMX = VDMX_buf;
+  *VDMX_len = VDMX_HEADER_LEN + 4 + 6 * num_sizes;
+
+  return TA_Err_Ok;
+
+Err:
+  ta_mem_free(font->memory, hdmx_buf);
+  ta_mem_free(font->memory, LTSH_buf);
+  ta_mem_free(font->memory, VDMX_buf);
+
+  return error;
+}
+
+
+FT_Error
+TA_font_build_device_tables(FONT* font)
+{
+  FT_Bool have_DSIG = font->have_DSIG;
+  FT_Long i;
+  FT_Error error;
+
+
+  /* nothing to do if the hinting range is out of reach */
+  if (font->hinting_range_min > DEVICE_PPEM_MAX)
+    return TA_Err_Ok;
+
+  /* we need a complete font to run the bytecode; */
+  /* the dummy `DSIG' table gets added in the final build */
+  font->have_DSIG = 0;
+
+  if (font->num_sfnts == 1)
+    error = TA_font_build_TTF(font);
+  else
+    error = TA_font_build_TTC(font);
+
+  font->have_DSIG = have_DSIG;
+
+  if (error)
+    goto Exit;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    FT_Face face;
+
+    FT_Byte* hdmx_buf;
+    FT_Byte* LTSH_buf;
+    FT_Byte* VDMX_buf;
+    FT_ULong hdmx_len;
+    FT_ULong LTSH_len;
+    FT_ULong VDMX_len;
+
+
+    error = FT_New_Memory_Face(font->lib, font->out_buf, font->out_len,
+                               i, &face);
+    if (error)
+      goto Exit;
+
+    error = TA_face_build_device_tables(face, font,
+                                        &hdmx_buf, &hdmx_len,
+                                        &LTSH_buf, &LTSH_len,
+                                        &VDMX_buf, &VDMX_len);
+    FT_Done_Face(face);
+    if (error)
+      goto Exit;
+
+    error = TA_sfnt_add_device_table(sfnt, font,
+                                     TTAG_hdmx, hdmx_len, hdmx_buf);
+    if (error)
+    {
+      ta_mem_free(font->memory, hdmx_buf);
+      ta_mem_free(font->memory, LTSH_buf);
+      ta_mem_free(font->memory, VDMX_buf);
+      goto Exit;
+    }
+    error = TA_sfnt_add_device_table(sfnt, font,
+                                     TTAG_LTSH, LTSH_len, LTSH_buf);
+    if (error)
+    {
+      ta_mem_free(font->memory, LTSH_buf);
+      ta_mem_free(font->memory, VDMX_buf);
+      goto Exit;
+    }
+    error = TA_sfnt_add_device_table(sfnt, font,
+                                     TTAG_VDMX, VDMX_len, VDMX_buf);
+    if (error)
+    {
+      ta_mem_free(font->memory, VDMX_buf);
+      goto Exit;
+    }
+  }
+
+Exit:
+  /* the final build creates a new output buffer */
+  free(font->out_buf);
+  font->out_buf = NULL;
+  font->out_len = 0;
+
+  return error;
+}
+
+/* end of tadevice.c */
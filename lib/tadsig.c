@@ -19,12 +19,13 @@
 /* we build a dummy `DSIG' table only */
 
 FT_Error
-TA_table_build_DSIG(FT_Byte** DSIG)
+TA_table_build_DSIG(FT_Byte** DSIG,
+                    FONT* font)
 {
   FT_Byte* buf;
 
 
-  buf = (FT_Byte*)malloc(DSIG_LEN);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, DSIG_LEN);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -22,29 +22,39 @@ FT_Error
 TA_font_file_read(FONT* font,
                   FILE* in_file)
 {
-  FT_Byte buf[BUF_SIZE];
   size_t in_len = 0;
+  size_t in_size = BUF_SIZE;
   size_t read_bytes;
 
 
-  font->in_buf = (FT_Byte*)malloc(BUF_SIZE);
+  /* the input buffer counts for the memory limit also */
+  font->in_buf = (FT_Byte*)ta_mem_alloc(font->memory, in_size);
   if (!font->in_buf)
     return FT_Err_Out_Of_Memory;
 
-  while ((read_bytes = fread(buf, 1, BUF_SIZE, in_file)) > 0)
+  while ((read_bytes = fread(font->in_buf + in_len, 1,
+                             in_size - in_len, in_file)) > 0)
   {
     FT_Byte* in_buf_new;
 
 
-    in_buf_new = (FT_Byte*)realloc(font->in_buf, in_len + read_bytes);
+    in_len += read_bytes;
+    if (in_len < in_size)
+      continue;
+
+    /* double the buffer size to avoid quadratic copying */
+    /* if there is no `realloc' callback                 */
+    in_buf_new = (FT_Byte*)ta_mem_realloc(font->memory,
+                                          font->in_buf, 2 * in_size);
     if (!in_buf_new)
+    {
+      ta_mem_free(font->memory, font->in_buf);
+      font->in_buf = NULL;
       return FT_Err_Out_Of_Memory;
-    else
-      font->in_buf = in_buf_new;
-
-    memcpy(font->in_buf + in_len, buf, read_bytes);
+    }
 
-    in_len += read_bytes;
+    font->in_buf = in_buf_new;
+    in_size *= 2;
   }
 
   if (ferror(in_file))
@@ -70,4 +80,29 @@ TA_font_file_write(FONT* font,
   return TA_Err_Ok;
 }
 
+
+FT_Error
+TA_font_stream_write(FONT* font,
+                     const FT_Byte* buf,
+                     FT_ULong len)
+{
+  if (fwrite(buf, 1, len, font->out_file) != len)
+    return TA_Err_Invalid_Stream_Write;
+
+  return TA_Err_Ok;
+}
+
+
+/* `offset' is relative to the start of the output font */
+
+FT_Error
+TA_font_stream_seek(FONT* font,
+                    FT_ULong offset)
+{
+  if (fseek(font->out_file, font->out_start + (long)offset, SEEK_SET))
+    return FT_Err_Invalid_Stream_Seek;
+
+  return TA_Err_Ok;
+}
+
 /* end of tafile.c */
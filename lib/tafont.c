@@ -13,9 +13,44 @@
  */
 
 
+#include <ft2build.h>
+#include FT_MODULE_H
+
 #include "ta.h"
 
 
+/* create a FreeType library object which uses our memory management; */
+/* this is the same as `FT_Init_FreeType' otherwise */
+
+FT_Error
+TA_new_library(TA_Memory memory,
+               FT_Library* alibrary)
+{
+  FT_Error error;
+
+
+  error = FT_New_Library(&memory->ft_memory, alibrary);
+  if (error)
+    return error;
+
+  FT_Add_Default_Modules(*alibrary);
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 8)
+  /* handle the `FREETYPE_PROPERTIES' environment variable */
+  FT_Set_Default_Properties(*alibrary);
+#endif
+
+  return TA_Err_Ok;
+}
+
+
+FT_Error
+TA_font_new_library(FONT* font,
+                    FT_Library* alibrary)
+{
+  return TA_new_library(font->memory, alibrary);
+}
+
+
 FT_Error
 TA_font_init(FONT* font)
 {
@@ -24,9 +59,13 @@ TA_font_init(FONT* font)
   FT_Int major, minor, patch;
 
 
-  error = FT_Init_FreeType(&font->lib);
-  if (error)
-    return error;
+  /* a context already provides a library */
+  if (!font->lib)
+  {
+    error = TA_font_new_library(font, &font->lib);
+    if (error)
+      return error;
+  }
 
   /* assure correct FreeType version to avoid using the wrong DLL */
   FT_Library_Version(font->lib, &major, &minor, &patch);
@@ -41,7 +80,8 @@ TA_font_init(FONT* font)
   FT_Done_Face(f);
 
   /* it is a TTC if we have more than a single subfont */
-  font->sfnts = (SFNT*)calloc(1, font->num_sfnts * sizeof (SFNT));
+  font->sfnts = (SFNT*)ta_mem_calloc(font->memory,
+                                     1, font->num_sfnts * sizeof (SFNT));
   if (!font->sfnts)
     return FT_Err_Out_Of_Memory;
 
@@ -60,6 +100,9 @@ TA_font_unload(FONT* font,
   if (!font)
     return;
 
+  /* the statistics shouldn't include the final deallocation */
+  ta_memory_set_phase(font->memory, TA_PHASE_MAX);
+
   if (font->loader)
     ta_loader_done(font);
 
@@ -70,7 +113,7 @@ TA_font_unload(FONT* font,
 
     for (i = 0; i < font->num_tables; i++)
     {
-      free(font->tables[i].buf);
+      ta_mem_free(font->memory, font->tables[i].buf);
       if (font->tables[i].data)
       {
         if (font->tables[i].tag == TTAG_glyf)
@@ -81,17 +124,17 @@ TA_font_unload(FONT* font,
 
           for (j = 0; j < data->num_glyphs; j++)
           {
-            free(data->glyphs[j].buf);
-            free(data->glyphs[j].ins_buf);
-            free(data->glyphs[j].components);
-            free(data->glyphs[j].pointsums);
+            ta_mem_free(font->memory, data->glyphs[j].buf);
+            ta_mem_free(font->memory, data->glyphs[j].ins_buf);
+            ta_mem_free(font->memory, data->glyphs[j].components);
+            ta_mem_free(font->memory, data->glyphs[j].pointsums);
           }
-          free(data->glyphs);
-          free(data);
+          ta_mem_free(font->memory, data->glyphs);
+          ta_mem_free(font->memory, data);
         }
       }
     }
-    free(font->tables);
+    ta_mem_free(font->memory, font->tables);
   }
 
   if (font->sfnts)
@@ -102,16 +145,35 @@ TA_font_unload(FONT* font,
     for (i = 0; i < font->num_sfnts; i++)
     {
       FT_Done_Face(font->sfnts[i].face);
-      free(font->sfnts[i].table_infos);
+      ta_mem_free(font->memory, font->sfnts[i].table_infos);
+      ta_mem_free(font->memory, font->sfnts[i].variant_name_buf);
     }
-    free(font->sfnts);
+    ta_mem_free(font->memory, font->sfnts);
   }
 
   number_set_free(font->x_height_snapping_exceptions);
+  number_set_free(font->hinting_sizes);
+  number_set_free(font->hint_glyphs);
 
-  FT_Done_FreeType(font->lib);
-  if (!in_buf)
+  free(font->woff_meta_buf);
+  free(font->woff_priv_buf);
+
+  /* unwrapped WOFF and WOFF2 data is always ours; */
+  /* input data read from a file uses our memory management */
+  if (font->in_format == TA_FORMAT_WOFF
+      || font->in_format == TA_FORMAT_WOFF2)
     free(font->in_buf);
+  else if (!in_buf)
+    ta_mem_free(font->memory, font->in_buf);
+
+  /* the library and the pool of a context get reused */
+  if (!font->context)
+    FT_Done_Library(font->lib);
+
+  if (font->memory_stats)
+    *font->memory_stats = font->memory->stats;
+  if (!font->context)
+    ta_memory_done(font->memory);
   if (!out_bufp)
     free(font->out_buf);
   free(font);
@@ -5092,7 +5092,7 @@ TA_table_build_fpgm(FT_Byte** fpgm,
 
   /* buffer length must be a multiple of four */
   len = (buf_len + 3) & ~3;
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -5263,12 +5263,14 @@ TA_sfnt_build_fpgm_table(SFNT* sfnt,
   FT_ULong fpgm_len;
 
 
-  error = TA_sfnt_add_table_info(sfnt);
+  error = TA_sfnt_add_table_info(sfnt, font);
   if (error)
     goto Exit;
 
-  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel */
-  if (glyf_table->processed)
+  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel; */
+  /* a previous subfont with the same `glyf' table has already */
+  /* created this table */
+  if (data->fpgm_idx != MISSING)
   {
     sfnt->table_infos[sfnt->num_table_infos - 1] = data->fpgm_idx;
     goto Exit;
@@ -5287,7 +5289,7 @@ TA_sfnt_build_fpgm_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_fpgm, fpgm_len, fpgm_buf);
   if (error)
-    free(fpgm_buf);
+    ta_mem_free(font->memory, fpgm_buf);
   else
     data->fpgm_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
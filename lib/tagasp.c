@@ -17,12 +17,13 @@
 
 
 static FT_Error
-TA_table_build_gasp(FT_Byte** gasp)
+TA_table_build_gasp(FT_Byte** gasp,
+                    FONT* font)
 {
   FT_Byte* buf;
 
 
-  buf = (FT_Byte*)malloc(GASP_LEN);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, GASP_LEN);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -56,7 +57,7 @@ TA_sfnt_build_gasp_table(SFNT* sfnt,
   FT_Byte* gasp_buf;
 
 
-  error = TA_sfnt_add_table_info(sfnt);
+  error = TA_sfnt_add_table_info(sfnt, font);
   if (error)
     goto Exit;
 
@@ -66,7 +67,7 @@ TA_sfnt_build_gasp_table(SFNT* sfnt,
     goto Exit;
   }
 
-  error = TA_table_build_gasp(&gasp_buf);
+  error = TA_table_build_gasp(&gasp_buf, font);
   if (error)
     goto Exit;
 
@@ -76,7 +77,7 @@ TA_sfnt_build_gasp_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_gasp, GASP_LEN, gasp_buf);
   if (error)
-    free(gasp_buf);
+    ta_mem_free(font->memory, gasp_buf);
   else
     font->gasp_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
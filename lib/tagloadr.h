@@ -23,6 +23,8 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "tamemory.h"
+
 
 typedef struct TA_SubGlyphRec_
 {
@@ -50,6 +52,7 @@ typedef struct TA_GlyphLoadRec_
 
 typedef struct TA_GlyphLoaderRec_
 {
+  TA_Memory memory;
   FT_UInt max_points;
   FT_UInt max_contours;
   FT_UInt max_subglyphs;
@@ -62,7 +65,8 @@ typedef struct TA_GlyphLoaderRec_
 
 /* create new empty glyph loader */
 FT_Error
-TA_GlyphLoader_New(TA_GlyphLoader *aloader);
+TA_GlyphLoader_New(TA_Memory memory,
+                   TA_GlyphLoader *aloader);
 
 /* add an extra points table to a glyph loader */
 FT_Error
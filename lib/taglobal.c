@@ -156,8 +156,10 @@ ta_face_globals_new(FT_Face face,
   TA_FaceGlobals globals;
 
 
-  globals = (TA_FaceGlobals)calloc(1, sizeof (TA_FaceGlobalsRec) +
-                                      face->num_glyphs * sizeof (FT_Byte));
+  globals = (TA_FaceGlobals)ta_mem_calloc(font->memory,
+                                         1, sizeof (TA_FaceGlobalsRec)
+                                            + face->num_glyphs
+                                              * sizeof (FT_Byte));
   if (!globals)
   {
     error = FT_Err_Out_Of_Memory;
@@ -206,7 +208,7 @@ ta_face_globals_free(TA_FaceGlobals globals)
         if (clazz->script_metrics_done)
           clazz->script_metrics_done(globals->metrics[nn]);
 
-        free(globals->metrics[nn]);
+        ta_mem_free(globals->font->memory, globals->metrics[nn]);
         globals->metrics[nn] = NULL;
       }
     }
@@ -215,12 +217,43 @@ ta_face_globals_free(TA_FaceGlobals globals)
     globals->glyph_scripts = NULL; /* no need to free this one! */
     globals->face = NULL;
 
-    free(globals);
+    ta_mem_free(globals->font->memory, globals);
     globals = NULL;
   }
 }
 
 
+/* the latin metrics cache the last scaling values; */
+/* we have to reset them after changing global properties */
+
+void
+ta_face_globals_reset_scale(TA_FaceGlobals globals)
+{
+  FT_UInt nn;
+
+
+  for (nn = 0; nn < TA_SCRIPT_MAX; nn++)
+  {
+    TA_ScriptMetrics metrics = globals->metrics[nn];
+
+
+    if (metrics
+        && metrics->clazz == &ta_latin_script_class)
+    {
+      TA_LatinMetrics latin = (TA_LatinMetrics)metrics;
+      FT_UInt dim;
+
+
+      for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+      {
+        latin->axis[dim].org_scale = 0;
+        latin->axis[dim].org_delta = 0;
+      }
+    }
+  }
+}
+
+
 FT_Error
 ta_face_globals_get_metrics(TA_FaceGlobals globals,
                             FT_UInt gindex,
@@ -255,7 +288,8 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
   if (metrics == NULL)
   {
     /* create the global metrics object if necessary */
-    metrics = (TA_ScriptMetrics)calloc(1, clazz->script_metrics_size);
+    metrics = (TA_ScriptMetrics)ta_mem_calloc(globals->font->memory,
+                                              1, clazz->script_metrics_size);
     if (!metrics)
     {
       error = FT_Err_Out_Of_Memory;
@@ -273,7 +307,7 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
         if (clazz->script_metrics_done)
           clazz->script_metrics_done(metrics);
 
-        free(metrics);
+        ta_mem_free(globals->font->memory, metrics);
         metrics = NULL;
         goto Exit;
       }
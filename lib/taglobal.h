@@ -74,6 +74,9 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
 void
 ta_face_globals_free(TA_FaceGlobals globals);
 
+void
+ta_face_globals_reset_scale(TA_FaceGlobals globals);
+
 FT_Bool
 ta_face_globals_is_digit(TA_FaceGlobals globals,
                          FT_UInt gindex);
@@ -16,21 +16,255 @@
 #include "ta.h"
 
 
+/*
+ * Glyphs with identical data (and the same script) get identical
+ * bytecode, so we hint them only once.  To find them, we use a hash table
+ * which maps a glyph's data to the first glyph index having it; `heads'
+ * holds the first glyph of each hash bucket, and `chain' the next glyph
+ * in the same bucket.
+ */
+
+typedef struct Dup_Table_
+{
+  FT_ULong mask;
+  FT_Long* heads;
+  FT_Long* chain;
+} Dup_Table;
+
+
+static FT_ULong
+TA_glyph_hash(GLYPH* glyph,
+              FT_Byte script)
+{
+  /* FNV-1a */
+  FT_ULong h = 2166136261UL;
+  FT_ULong len = glyph->len1 + glyph->len2;
+  FT_ULong i;
+
+
+  h = ((h ^ script) * 16777619UL) & 0xFFFFFFFFUL;
+  for (i = 0; i < len; i++)
+    h = ((h ^ glyph->buf[i]) * 16777619UL) & 0xFFFFFFFFUL;
+
+  return h;
+}
+
+
+/* return the index of an identical glyph already hinted, or -1; */
+/* in the latter case, `idx' gets added to the table */
+
+static FT_Long
+TA_glyph_find_duplicate(Dup_Table* dups,
+                        glyf_Data* data,
+                        FT_Byte* glyph_scripts,
+                        FT_Long idx)
+{
+  GLYPH* glyph = &data->glyphs[idx];
+  FT_ULong h;
+  FT_Long i;
+
+
+  /* empty glyphs don't need bytecode anyway */
+  if (!glyph->buf)
+    return -1;
+
+  h = TA_glyph_hash(glyph, glyph_scripts[idx]) & dups->mask;
+
+  for (i = dups->heads[h]; i >= 0; i = dups->chain[i])
+  {
+    GLYPH* g = &data->glyphs[i];
+
+
+    if (glyph_scripts[i] == glyph_scripts[idx]
+        && g->len1 == glyph->len1
+        && g->len2 == glyph->len2
+        && !memcmp(g->buf, glyph->buf, glyph->len1 + glyph->len2))
+      return i;
+  }
+
+  dups->chain[idx] = dups->heads[h];
+  dups->heads[h] = idx;
+
+  return -1;
+}
+
+
+static FT_Error
+TA_glyph_copy_instructions(FONT* font,
+                           GLYPH* glyph,
+                           GLYPH* source)
+{
+  glyph->have_bound = source->have_bound;
+  glyph->bound = source->bound;
+
+  if (!source->ins_len)
+    return FT_Err_Ok;
+
+  /* we don't share the buffer since variants might free it */
+  glyph->ins_buf = (FT_Byte*)ta_mem_alloc(font->memory, source->ins_len);
+  if (!glyph->ins_buf)
+    return FT_Err_Out_Of_Memory;
+
+  memcpy(glyph->ins_buf, source->ins_buf, source->ins_len);
+  glyph->ins_len = source->ins_len;
+
+  return FT_Err_Ok;
+}
+
+
+/* mark the glyphs selected with `hint-glyphs', together with */
+/* all of their components (recursively) */
+
+static FT_Error
+TA_sfnt_mark_hint_glyphs(glyf_Data* data,
+                         FONT* font,
+                         FT_Byte* marks)
+{
+  number_range* range;
+  FT_UShort* stack;
+  FT_UShort sp = 0;
+
+
+  /* every glyph gets pushed at most once */
+  stack = (FT_UShort*)ta_mem_alloc(font->memory,
+                                   data->num_glyphs * sizeof (FT_UShort));
+  if (!stack)
+    return FT_Err_Out_Of_Memory;
+
+  for (range = font->hint_glyphs; range; range = range->next)
+  {
+    int i;
+
+
+    for (i = range->start; i <= range->end && i < data->num_glyphs; i++)
+    {
+      if (marks[i])
+        continue;
+
+      marks[i] = 1;
+      stack[sp++] = (FT_UShort)i;
+
+      while (sp)
+      {
+        GLYPH* glyph = &data->glyphs[stack[--sp]];
+        FT_UShort j;
+
+
+        for (j = 0; j < glyph->num_components; j++)
+        {
+          FT_UShort component = glyph->components[j];
+
+
+          if (component < data->num_glyphs && !marks[component])
+          {
+            marks[component] = 1;
+            stack[sp++] = component;
+          }
+        }
+      }
+    }
+  }
+
+  ta_mem_free(font->memory, stack);
+
+  return FT_Err_Ok;
+}
+
+
 static FT_Error
 TA_sfnt_build_glyf_hints(SFNT* sfnt,
                          FONT* font)
 {
   FT_Face face = sfnt->face;
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  TA_FaceGlobals globals = (TA_FaceGlobals)face->autohint.data;
+  Dup_Table dups;
+  FT_Byte* marks = NULL;
   FT_Long idx;
   FT_Error error;
 
 
+  /* in merge mode, the bytecode comes from the shards */
+  if (font->shard_buf)
+    return TA_sfnt_merge_shards(sfnt, font);
+
+  /* variants which don't change the autohinter's scaling */
+  /* can use the bytecode of the previous run */
+  if (font->reuse_glyph_hints)
+    return FT_Err_Ok;
+
+  /* with pre-hinting, the glyphs' original bytecode */
+  /* (which is not part of the glyph data) influences the result */
+  dups.heads = NULL;
+  dups.chain = NULL;
+  if (!font->pre_hinting)
+  {
+    dups.mask = 1;
+    while (dups.mask < (FT_ULong)face->num_glyphs)
+      dups.mask <<= 1;
+
+    dups.heads = (FT_Long*)ta_mem_alloc(font->memory,
+                                        dups.mask * sizeof (FT_Long));
+    dups.chain = (FT_Long*)ta_mem_alloc(font->memory,
+                                        face->num_glyphs * sizeof (FT_Long));
+    if (!dups.heads || !dups.chain)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+
+    memset(dups.heads, 0xFF, dups.mask * sizeof (FT_Long));
+    dups.mask--;
+  }
+
+  if (font->hint_glyphs)
+  {
+    marks = (FT_Byte*)ta_mem_calloc(font->memory, data->num_glyphs, 1);
+    if (!marks)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+
+    error = TA_sfnt_mark_hint_glyphs(data, font, marks);
+    if (error)
+      goto Exit;
+  }
+
   /* this loop doesn't include the artificial `.ttfautohint' glyph */
   for (idx = 0; idx < face->num_glyphs; idx++)
   {
-    error = TA_sfnt_build_glyph_instructions(sfnt, font, idx);
-    if (error)
-      return error;
+    /* in shard mode, only a range of glyphs gets hinted; */
+    /* with `hint-glyphs', only the selected glyphs and their components */
+    if ((!font->shard_last
+         || (idx >= (FT_Long)font->shard_first
+             && idx < (FT_Long)font->shard_last))
+        && (!marks || marks[idx]))
+    {
+      FT_Long dup_idx = -1;
+
+
+      if (dups.heads)
+        dup_idx = TA_glyph_find_duplicate(&dups, data,
+                                          globals->glyph_scripts, idx);
+
+      if (dup_idx >= 0)
+      {
+        error = TA_glyph_copy_instructions(font,
+                                           &data->glyphs[idx],
+                                           &data->glyphs[dup_idx]);
+        font->num_duplicate_glyphs++;
+
+        if (!error && data->glyphs[idx].have_bound && font->bound)
+          font->bound(idx, sfnt - font->sfnts,
+                      (int)data->glyphs[idx].bound, font->bound_data);
+      }
+      else
+        error = TA_sfnt_build_cached_glyph_instructions(sfnt, font, idx);
+      if (error)
+        goto Exit;
+    }
     if (font->progress)
     {
       FT_Int ret;
@@ -40,16 +274,27 @@ TA_sfnt_build_glyf_hints(SFNT* sfnt,
                            sfnt - font->sfnts, font->num_sfnts,
                            font->progress_data);
       if (ret)
-        return TA_Err_Canceled;
+      {
+        error = TA_Err_Canceled;
+        goto Exit;
+      }
     }
   }
 
-  return FT_Err_Ok;
+  error = FT_Err_Ok;
+
+Exit:
+  ta_mem_free(font->memory, dups.heads);
+  ta_mem_free(font->memory, dups.chain);
+  ta_mem_free(font->memory, marks);
+
+  return error;
 }
 
 
 static FT_Error
-TA_glyph_get_components(GLYPH* glyph,
+TA_glyph_get_components(TA_Memory memory,
+                        GLYPH* glyph,
                         FT_Byte* buf,
                         FT_ULong len)
 {
@@ -81,9 +326,10 @@ TA_glyph_get_components(GLYPH* glyph,
     component += *(p++);
 
     glyph->num_components++;
-    components_new = (FT_UShort*)realloc(glyph->components,
-                                         glyph->num_components
-                                         * sizeof (FT_UShort));
+    components_new = (FT_UShort*)ta_mem_realloc(memory,
+                                                glyph->components,
+                                                glyph->num_components
+                                                * sizeof (FT_UShort));
     if (!components_new)
     {
       glyph->num_components--;
@@ -113,7 +359,8 @@ TA_glyph_get_components(GLYPH* glyph,
 
 
 static FT_Error
-TA_glyph_parse_composite(GLYPH* glyph,
+TA_glyph_parse_composite(TA_Memory memory,
+                         GLYPH* glyph,
                          FT_Byte* buf,
                          FT_ULong len,
                          FT_UShort num_glyphs,
@@ -131,7 +378,8 @@ TA_glyph_parse_composite(GLYPH* glyph,
   /* (including space for the new component */
   /* and possible argument size changes for shifted point indices) */
   /* and reallocate it later to its real size */
-  glyph->buf = (FT_Byte*)malloc(len + 8 + glyph->num_components * 2);
+  glyph->buf = (FT_Byte*)ta_mem_alloc(memory,
+                                      len + 8 + glyph->num_components * 2);
   if (!glyph->buf)
     return FT_Err_Out_Of_Memory;
 
@@ -304,7 +552,10 @@ TA_glyph_parse_composite(GLYPH* glyph,
   glyph->len1 = q - glyph->buf;
   /* glyph->len2 = 0; */
   glyph->flags_offset = flags_offset;
-  glyph->buf = (FT_Byte*)realloc(glyph->buf, glyph->len1);
+  q = (FT_Byte*)ta_mem_realloc(memory, glyph->buf, glyph->len1);
+  if (!q)
+    return FT_Err_Out_Of_Memory;
+  glyph->buf = q;
 
   /* we discard instructions (if any) */
   glyph->buf[glyph->flags_offset] &= ~(WE_HAVE_INSTR >> 8);
@@ -314,7 +565,8 @@ TA_glyph_parse_composite(GLYPH* glyph,
 
 
 static FT_Error
-TA_glyph_parse_simple(GLYPH* glyph,
+TA_glyph_parse_simple(TA_Memory memory,
+                      GLYPH* glyph,
                       FT_Byte* buf,
                       FT_ULong len)
 {
@@ -416,7 +668,7 @@ TA_glyph_parse_simple(GLYPH* glyph,
   /* in the same array */
   glyph->len1 = ins_offset;
   glyph->len2 = flags_size + xy_size;
-  glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
+  glyph->buf = (FT_Byte*)ta_mem_alloc(memory, glyph->len1 + glyph->len2);
   if (!glyph->buf)
     return FT_Err_Out_Of_Memory;
 
@@ -428,78 +680,110 @@ TA_glyph_parse_simple(GLYPH* glyph,
 }
 
 
+/*
+ * Composite glyphs form a directed acyclic graph.  We first sort all
+ * composite glyphs topologically (using a depth-first search with an
+ * explicit stack) so that each composite comes after all of its composite
+ * components.  Walking over this order, the accumulated values of a
+ * glyph's components are always available, making the whole computation
+ * linear in the number of component references.
+ */
+
 static FT_Error
-TA_iterate_composite_glyph(glyf_Data* data,
-                           FT_UShort* components,
-                           FT_UShort num_components,
-                           FT_UShort** pointsums,
-                           FT_UShort* num_pointsums,
-                           FT_UShort* num_composite_contours,
-                           FT_UShort* num_composite_points)
+TA_sfnt_sort_composite_glyphs(glyf_Data* data,
+                              FONT* font,
+                              FT_UShort* order,
+                              FT_UShort* num_order)
 {
-  FT_UShort* pointsums_new;
+  FT_Byte* state; /* 0: not visited, 1: on stack, 2: done */
+  FT_UShort* stack;
+  FT_UShort* next; /* the next component to visit */
+  FT_UShort sp;
+  FT_UShort n = 0;
   FT_UShort i;
+  FT_Error error = TA_Err_Ok;
 
 
-  /* save current state */
-
-  if (*num_pointsums == 0xFFFF)
-    return FT_Err_Invalid_Table;
-
-  (*num_pointsums)++;
-  pointsums_new = (FT_UShort*)realloc(*pointsums,
-                                      *num_pointsums
-                                      * sizeof (FT_UShort));
-  if (!pointsums_new)
+  state = (FT_Byte*)ta_mem_calloc(font->memory, data->num_glyphs, 1);
+  stack = (FT_UShort*)ta_mem_alloc(font->memory,
+                                   data->num_glyphs * sizeof (FT_UShort));
+  next = (FT_UShort*)ta_mem_alloc(font->memory,
+                                  data->num_glyphs * sizeof (FT_UShort));
+  if (!state || !stack || !next)
   {
-    (*num_pointsums)--;
-    return FT_Err_Out_Of_Memory;
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
   }
-  else
-    *pointsums = pointsums_new;
 
-  (*pointsums)[*num_pointsums - 1] = *num_composite_points;
-
-  for (i = 0; i < num_components; i++)
+  for (i = 0; i < data->num_glyphs; i++)
   {
-    GLYPH* glyph;
-    FT_UShort component = components[i];
-    FT_Error error;
+    if (!data->glyphs[i].num_components || state[i])
+      continue;
 
+    sp = 0;
+    stack[sp] = i;
+    next[sp] = 0;
+    sp++;
+    state[i] = 1;
 
-    if (component >= data->num_glyphs)
-      return FT_Err_Invalid_Table;
+    while (sp)
+    {
+      GLYPH* glyph = &data->glyphs[stack[sp - 1]];
 
-    glyph = &data->glyphs[component];
 
-    if (glyph->num_components)
-    {
-      error = TA_iterate_composite_glyph(data,
-                                         glyph->components,
-                                         glyph->num_components,
-                                         pointsums,
-                                         num_pointsums,
-                                         num_composite_contours,
-                                         num_composite_points);
-      if (error)
-        return error;
-    }
-    else
-    {
-      /* no need for checking overflow of the number of contours */
-      /* since the number of points is always larger or equal */
-      if (*num_composite_points > 0xFFFF - glyph->num_points)
-        return FT_Err_Invalid_Table;
+      if (next[sp - 1] < glyph->num_components)
+      {
+        FT_UShort component = glyph->components[next[sp - 1]++];
 
-      *num_composite_contours += glyph->num_contours;
-      *num_composite_points += glyph->num_points;
+
+        if (component >= data->num_glyphs)
+        {
+          error = FT_Err_Invalid_Table;
+          goto Exit;
+        }
+
+        if (!data->glyphs[component].num_components)
+          continue;
+
+        /* a glyph referring to itself (directly or indirectly) */
+        if (state[component] == 1)
+        {
+          error = FT_Err_Invalid_Table;
+          goto Exit;
+        }
+
+        if (!state[component])
+        {
+          stack[sp] = component;
+          next[sp] = 0;
+          sp++;
+          state[component] = 1;
+        }
+      }
+      else
+      {
+        sp--;
+        state[stack[sp]] = 2;
+        order[n++] = stack[sp];
+      }
     }
   }
 
-  return TA_Err_Ok;
+  *num_order = n;
+
+Exit:
+  ta_mem_free(font->memory, state);
+  ta_mem_free(font->memory, stack);
+  ta_mem_free(font->memory, next);
+
+  return error;
 }
 
 
+/* compute the number of contours and points of all composite glyphs */
+/* (after walking recursively over all subglyphs); */
+/* if `hint-with-components' is set, also compute the pointsums */
+
 static FT_Error
 TA_sfnt_compute_composite_pointsums(SFNT* sfnt,
                                     FONT* font)
@@ -507,50 +791,204 @@ TA_sfnt_compute_composite_pointsums(SFNT* sfnt,
   SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
   glyf_Data* data = (glyf_Data*)glyf_table->data;
 
+  FT_Bool need_pointsums = sfnt->max_components
+                           && font->hint_with_components;
+
+  FT_UShort* order;
+  FT_UShort num_order;
   FT_UShort i;
+  FT_Error error;
 
 
-  for (i = 0; i < data->num_glyphs; i++)
+  order = (FT_UShort*)ta_mem_alloc(font->memory,
+                                   data->num_glyphs * sizeof (FT_UShort));
+  if (!order)
+    return FT_Err_Out_Of_Memory;
+
+  error = TA_sfnt_sort_composite_glyphs(data, font, order, &num_order);
+  if (error)
+    goto Exit;
+
+  for (i = 0; i < num_order; i++)
   {
-    GLYPH* glyph = &data->glyphs[i];
+    GLYPH* glyph = &data->glyphs[order[i]];
+    FT_ULong num_composite_contours = 0;
+    FT_ULong num_composite_points = 0;
+    FT_ULong num_pointsums = 1;
+    FT_UShort j;
 
 
-    if (glyph->num_components)
+    for (j = 0; j < glyph->num_components; j++)
     {
-      FT_Error error;
-      FT_UShort num_composite_contours = 0;
-      FT_UShort num_composite_points = 0;
-
-
-      error = TA_iterate_composite_glyph(data,
-                                         glyph->components,
-                                         glyph->num_components,
-                                         &glyph->pointsums,
-                                         &glyph->num_pointsums,
-                                         &num_composite_contours,
-                                         &num_composite_points);
-      if (error)
-        return error;
+      GLYPH* component = &data->glyphs[glyph->components[j]];
+
 
-      glyph->num_composite_contours = num_composite_contours;
+      if (component->num_components)
+      {
+        num_composite_contours += component->num_composite_contours;
+        num_composite_points += component->num_composite_points;
+        num_pointsums += component->num_pointsums;
+      }
+      else
+      {
+        num_composite_contours += component->num_contours;
+        num_composite_points += component->num_points;
+      }
+    }
+
+    /* no need for checking overflow of the number of contours */
+    /* since the number of points is always larger or equal */
+    if (num_composite_points > 0xFFFF)
+    {
+      error = FT_Err_Invalid_Table;
+      goto Exit;
+    }
+
+    glyph->num_composite_contours = (FT_UShort)num_composite_contours;
+    glyph->num_composite_points = (FT_UShort)num_composite_points;
+
+    if (need_pointsums)
+    {
+      FT_UShort* pointsums;
+      FT_UShort points = 0;
+      FT_UShort k = 0;
+
+
+      if (num_pointsums > 0xFFFF)
+      {
+        error = FT_Err_Invalid_Table;
+        goto Exit;
+      }
 
-      if (font->hint_with_components)
+      pointsums = (FT_UShort*)ta_mem_alloc(font->memory,
+                                           num_pointsums
+                                           * sizeof (FT_UShort));
+      if (!pointsums)
       {
-        /* update maximum values, */
-        /* including the subglyphs not in `components' array */
-        /* (each of them has a single point in a single contour) */
-        if (num_composite_points + glyph->num_pointsums
-            > sfnt->max_composite_points)
-          sfnt->max_composite_points = num_composite_points
-                                       + glyph->num_pointsums;
-        if (num_composite_contours + glyph->num_pointsums
-            > sfnt->max_composite_contours)
-          sfnt->max_composite_contours = num_composite_contours
-                                         + glyph->num_pointsums;
+        error = FT_Err_Out_Of_Memory;
+        goto Exit;
       }
+
+      /* the pointsums of a composite component */
+      /* get inserted, shifted by the preceding points */
+      pointsums[k++] = 0;
+      for (j = 0; j < glyph->num_components; j++)
+      {
+        GLYPH* component = &data->glyphs[glyph->components[j]];
+
+
+        if (component->num_components)
+        {
+          FT_UShort l;
+
+
+          for (l = 0; l < component->num_pointsums; l++)
+            pointsums[k++] = points + component->pointsums[l];
+          points += component->num_composite_points;
+        }
+        else
+          points += component->num_points;
+      }
+
+      glyph->pointsums = pointsums;
+      glyph->num_pointsums = (FT_UShort)num_pointsums;
+
+      /* update maximum values, */
+      /* including the subglyphs not in `components' array */
+      /* (each of them has a single point in a single contour) */
+      if (num_composite_points + num_pointsums
+          > sfnt->max_composite_points)
+        sfnt->max_composite_points = (FT_UShort)(num_composite_points
+                                                 + num_pointsums);
+      if (num_composite_contours + num_pointsums
+          > sfnt->max_composite_contours)
+        sfnt->max_composite_contours = (FT_UShort)(num_composite_contours
+                                                   + num_pointsums);
+    }
+  }
+
+Exit:
+  ta_mem_free(font->memory, order);
+
+  return error;
+}
+
+
+/*
+ * In streaming mode, the original `glyf' table is not loaded as a whole;
+ * instead, we read it in chunks of at least `TA_GLYF_WINDOW_SIZE' bytes
+ * (or more for larger glyph records), and the hinted glyph records are
+ * collected in a buffer of the same size before being written to the
+ * output file.
+ */
+
+#define TA_GLYF_WINDOW_SIZE 0x10000
+
+typedef struct Glyf_Window_
+{
+  FT_Byte* buf;
+  FT_ULong size; /* the allocated size of `buf' */
+  FT_ULong start; /* the table offset of `buf[0]' */
+  FT_ULong len; /* the number of valid bytes in `buf' */
+} Glyf_Window;
+
+
+/* make the glyph record at `offset' with length `len' */
+/* available in `window' and return a pointer to it */
+
+static FT_Error
+TA_sfnt_read_glyf_window(SFNT* sfnt,
+                         FONT* font,
+                         Glyf_Window* window,
+                         FT_ULong offset,
+                         FT_ULong len,
+                         FT_Byte** abuf)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  FT_ULong size;
+  FT_ULong read_len;
+  FT_Error error;
+
+
+  if (offset >= window->start
+      && offset + len <= window->start + window->len)
+  {
+    *abuf = window->buf + (offset - window->start);
+    return TA_Err_Ok;
+  }
+
+  size = len > TA_GLYF_WINDOW_SIZE ? len : TA_GLYF_WINDOW_SIZE;
+  if (size > window->size)
+  {
+    ta_mem_free(font->memory, window->buf);
+    window->len = 0;
+    window->buf = (FT_Byte*)ta_mem_alloc(font->memory, size);
+    if (!window->buf)
+    {
+      window->size = 0;
+      return FT_Err_Out_Of_Memory;
     }
+    window->size = size;
+  }
+
+  /* the caller has already checked that the record is within the table */
+  read_len = glyf_table->len - offset;
+  if (read_len > window->size)
+    read_len = window->size;
+
+  error = FT_Load_Sfnt_Table(sfnt->face, TTAG_glyf, (FT_Long)offset,
+                             window->buf, &read_len);
+  if (error)
+  {
+    window->len = 0;
+    return error;
   }
 
+  window->start = offset;
+  window->len = read_len;
+
+  *abuf = window->buf;
+
   return TA_Err_Ok;
 }
 
@@ -573,6 +1011,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   FT_UShort i;
   FT_UShort loop_count;
 
+  Glyf_Window window;
   FT_Error error;
 
 
@@ -583,7 +1022,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   if (glyf_table->data)
     return TA_Err_Ok;
 
-  data = (glyf_Data*)calloc(1, sizeof (glyf_Data));
+  data = (glyf_Data*)ta_mem_calloc(font->memory, 1, sizeof (glyf_Data));
   if (!data)
     return FT_Err_Out_Of_Memory;
 
@@ -598,9 +1037,14 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   /* allocate one more glyph slot if we have composite glyphs */
   if (!sfnt->max_components || !font->hint_with_components)
     data->num_glyphs -= 1;
-  data->glyphs = (GLYPH*)calloc(1, data->num_glyphs * sizeof (GLYPH));
+  data->glyphs = (GLYPH*)ta_mem_calloc(font->memory,
+                                        1, data->num_glyphs * sizeof (GLYPH));
   if (!data->glyphs)
+  {
+    /* `TA_font_unload' loops over the glyphs */
+    data->num_glyphs = 0;
     return FT_Err_Out_Of_Memory;
+  }
 
   data->master_globals = NULL;
   data->cvt_idx = MISSING;
@@ -609,6 +1053,8 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 
   /* first loop over `loca' and `glyf' data */
 
+  memset(&window, 0, sizeof (Glyf_Window));
+
   p = loca_table->buf;
 
   if (loca_format)
@@ -649,7 +1095,10 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 
     if (offset_next < offset
         || offset_next > glyf_table->len)
-      return FT_Err_Invalid_Table;
+    {
+      error = FT_Err_Invalid_Table;
+      goto Exit;
+    }
 
     len = offset_next - offset;
     if (!len)
@@ -661,18 +1110,29 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 
       /* check header size */
       if (len < 10)
-        return FT_Err_Invalid_Table;
+      {
+        error = FT_Err_Invalid_Table;
+        goto Exit;
+      }
 
       /* we need the number of contours and points for */
       /* `TA_sfnt_compute_composite_pointsums' */
-      buf = glyf_table->buf + offset;
+      if (font->streaming)
+      {
+        error = TA_sfnt_read_glyf_window(sfnt, font, &window,
+                                         offset, len, &buf);
+        if (error)
+          goto Exit;
+      }
+      else
+        buf = glyf_table->buf + offset;
       glyph->num_contours = (FT_Short)((buf[0] << 8) + buf[1]);
 
       if (glyph->num_contours < 0)
       {
-        error = TA_glyph_get_components(glyph, buf, len);
+        error = TA_glyph_get_components(font->memory, glyph, buf, len);
         if (error)
-          return error;
+          goto Exit;
       }
       else
       {
@@ -682,7 +1142,10 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
         /* use the last contour's end point to compute number of points */
         off = 10 + (glyph->num_contours - 1) * 2;
         if (off >= len - 1)
-          return FT_Err_Invalid_Table;
+        {
+          error = FT_Err_Invalid_Table;
+          goto Exit;
+        }
 
         glyph->num_points = buf[off] << 8;
         glyph->num_points += buf[off + 1] + 1;
@@ -690,12 +1153,23 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
     }
   }
 
-  if (sfnt->max_components && font->hint_with_components)
-  {
-    error = TA_sfnt_compute_composite_pointsums(sfnt, font);
-    if (error)
-      return error;
-  }
+  error = TA_Err_Ok;
+
+Exit:
+  ta_mem_free(font->memory, window.buf);
+  if (error)
+    return error;
+
+  /* we don't rely on the `maxp' table here since the contour numbers */
+  /* are also needed by `TA_font_build_subglyph_shifter' */
+  error = TA_sfnt_compute_composite_pointsums(sfnt, font);
+  if (error)
+    return error;
+
+  /* in streaming mode, the glyphs get parsed */
+  /* in `TA_sfnt_stream_glyf_table' */
+  if (font->streaming)
+    goto Special_Glyph;
 
   /* second loop over `loca' and `glyf' data */
 
@@ -755,16 +1229,17 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
       /* is more or less invalid. */
 
       if (glyph->num_contours < 0)
-        error = TA_glyph_parse_composite(glyph, buf, len,
+        error = TA_glyph_parse_composite(font->memory, glyph, buf, len,
                                          data->num_glyphs,
                                          font->hint_with_components);
       else
-        error = TA_glyph_parse_simple(glyph, buf, len);
+        error = TA_glyph_parse_simple(font->memory, glyph, buf, len);
       if (error)
         return error;
     }
   }
 
+Special_Glyph:
   if (sfnt->max_components && font->hint_with_components)
   {
     /* construct and append our special glyph used as a composite element */
@@ -773,7 +1248,8 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 
     glyph->len1 = 12;
     glyph->len2 = 1;
-    glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
+    glyph->buf = (FT_Byte*)ta_mem_alloc(font->memory,
+                                        glyph->len1 + glyph->len2);
     if (!glyph->buf)
       return FT_Err_Out_Of_Memory;
 
@@ -798,7 +1274,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
     /* this works because the loop in `TA_sfnt_build_glyf_hints' */
     /* doesn't include the newly appended glyph */
     glyph->ins_len = sizeof (ttfautohint_glyph_bytecode);
-    glyph->ins_buf = (FT_Byte*)malloc(glyph->ins_len);
+    glyph->ins_buf = (FT_Byte*)ta_mem_alloc(font->memory, glyph->ins_len);
     if (!glyph->ins_buf)
       return FT_Err_Out_Of_Memory;
     memcpy(glyph->ins_buf, ttfautohint_glyph_bytecode, glyph->ins_len);
@@ -810,7 +1286,288 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
 }
 
 
-FT_Error
+/* return the length of a glyph record with new instructions */
+
+static FT_ULong
+TA_glyph_get_record_len(GLYPH* glyph)
+{
+  FT_ULong len;
+
+
+  len = glyph->len1 + glyph->len2 + glyph->ins_len;
+  /* add two bytes for the instructionLength field */
+  if (glyph->len2 || glyph->ins_len)
+    len += 2;
+
+  return len;
+}
+
+
+/* copy glyph data to `p', inserting the new instructions, */
+/* and return the position after the (padded) record */
+
+static FT_Byte*
+TA_glyph_write_record(GLYPH* glyph,
+                      FT_Byte* p)
+{
+  FT_ULong len = TA_glyph_get_record_len(glyph);
+
+
+  if (!len)
+    return p;
+
+  memcpy(p, glyph->buf, glyph->len1);
+
+  if (glyph->len2)
+  {
+    /* simple glyph */
+    p += glyph->len1;
+    *(p++) = HIGH(glyph->ins_len);
+    *(p++) = LOW(glyph->ins_len);
+    memcpy(p, glyph->ins_buf, glyph->ins_len);
+    p += glyph->ins_len;
+    memcpy(p, glyph->buf + glyph->len1, glyph->len2);
+    p += glyph->len2;
+  }
+  else
+  {
+    /* composite glyph */
+    if (glyph->ins_len)
+    {
+      *(p + glyph->flags_offset) |= (WE_HAVE_INSTR >> 8);
+      p += glyph->len1;
+      *(p++) = HIGH(glyph->ins_len);
+      *(p++) = LOW(glyph->ins_len);
+      memcpy(p, glyph->ins_buf, glyph->ins_len);
+      p += glyph->ins_len;
+    }
+    else
+      p += glyph->len1;
+  }
+
+  /* pad with zero bytes to have an offset which is a multiple of 4; */
+  /* this works even for the last glyph record since the `glyf' */
+  /* table length is a multiple of 4 also */
+  switch (len % 4)
+  {
+  case 1:
+    *(p++) = 0;
+  case 2:
+    *(p++) = 0;
+  case 3:
+    *(p++) = 0;
+  default:
+    break;
+  }
+
+  return p;
+}
+
+
+static FT_ULong
+TA_loca_get_offset(FT_Byte* loca_buf,
+                   FT_Byte loca_format,
+                   FT_UShort idx)
+{
+  FT_Byte* p;
+
+
+  if (loca_format)
+  {
+    p = loca_buf + 4 * idx;
+    return ((FT_ULong)p[0] << 24) + (p[1] << 16) + (p[2] << 8) + p[3];
+  }
+  else
+  {
+    p = loca_buf + 2 * idx;
+    return ((FT_ULong)(p[0] << 8) + p[1]) << 1;
+  }
+}
+
+
+/*
+ * In streaming mode, `TA_sfnt_split_glyf_table' only collects the data
+ * necessary for composite glyphs.  Here we read each glyph's data from
+ * the original `glyf' table (via a window, see above), hint the glyph,
+ * and append its record to the output buffer, which gets written to the
+ * output file as soon as it is full.  Afterwards, the glyph data and
+ * bytecode are no longer needed; we only keep the record lengths for the
+ * `loca' table.  This way, only the data of a single glyph and two
+ * buffers of limited size are in memory at the same time.
+ */
+
+static FT_Error
+TA_sfnt_stream_glyf_table(SFNT* sfnt,
+                          FONT* font)
+{
+  FT_Face face = sfnt->face;
+
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  SFNT_Table* loca_table = &font->tables[sfnt->loca_idx];
+  SFNT_Table* head_table = &font->tables[sfnt->head_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  FT_Byte loca_format;
+  FT_ULong num_loca_glyphs;
+
+  Glyf_Window window;
+
+  FT_Byte* out_buf = NULL;
+  FT_ULong out_size = 0;
+  FT_ULong out_len = 0;
+
+  FT_ULong len = 0;
+  FT_ULong checksum = 0;
+
+  FT_UShort i;
+  FT_Error error;
+
+
+  /* `loca' and `head' still hold the original data */
+  loca_format = head_table->buf[LOCA_FORMAT_OFFSET];
+  num_loca_glyphs = loca_format ? loca_table->len / 4 - 1
+                                : loca_table->len / 2 - 1;
+
+  error = TA_font_start_TTF_stream(font);
+  if (error)
+    return error;
+
+  memset(&window, 0, sizeof (Glyf_Window));
+
+  for (i = 0; i < data->num_glyphs; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+    FT_ULong rec_len;
+
+
+    /* with pre-hinting, the glyph data has already been created */
+    if (!font->pre_hinting && i < num_loca_glyphs)
+    {
+      FT_ULong offset = TA_loca_get_offset(loca_table->buf,
+                                           loca_format, i);
+      FT_ULong offset_next = TA_loca_get_offset(loca_table->buf,
+                                                loca_format, i + 1);
+
+
+      /* the offsets have been checked in `TA_sfnt_split_glyf_table' */
+      if (offset_next > offset)
+      {
+        FT_Byte* buf;
+
+
+        error = TA_sfnt_read_glyf_window(sfnt, font, &window,
+                                         offset, offset_next - offset,
+                                         &buf);
+        if (error)
+          goto Exit;
+
+        if (glyph->num_contours < 0)
+          error = TA_glyph_parse_composite(font->memory, glyph, buf,
+                                           offset_next - offset,
+                                           data->num_glyphs,
+                                           font->hint_with_components);
+        else
+          error = TA_glyph_parse_simple(font->memory, glyph, buf,
+                                        offset_next - offset);
+        if (error)
+          goto Exit;
+      }
+    }
+
+    /* this doesn't include the artificial `.ttfautohint' glyph */
+    if (i < face->num_glyphs)
+    {
+      error = TA_sfnt_build_glyph_instructions(sfnt, font, i);
+      if (error)
+        goto Exit;
+
+      if (font->progress)
+      {
+        FT_Int ret;
+
+
+        ret = font->progress(i, face->num_glyphs,
+                             sfnt - font->sfnts, font->num_sfnts,
+                             font->progress_data);
+        if (ret)
+        {
+          error = TA_Err_Canceled;
+          goto Exit;
+        }
+      }
+    }
+
+    rec_len = TA_glyph_get_record_len(glyph);
+    if (rec_len)
+    {
+      FT_ULong rec_len_padded = (rec_len + 3) & ~3;
+      FT_Byte* rec_buf;
+
+
+      /* flush the output buffer if the record doesn't fit */
+      if (out_len
+          && out_len + rec_len_padded > out_size)
+      {
+        error = TA_font_stream_write(font, out_buf, out_len);
+        if (error)
+          goto Exit;
+        out_len = 0;
+      }
+
+      if (rec_len_padded > out_size)
+      {
+        out_size = rec_len_padded > TA_GLYF_WINDOW_SIZE
+                     ? rec_len_padded
+                     : TA_GLYF_WINDOW_SIZE;
+
+        ta_mem_free(font->memory, out_buf);
+        out_buf = (FT_Byte*)ta_mem_alloc(font->memory, out_size);
+        if (!out_buf)
+        {
+          error = FT_Err_Out_Of_Memory;
+          goto Exit;
+        }
+      }
+
+      rec_buf = out_buf + out_len;
+      (void)TA_glyph_write_record(glyph, rec_buf);
+      out_len += rec_len_padded;
+
+      /* the records are padded, so we can sum up the checksums */
+      checksum += TA_table_compute_checksum(rec_buf, rec_len_padded);
+    }
+
+    /* glyph records should have offsets which are multiples of 4 */
+    len = ((len + 3) & ~3) + rec_len;
+
+    ta_mem_free(font->memory, glyph->buf);
+    glyph->buf = NULL;
+    ta_mem_free(font->memory, glyph->ins_buf);
+    glyph->ins_buf = NULL;
+  }
+
+  if (out_len)
+  {
+    error = TA_font_stream_write(font, out_buf, out_len);
+    if (error)
+      goto Exit;
+  }
+
+  /* to make the short format of the `loca' table always work, */
+  /* assure an even length of the `glyf' table */
+  glyf_table->len = (len + 1) & ~1;
+  glyf_table->checksum = checksum;
+  glyf_table->processed = 1;
+
+Exit:
+  ta_mem_free(font->memory, window.buf);
+  ta_mem_free(font->memory, out_buf);
+
+  return error;
+}
+
+
+FT_Error
 TA_sfnt_build_glyf_table(SFNT* sfnt,
                          FONT* font)
 {
@@ -830,6 +1587,9 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   if (glyf_table->processed)
     return TA_Err_Ok;
 
+  if (font->streaming)
+    return TA_sfnt_stream_glyf_table(sfnt, font);
+
   error = TA_sfnt_build_glyf_hints(sfnt, font);
   if (error)
     return error;
@@ -841,17 +1601,15 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   {
     /* glyph records should have offsets which are multiples of 4 */
     len = (len + 3) & ~3;
-    len += glyph->len1 + glyph->len2 + glyph->ins_len;
-    /* add two bytes for the instructionLength field */
-    if (glyph->len2 || glyph->ins_len)
-      len += 2;
+    len += TA_glyph_get_record_len(glyph);
   }
 
   /* to make the short format of the `loca' table always work, */
   /* assure an even length of the `glyf' table */
   glyf_table->len = (len + 1) & ~1;
 
-  buf_new = (FT_Byte*)realloc(glyf_table->buf, (len + 3) & ~3);
+  buf_new = (FT_Byte*)ta_mem_realloc(font->memory,
+                                     glyf_table->buf, (len + 3) & ~3);
   if (!buf_new)
     return FT_Err_Out_Of_Memory;
   else
@@ -860,59 +1618,7 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   p = glyf_table->buf;
   glyph = data->glyphs;
   for (i = 0; i < data->num_glyphs; i++, glyph++)
-  {
-    len = glyph->len1 + glyph->len2 + glyph->ins_len;
-    if (glyph->len2 || glyph->ins_len)
-      len += 2;
-
-    if (len)
-    {
-      /* copy glyph data and insert new instructions */
-      memcpy(p, glyph->buf, glyph->len1);
-
-      if (glyph->len2)
-      {
-        /* simple glyph */
-        p += glyph->len1;
-        *(p++) = HIGH(glyph->ins_len);
-        *(p++) = LOW(glyph->ins_len);
-        memcpy(p, glyph->ins_buf, glyph->ins_len);
-        p += glyph->ins_len;
-        memcpy(p, glyph->buf + glyph->len1, glyph->len2);
-        p += glyph->len2;
-      }
-      else
-      {
-        /* composite glyph */
-        if (glyph->ins_len)
-        {
-          *(p + glyph->flags_offset) |= (WE_HAVE_INSTR >> 8);
-          p += glyph->len1;
-          *(p++) = HIGH(glyph->ins_len);
-          *(p++) = LOW(glyph->ins_len);
-          memcpy(p, glyph->ins_buf, glyph->ins_len);
-          p += glyph->ins_len;
-        }
-        else
-          p += glyph->len1;
-      }
-
-      /* pad with zero bytes to have an offset which is a multiple of 4; */
-      /* this works even for the last glyph record since the `glyf' */
-      /* table length is a multiple of 4 also */
-      switch (len % 4)
-      {
-      case 1:
-        *(p++) = 0;
-      case 2:
-        *(p++) = 0;
-      case 3:
-        *(p++) = 0;
-      default:
-        break;
-      }
-    }
-  }
+    p = TA_glyph_write_record(glyph, p);
 
   glyf_table->checksum = TA_table_compute_checksum(glyf_table->buf,
                                                    glyf_table->len);
@@ -923,7 +1629,8 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
 
 
 static FT_Error
-TA_create_glyph_data(FT_Outline* outline,
+TA_create_glyph_data(TA_Memory memory,
+                     FT_Outline* outline,
                      GLYPH* glyph)
 {
   FT_Error error = TA_Err_Ok;
@@ -957,7 +1664,7 @@ TA_create_glyph_data(FT_Outline* outline,
   /* we use `calloc' since we rely on the array */
   /* being initialized to zero; */
   /* additionally, we need one more byte for a test after the loop */
-  flags = (FT_Byte*)calloc(1, outline->n_points + 1);
+  flags = (FT_Byte*)ta_mem_calloc(memory, 1, outline->n_points + 1);
   if (!flags)
   {
     error = FT_Err_Out_Of_Memory;
@@ -965,14 +1672,14 @@ TA_create_glyph_data(FT_Outline* outline,
   }
 
   /* we have either one-byte or two-byte elements */
-  x = (FT_Byte*)malloc(2 * outline->n_points);
+  x = (FT_Byte*)ta_mem_alloc(memory, 2 * outline->n_points);
   if (!x)
   {
     error = FT_Err_Out_Of_Memory;
     goto Exit;
   }
 
-  y = (FT_Byte*)malloc(2 * outline->n_points);
+  y = (FT_Byte*)ta_mem_alloc(memory, 2 * outline->n_points);
   if (!y)
   {
     error = FT_Err_Out_Of_Memory;
@@ -1107,7 +1814,7 @@ TA_create_glyph_data(FT_Outline* outline,
   glyph->len1 = 10 + 2 * outline->n_contours;
   glyph->len2 = (flagsp - flags) + (xp - x) + (yp - y);
 
-  glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
+  glyph->buf = (FT_Byte*)ta_mem_alloc(memory, glyph->len1 + glyph->len2);
   if (!glyph->buf)
   {
     error = FT_Err_Out_Of_Memory;
@@ -1134,15 +1841,89 @@ TA_create_glyph_data(FT_Outline* outline,
   memcpy(p, y, yp - y);
 
 Exit:
-  free(flags);
-  free(x);
-  free(y);
+  ta_mem_free(memory, flags);
+  ta_mem_free(memory, x);
+  ta_mem_free(memory, y);
 
   return error;
 }
 
 
-/* We hint each glyph at EM size and construct a new `glyf' table. */
+/* set the size of `face' used for pre-hinting */
+
+FT_Error
+TA_font_set_pre_hinting_size(FONT* font,
+                             FT_Face face)
+{
+  if (font->pre_hinting_size)
+    return FT_Set_Pixel_Sizes(face,
+                              font->pre_hinting_size,
+                              font->pre_hinting_size);
+
+  /* by default, we use the EM size */
+  /* so that the resulting coordinates can be used without transformation */
+  return FT_Set_Char_Size(face, face->units_per_EM * 64, 0, 72, 0);
+}
+
+
+/* load glyphs `first' to `last - 1' of `sfnt' with the original hints */
+/* applied, using `face' (which must be set up with */
+/* `TA_font_set_pre_hinting_size'), and store them in the glyf data; */
+/* `face' is either the subfont's face or a copy of it */
+
+FT_Error
+TA_sfnt_pre_hint_glyphs(SFNT* sfnt,
+                        FONT* font,
+                        FT_Face face,
+                        FT_Long first,
+                        FT_Long last)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  FT_Error error;
+
+  FT_Long i;
+
+
+  for (i = first; i < last; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+    FT_Outline* outline = &face->glyph->outline;
+
+
+    error = FT_Load_Glyph(face, (FT_UInt)i,
+                          FT_LOAD_NO_BITMAP | FT_LOAD_NO_AUTOHINT);
+    if (error)
+      return error;
+
+    /* scale the outline back to the EM size */
+    if (font->pre_hinting_size)
+    {
+      FT_Short j;
+
+
+      for (j = 0; j < outline->n_points; j++)
+      {
+        outline->points[j].x = FT_MulDiv(outline->points[j].x,
+                                         face->units_per_EM,
+                                         font->pre_hinting_size);
+        outline->points[j].y = FT_MulDiv(outline->points[j].y,
+                                         face->units_per_EM,
+                                         font->pre_hinting_size);
+      }
+    }
+
+    error = TA_create_glyph_data(font->memory, outline, glyph);
+    if (error)
+      return error;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* We hint each glyph at EM size (or the size given by */
+/* `pre-hinting-size') and construct a new `glyf' table. */
 /* Some fonts need this; in particular, */
 /* there are CJK fonts which use hints to scale and position subglyphs. */
 /* As a consequence, there are no longer composite glyphs. */
@@ -1153,12 +1934,9 @@ TA_sfnt_create_glyf_data(SFNT* sfnt,
 {
   SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
   FT_Face face = sfnt->face;
-  FT_Error error;
 
   glyf_Data* data;
 
-  FT_UShort i;
-
 
   /* in case of success, all allocated arrays are */
   /* linked and eventually freed in `TA_font_unload' */
@@ -1167,40 +1945,211 @@ TA_sfnt_create_glyf_data(SFNT* sfnt,
   if (glyf_table->data)
     return TA_Err_Ok;
 
-  data = (glyf_Data*)calloc(1, sizeof (glyf_Data));
+  data = (glyf_Data*)ta_mem_calloc(font->memory, 1, sizeof (glyf_Data));
   if (!data)
     return FT_Err_Out_Of_Memory;
 
   glyf_table->data = data;
 
   data->num_glyphs = face->num_glyphs;
-  data->glyphs = (GLYPH*)calloc(1, data->num_glyphs * sizeof (GLYPH));
+  data->glyphs = (GLYPH*)ta_mem_calloc(font->memory,
+                                        1, data->num_glyphs * sizeof (GLYPH));
   if (!data->glyphs)
+  {
+    /* `TA_font_unload' loops over the glyphs */
+    data->num_glyphs = 0;
     return FT_Err_Out_Of_Memory;
+  }
 
-  /* XXX: Make size configurable */
-  /* we use the EM size */
-  /* so that the resulting coordinates can be used without transformation */
-  error = FT_Set_Char_Size(face, face->units_per_EM * 64, 0, 72, 0);
-  if (error)
-    return error;
+  data->cvt_idx = MISSING;
+  data->fpgm_idx = MISSING;
+  data->prep_idx = MISSING;
 
-  /* loop over all glyphs in font face */
-  for (i = 0; i < data->num_glyphs; i++)
+  /* this might use threads (see `tathread.c') */
+  return TA_sfnt_pre_hint_glyf_data(sfnt, font);
+}
+
+
+/* Decode the data of a simple glyph (as stored in `glyph->buf') */
+/* into unscaled outline coordinates, exactly as FreeType's glyph loader */
+/* does with flag `FT_LOAD_NO_SCALE'.  This is much faster than */
+/* `FT_Load_Glyph', which we would otherwise call for every PPEM value */
+/* of the hinting range. */
+
+FT_Error
+TA_glyph_decode_outline(TA_Memory memory,
+                        GLYPH* glyph,
+                        FT_Outline* outline)
+{
+  FT_Byte* p;
+  FT_Byte* endp;
+
+  FT_Short num_contours = glyph->num_contours;
+  FT_UShort num_points = glyph->num_points;
+
+  FT_Byte* tags;
+  FT_Byte* limit;
+  FT_Vector* vec;
+  FT_Pos x, y;
+
+  FT_Short i;
+
+
+  memset(outline, 0, sizeof (FT_Outline));
+
+  /* composite and empty glyphs are not handled */
+  if (num_contours <= 0
+      || !num_points
+      || !glyph->buf
+      || !glyph->len2)
+    return FT_Err_Invalid_Glyph_Format;
+
+  outline->points = (FT_Vector*)ta_mem_alloc(memory,
+                                             num_points * sizeof (FT_Vector));
+  outline->tags = (char*)ta_mem_alloc(memory, num_points);
+  outline->contours = (short*)ta_mem_alloc(memory,
+                                           num_contours * sizeof (short));
+  if (!outline->points
+      || !outline->tags
+      || !outline->contours)
   {
-    GLYPH* glyph = &data->glyphs[i];
+    TA_glyph_free_outline(memory, outline);
+    return FT_Err_Out_Of_Memory;
+  }
 
+  outline->n_points = (short)num_points;
+  outline->n_contours = num_contours;
 
-    error = FT_Load_Glyph(face, i, FT_LOAD_NO_BITMAP | FT_LOAD_NO_AUTOHINT);
-    if (error)
-      return error;
+  /* the end points of the contours */
+  p = glyph->buf + 10;
 
-    error = TA_create_glyph_data(&face->glyph->outline, glyph);
-    if (error)
-      return error;
+  for (i = 0; i < num_contours; i++)
+  {
+    FT_UShort end = *(p++) << 8;
+
+
+    end += *(p++);
+    if ((i > 0 && end <= (FT_UShort)outline->contours[i - 1])
+        || end >= num_points)
+      goto Invalid;
+
+    outline->contours[i] = (short)end;
+  }
+
+  /* the instructions have already been removed */
+  p = glyph->buf + glyph->len1;
+  endp = p + glyph->len2;
+
+  /* the flags, temporarily stored in the `tags' array */
+  tags = (FT_Byte*)outline->tags;
+  limit = tags + num_points;
+
+  while (tags < limit)
+  {
+    FT_Byte flags;
+    FT_UInt count;
+
+
+    if (p >= endp)
+      goto Invalid;
+
+    flags = *(p++);
+    count = 1;
+
+    if (flags & REPEAT)
+    {
+      if (p >= endp)
+        goto Invalid;
+
+      count += *(p++);
+      if (tags + count > limit)
+        goto Invalid;
+    }
+
+    while (count--)
+      *(tags++) = flags;
+  }
+
+  /* the x coordinates */
+  tags = (FT_Byte*)outline->tags;
+  vec = outline->points;
+  x = 0;
+
+  for (; tags < limit; tags++, vec++)
+  {
+    FT_Byte flags = *tags;
+
+
+    if (flags & X_SHORT_VECTOR)
+    {
+      if (p + 1 > endp)
+        goto Invalid;
+
+      x += (flags & SAME_X) ? *p : -*p;
+      p++;
+    }
+    else if (!(flags & SAME_X))
+    {
+      if (p + 2 > endp)
+        goto Invalid;
+
+      x += (FT_Short)((p[0] << 8) + p[1]);
+      p += 2;
+    }
+
+    vec->x = x;
+  }
+
+  /* the y coordinates */
+  tags = (FT_Byte*)outline->tags;
+  vec = outline->points;
+  y = 0;
+
+  for (; tags < limit; tags++, vec++)
+  {
+    FT_Byte flags = *tags;
+
+
+    if (flags & Y_SHORT_VECTOR)
+    {
+      if (p + 1 > endp)
+        goto Invalid;
+
+      y += (flags & SAME_Y) ? *p : -*p;
+      p++;
+    }
+    else if (!(flags & SAME_Y))
+    {
+      if (p + 2 > endp)
+        goto Invalid;
+
+      y += (FT_Short)((p[0] << 8) + p[1]);
+      p += 2;
+    }
+
+    vec->y = y;
+
+    /* now convert the flags into outline tags */
+    *tags &= ON_CURVE;
   }
 
   return TA_Err_Ok;
+
+Invalid:
+  TA_glyph_free_outline(memory, outline);
+  return FT_Err_Invalid_Table;
+}
+
+
+void
+TA_glyph_free_outline(TA_Memory memory,
+                      FT_Outline* outline)
+{
+  ta_mem_free(memory, outline->points);
+  ta_mem_free(memory, outline->tags);
+  ta_mem_free(memory, outline->contours);
+
+  memset(outline, 0, sizeof (FT_Outline));
 }
 
 
@@ -67,7 +67,8 @@ TA_read_coverage_table(FT_Byte* p,
     if (p - GPOS_table->buf > (ptrdiff_t)(GPOS_table->len - GlyphCount * 2))
       return FT_Err_Invalid_Table;
 
-    glyph_idxs = (FT_UShort*)malloc(GlyphCount * sizeof (FT_UShort));
+    glyph_idxs = (FT_UShort*)ta_mem_alloc(font->memory,
+                                          GlyphCount * sizeof (FT_UShort));
     if (!glyph_idxs)
       return FT_Err_Out_Of_Memory;
 
@@ -118,7 +119,8 @@ TA_read_coverage_table(FT_Byte* p,
       count += end - start + 1;
     }
 
-    glyph_idxs = (FT_UShort*)malloc(count * sizeof (FT_UShort));
+    glyph_idxs = (FT_UShort*)ta_mem_alloc(font->memory,
+                                          count * sizeof (FT_UShort));
     if (!glyph_idxs)
       return FT_Err_Out_Of_Memory;
 
@@ -268,14 +270,14 @@ TA_handle_cursive_lookup(FT_Byte* Lookup,
         goto Fail;
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_mem_free(font->memory, cov.glyph_idxs);
   return error;
 }
 
@@ -349,7 +351,7 @@ TA_handle_markbase_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
 
     error = TA_read_coverage_table(BaseCoverage, &cov, sfnt, font);
     if (error)
@@ -385,14 +387,14 @@ TA_handle_markbase_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_mem_free(font->memory, cov.glyph_idxs);
   return error;
 }
 
@@ -466,7 +468,7 @@ TA_handle_marklig_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
 
     error = TA_read_coverage_table(LigatureCoverage, &cov, sfnt, font);
     if (error)
@@ -516,14 +518,14 @@ TA_handle_marklig_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_mem_free(font->memory, cov.glyph_idxs);
   return error;
 }
 
@@ -597,7 +599,7 @@ TA_handle_markmark_lookup(FT_Byte* Lookup,
         return error;
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
 
     error = TA_read_coverage_table(Mark2Coverage, &cov, sfnt, font);
     if (error)
@@ -633,14 +635,14 @@ TA_handle_markmark_lookup(FT_Byte* Lookup,
       }
     }
 
-    free(cov.glyph_idxs);
+    ta_mem_free(font->memory, cov.glyph_idxs);
     cov.glyph_idxs = NULL;
   }
 
   return TA_Err_Ok;
 
 Fail:
-  free(cov.glyph_idxs);
+  ta_mem_free(font->memory, cov.glyph_idxs);
   return error;
 }
 
@@ -26,6 +26,7 @@
 
 FT_Error
 ta_axis_hints_new_segment(TA_AxisHints axis,
+                          TA_Memory memory,
                           TA_Segment* asegment)
 {
   FT_Error error = FT_Err_Ok;
@@ -52,8 +53,10 @@ ta_axis_hints_new_segment(TA_AxisHints axis,
         || new_max > big_max)
       new_max = big_max;
 
-    segments_new = (TA_Segment)realloc(axis->segments,
-                                       new_max * sizeof (TA_SegmentRec));
+    segments_new = (TA_Segment)ta_mem_realloc(memory,
+                                              axis->segments,
+                                              new_max
+                                              * sizeof (TA_SegmentRec));
     if (!segments_new)
       return FT_Err_Out_Of_Memory;
 
@@ -75,6 +78,7 @@ FT_Error
 ta_axis_hints_new_edge(TA_AxisHints axis,
                        FT_Int fpos,
                        TA_Direction dir,
+                       TA_Memory memory,
                        TA_Edge* anedge)
 {
   FT_Error error = FT_Err_Ok;
@@ -102,8 +106,9 @@ ta_axis_hints_new_edge(TA_AxisHints axis,
         || new_max > big_max)
       new_max = big_max;
 
-    edges_new = (TA_Edge)realloc(axis->edges,
-                                 new_max * sizeof (TA_EdgeRec));
+    edges_new = (TA_Edge)ta_mem_realloc(memory,
+                                        axis->edges,
+                                        new_max * sizeof (TA_EdgeRec));
     if (!edges_new)
       return FT_Err_Out_Of_Memory;
 
@@ -141,6 +146,21 @@ Exit:
 }
 
 
+/* check whether the horizontal point coordinates */
+/* are needed while hinting */
+
+static FT_Bool
+ta_glyph_hints_need_x(TA_GlyphHints hints)
+{
+#ifdef TA_CONFIG_OPTION_USE_WARPER
+  if (hints->metrics->scaler.render_mode == FT_RENDER_MODE_LIGHT)
+    return 1;
+#endif
+
+  return TA_HINTS_DO_HORIZONTAL(hints) ? 1 : 0;
+}
+
+
 #ifdef TA_DEBUG
 
 #include <stdio.h>
@@ -201,27 +221,42 @@ ta_glyph_hints_dump_points(TA_GlyphHints hints)
   TA_Point limit = points + hints->num_points;
   TA_Point point;
 
+  /* in vertical-only mode, `ox' and `x' are not set while hinting */
+  /* (see `ta_glyph_hints_reload'), so we don't show them          */
+  FT_Bool do_horz = ta_glyph_hints_need_x(hints);
+
 
   TA_LOG(("Table of points:\n"
           "  [ index |  xorg |  yorg | xscale | yscale"
           " |  xfit |  yfit |  flags ]\n"));
 
   for (point = points; point < limit; point++)
-    TA_LOG(("  [ %5d | %5d | %5d | %6.2f | %6.2f"
-            " | %5.2f | %5.2f | %c%c%c%c%c%c ]\n",
-            point - points,
-            point->fx,
-            point->fy,
-            point->ox / 64.0,
-            point->oy / 64.0,
-            point->x / 64.0,
-            point->y / 64.0,
+  {
+    if (do_horz)
+      TA_LOG(("  [ %5d | %5d | %5d | %6.2f | %6.2f | %5.2f | %5.2f",
+              point - points,
+              point->fx,
+              point->fy,
+              point->ox / 64.0,
+              point->oy / 64.0,
+              point->x / 64.0,
+              point->y / 64.0));
+    else
+      TA_LOG(("  [ %5d | %5d | %5d |    --- | %6.2f |   --- | %5.2f",
+              point - points,
+              point->fx,
+              point->fy,
+              point->oy / 64.0,
+              point->y / 64.0));
+
+    TA_LOG((" | %c%c%c%c%c%c ]\n",
             (point->flags & TA_FLAG_WEAK_INTERPOLATION) ? 'w' : ' ',
             (point->flags & TA_FLAG_INFLECTION) ? 'i' : ' ',
             (point->flags & TA_FLAG_EXTREMA_X) ? '<' : ' ',
             (point->flags & TA_FLAG_EXTREMA_Y) ? 'v' : ' ',
             (point->flags & TA_FLAG_ROUND_X) ? '(' : ' ',
             (point->flags & TA_FLAG_ROUND_Y) ? 'u' : ' '));
+  }
   TA_LOG(("\n"));
 }
 
@@ -405,21 +440,26 @@ ta_direction_compute(FT_Pos dx,
 
 
 void
-ta_glyph_hints_init(TA_GlyphHints hints)
+ta_glyph_hints_init(TA_GlyphHints hints,
+                    TA_Memory memory)
 {
   memset(hints, 0, sizeof (TA_GlyphHintsRec));
+  hints->memory = memory;
 }
 
 
 void
 ta_glyph_hints_done(TA_GlyphHints hints)
 {
+  TA_Memory memory;
   int dim;
 
 
   if (!hints)
     return;
 
+  memory = hints->memory;
+
   /* we don't need to free the segment and edge buffers */
   /* since they are really within the hints->points array */
   for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
@@ -429,21 +469,21 @@ ta_glyph_hints_done(TA_GlyphHints hints)
 
     axis->num_segments = 0;
     axis->max_segments = 0;
-    free(axis->segments);
+    ta_mem_free(memory, axis->segments);
     axis->segments = NULL;
 
     axis->num_edges = 0;
     axis->max_edges = 0;
-    free(axis->edges);
+    ta_mem_free(memory, axis->edges);
     axis->edges = NULL;
   }
 
-  free(hints->contours);
+  ta_mem_free(memory, hints->contours);
   hints->contours = NULL;
   hints->max_contours = 0;
   hints->num_contours = 0;
 
-  free(hints->points);
+  ta_mem_free(memory, hints->points);
   hints->points = NULL;
   hints->num_points = 0;
   hints->max_points = 0;
@@ -536,8 +576,9 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
 
     new_max = (new_max + 3) & ~3; /* round up to a multiple of 4 */
 
-    contours_new = (TA_Point*)realloc(hints->contours,
-                                      new_max * sizeof (TA_Point));
+    contours_new = (TA_Point*)ta_mem_realloc(hints->memory,
+                                             hints->contours,
+                                             new_max * sizeof (TA_Point));
     if (!contours_new)
       return FT_Err_Out_Of_Memory;
 
@@ -556,8 +597,9 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
 
     new_max = (new_max + 2 + 7) & ~7; /* round up to a multiple of 8 */
 
-    points_new = (TA_Point)realloc(hints->points,
-                                   new_max * sizeof (TA_PointRec));
+    points_new = (TA_Point)ta_mem_realloc(hints->memory,
+                                          hints->points,
+                                          new_max * sizeof (TA_PointRec));
     if (!points_new)
       return FT_Err_Out_Of_Memory;
 
@@ -608,12 +650,18 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
 
       FT_Int contour_index = 0;
 
+      /* in vertical-only mode, the horizontal coordinates */
+      /* are only needed for the final outline; */
+      /* `ta_glyph_hints_save' computes them in this case */
+      FT_Bool do_horz = ta_glyph_hints_need_x(hints);
+
 
       for (point = points; point < point_limit; point++, vec++, tag++)
       {
         point->fx = (FT_Short)vec->x;
         point->fy = (FT_Short)vec->y;
-        point->ox = point->x = FT_MulFix(vec->x, x_scale) + x_delta;
+        if (do_horz)
+          point->ox = point->x = FT_MulFix(vec->x, x_scale) + x_delta;
         point->oy = point->y = FT_MulFix(vec->y, y_scale) + y_delta;
 
         switch (FT_CURVE_TAG(*tag))
@@ -736,9 +784,16 @@ ta_glyph_hints_save(TA_GlyphHints hints,
   FT_Vector* vec = outline->points;
   char* tag = outline->tags;
 
+  FT_Bool do_horz = ta_glyph_hints_need_x(hints);
+
 
   for (; point < limit; point++, vec++, tag++)
   {
+    /* see `ta_glyph_hints_reload' */
+    if (!do_horz)
+      point->ox = point->x = FT_MulFix(point->fx, hints->x_scale)
+                             + hints->x_delta;
+
     vec->x = point->x;
     vec->y = point->y;
 
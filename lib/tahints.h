@@ -21,6 +21,7 @@
 #define __TAHINTS_H__
 
 #include "tatypes.h"
+#include "tamemory.h"
 
 #define xxTA_SORT_SEGMENTS
 
@@ -391,6 +392,8 @@ typedef void
 
 typedef struct TA_GlyphHintsRec_
 {
+  TA_Memory memory;
+
   FT_Fixed x_scale;
   FT_Pos x_delta;
 
@@ -465,12 +468,14 @@ ta_direction_compute(FT_Pos dx,
 
 FT_Error
 ta_axis_hints_new_segment(TA_AxisHints axis,
+                          TA_Memory memory,
                           TA_Segment* asegment);
 
 FT_Error
 ta_axis_hints_new_edge(TA_AxisHints axis,
                        FT_Int fpos,
                        TA_Direction dir,
+                       TA_Memory memory,
                        TA_Edge* edge);
 
 #ifdef TA_DEBUG
@@ -485,7 +490,8 @@ ta_glyph_hints_dump_edges(TA_GlyphHints hints);
 #endif
 
 void
-ta_glyph_hints_init(TA_GlyphHints hints);
+ta_glyph_hints_init(TA_GlyphHints hints,
+                    TA_Memory memory);
 
 void
 ta_glyph_hints_rescale(TA_GlyphHints hints,
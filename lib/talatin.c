@@ -49,7 +49,7 @@ ta_latin_metrics_init_widths(TA_LatinMetrics metrics,
   TA_LOG(("standard widths computation\n"
           "===========================\n\n"));
 
-  ta_glyph_hints_init(hints);
+  ta_glyph_hints_init(hints, metrics->root.globals->font->memory);
 
   metrics->axis[TA_DIMENSION_HORZ].width_count = 0;
   metrics->axis[TA_DIMENSION_VERT].width_count = 0;
@@ -693,6 +693,17 @@ ta_latin_metrics_scale_dim(TA_LatinMetrics metrics,
     metrics->root.scaler.y_delta = delta;
   }
 
+  /* in vertical-only mode we never hint horizontally, */
+  /* so there is no need to scale the horizontal widths; */
+  /* we reset `org_scale' to enforce a complete rescaling */
+  /* for the next call without this flag */
+  if (dim == TA_DIMENSION_HORZ
+      && (scaler->flags & TA_SCALER_FLAG_NO_HORIZONTAL))
+  {
+    axis->org_scale = 0;
+    return;
+  }
+
   /* scale the widths */
   for (nn = 0; nn < axis->width_count; nn++)
   {
@@ -968,7 +979,7 @@ ta_latin_hints_compute_segments(TA_GlyphHints hints,
         segment_dir = (TA_Direction)point->out_dir;
 
         /* clear all segment fields */
-        error = ta_axis_hints_new_segment(axis, &segment);
+        error = ta_axis_hints_new_segment(axis, hints->memory, &segment);
         if (error)
           goto Exit;
 
@@ -1244,6 +1255,7 @@ ta_latin_hints_compute_edges(TA_GlyphHints hints,
       /* insert a new edge in the list and sort according to the position */
       error = ta_axis_hints_new_edge(axis, seg->pos,
                                      (TA_Direction)seg->dir,
+                                     hints->memory,
                                      &edge);
       if (error)
         goto Exit;
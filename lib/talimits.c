@@ -0,0 +1,1859 @@
+/* talimits.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* While emitting bytecode, we only collect rough upper bounds for the */
+/* stack depth, the size of the storage area, and the number of */
+/* twilight points.  This file implements an abstract interpreter for */
+/* TrueType bytecode which walks over the `fpgm' and `prep' tables and */
+/* the instructions of all glyphs to compute the exact values (if */
+/* option `exact-maxp' is set). */
+/* */
+/* The interpreter only tracks values which are known at compile time */
+/* (for example, arguments pushed onto the stack and data written to */
+/* the storage area or the CVT); everything else (coordinates, scaled */
+/* CVT values, the current PPEM value, etc.) is `unknown'.  If an `IF' */
+/* instruction gets an unknown value, both branches are executed, and */
+/* the resulting states get merged.  If the bytecode does something we */
+/* can't handle (for example, a jump or a loop count which depends on */
+/* an unknown value), we give up and use the upper bounds instead. */
+/* */
+/* Since the `prep' table selects functions depending on the rasterizer */
+/* (via `GETINFO'), we run the `fpgm' and `prep' tables for all */
+/* rasterizer environments we know of.  Most environments leave the */
+/* storage area and the CVT in the same state, so each glyph program is */
+/* only analyzed once per distinct state (with `GETINFO' returning an */
+/* unknown value). */
+/* */
+/* Glyph programs select their hints records by comparing the PPEM value */
+/* with the records' start sizes (see `TA_emit_hints_records').  Instead */
+/* of merging the states after such an `IF', we follow both branches up */
+/* to the end of the program.  To avoid combining hints records which */
+/* are never active at the same time, the state tracks the range of */
+/* possible PPEM values.  The number of execution paths per glyph is */
+/* limited; if it gets exceeded, we use the upper bounds. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+
+/* the maximum nesting depth of function calls */
+#define LIMITS_MAX_CALL_DEPTH 32
+
+/* the maximum number of instructions we execute in a single program */
+#define LIMITS_MAX_STEPS 1000000UL
+
+/* the maximum number of execution paths we follow in a glyph program */
+#define LIMITS_MAX_PATHS 256
+
+/* the initial size of the stack array (gets enlarged as needed) */
+#define LIMITS_STACK_SIZE 256
+
+/* this value (which is not a valid error code) */
+/* signals that the bytecode can't be analyzed */
+#define LIMITS_UNKNOWN -1
+
+
+/* values of the `ppem' field in `Value' */
+#define PPEM_NONE 0
+#define PPEM_VALUE 1 /* the PPEM value (as returned by `MPPEM') */
+#define PPEM_LESS 2 /* the condition `PPEM < value' */
+#define PPEM_NOT_LESS 3 /* the condition `PPEM >= value' */
+
+typedef struct Value_
+{
+  FT_Long value;
+  FT_Bool known;
+
+  /* for unknown values which depend on the PPEM value only; */
+  /* since `MPPEM' returns the PPEM value in the direction of the */
+  /* projection vector, `epoch' identifies the latter */
+  FT_Byte ppem;
+  FT_ULong epoch;
+} Value;
+
+/* the part of the interpreter state which depends on the execution path */
+typedef struct State_
+{
+  Value* stack;
+  FT_ULong stack_size; /* allocated number of elements */
+  FT_ULong depth;
+  FT_ULong extra; /* number of unknown elements which might be */
+                  /* below `stack[0]' (see `TA_state_merge') */
+
+  Value* storage; /* elements beyond `storage_size' are unknown */
+  FT_ULong storage_size;
+
+  Value* cvt; /* elements beyond `cvt_size' are unknown */
+  FT_ULong cvt_size;
+
+  Value zp[3];
+  Value rp[3];
+  Value loop;
+
+  /* the possible PPEM values for the current projection vector */
+  FT_ULong epoch; /* zero for the initial vector (the x axis) */
+  FT_Long ppem_min;
+  FT_Long ppem_max;
+} State;
+
+typedef struct Function_
+{
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_ULong start; /* first instruction after `FDEF' */
+  FT_ULong end; /* position of `ENDF' */
+} Function;
+
+/* the values returned by `GETINFO' */
+typedef struct Environment_
+{
+  FT_Long version;
+  FT_Bool grayscale;
+  FT_Bool cleartype;
+  FT_Bool subpixel_positioning;
+} Environment;
+
+typedef struct Limits_
+{
+  TA_Memory memory;
+
+  const Environment* env;
+  Function functions[NUM_FDEFS];
+
+  FT_ULong max_stack;
+  FT_ULong max_storage;
+  FT_ULong max_twilight;
+
+  FT_ULong num_steps;
+  FT_UInt call_depth;
+
+  FT_Bool split_paths; /* see the handling of `IF' */
+  FT_UInt num_paths;
+
+  FT_ULong num_epochs;
+} Limits;
+
+
+static const Value unknown = { 0, 0, PPEM_NONE, 0 };
+
+static const Environment environments[] =
+{
+  { 35, 0, 0, 0 }, /* B/W */
+  { 35, 1, 0, 0 }, /* grayscale */
+  { 37, 0, 1, 0 }, /* GDI ClearType */
+  { 38, 0, 1, 0 }, /* DW ClearType without sub-pixel positioning */
+  { 38, 0, 1, 1 }, /* DW ClearType */
+  { 40, 1, 0, 0 }, /* FreeType's `v40' interpreter */
+  { 40, 0, 1, 1 }
+};
+
+
+static Value
+TA_value(FT_Long v)
+{
+  Value value;
+
+
+  value.value = (FT_Int32)v;
+  value.known = 1;
+  value.ppem = PPEM_NONE;
+  value.epoch = 0;
+
+  return value;
+}
+
+
+static Value
+TA_value_merge(Value a,
+               Value b)
+{
+  if (a.known && b.known && a.value == b.value)
+    return a;
+
+  if (!a.known && !b.known
+      && a.ppem != PPEM_NONE
+      && a.ppem == b.ppem
+      && a.epoch == b.epoch
+      && a.value == b.value)
+    return a;
+
+  return unknown;
+}
+
+
+/* the projection vector has changed */
+
+static void
+TA_state_new_epoch(Limits* limits,
+                   State* state)
+{
+  state->epoch = ++limits->num_epochs;
+  state->ppem_min = 0;
+  state->ppem_max = 0xFFFF;
+}
+
+
+/* return the value of condition `cond' if it is already determined */
+/* by the PPEM range of `state' */
+
+static Value
+TA_state_test_ppem(State* state,
+                   Value cond)
+{
+  if (cond.known
+      || cond.ppem < PPEM_LESS
+      || cond.epoch != state->epoch)
+    return cond;
+
+  if (state->ppem_max < cond.value)
+    return TA_value(cond.ppem == PPEM_LESS);
+  if (state->ppem_min >= cond.value)
+    return TA_value(cond.ppem == PPEM_NOT_LESS);
+
+  return cond;
+}
+
+
+/* compare `a' and `b' (with opcode `LT', `LTEQ', `GT', or `GTEQ'), */
+/* where one of the two values is the PPEM value */
+
+static Value
+TA_state_compare_ppem(State* state,
+                      FT_Byte opcode,
+                      Value a,
+                      Value b)
+{
+  Value c;
+
+
+  /* normalize to `PPEM < n' or `PPEM >= n' */
+  if (a.ppem == PPEM_VALUE && a.epoch == state->epoch && b.known)
+  {
+    c.value = b.value;
+    switch (opcode)
+    {
+    case LT:
+      c.ppem = PPEM_LESS;
+      break;
+    case LTEQ:
+      c.value++;
+      c.ppem = PPEM_LESS;
+      break;
+    case GT:
+      c.value++;
+      c.ppem = PPEM_NOT_LESS;
+      break;
+    default: /* GTEQ */
+      c.ppem = PPEM_NOT_LESS;
+      break;
+    }
+  }
+  else if (b.ppem == PPEM_VALUE && b.epoch == state->epoch && a.known)
+  {
+    c.value = a.value;
+    switch (opcode)
+    {
+    case LT:
+      c.value++;
+      c.ppem = PPEM_NOT_LESS;
+      break;
+    case LTEQ:
+      c.ppem = PPEM_NOT_LESS;
+      break;
+    case GT:
+      c.ppem = PPEM_LESS;
+      break;
+    default: /* GTEQ */
+      c.value++;
+      c.ppem = PPEM_LESS;
+      break;
+    }
+  }
+  else
+    return unknown;
+
+  c.known = 0;
+  c.epoch = state->epoch;
+
+  return TA_state_test_ppem(state, c);
+}
+
+
+/* restrict the PPEM range of `state' to the values */
+/* for which the (undetermined) condition `cond' gives `result' */
+
+static void
+TA_state_restrict_ppem(State* state,
+                       Value cond,
+                       FT_Bool result)
+{
+  if (cond.ppem < PPEM_LESS || cond.epoch != state->epoch)
+    return;
+
+  if ((cond.ppem == PPEM_LESS) == result)
+    state->ppem_max = cond.value - 1;
+  else
+    state->ppem_min = cond.value;
+}
+
+
+/* reset the stack and the graphics state variables we are tracking; */
+/* this is done before a new program starts */
+
+static void
+TA_state_reset(State* state)
+{
+  state->depth = 0;
+  state->extra = 0;
+
+  state->zp[0] = TA_value(1);
+  state->zp[1] = TA_value(1);
+  state->zp[2] = TA_value(1);
+
+  state->rp[0] = TA_value(0);
+  state->rp[1] = TA_value(0);
+  state->rp[2] = TA_value(0);
+
+  state->loop = TA_value(1);
+
+  state->epoch = 0;
+  state->ppem_min = 0;
+  state->ppem_max = 0xFFFF;
+}
+
+
+static void
+TA_state_free(Limits* limits,
+              State* state)
+{
+  ta_mem_free(limits->memory, state->stack);
+  ta_mem_free(limits->memory, state->storage);
+  ta_mem_free(limits->memory, state->cvt);
+
+  state->stack = NULL;
+  state->stack_size = 0;
+  state->depth = 0;
+  state->extra = 0;
+  state->storage = NULL;
+  state->storage_size = 0;
+  state->cvt = NULL;
+  state->cvt_size = 0;
+}
+
+
+static FT_Error
+TA_state_copy(Limits* limits,
+              State* dst,
+              State* src)
+{
+  dst->stack = NULL;
+  dst->storage = NULL;
+  dst->cvt = NULL;
+
+  dst->stack_size = src->stack_size;
+  dst->depth = src->depth;
+  dst->extra = src->extra;
+  dst->storage_size = src->storage_size;
+  dst->cvt_size = src->cvt_size;
+
+  if (src->stack_size)
+  {
+    dst->stack = (Value*)ta_mem_alloc(limits->memory,
+                                      src->stack_size * sizeof (Value));
+    if (!dst->stack)
+      goto Err;
+    memcpy(dst->stack, src->stack, src->depth * sizeof (Value));
+  }
+
+  if (src->storage_size)
+  {
+    dst->storage = (Value*)ta_mem_alloc(limits->memory,
+                                        src->storage_size * sizeof (Value));
+    if (!dst->storage)
+      goto Err;
+    memcpy(dst->storage, src->storage, src->storage_size * sizeof (Value));
+  }
+
+  if (src->cvt_size)
+  {
+    dst->cvt = (Value*)ta_mem_alloc(limits->memory,
+                                    src->cvt_size * sizeof (Value));
+    if (!dst->cvt)
+      goto Err;
+    memcpy(dst->cvt, src->cvt, src->cvt_size * sizeof (Value));
+  }
+
+  memcpy(dst->zp, src->zp, sizeof (src->zp));
+  memcpy(dst->rp, src->rp, sizeof (src->rp));
+  dst->loop = src->loop;
+
+  dst->epoch = src->epoch;
+  dst->ppem_min = src->ppem_min;
+  dst->ppem_max = src->ppem_max;
+
+  return TA_Err_Ok;
+
+Err:
+  TA_state_free(limits, dst);
+
+  return FT_Err_Out_Of_Memory;
+}
+
+
+/* return true if the storage areas and CVTs of `a' and `b' are equal */
+
+static FT_Bool
+TA_state_equal(State* a,
+               State* b)
+{
+  FT_ULong i;
+
+
+  if (a->storage_size != b->storage_size
+      || a->cvt_size != b->cvt_size)
+    return 0;
+
+  for (i = 0; i < a->storage_size; i++)
+    if (a->storage[i].known != b->storage[i].known
+        || (a->storage[i].known
+            && a->storage[i].value != b->storage[i].value))
+      return 0;
+
+  for (i = 0; i < a->cvt_size; i++)
+    if (a->cvt[i].known != b->cvt[i].known
+        || (a->cvt[i].known && a->cvt[i].value != b->cvt[i].value))
+      return 0;
+
+  return 1;
+}
+
+
+/* merge state `b' into state `a' */
+
+static FT_Error
+TA_state_merge(Limits* limits,
+               State* a,
+               State* b)
+{
+  FT_ULong depth = a->depth < b->depth ? a->depth : b->depth;
+  FT_ULong a_extra = a->extra + a->depth - depth;
+  FT_ULong b_extra = b->extra + b->depth - depth;
+  FT_ULong i;
+
+
+  /* It is legal for a branch to leave elements on the stack which */
+  /* are never used afterwards.  We thus align both stacks at the top */
+  /* and convert the surplus elements of the larger stack into */
+  /* `extra' elements, which are unknown and possibly non-existent. */
+  if (a->depth > depth)
+    memmove(a->stack, a->stack + a->depth - depth, depth * sizeof (Value));
+
+  for (i = 0; i < depth; i++)
+    a->stack[i] = TA_value_merge(a->stack[i],
+                                 b->stack[b->depth - depth + i]);
+
+  a->depth = depth;
+  a->extra = a_extra > b_extra ? a_extra : b_extra;
+
+  /* storage and CVT elements only known in one state become unknown */
+  for (i = 0; i < a->storage_size; i++)
+  {
+    if (i < b->storage_size)
+      a->storage[i] = TA_value_merge(a->storage[i], b->storage[i]);
+    else
+      a->storage[i] = unknown;
+  }
+  for (i = 0; i < a->cvt_size; i++)
+  {
+    if (i < b->cvt_size)
+      a->cvt[i] = TA_value_merge(a->cvt[i], b->cvt[i]);
+    else
+      a->cvt[i] = unknown;
+  }
+
+  for (i = 0; i < 3; i++)
+  {
+    a->zp[i] = TA_value_merge(a->zp[i], b->zp[i]);
+    a->rp[i] = TA_value_merge(a->rp[i], b->rp[i]);
+  }
+  a->loop = TA_value_merge(a->loop, b->loop);
+
+  if (a->epoch != b->epoch)
+    TA_state_new_epoch(limits, a);
+  else
+  {
+    if (b->ppem_min < a->ppem_min)
+      a->ppem_min = b->ppem_min;
+    if (b->ppem_max > a->ppem_max)
+      a->ppem_max = b->ppem_max;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_push(Limits* limits,
+              State* state,
+              Value value)
+{
+  if (state->depth == state->stack_size)
+  {
+    FT_ULong new_size = state->stack_size ? 2 * state->stack_size
+                                          : LIMITS_STACK_SIZE;
+    Value* stack_new;
+
+
+    /* the stack depth is a 16bit value in the `maxp' table */
+    if (new_size > 0x20000UL)
+      return LIMITS_UNKNOWN;
+
+    stack_new = (Value*)ta_mem_realloc(limits->memory,
+                                       state->stack,
+                                       new_size * sizeof (Value));
+    if (!stack_new)
+      return FT_Err_Out_Of_Memory;
+
+    state->stack = stack_new;
+    state->stack_size = new_size;
+  }
+
+  state->stack[state->depth++] = value;
+
+  if (state->depth + state->extra > limits->max_stack)
+    limits->max_stack = state->depth + state->extra;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_pop(State* state,
+             Value* value)
+{
+  if (!state->depth)
+  {
+    /* stack underflow */
+    if (!state->extra)
+      return LIMITS_UNKNOWN;
+
+    state->extra--;
+    *value = unknown;
+
+    return TA_Err_Ok;
+  }
+
+  *value = state->stack[--state->depth];
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_read_storage(Limits* limits,
+                      State* state,
+                      Value idx,
+                      Value* value)
+{
+  if (!idx.known || idx.value < 0 || idx.value > 0xFFFF)
+    return LIMITS_UNKNOWN;
+
+  if ((FT_ULong)idx.value + 1 > limits->max_storage)
+    limits->max_storage = (FT_ULong)idx.value + 1;
+
+  if ((FT_ULong)idx.value < state->storage_size)
+    *value = state->storage[idx.value];
+  else
+    *value = unknown;
+
+  return TA_Err_Ok;
+}
+
+
+/* set element `idx' of a value array, enlarging it if necessary */
+
+static FT_Error
+TA_values_set(Limits* limits,
+              Value** values,
+              FT_ULong* size,
+              FT_ULong idx,
+              Value value)
+{
+  if (idx >= *size)
+  {
+    FT_ULong new_size = idx + 1;
+    Value* values_new;
+    FT_ULong i;
+
+
+    values_new = (Value*)ta_mem_realloc(limits->memory,
+                                        *values, new_size * sizeof (Value));
+    if (!values_new)
+      return FT_Err_Out_Of_Memory;
+
+    for (i = *size; i < new_size; i++)
+      values_new[i] = unknown;
+
+    *values = values_new;
+    *size = new_size;
+  }
+
+  (*values)[idx] = value;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_write_storage(Limits* limits,
+                       State* state,
+                       Value idx,
+                       Value value)
+{
+  if (!idx.known || idx.value < 0 || idx.value > 0xFFFF)
+    return LIMITS_UNKNOWN;
+
+  if ((FT_ULong)idx.value + 1 > limits->max_storage)
+    limits->max_storage = (FT_ULong)idx.value + 1;
+
+  /* the storage area persists between programs, */
+  /* which might use different projection vectors */
+  if (!value.known)
+    value = unknown;
+
+  return TA_values_set(limits, &state->storage, &state->storage_size,
+                       (FT_ULong)idx.value, value);
+}
+
+
+static Value
+TA_state_read_cvt(State* state,
+                  Value idx)
+{
+  if (idx.known
+      && idx.value >= 0
+      && (FT_ULong)idx.value < state->cvt_size)
+    return state->cvt[idx.value];
+
+  return unknown;
+}
+
+
+static FT_Error
+TA_state_write_cvt(Limits* limits,
+                   State* state,
+                   Value idx,
+                   Value value)
+{
+  if (!idx.known || idx.value < 0 || idx.value > 0xFFFF)
+  {
+    FT_ULong i;
+
+
+    /* we don't know which element gets changed */
+    for (i = 0; i < state->cvt_size; i++)
+      state->cvt[i] = unknown;
+
+    return TA_Err_Ok;
+  }
+
+  if (!value.known)
+    value = unknown;
+
+  return TA_values_set(limits, &state->cvt, &state->cvt_size,
+                       (FT_ULong)idx.value, value);
+}
+
+
+/* register an access to point `point' in zone `zone' */
+
+static FT_Error
+TA_touch_point(Limits* limits,
+               Value zone,
+               Value point)
+{
+  /* we only need to track points in the twilight zone */
+  if (zone.known && zone.value != 0)
+    return TA_Err_Ok;
+
+  if (!point.known || point.value < 0 || point.value > 0xFFFF)
+    return LIMITS_UNKNOWN;
+
+  if ((FT_ULong)point.value + 1 > limits->max_twilight)
+    limits->max_twilight = (FT_ULong)point.value + 1;
+
+  return TA_Err_Ok;
+}
+
+
+/* return the length of the instruction at position `pc', */
+/* including inline data; zero means a truncated instruction */
+
+static FT_ULong
+TA_instruction_length(FT_Byte* buf,
+                      FT_ULong len,
+                      FT_ULong pc)
+{
+  FT_Byte opcode = buf[pc];
+  FT_ULong n;
+
+
+  if (opcode == NPUSHB || opcode == NPUSHW)
+  {
+    if (pc + 1 >= len)
+      return 0;
+    n = 2 + buf[pc + 1] * (opcode == NPUSHW ? 2 : 1);
+  }
+  else if (opcode >= PUSHB_1 && opcode <= PUSHB_8)
+    n = 1 + (opcode - PUSHB_1 + 1);
+  else if (opcode >= PUSHW_1 && opcode <= PUSHW_8)
+    n = 1 + 2 * (opcode - PUSHW_1 + 1);
+  else
+    n = 1;
+
+  if (pc + n > len)
+    return 0;
+
+  return n;
+}
+
+
+/* starting at `pc' (which is the position after an `IF' or `ELSE' */
+/* instruction), find the matching `ELSE' and `EIF' instructions; */
+/* if there is no `ELSE', `else_pos' is set to zero */
+
+static FT_Error
+TA_find_else_eif(FT_Byte* buf,
+                 FT_ULong len,
+                 FT_ULong pc,
+                 FT_ULong* else_pos,
+                 FT_ULong* eif_pos)
+{
+  FT_UInt nesting = 0;
+
+
+  *else_pos = 0;
+
+  while (pc < len)
+  {
+    FT_ULong n = TA_instruction_length(buf, len, pc);
+
+
+    if (!n)
+      break;
+
+    switch (buf[pc])
+    {
+    case IF:
+      nesting++;
+      break;
+
+    case ELSE:
+      if (!nesting && !*else_pos)
+        *else_pos = pc;
+      break;
+
+    case EIF:
+      if (!nesting)
+      {
+        *eif_pos = pc;
+        return TA_Err_Ok;
+      }
+      nesting--;
+      break;
+
+    case FDEF:
+    case ENDF:
+    case IDEF:
+      return LIMITS_UNKNOWN;
+    }
+
+    pc += n;
+  }
+
+  return LIMITS_UNKNOWN;
+}
+
+
+/* starting at `pc' (which is the position after an `FDEF' */
+/* instruction), find the matching `ENDF' instruction */
+
+static FT_Error
+TA_find_endf(FT_Byte* buf,
+             FT_ULong len,
+             FT_ULong pc,
+             FT_ULong* endf_pos)
+{
+  while (pc < len)
+  {
+    FT_ULong n = TA_instruction_length(buf, len, pc);
+
+
+    if (!n)
+      break;
+
+    if (buf[pc] == ENDF)
+    {
+      *endf_pos = pc;
+      return TA_Err_Ok;
+    }
+    if (buf[pc] == FDEF || buf[pc] == IDEF)
+      break;
+
+    pc += n;
+  }
+
+  return LIMITS_UNKNOWN;
+}
+
+
+static FT_Error
+TA_limits_run(Limits* limits,
+              State* state,
+              FT_Byte* buf,
+              FT_ULong len,
+              FT_ULong start,
+              FT_ULong stop);
+
+
+static FT_Error
+TA_limits_call(Limits* limits,
+               State* state,
+               Value func)
+{
+  Function* f;
+  FT_Error error;
+
+
+  if (!func.known || func.value < 0 || func.value >= NUM_FDEFS)
+    return LIMITS_UNKNOWN;
+
+  f = &limits->functions[func.value];
+  if (!f->buf)
+    return LIMITS_UNKNOWN;
+
+  if (limits->call_depth >= LIMITS_MAX_CALL_DEPTH)
+    return LIMITS_UNKNOWN;
+
+  limits->call_depth++;
+  error = TA_limits_run(limits, state, f->buf, f->len, f->start, f->end);
+  limits->call_depth--;
+
+  return error;
+}
+
+
+/* execute the bytecode in `buf' from position `start' */
+/* until position `stop' is reached */
+
+#define POP_VALUE(v) \
+          do \
+          { \
+            error = TA_state_pop(state, &(v)); \
+            if (error) \
+              return error; \
+          } while (0)
+
+#define PUSH_VALUE(v) \
+          do \
+          { \
+            error = TA_state_push(limits, state, (v)); \
+            if (error) \
+              return error; \
+          } while (0)
+
+#define TOUCH(zone, point) \
+          do \
+          { \
+            error = TA_touch_point(limits, (zone), (point)); \
+            if (error) \
+              return error; \
+          } while (0)
+
+#define CHECK(expr) \
+          do \
+          { \
+            error = (expr); \
+            if (error) \
+              return error; \
+          } while (0)
+
+static FT_Error
+TA_limits_run(Limits* limits,
+              State* state,
+              FT_Byte* buf,
+              FT_ULong len,
+              FT_ULong start,
+              FT_ULong stop)
+{
+  FT_ULong pc = start;
+  FT_Error error;
+
+
+  while (pc < stop)
+  {
+    FT_Byte opcode = buf[pc];
+    FT_ULong n = TA_instruction_length(buf, len, pc);
+    FT_ULong next = pc + n;
+
+    Value a, b, c;
+    FT_Long i;
+
+
+    if (!n)
+      return LIMITS_UNKNOWN;
+
+    if (++limits->num_steps > LIMITS_MAX_STEPS)
+      return LIMITS_UNKNOWN;
+
+    switch (opcode)
+    {
+    case SVTCA_y:
+    case SVTCA_x:
+    case SPVTCA_y:
+    case SPVTCA_x:
+      TA_state_new_epoch(limits, state);
+      break;
+
+    case SFVTCA_y:
+    case SFVTCA_x:
+    case SFVTPV:
+    case RTG:
+    case RTHG:
+    case IUP_y:
+    case IUP_x:
+    case RTDG:
+    case FLIPON:
+    case FLIPOFF:
+    case EIF:
+    case ROFF:
+    case RUTG:
+    case RDTG:
+      break;
+
+    case SPVTL_para:
+    case SPVTL_perp:
+    case SFVTL_para:
+    case SFVTL_perp:
+    case SDPVTL_para:
+    case SDPVTL_perp:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      TOUCH(state->zp[2], a);
+      TOUCH(state->zp[1], b);
+      if (opcode != SFVTL_para && opcode != SFVTL_perp)
+        TA_state_new_epoch(limits, state);
+      break;
+
+    case WCVTP:
+    case WCVTF:
+      POP_VALUE(b);
+      POP_VALUE(a);
+      /* `WCVTF' scales its argument */
+      CHECK(TA_state_write_cvt(limits, state, a,
+                               opcode == WCVTP ? b : unknown));
+      break;
+
+    case SPVFS:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      TA_state_new_epoch(limits, state);
+      break;
+
+    case SFVFS:
+    case FLIPRGON:
+    case FlIPRGOFF:
+    case INSTCTRL:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      break;
+
+    case GPV:
+    case GFV:
+      PUSH_VALUE(unknown);
+      PUSH_VALUE(unknown);
+      break;
+
+    case ISECT:
+      POP_VALUE(a);
+      TOUCH(state->zp[0], a);
+      POP_VALUE(a);
+      TOUCH(state->zp[0], a);
+      POP_VALUE(a);
+      TOUCH(state->zp[1], a);
+      POP_VALUE(a);
+      TOUCH(state->zp[1], a);
+      POP_VALUE(a);
+      TOUCH(state->zp[2], a);
+      break;
+
+    case SRP0:
+    case SRP1:
+    case SRP2:
+      POP_VALUE(state->rp[opcode - SRP0]);
+      break;
+
+    case SZP0:
+    case SZP1:
+    case SZP2:
+    case SZPS:
+      POP_VALUE(a);
+      if (a.known && a.value != 0 && a.value != 1)
+        return LIMITS_UNKNOWN;
+      if (opcode == SZPS)
+        state->zp[0] = state->zp[1] = state->zp[2] = a;
+      else
+        state->zp[opcode - SZP0] = a;
+      break;
+
+    case SLOOP:
+      POP_VALUE(state->loop);
+      break;
+
+    case SMD:
+    case SCVTCI:
+    case SSWCI:
+    case SSW:
+    case POP:
+    case DEBUG:
+    case SDB:
+    case SDS:
+    case SROUND:
+    case S45Round:
+    case SANGW:
+    case AA:
+    case SCANCTRL:
+    case SCANTYPE:
+      POP_VALUE(a);
+      break;
+
+    case ELSE:
+      /* we only get here after executing the `IF' branch */
+      {
+        FT_ULong else_pos, eif_pos;
+
+
+        CHECK(TA_find_else_eif(buf, len, next, &else_pos, &eif_pos));
+        next = eif_pos + 1;
+      }
+      break;
+
+    case JMPR:
+    case JROT:
+    case JROF:
+      if (opcode == JMPR)
+        c = TA_value(1);
+      else
+      {
+        POP_VALUE(c);
+        if (!c.known)
+          return LIMITS_UNKNOWN;
+        if (opcode == JROF)
+          c.value = !c.value;
+      }
+      POP_VALUE(a);
+      if (!c.value)
+        break;
+      if (!a.known || a.value == 0)
+        return LIMITS_UNKNOWN;
+      /* jumps must not leave the current code block */
+      if ((a.value < 0 && (FT_ULong)-a.value > pc - start)
+          || (a.value > 0 && (FT_ULong)a.value > stop - pc))
+        return LIMITS_UNKNOWN;
+      next = pc + a.value;
+      break;
+
+    case DUP:
+      POP_VALUE(a);
+      PUSH_VALUE(a);
+      PUSH_VALUE(a);
+      break;
+
+    case CLEAR:
+      state->depth = 0;
+      state->extra = 0;
+      break;
+
+    case SWAP:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      PUSH_VALUE(a);
+      PUSH_VALUE(b);
+      break;
+
+    case DEPTH:
+      if (state->extra)
+        PUSH_VALUE(unknown);
+      else
+        PUSH_VALUE(TA_value((FT_Long)state->depth));
+      break;
+
+    case CINDEX:
+    case MINDEX:
+      POP_VALUE(a);
+      /* the stack depth doesn't depend on the index of `CINDEX' */
+      if (!a.known && opcode == CINDEX)
+      {
+        PUSH_VALUE(unknown);
+        break;
+      }
+      if (!a.known || a.value <= 0 || (FT_ULong)a.value > state->depth)
+        return LIMITS_UNKNOWN;
+      i = (FT_Long)state->depth - a.value;
+      b = state->stack[i];
+      if (opcode == MINDEX)
+      {
+        memmove(state->stack + i, state->stack + i + 1,
+                (a.value - 1) * sizeof (Value));
+        state->depth--;
+      }
+      PUSH_VALUE(b);
+      break;
+
+    case ALIGNPTS:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      TOUCH(state->zp[0], a);
+      TOUCH(state->zp[1], b);
+      break;
+
+    case UTP:
+      POP_VALUE(a);
+      TOUCH(state->zp[0], a);
+      break;
+
+    case LOOPCALL:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      if (!b.known)
+        return LIMITS_UNKNOWN;
+      for (i = 0; i < b.value; i++)
+        CHECK(TA_limits_call(limits, state, a));
+      break;
+
+    case CALL:
+      POP_VALUE(a);
+      CHECK(TA_limits_call(limits, state, a));
+      break;
+
+    case FDEF:
+      {
+        FT_ULong endf_pos;
+
+
+        POP_VALUE(a);
+        if (!a.known || a.value < 0 || a.value >= NUM_FDEFS)
+          return LIMITS_UNKNOWN;
+        CHECK(TA_find_endf(buf, len, next, &endf_pos));
+
+        limits->functions[a.value].buf = buf;
+        limits->functions[a.value].len = len;
+        limits->functions[a.value].start = next;
+        limits->functions[a.value].end = endf_pos;
+
+        next = endf_pos + 1;
+      }
+      break;
+
+    case MDAP_noround:
+    case MDAP_round:
+      POP_VALUE(a);
+      TOUCH(state->zp[0], a);
+      state->rp[0] = state->rp[1] = a;
+      break;
+
+    case SHP_rp2:
+    case SHP_rp1:
+    case SHC_rp2:
+    case SHC_rp1:
+    case SHZ_rp2:
+    case SHZ_rp1:
+      if (opcode & 1)
+        TOUCH(state->zp[0], state->rp[1]);
+      else
+        TOUCH(state->zp[1], state->rp[2]);
+
+      if (opcode == SHP_rp2 || opcode == SHP_rp1)
+      {
+        if (!state->loop.known)
+          return LIMITS_UNKNOWN;
+        for (i = 0; i < state->loop.value; i++)
+        {
+          POP_VALUE(a);
+          TOUCH(state->zp[2], a);
+        }
+        state->loop = TA_value(1);
+      }
+      else
+        POP_VALUE(a); /* contour or zone */
+      break;
+
+    case SHPIX:
+    case IP:
+    case ALIGNRP:
+    case FLIPPT:
+      if (opcode == SHPIX)
+        POP_VALUE(a); /* amount */
+      else if (opcode == IP)
+      {
+        TOUCH(state->zp[0], state->rp[1]);
+        TOUCH(state->zp[1], state->rp[2]);
+      }
+      else if (opcode == ALIGNRP)
+        TOUCH(state->zp[0], state->rp[0]);
+
+      if (!state->loop.known)
+        return LIMITS_UNKNOWN;
+      for (i = 0; i < state->loop.value; i++)
+      {
+        POP_VALUE(a);
+        /* `FLIPPT' always acts on the glyph zone */
+        if (opcode == ALIGNRP)
+          TOUCH(state->zp[1], a);
+        else if (opcode != FLIPPT)
+          TOUCH(state->zp[2], a);
+      }
+      state->loop = TA_value(1);
+      break;
+
+    case MSIRP_norp0:
+    case MSIRP_rp0:
+      POP_VALUE(b); /* distance */
+      POP_VALUE(a);
+      TOUCH(state->zp[0], state->rp[0]);
+      TOUCH(state->zp[1], a);
+      state->rp[1] = state->rp[0];
+      state->rp[2] = a;
+      if (opcode == MSIRP_rp0)
+        state->rp[0] = a;
+      break;
+
+    case MIAP_noround:
+    case MIAP_round:
+      POP_VALUE(b); /* CVT index */
+      POP_VALUE(a);
+      TOUCH(state->zp[0], a);
+      state->rp[0] = state->rp[1] = a;
+      break;
+
+    case NPUSHB:
+      for (i = 0; i < buf[pc + 1]; i++)
+        PUSH_VALUE(TA_value(buf[pc + 2 + i]));
+      break;
+
+    case NPUSHW:
+      for (i = 0; i < buf[pc + 1]; i++)
+        PUSH_VALUE(TA_value((FT_Short)((buf[pc + 2 + 2 * i] << 8)
+                                 | buf[pc + 3 + 2 * i])));
+      break;
+
+    case WS:
+      POP_VALUE(b);
+      POP_VALUE(a);
+      CHECK(TA_state_write_storage(limits, state, a, b));
+      break;
+
+    case RS:
+      POP_VALUE(a);
+      CHECK(TA_state_read_storage(limits, state, a, &b));
+      PUSH_VALUE(b);
+      break;
+
+    case RCVT:
+      POP_VALUE(a);
+      PUSH_VALUE(TA_state_read_cvt(state, a));
+      break;
+
+    case GETINFO:
+      POP_VALUE(a);
+      /* glyph programs get analyzed for all environments at once */
+      if (a.known && limits->env)
+      {
+        const Environment* env = limits->env;
+        FT_Long info = 0;
+
+
+        if (a.value & 0x01)
+          info |= env->version;
+        if ((a.value & 0x20) && env->grayscale)
+          info |= 1L << 12;
+        if ((a.value & 0x40) && env->cleartype)
+          info |= 1L << 13;
+        if ((a.value & 0x400) && env->subpixel_positioning)
+          info |= 1L << 17;
+
+        PUSH_VALUE(TA_value(info));
+      }
+      else
+        PUSH_VALUE(unknown);
+      break;
+
+    case ODD:
+    case EVEN:
+    case ROUND_gray:
+    case ROUND_black:
+    case ROUND_white:
+    case ROUND_3:
+    case NROUND_gray:
+    case NROUND_black:
+    case NROUND_white:
+    case NROUND_3:
+      POP_VALUE(a);
+      PUSH_VALUE(unknown);
+      break;
+
+    case GC_cur:
+    case GC_orig:
+      POP_VALUE(a);
+      TOUCH(state->zp[2], a);
+      PUSH_VALUE(unknown);
+      break;
+
+    case SCFS:
+      POP_VALUE(b); /* value */
+      POP_VALUE(a);
+      TOUCH(state->zp[2], a);
+      break;
+
+    case MD_cur:
+    case MD_orig:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      TOUCH(state->zp[1], a);
+      TOUCH(state->zp[0], b);
+      PUSH_VALUE(unknown);
+      break;
+
+    case MPPEM:
+      a = unknown;
+      a.ppem = PPEM_VALUE;
+      a.epoch = state->epoch;
+      PUSH_VALUE(a);
+      break;
+
+    case MPS:
+      PUSH_VALUE(unknown);
+      break;
+
+    case LT:
+    case LTEQ:
+    case GT:
+    case GTEQ:
+    case EQ:
+    case NEQ:
+    case ADD:
+    case SUB:
+    case DIV:
+    case MUL:
+    case MAX:
+    case MIN:
+      POP_VALUE(b);
+      POP_VALUE(a);
+      if (!a.known || !b.known)
+      {
+        if (opcode >= LT && opcode <= GTEQ)
+          PUSH_VALUE(TA_state_compare_ppem(state, opcode, a, b));
+        else
+          PUSH_VALUE(unknown);
+        break;
+      }
+      switch (opcode)
+      {
+      case LT:
+        c = TA_value(a.value < b.value);
+        break;
+      case LTEQ:
+        c = TA_value(a.value <= b.value);
+        break;
+      case GT:
+        c = TA_value(a.value > b.value);
+        break;
+      case GTEQ:
+        c = TA_value(a.value >= b.value);
+        break;
+      case EQ:
+        c = TA_value(a.value == b.value);
+        break;
+      case NEQ:
+        c = TA_value(a.value != b.value);
+        break;
+      case ADD:
+        c = TA_value(a.value + b.value);
+        break;
+      case SUB:
+        c = TA_value(a.value - b.value);
+        break;
+      case DIV:
+        /* rasterizers agree on truncation for non-negative values */
+        /* (which our own bytecode relies on); otherwise we only */
+        /* handle exact results */
+        if (b.value > 0 && a.value >= 0)
+          c = TA_value(a.value * 64 / b.value);
+        else if (b.value && !((a.value * 64) % b.value))
+          c = TA_value(a.value * 64 / b.value);
+        else
+          c = unknown;
+        break;
+      case MUL:
+        c = TA_value(FT_MulDiv(a.value, b.value, 64));
+        break;
+      case MAX:
+        c = TA_value(a.value > b.value ? a.value : b.value);
+        break;
+      default: /* MIN */
+        c = TA_value(a.value < b.value ? a.value : b.value);
+        break;
+      }
+      PUSH_VALUE(c);
+      break;
+
+    case AND:
+    case OR:
+      POP_VALUE(b);
+      POP_VALUE(a);
+      if (a.known && b.known)
+        c = TA_value(opcode == AND ? (a.value && b.value)
+                                   : (a.value || b.value));
+      else if (opcode == AND
+               && ((a.known && !a.value) || (b.known && !b.value)))
+        c = TA_value(0);
+      else if (opcode == OR
+               && ((a.known && a.value) || (b.known && b.value)))
+        c = TA_value(1);
+      else
+        c = unknown;
+      PUSH_VALUE(c);
+      break;
+
+    case NOT:
+    case ABS:
+    case NEG:
+    case FLOOR:
+    case CEILING:
+      POP_VALUE(a);
+      if (a.known)
+      {
+        switch (opcode)
+        {
+        case NOT:
+          a.value = !a.value;
+          break;
+        case ABS:
+          a.value = TA_ABS(a.value);
+          break;
+        case NEG:
+          a.value = -a.value;
+          break;
+        case FLOOR:
+          a.value = TA_PAD_FLOOR(a.value, 64);
+          break;
+        default: /* CEILING */
+          a.value = TA_PAD_CEIL(a.value, 64);
+          break;
+        }
+        a = TA_value(a.value);
+      }
+      else if (opcode == NOT && a.ppem >= PPEM_LESS)
+        a.ppem = (a.ppem == PPEM_LESS) ? PPEM_NOT_LESS : PPEM_LESS;
+      else
+        a = unknown;
+      PUSH_VALUE(a);
+      break;
+
+    case IF:
+      {
+        FT_ULong else_pos, eif_pos;
+        State else_state;
+
+
+        POP_VALUE(a);
+        CHECK(TA_find_else_eif(buf, len, next, &else_pos, &eif_pos));
+        if (eif_pos >= stop)
+          return LIMITS_UNKNOWN;
+
+        /* the PPEM range might have changed since the comparison */
+        a = TA_state_test_ppem(state, a);
+
+        if (a.known)
+        {
+          /* `ELSE' (if reached) skips to `EIF' */
+          if (!a.value)
+            next = (else_pos ? else_pos : eif_pos) + 1;
+          break;
+        }
+
+        CHECK(TA_state_copy(limits, &else_state, state));
+        TA_state_restrict_ppem(state, a, 1);
+        TA_state_restrict_ppem(&else_state, a, 0);
+
+        /* Glyph programs push different arguments for different PPEM */
+        /* ranges, so the stack depths don't match after the `EIF'. */
+        /* Instead of merging the states, we thus follow the `ELSE' */
+        /* branch up to the end of the program and continue with the */
+        /* `IF' branch. */
+        if (limits->split_paths && !limits->call_depth)
+        {
+          if (++limits->num_paths > LIMITS_MAX_PATHS)
+            error = LIMITS_UNKNOWN;
+          else
+            error = TA_limits_run(limits, &else_state, buf, len,
+                                  (else_pos ? else_pos : eif_pos) + 1,
+                                  stop);
+
+          TA_state_free(limits, &else_state);
+          if (error)
+            return error;
+
+          break;
+        }
+
+        /* execute both branches and merge the results */
+
+        error = TA_limits_run(limits, state, buf, len,
+                              next, else_pos ? else_pos : eif_pos);
+        if (!error && else_pos)
+          error = TA_limits_run(limits, &else_state, buf, len,
+                                else_pos + 1, eif_pos);
+        if (!error)
+          error = TA_state_merge(limits, state, &else_state);
+
+        TA_state_free(limits, &else_state);
+        if (error)
+          return error;
+
+        next = eif_pos + 1;
+      }
+      break;
+
+    case DELTAP1:
+    case DELTAP2:
+    case DELTAP3:
+    case DELTAC1:
+    case DELTAC2:
+    case DELTAC3:
+      POP_VALUE(c);
+      if (!c.known)
+        return LIMITS_UNKNOWN;
+      for (i = 0; i < c.value; i++)
+      {
+        POP_VALUE(a);
+        POP_VALUE(b);
+        if (opcode <= DELTAP3)
+          TOUCH(state->zp[0], a);
+      }
+      break;
+
+    case ROLL:
+      POP_VALUE(a);
+      POP_VALUE(b);
+      POP_VALUE(c);
+      PUSH_VALUE(b);
+      PUSH_VALUE(a);
+      PUSH_VALUE(c);
+      break;
+
+    default:
+      if (opcode >= PUSHB_1 && opcode <= PUSHB_8)
+      {
+        for (i = 1; (FT_ULong)i < n; i++)
+          PUSH_VALUE(TA_value(buf[pc + i]));
+      }
+      else if (opcode >= PUSHW_1 && opcode <= PUSHW_8)
+      {
+        for (i = 1; (FT_ULong)i < n; i += 2)
+          PUSH_VALUE(TA_value((FT_Short)((buf[pc + i] << 8) | buf[pc + i + 1])));
+      }
+      else if (opcode >= MDRP_norp0_nokeep_noround_gray)
+      {
+        /* `MDRP' and `MIRP' */
+        if (opcode >= MIRP_norp0_nokeep_noround_gray)
+          POP_VALUE(b); /* CVT index */
+        POP_VALUE(a);
+        TOUCH(state->zp[0], state->rp[0]);
+        TOUCH(state->zp[1], a);
+        state->rp[1] = state->rp[0];
+        state->rp[2] = a;
+        if (opcode & 0x10)
+          state->rp[0] = a;
+      }
+      else
+      {
+        /* `ENDF' outside of a function call, `IDEF', */
+        /* and undefined opcodes */
+        return LIMITS_UNKNOWN;
+      }
+      break;
+    }
+
+    pc = next;
+  }
+
+  /* we must arrive exactly at the end of the current code block */
+  if (pc != stop)
+    return LIMITS_UNKNOWN;
+
+  return TA_Err_Ok;
+}
+
+#undef POP_VALUE
+#undef PUSH_VALUE
+#undef TOUCH
+#undef CHECK
+
+
+/* run the `fpgm' and `prep' tables of `sfnt' */
+/* for the current rasterizer environment; */
+/* `state' must be zeroed */
+
+static FT_Error
+TA_sfnt_analyze_global_bytecode(SFNT* sfnt,
+                                FONT* font,
+                                Limits* limits,
+                                State* state)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  SFNT_Table* fpgm_table = &font->tables[data->fpgm_idx];
+  SFNT_Table* prep_table = &font->tables[data->prep_idx];
+
+  FT_Error error;
+
+
+  /* the storage area persists between programs, */
+  /* while the stack and the graphics state get reset */
+
+  TA_state_reset(state);
+  limits->num_steps = 0;
+  error = TA_limits_run(limits, state,
+                        fpgm_table->buf, fpgm_table->len,
+                        0, fpgm_table->len);
+  if (error)
+    return error;
+
+  TA_state_reset(state);
+  limits->num_steps = 0;
+  return TA_limits_run(limits, state,
+                       prep_table->buf, prep_table->len,
+                       0, prep_table->len);
+}
+
+
+/* all glyph programs start with the storage area */
+/* as left by the `prep' table */
+
+static FT_Error
+TA_glyph_analyze_bytecode(GLYPH* glyph,
+                          Limits* limits,
+                          State* prep_state)
+{
+  State state;
+  FT_Error error;
+
+
+  error = TA_state_copy(limits, &state, prep_state);
+  if (error)
+    return error;
+
+  TA_state_reset(&state);
+  limits->num_steps = 0;
+  limits->num_paths = 0;
+  limits->split_paths = 1;
+  error = TA_limits_run(limits, &state,
+                        glyph->ins_buf, glyph->ins_len,
+                        0, glyph->ins_len);
+  limits->split_paths = 0;
+  TA_state_free(limits, &state);
+
+  return error;
+}
+
+
+FT_Error
+TA_sfnt_compute_bytecode_limits(SFNT* sfnt,
+                                FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  Limits* limits;
+  State prep_states[sizeof (environments) / sizeof (environments[0])];
+  FT_UInt num_prep_states = 0;
+  FT_UInt i, j;
+  FT_Error error = TA_Err_Ok;
+
+
+  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel; */
+  /* subfonts which share them also share the limits */
+  if (data->have_limits)
+    goto Exit;
+
+  /* the analysis is optional since it takes about as long */
+  /* as hinting the glyphs; in streaming mode, */
+  /* the glyph bytecode is already gone */
+  if (!font->exact_maxp || font->streaming)
+  {
+    data->max_storage = sfnt->max_storage;
+    data->max_stack_elements = sfnt->max_stack_elements;
+    data->max_twilight_points = sfnt->max_twilight_points;
+    data->have_limits = 1;
+
+    goto Exit;
+  }
+
+  limits = (Limits*)ta_mem_calloc(font->memory, 1, sizeof (Limits));
+  if (!limits)
+    return FT_Err_Out_Of_Memory;
+
+  limits->memory = font->memory;
+
+  /* the maximum values accumulate over all runs */
+  for (i = 0; i < sizeof (environments) / sizeof (environments[0]); i++)
+  {
+    State* state = &prep_states[num_prep_states];
+
+
+    memset(state, 0, sizeof (State));
+    limits->env = &environments[i];
+
+    error = TA_sfnt_analyze_global_bytecode(sfnt, font, limits, state);
+    if (error)
+    {
+      TA_state_free(limits, state);
+      break;
+    }
+
+    for (j = 0; j < num_prep_states; j++)
+      if (TA_state_equal(&prep_states[j], state))
+        break;
+
+    if (j < num_prep_states)
+      TA_state_free(limits, state);
+    else
+      num_prep_states++;
+  }
+
+  /* glyph programs only depend on the environment */
+  /* via the data set up by the `prep' table */
+  limits->env = NULL;
+
+  for (i = 0; !error && i < data->num_glyphs; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+    FT_ULong max_storage;
+    FT_ULong max_stack;
+    FT_ULong max_twilight;
+
+
+    if (!glyph->ins_len)
+      continue;
+
+    /* the glyph cache holds the values of unchanged glyphs */
+    if (TA_glyph_get_cached_limits(font, glyph,
+                                   &max_storage, &max_stack, &max_twilight))
+    {
+      if (max_storage > limits->max_storage)
+        limits->max_storage = max_storage;
+      if (max_stack > limits->max_stack)
+        limits->max_stack = max_stack;
+      if (max_twilight > limits->max_twilight)
+        limits->max_twilight = max_twilight;
+
+      continue;
+    }
+
+    /* compute the glyph's own values separately */
+    /* so that they can be cached */
+    max_storage = limits->max_storage;
+    max_stack = limits->max_stack;
+    max_twilight = limits->max_twilight;
+
+    limits->max_storage = 0;
+    limits->max_stack = 0;
+    limits->max_twilight = 0;
+
+    for (j = 0; !error && j < num_prep_states; j++)
+      error = TA_glyph_analyze_bytecode(glyph, limits, &prep_states[j]);
+    if (error == LIMITS_UNKNOWN)
+      TA_LOG(("bytecode limits: can't analyze glyph %d\n", i));
+
+    if (!error)
+      TA_glyph_set_cached_limits(font, glyph,
+                                 limits->max_storage,
+                                 limits->max_stack,
+                                 limits->max_twilight);
+
+    if (max_storage > limits->max_storage)
+      limits->max_storage = max_storage;
+    if (max_stack > limits->max_stack)
+      limits->max_stack = max_stack;
+    if (max_twilight > limits->max_twilight)
+      limits->max_twilight = max_twilight;
+  }
+
+  for (j = 0; j < num_prep_states; j++)
+    TA_state_free(limits, &prep_states[j]);
+
+  if (error == LIMITS_UNKNOWN)
+  {
+    /* use the upper bounds collected while emitting bytecode */
+    TA_LOG(("bytecode limits: analysis failed, using upper bounds\n"));
+
+    data->max_storage = sfnt->max_storage;
+    data->max_stack_elements = sfnt->max_stack_elements;
+    data->max_twilight_points = sfnt->max_twilight_points;
+  }
+  else if (error)
+  {
+    ta_mem_free(font->memory, limits);
+    return error;
+  }
+  else
+  {
+    TA_LOG(("bytecode limits:\n"
+            "  storage: %lu (upper bound %d)\n"
+            "  stack elements: %lu (upper bound %d)\n"
+            "  twilight points: %lu (upper bound %d)\n",
+            limits->max_storage, sfnt->max_storage,
+            limits->max_stack, sfnt->max_stack_elements,
+            limits->max_twilight, sfnt->max_twilight_points));
+
+    /* the upper bounds are wrong if the bytecode needs more */
+    if (limits->max_storage > sfnt->max_storage
+        || limits->max_stack > sfnt->max_stack_elements
+        || limits->max_twilight > sfnt->max_twilight_points)
+    {
+      ta_mem_free(font->memory, limits);
+      return TA_Err_Maxp_Limits_Exceeded;
+    }
+
+    data->max_storage = (FT_UShort)limits->max_storage;
+    data->max_stack_elements = (FT_UShort)limits->max_stack;
+    data->max_twilight_points = (FT_UShort)limits->max_twilight;
+  }
+
+  data->have_limits = 1;
+  ta_mem_free(font->memory, limits);
+
+Exit:
+  sfnt->max_storage = data->max_storage;
+  sfnt->max_stack_elements = data->max_stack_elements;
+  sfnt->max_twilight_points = data->max_twilight_points;
+
+  return TA_Err_Ok;
+}
+
+/* end of talimits.c */
@@ -49,11 +49,11 @@ ta_loader_init(FONT* font)
 
   memset(loader, 0, sizeof (TA_LoaderRec));
 
-  ta_glyph_hints_init(&loader->hints);
+  ta_glyph_hints_init(&loader->hints, font->memory);
 #ifdef TA_DEBUG
   _ta_debug_hints = &loader->hints;
 #endif
-  return TA_GlyphLoader_New(&loader->gloader);
+  return TA_GlyphLoader_New(font->memory, &loader->gloader);
 }
 
 
@@ -127,12 +127,62 @@ ta_loader_load_g(TA_Loader loader,
   FT_Slot_Internal internal = slot->internal;
 #endif
   FT_Int32 flags;
+  FT_Outline* outline;
+  FT_Glyph_Format format;
 
 
-  flags = load_flags | FT_LOAD_LINEAR_DESIGN;
-  error = FT_Load_Glyph(face, glyph_index, flags);
-  if (error)
-    goto Exit;
+  if (depth == 0
+      && loader->cache_outline
+      && loader->have_cache_metrics
+      && glyph_index == loader->cache_index)
+  {
+    /* bypass FreeType's glyph loader; */
+    /* we only have to restore the unscaled metrics */
+    /* which get modified below */
+    outline = loader->cache_outline;
+    format = FT_GLYPH_FORMAT_OUTLINE;
+
+    slot->metrics = loader->cache_metrics;
+    slot->lsb_delta = 0;
+    slot->rsb_delta = 0;
+  }
+  else
+  {
+    flags = load_flags | FT_LOAD_LINEAR_DESIGN;
+    error = FT_Load_Glyph(face, glyph_index, flags);
+    if (error)
+      goto Exit;
+
+    outline = &slot->outline;
+    format = slot->format;
+
+    if (depth == 0
+        && loader->cache_outline
+        && glyph_index == loader->cache_index)
+    {
+      FT_Outline* cached = loader->cache_outline;
+
+
+      /* we only use the cached outline if FreeType delivers */
+      /* exactly the same data; otherwise we disable the cache */
+      if ((load_flags & FT_LOAD_NO_SCALE)
+          && format == FT_GLYPH_FORMAT_OUTLINE
+          && outline->n_points == cached->n_points
+          && outline->n_contours == cached->n_contours
+          && !memcmp(outline->points, cached->points,
+                     outline->n_points * sizeof (FT_Vector))
+          && !memcmp(outline->contours, cached->contours,
+                     outline->n_contours * sizeof (short))
+          && !memcmp(outline->tags, cached->tags,
+                     outline->n_points * sizeof (char)))
+      {
+        loader->cache_metrics = slot->metrics;
+        loader->have_cache_metrics = 1;
+      }
+      else
+        loader->cache_outline = NULL;
+    }
+  }
 
 #if 0
   loader->transformed = internal->glyph_transformed;
@@ -150,35 +200,35 @@ ta_loader_load_g(TA_Loader loader,
   }
 #endif
 
-  switch (slot->format)
+  switch (format)
   {
   case FT_GLYPH_FORMAT_OUTLINE:
     /* translate the loaded glyph when an internal transform is needed */
     if (loader->transformed)
-      FT_Outline_Translate(&slot->outline,
+      FT_Outline_Translate(outline,
                            loader->trans_delta.x,
                            loader->trans_delta.y);
 
     /* copy the outline points in the loader's current extra points */
     /* which are used to keep original glyph coordinates */
     error = TA_GLYPHLOADER_CHECK_POINTS(gloader,
-                                        slot->outline.n_points + 4,
-                                        slot->outline.n_contours);
+                                        outline->n_points + 4,
+                                        outline->n_contours);
     if (error)
       goto Exit;
 
     memcpy(gloader->current.outline.points,
-           slot->outline.points,
-           slot->outline.n_points * sizeof (FT_Vector));
+           outline->points,
+           outline->n_points * sizeof (FT_Vector));
     memcpy(gloader->current.outline.contours,
-           slot->outline.contours,
-           slot->outline.n_contours * sizeof (short));
+           outline->contours,
+           outline->n_contours * sizeof (short));
     memcpy(gloader->current.outline.tags,
-           slot->outline.tags,
-           slot->outline.n_points * sizeof (char));
+           outline->tags,
+           outline->n_points * sizeof (char));
 
-    gloader->current.outline.n_points = slot->outline.n_points;
-    gloader->current.outline.n_contours = slot->outline.n_contours;
+    gloader->current.outline.n_points = outline->n_points;
+    gloader->current.outline.n_contours = outline->n_contours;
 
     /* compute original horizontal phantom points */
     /* (and ignore vertical ones) */
@@ -189,15 +239,19 @@ ta_loader_load_g(TA_Loader loader,
     loader->pp2.y = hints->y_delta;
 
     /* be sure to check for spacing glyphs */
-    if (slot->outline.n_points == 0)
+    if (outline->n_points == 0)
       goto Hint_Metrics;
 
     /* now load the slot image into the auto-outline */
     /* and run the automatic hinting process */
     if (metrics->clazz->script_hints_apply)
-      metrics->clazz->script_hints_apply(hints,
-                                         &gloader->current.outline,
-                                         metrics);
+    {
+      error = metrics->clazz->script_hints_apply(hints,
+                                                 &gloader->current.outline,
+                                                 metrics);
+      if (error)
+        goto Exit;
+    }
 
     /* we now need to adjust the metrics according to the change in */
     /* width/positioning that occurred during the hinting process */
@@ -578,4 +632,20 @@ ta_loader_register_hints_recorder(TA_Loader loader,
   loader->hints.user = user;
 }
 
+
+/* register an unscaled outline of glyph `gindex' which gets used */
+/* instead of loading the glyph with FreeType; */
+/* it is activated only after a comparison with FreeType's data, */
+/* and `outline' set to NULL removes the registration */
+
+void
+ta_loader_register_outline(TA_Loader loader,
+                           FT_UInt gindex,
+                           FT_Outline* outline)
+{
+  loader->cache_index = gindex;
+  loader->cache_outline = outline;
+  loader->have_cache_metrics = 0;
+}
+
 /* end of taloader.c */
@@ -42,6 +42,13 @@ typedef struct TA_LoaderRec_
   FT_Vector pp1;
   FT_Vector pp2;
   /* we don't handle vertical phantom points */
+
+  /* an optional, already decoded unscaled outline of glyph */
+  /* `cache_index'; see `ta_loader_register_outline' */
+  FT_UInt cache_index;
+  FT_Outline* cache_outline;
+  FT_Glyph_Metrics cache_metrics;
+  FT_Bool have_cache_metrics;
 } TA_LoaderRec, *TA_Loader;
 
 
@@ -70,6 +77,12 @@ ta_loader_register_hints_recorder(TA_Loader loader,
                                   TA_Hints_Recorder hints_recorder,
                                   void* user);
 
+
+void
+ta_loader_register_outline(TA_Loader loader,
+                           FT_UInt gindex,
+                           FT_Outline* outline);
+
 #endif /* __TALOADER_H__ */
 
 /* end of taloader.h */
@@ -0,0 +1,524 @@
+/* tamemory.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Memory management.
+ *
+ * All allocations of the library and of FreeType go through a
+ * `TA_Memory' object, which calls either the user-supplied hooks or the
+ * standard C functions.  Every block is preceded by a header which holds
+ * its size so that we can count the allocated bytes (and so that a
+ * missing `realloc' hook can be emulated).
+ *
+ * If the pool is active, small blocks are taken from free lists with size
+ * classes of powers of two; the free lists get refilled from large chunks
+ * which are only released at the very end.  This is much faster for the
+ * many short-lived allocations of the hinting engine.
+ *
+ * While worker threads are running (see `tathread.c'), a mutex serializes
+ * the calls.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tamemory.h"
+
+
+/* the union assures proper alignment of the block data */
+typedef union TA_MemHeader_
+{
+  size_t size;
+  long l;
+  double d;
+  long double ld;
+  void* p;
+} TA_MemHeader;
+
+
+static void*
+ta_default_alloc(size_t size,
+                 void* alloc_data)
+{
+  FT_UNUSED(alloc_data);
+
+  return malloc(size);
+}
+
+
+static void*
+ta_default_realloc(void* block,
+                   size_t size,
+                   void* alloc_data)
+{
+  FT_UNUSED(alloc_data);
+
+  return realloc(block, size);
+}
+
+
+static void
+ta_default_free(void* block,
+                void* alloc_data)
+{
+  FT_UNUSED(alloc_data);
+
+  free(block);
+}
+
+
+#ifdef HAVE_PTHREAD
+#  define TA_MEMORY_LOCK(memory) \
+          do \
+          { \
+            if ((memory)->use_lock) \
+              pthread_mutex_lock(&(memory)->lock); \
+          } while (0)
+#  define TA_MEMORY_UNLOCK(memory) \
+          do \
+          { \
+            if ((memory)->use_lock) \
+              pthread_mutex_unlock(&(memory)->lock); \
+          } while (0)
+#else
+#  define TA_MEMORY_LOCK(memory) do { } while (0)
+#  define TA_MEMORY_UNLOCK(memory) do { } while (0)
+#endif
+
+
+/* the FreeType interface */
+
+static void*
+ta_ft_alloc(FT_Memory ft_memory,
+            long size)
+{
+  return ta_mem_alloc((TA_Memory)ft_memory->user, (size_t)size);
+}
+
+
+static void*
+ta_ft_realloc(FT_Memory ft_memory,
+              long cur_size,
+              long new_size,
+              void* block)
+{
+  FT_UNUSED(cur_size);
+
+  return ta_mem_realloc((TA_Memory)ft_memory->user, block, (size_t)new_size);
+}
+
+
+static void
+ta_ft_free(FT_Memory ft_memory,
+           void* block)
+{
+  ta_mem_free((TA_Memory)ft_memory->user, block);
+}
+
+
+void
+ta_memory_init(TA_Memory memory,
+               TA_Alloc_Func alloc_func,
+               TA_Realloc_Func realloc_func,
+               TA_Free_Func free_func,
+               void* alloc_data,
+               FT_Bool use_pool,
+               size_t limit)
+{
+  memset(memory, 0, sizeof (TA_MemoryRec));
+
+  if (alloc_func)
+  {
+    /* a missing `realloc' hook gets emulated */
+    memory->alloc = alloc_func;
+    memory->realloc = realloc_func;
+    memory->free = free_func;
+    memory->alloc_data = alloc_data;
+  }
+  else
+  {
+    memory->alloc = ta_default_alloc;
+    memory->realloc = ta_default_realloc;
+    memory->free = ta_default_free;
+  }
+
+  memory->use_pool = use_pool;
+  memory->limit = limit;
+
+  memory->ft_memory.user = memory;
+  memory->ft_memory.alloc = ta_ft_alloc;
+  memory->ft_memory.realloc = ta_ft_realloc;
+  memory->ft_memory.free = ta_ft_free;
+}
+
+
+static void
+ta_memory_count(TA_Memory memory,
+                size_t old_size,
+                size_t new_size)
+{
+  memory->current -= old_size;
+  memory->current += new_size;
+
+  if (memory->phase < TA_PHASE_MAX)
+  {
+    TA_Memory_Stats* stats = &memory->stats;
+
+
+    stats->current[memory->phase] = memory->current;
+    if (memory->current > stats->peak[memory->phase])
+      stats->peak[memory->phase] = memory->current;
+  }
+}
+
+
+void
+ta_memory_set_phase(TA_Memory memory,
+                    FT_UInt phase)
+{
+  memory->phase = phase;
+  ta_memory_count(memory, 0, 0);
+}
+
+
+#ifdef HAVE_PTHREAD
+
+/* return 1 if successful */
+
+FT_Bool
+ta_memory_enable_lock(TA_Memory memory)
+{
+  if (pthread_mutex_init(&memory->lock, NULL))
+    return 0;
+
+  memory->use_lock = 1;
+
+  return 1;
+}
+
+
+void
+ta_memory_disable_lock(TA_Memory memory)
+{
+  if (!memory->use_lock)
+    return;
+
+  memory->use_lock = 0;
+  pthread_mutex_destroy(&memory->lock);
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+void
+ta_memory_done(TA_Memory memory)
+{
+  TA_PoolBlock* chunk = memory->chunks;
+
+
+  while (chunk)
+  {
+    TA_PoolBlock* next = chunk->next;
+
+
+    memory->free(chunk, memory->alloc_data);
+    chunk = next;
+  }
+
+  memory->chunks = NULL;
+  memory->chunk_cur = NULL;
+  memory->chunk_left = 0;
+}
+
+
+/* check whether we can increase the amount of allocated memory */
+
+static FT_Bool
+ta_memory_check_limit(TA_Memory memory,
+                      size_t old_size,
+                      size_t new_size)
+{
+  if (new_size > (size_t)-1 - sizeof (TA_MemHeader))
+    return 0;
+
+  if (!memory->limit || new_size <= old_size)
+    return 1;
+
+  /* with a context, the library's allocations */
+  /* might already exceed the limit */
+  if (memory->current > memory->limit)
+    return 0;
+
+  return new_size - old_size <= memory->limit - memory->current;
+}
+
+
+/* return the size class of a block, or -1 if not handled by the pool */
+
+static FT_Int
+ta_pool_class(TA_Memory memory,
+              size_t size)
+{
+  size_t total = size + sizeof (TA_MemHeader);
+  size_t block_size = TA_POOL_MIN_BLOCK;
+  FT_Int k;
+
+
+  if (!memory->use_pool || total > TA_POOL_MAX_BLOCK)
+    return -1;
+
+  for (k = 0; block_size < total; k++)
+    block_size <<= 1;
+
+  return k;
+}
+
+
+static TA_MemHeader*
+ta_pool_alloc(TA_Memory memory,
+              FT_Int k)
+{
+  size_t block_size = TA_POOL_MIN_BLOCK << k;
+  TA_PoolBlock* block = memory->free_blocks[k];
+  FT_Byte* p;
+
+
+  if (block)
+  {
+    memory->free_blocks[k] = block->next;
+    return (TA_MemHeader*)block;
+  }
+
+  if (memory->chunk_left < block_size)
+  {
+    /* the remaining part of the current chunk is lost, */
+    /* which is less than 4kByte */
+    TA_PoolBlock* chunk = (TA_PoolBlock*)memory->alloc(TA_POOL_CHUNK_SIZE,
+                                                       memory->alloc_data);
+    if (!chunk)
+      return NULL;
+
+    chunk->next = memory->chunks;
+    memory->chunks = chunk;
+
+    /* keep the alignment of the block data */
+    memory->chunk_cur = (FT_Byte*)chunk + sizeof (TA_MemHeader);
+    memory->chunk_left = TA_POOL_CHUNK_SIZE - sizeof (TA_MemHeader);
+  }
+
+  p = memory->chunk_cur;
+  memory->chunk_cur += block_size;
+  memory->chunk_left -= block_size;
+
+  return (TA_MemHeader*)p;
+}
+
+
+static void
+ta_pool_free(TA_Memory memory,
+             TA_MemHeader* header,
+             FT_Int k)
+{
+  TA_PoolBlock* block = (TA_PoolBlock*)header;
+
+
+  block->next = memory->free_blocks[k];
+  memory->free_blocks[k] = block;
+}
+
+
+static void*
+ta_mem_do_alloc(TA_Memory memory,
+                size_t size)
+{
+  TA_MemHeader* header;
+  FT_Int k;
+
+
+  if (!ta_memory_check_limit(memory, 0, size))
+    return NULL;
+
+  k = ta_pool_class(memory, size);
+  if (k >= 0)
+    header = ta_pool_alloc(memory, k);
+  else
+    header = (TA_MemHeader*)memory->alloc(size + sizeof (TA_MemHeader),
+                                          memory->alloc_data);
+  if (!header)
+    return NULL;
+
+  header->size = size;
+
+  if (memory->phase < TA_PHASE_MAX)
+    memory->stats.num_allocs[memory->phase]++;
+  ta_memory_count(memory, 0, size);
+
+  return header + 1;
+}
+
+
+void*
+ta_mem_alloc(TA_Memory memory,
+             size_t size)
+{
+  void* block;
+
+
+  TA_MEMORY_LOCK(memory);
+  block = ta_mem_do_alloc(memory, size);
+  TA_MEMORY_UNLOCK(memory);
+
+  return block;
+}
+
+
+void*
+ta_mem_calloc(TA_Memory memory,
+              size_t count,
+              size_t size)
+{
+  void* block;
+
+
+  if (size && count > (size_t)-1 / size)
+    return NULL;
+
+  block = ta_mem_alloc(memory, count * size);
+  if (block)
+    memset(block, 0, count * size);
+
+  return block;
+}
+
+
+static void*
+ta_mem_do_realloc(TA_Memory memory,
+                  void* block,
+                  size_t size)
+{
+  TA_MemHeader* header;
+  TA_MemHeader* header_new;
+  size_t old_size;
+  FT_Int old_k;
+  FT_Int new_k;
+
+
+  if (!block)
+    return ta_mem_do_alloc(memory, size);
+
+  header = (TA_MemHeader*)block - 1;
+  old_size = header->size;
+
+  if (!ta_memory_check_limit(memory, old_size, size))
+    return NULL;
+
+  old_k = ta_pool_class(memory, old_size);
+  new_k = ta_pool_class(memory, size);
+
+  if (old_k >= 0 && old_k == new_k)
+    header_new = header;
+  else if (old_k < 0 && new_k < 0 && memory->realloc)
+  {
+    header_new = (TA_MemHeader*)memory->realloc(header,
+                                                size + sizeof (TA_MemHeader),
+                                                memory->alloc_data);
+    if (!header_new)
+      return NULL;
+  }
+  else
+  {
+    /* move the data to a new block */
+    if (new_k >= 0)
+      header_new = ta_pool_alloc(memory, new_k);
+    else
+      header_new = (TA_MemHeader*)memory->alloc(size
+                                                  + sizeof (TA_MemHeader),
+                                                memory->alloc_data);
+    if (!header_new)
+      return NULL;
+
+    memcpy(header_new + 1, header + 1, old_size < size ? old_size : size);
+
+    if (old_k >= 0)
+      ta_pool_free(memory, header, old_k);
+    else
+      memory->free(header, memory->alloc_data);
+  }
+
+  header_new->size = size;
+
+  if (memory->phase < TA_PHASE_MAX)
+    memory->stats.num_allocs[memory->phase]++;
+  ta_memory_count(memory, old_size, size);
+
+  return header_new + 1;
+}
+
+
+void*
+ta_mem_realloc(TA_Memory memory,
+               void* block,
+               size_t size)
+{
+  void* block_new;
+
+
+  TA_MEMORY_LOCK(memory);
+  block_new = ta_mem_do_realloc(memory, block, size);
+  TA_MEMORY_UNLOCK(memory);
+
+  return block_new;
+}
+
+
+static void
+ta_mem_do_free(TA_Memory memory,
+               void* block)
+{
+  TA_MemHeader* header;
+  size_t size;
+  FT_Int k;
+
+
+  if (!block)
+    return;
+
+  header = (TA_MemHeader*)block - 1;
+  size = header->size;
+
+  k = ta_pool_class(memory, size);
+  if (k >= 0)
+    ta_pool_free(memory, header, k);
+  else
+    memory->free(header, memory->alloc_data);
+
+  ta_memory_count(memory, size, 0);
+}
+
+
+void
+ta_mem_free(TA_Memory memory,
+            void* block)
+{
+  /* `memory' might not be set up yet if `block' is NULL */
+  if (!block)
+    return;
+
+  TA_MEMORY_LOCK(memory);
+  ta_mem_do_free(memory, block);
+  TA_MEMORY_UNLOCK(memory);
+}
+
+/* end of tamemory.c */
@@ -0,0 +1,125 @@
+/* tamemory.h */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#ifndef __TAMEMORY_H__
+#define __TAMEMORY_H__
+
+#include <config.h>
+
+#include <stddef.h>
+
+#ifdef HAVE_PTHREAD
+#  include <pthread.h>
+#endif
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_SYSTEM_H
+
+#include <ttfautohint.h>
+
+
+/* the pool serves blocks (including the header) of 32, 64, ..., */
+/* 4096 bytes; larger blocks are directly allocated */
+#define TA_POOL_NUM_CLASSES 8
+#define TA_POOL_MIN_BLOCK 32
+#define TA_POOL_MAX_BLOCK (TA_POOL_MIN_BLOCK << (TA_POOL_NUM_CLASSES - 1))
+#define TA_POOL_CHUNK_SIZE 65536
+
+
+typedef struct TA_PoolBlock_
+{
+  struct TA_PoolBlock_* next;
+} TA_PoolBlock;
+
+
+typedef struct TA_MemoryRec_
+{
+  TA_Alloc_Func alloc;
+  TA_Realloc_Func realloc;
+  TA_Free_Func free;
+  void* alloc_data;
+
+  size_t limit; /* zero means no limit */
+
+  /* the pool: free lists for each size class, */
+  /* and a linked list of all chunks */
+  FT_Bool use_pool;
+  TA_PoolBlock* free_blocks[TA_POOL_NUM_CLASSES];
+  TA_PoolBlock* chunks;
+  FT_Byte* chunk_cur;
+  size_t chunk_left;
+
+  /* accounting; `TA_PHASE_MAX' means that we no longer count */
+  FT_UInt phase;
+  size_t current;
+  TA_Memory_Stats stats;
+
+#ifdef HAVE_PTHREAD
+  /* while hinting in parallel, all calls get serialized */
+  FT_Bool use_lock;
+  pthread_mutex_t lock;
+#endif
+
+  /* the interface for FreeType */
+  struct FT_MemoryRec_ ft_memory;
+} TA_MemoryRec, *TA_Memory;
+
+
+void
+ta_memory_init(TA_Memory memory,
+               TA_Alloc_Func alloc_func,
+               TA_Realloc_Func realloc_func,
+               TA_Free_Func free_func,
+               void* alloc_data,
+               FT_Bool use_pool,
+               size_t limit);
+
+void
+ta_memory_set_phase(TA_Memory memory,
+                    FT_UInt phase);
+
+void
+ta_memory_done(TA_Memory memory);
+
+#ifdef HAVE_PTHREAD
+FT_Bool
+ta_memory_enable_lock(TA_Memory memory);
+void
+ta_memory_disable_lock(TA_Memory memory);
+#endif
+
+
+void*
+ta_mem_alloc(TA_Memory memory,
+             size_t size);
+
+void*
+ta_mem_calloc(TA_Memory memory,
+              size_t count,
+              size_t size);
+
+void*
+ta_mem_realloc(TA_Memory memory,
+               void* block,
+               size_t size);
+
+void
+ta_mem_free(TA_Memory memory,
+            void* block);
+
+#endif /* __TAMEMORY_H__ */
+
+/* end of tamemory.h */
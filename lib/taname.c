@@ -123,8 +123,9 @@ parse_name_records(FT_Byte** curp,
     return TA_Err_Ok;
 
   /* allocate name records array */
-  n->name_records = (Name_Record*)calloc(1, n->name_count
-                                            * sizeof (Name_Record));
+  n->name_records = (Name_Record*)ta_mem_calloc(font->memory,
+                                                 1, n->name_count
+                                                    * sizeof (Name_Record));
   if (!n->name_records)
     return FT_Err_Out_Of_Memory;
 
@@ -193,6 +194,8 @@ parse_name_records(FT_Byte** curp,
         continue;
     }
 
+    /* the info callback might reallocate the string, */
+    /* so we don't use our memory management for it */
     r->str = (FT_Byte*)malloc(r->len);
     if (!r->str)
       return FT_Err_Out_Of_Memory;
@@ -212,9 +215,20 @@ parse_name_records(FT_Byte** curp,
     count++;
   }
 
-  /* shrink name record array if necessary */
-  n->name_records = (Name_Record*)realloc(n->name_records,
-                                          count * sizeof (Name_Record));
+  /* shrink name record array if necessary; */
+  /* in case of failure we simply keep the larger array */
+  if (count < n->name_count)
+  {
+    Name_Record* name_records_new;
+
+
+    name_records_new =
+      (Name_Record*)ta_mem_realloc(font->memory,
+                                   n->name_records,
+                                   count * sizeof (Name_Record));
+    if (name_records_new)
+      n->name_records = name_records_new;
+  }
   n->name_count = count;
 
   return TA_Err_Ok;
@@ -226,7 +240,8 @@ parse_lang_tag_records(FT_Byte** curp,
                        Naming_Table* n,
                        FT_Byte* buf,
                        FT_Byte* startp,
-                       FT_Byte* endp)
+                       FT_Byte* endp,
+                       FONT* font)
 {
   FT_UShort i;
   FT_Byte* p;
@@ -238,7 +253,8 @@ parse_lang_tag_records(FT_Byte** curp,
     return TA_Err_Ok;
 
   /* allocate language tags array */
-  n->lang_tag_records = (Lang_Tag_Record*)calloc(
+  n->lang_tag_records = (Lang_Tag_Record*)ta_mem_calloc(
+                          font->memory,
                           1, n->lang_tag_count * sizeof (Lang_Tag_Record));
   if (!n->lang_tag_records)
     return FT_Err_Out_Of_Memory;
@@ -269,7 +285,7 @@ parse_lang_tag_records(FT_Byte** curp,
       continue;
 
     /* we don't massage the data since we only make a copy */
-    r->str = (FT_Byte*)malloc(r->len);
+    r->str = (FT_Byte*)ta_mem_alloc(font->memory, r->len);
     if (!r->str)
       return FT_Err_Out_Of_Memory;
 
@@ -285,7 +301,8 @@ parse_lang_tag_records(FT_Byte** curp,
 
 static FT_Error
 build_name_table(Naming_Table* n,
-                 SFNT_Table* name_table)
+                 SFNT_Table* name_table,
+                 FONT* font)
 {
   FT_Byte* buf_new;
   FT_Byte* buf_new_resized;
@@ -307,7 +324,7 @@ build_name_table(Naming_Table* n,
   if (n->format == 1)
     buf_new_len += 2 + 4 * n->lang_tag_count;
 
-  buf_new = (FT_Byte*)malloc(buf_new_len);
+  buf_new = (FT_Byte*)ta_mem_alloc(font->memory, buf_new_len);
   if (!buf_new)   
     return FT_Err_Out_Of_Memory;
 
@@ -375,7 +392,7 @@ build_name_table(Naming_Table* n,
   if (buf_new_len + data_len > 2 * 0xFFFF)
   {
     /* the table would become too large, so we do nothing */
-    free(buf_new);
+    ta_mem_free(font->memory, buf_new);
     return TA_Err_Ok;
   }
 
@@ -386,10 +403,10 @@ build_name_table(Naming_Table* n,
   /* make the allocated buffer length a multiple of 4 */
   len = (buf_new_len + 3) & ~3;
 
-  buf_new_resized = (FT_Byte*)realloc(buf_new, len);
+  buf_new_resized = (FT_Byte*)ta_mem_realloc(font->memory, buf_new, len);
   if (!buf_new_resized)
   {
-    free(buf_new);
+    ta_mem_free(font->memory, buf_new);
     return FT_Err_Out_Of_Memory;
   }
   buf_new = buf_new_resized;
@@ -452,7 +469,7 @@ build_name_table(Naming_Table* n,
   }
 
   /* we are done; replace the old buffer with the new one */
-  free(name_table->buf);
+  ta_mem_free(font->memory, name_table->buf);
 
   name_table->buf = buf_new;
   name_table->len = buf_new_len;
@@ -508,11 +525,11 @@ TA_sfnt_update_name_table(SFNT* sfnt,
   if (error)
     goto Exit;
 
-  error = parse_lang_tag_records(&p, &n, buf, startp, endp);
+  error = parse_lang_tag_records(&p, &n, buf, startp, endp, font);
   if (error)
     goto Exit;
 
-  error = build_name_table(&n, name_table);
+  error = build_name_table(&n, name_table, font);
   if (error)
     goto Exit;
 
@@ -523,10 +540,10 @@ Exit:
   for (i = 0; i < n.name_count; i++)
     free(n.name_records[i].str);
   for (i = 0; i < n.lang_tag_count; i++)
-    free(n.lang_tag_records[i].str);
+    ta_mem_free(font->memory, n.lang_tag_records[i].str);
 
-  free(n.name_records);
-  free(n.lang_tag_records);
+  ta_mem_free(font->memory, n.name_records);
+  ta_mem_free(font->memory, n.lang_tag_records);
 
   name_table->processed = 1;
 
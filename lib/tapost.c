@@ -91,7 +91,7 @@ TA_sfnt_update_post_table(SFNT* sfnt,
 
     /* make the allocated buffer length a multiple of 4 */
     len = (buf_new_len + 3) & ~3;
-    buf_new = (FT_Byte*)malloc(len);
+    buf_new = (FT_Byte*)ta_mem_alloc(font->memory, len);
     if (!buf_new)
       return FT_Err_Out_Of_Memory;
 
@@ -127,7 +127,7 @@ TA_sfnt_update_post_table(SFNT* sfnt,
     strncpy((char*)p_new, TTFAUTOHINT_GLYPH_FIRST_BYTE TTFAUTOHINT_GLYPH,
             TTFAUTOHINT_GLYPH_LEN); /* new entry */
 
-    free(buf);
+    ta_mem_free(font->memory, buf);
     post_table->buf = buf_new;
     post_table->len = buf_new_len;
   }
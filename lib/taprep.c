@@ -402,13 +402,121 @@ unsigned char PREP(reset_component_counter) [] =
 };
 
 
+/*
+ * Functions `bci_number_set_is_element' and `bci_number_set_is_element2'
+ * scan linearly through all elements of a number set each time the `prep'
+ * table gets executed.  For sets with at least `NUMBER_SET_TABLE_MIN'
+ * ranges we instead push a lookup table with one flag per PPEM value onto
+ * the stack and access it with a single `CINDEX' instruction, provided
+ * the table doesn't get larger than `NUMBER_SET_TABLE_MAX' elements.
+ */
+
+#define NUMBER_SET_TABLE_MIN 8
+#define NUMBER_SET_TABLE_MAX 512
+
+
+/* this function allocates `buf', converting `number_set' into a lookup */
+/* table for PPEM values in the range [`min';`max'] to create bytecode */
+/* which sets CVT index `cvtl_is_element'; if the last range of */
+/* `number_set' is open, it must start at `max' */
+
+static FT_Byte*
+TA_sfnt_build_number_set_table(SFNT* sfnt,
+                               FONT* font,
+                               FT_Byte** buf,
+                               number_range* number_set,
+                               FT_UInt min,
+                               FT_UInt max)
+{
+  FT_Byte* bufp = NULL;
+  number_range* nr;
+
+  FT_UInt num_args = max - min + 3;
+  FT_UInt* args;
+  FT_UInt index_args[3];
+  FT_UInt i;
+
+  FT_UShort num_stack_elements;
+
+
+  args = (FT_UInt*)ta_mem_alloc(font->memory, num_args * sizeof (FT_UInt));
+  if (!args)
+    return NULL;
+
+  /* the topmost element is for PPEM values smaller than `min', */
+  /* the lowest one for PPEM values larger than `max'; */
+  /* in between, we have the flags for `max' down to `min' */
+  for (i = 0; i < num_args; i++)
+    args[i] = 0;
+
+  nr = number_set;
+  while (nr)
+  {
+    FT_UInt end = (FT_UInt)nr->end < max ? (FT_UInt)nr->end : max;
+
+
+    for (i = nr->start; i <= end; i++)
+      args[max - i + 1] = 1;
+
+    if (nr->end == 0x7FFF)
+      args[0] = 1;
+
+    nr = nr->next;
+  }
+
+  /* the stack index is `MPPEM - min + 2', clamped to [1;num_args] */
+  index_args[0] = num_args;
+  index_args[1] = 1;
+  index_args[2] = min - 2;
+
+  /* this rough estimate of the buffer size gets adjusted later on */
+  *buf = (FT_Byte*)ta_mem_alloc(font->memory,
+                                num_args
+                                + 2 * (num_args / 255 + 1)
+                                + 3 * 2 + 1
+                                + 20);
+  if (!*buf)
+    goto Fail;
+  bufp = *buf;
+
+  bufp = TA_build_push(bufp, args, num_args, 0, 1);
+  bufp = TA_build_push(bufp, index_args, 3, num_args > 0xFF, 1);
+
+  BCI(MPPEM);
+  BCI(SWAP);
+  BCI(SUB);
+  BCI(MAX);
+  BCI(MIN);
+  BCI(CINDEX);
+  BCI(PUSHB_1);
+    BCI(cvtl_is_element);
+  BCI(SWAP);
+  BCI(WCVTP);
+
+  /* remove the lookup table; */
+  /* this is the first code in the `prep' table, */
+  /* thus the stack doesn't contain other data */
+  BCI(CLEAR);
+
+  num_stack_elements = num_args + 4 + ADDITIONAL_STACK_ELEMENTS;
+  if (num_stack_elements > sfnt->max_stack_elements)
+    sfnt->max_stack_elements = num_stack_elements;
+
+Fail:
+  ta_mem_free(font->memory, args);
+
+  return bufp;
+}
+
+
 /* this function allocates `buf', parsing `number_set' to create bytecode */
 /* which eventually sets CVT index `cvtl_is_element' */
 /* (in functions `bci_number_set_is_element' and */
-/* `bci_number_set_is_element2') */
+/* `bci_number_set_is_element2', or with a lookup table for large sets) */
 
 static FT_Byte*
 TA_sfnt_build_number_set(SFNT* sfnt,
+                         FONT* font,
                          FT_Byte** buf,
                          number_range* number_set)
 {
@@ -456,14 +564,41 @@ TA_sfnt_build_number_set(SFNT* sfnt,
     nr = nr->next;
   }
 
+  if (num_singles + num_singles2
+      + num_ranges + num_ranges2 >= NUMBER_SET_TABLE_MIN)
+  {
+    FT_UInt min = number_set->start;
+    FT_UInt max;
+
+
+    nr = number_set;
+    while (nr->next)
+      nr = nr->next;
+
+    /* an open range is handled by the table's lowest element */
+    max = (nr->end == 0x7FFF) ? nr->start : nr->end;
+
+    if (max - min + 3 <= NUMBER_SET_TABLE_MAX)
+      return TA_sfnt_build_number_set_table(sfnt, font, buf, number_set,
+                                            min, max);
+  }
+
   /* collect all arguments temporarily in arrays (in reverse order) */
   /* so that we can easily split into chunks of 255 args */
   /* as needed by NPUSHB and friends; */
   /* for simplicity, always allocate an extra slot */
-  single2_args = (FT_UInt*)malloc((num_singles2 + 1) * sizeof (FT_UInt));
-  single_args = (FT_UInt*)malloc((num_singles + 1) * sizeof (FT_UInt));
-  range2_args = (FT_UInt*)malloc((2 * num_ranges2 + 1) * sizeof (FT_UInt));
-  range_args = (FT_UInt*)malloc((2 * num_ranges + 1) * sizeof (FT_UInt));
+  single2_args = (FT_UInt*)ta_mem_alloc(font->memory,
+                                        (num_singles2 + 1)
+                                        * sizeof (FT_UInt));
+  single_args = (FT_UInt*)ta_mem_alloc(font->memory,
+                                       (num_singles + 1)
+                                       * sizeof (FT_UInt));
+  range2_args = (FT_UInt*)ta_mem_alloc(font->memory,
+                                       (2 * num_ranges2 + 1)
+                                       * sizeof (FT_UInt));
+  range_args = (FT_UInt*)ta_mem_alloc(font->memory,
+                                      (2 * num_ranges + 1)
+                                      * sizeof (FT_UInt));
   if (!single2_args || !single_args
       || !range2_args || !range_args)
     goto Fail;
@@ -512,11 +647,12 @@ TA_sfnt_build_number_set(SFNT* sfnt,
   }
 
   /* this rough estimate of the buffer size gets adjusted later on */
-  *buf = (FT_Byte*)malloc((2 + 1) * num_singles2
-                          + (1 + 1) * num_singles
-                          + (4 + 1) * num_ranges2
-                          + (2 + 1) * num_ranges
-                          + 10);
+  *buf = (FT_Byte*)ta_mem_alloc(font->memory,
+                                (2 + 1) * num_singles2
+                                + (1 + 1) * num_singles
+                                + (4 + 1) * num_ranges2
+                                + (2 + 1) * num_ranges
+                                + 10);
   if (!*buf)
     goto Fail;
   bufp = *buf;
@@ -544,10 +680,10 @@ TA_sfnt_build_number_set(SFNT* sfnt,
     sfnt->max_stack_elements = num_stack_elements;
 
 Fail:
-  free(single2_args);
-  free(single_args);
-  free(range2_args);
-  free(range_args);
+  ta_mem_free(font->memory, single2_args);
+  ta_mem_free(font->memory, single_args);
+  ta_mem_free(font->memory, range2_args);
+  ta_mem_free(font->memory, range_args);
 
   return bufp;
 }
@@ -598,7 +734,7 @@ TA_table_build_prep(FT_Byte** prep,
 
   if (blue_adjustment && font->x_height_snapping_exceptions)
   {
-    buf_p = TA_sfnt_build_number_set(sfnt, &buf,
+    buf_p = TA_sfnt_build_number_set(sfnt, font, &buf,
                                      font->x_height_snapping_exceptions);
     if (!buf_p)
       return FT_Err_Out_Of_Memory;
@@ -659,10 +795,10 @@ TA_table_build_prep(FT_Byte** prep,
 
   /* buffer length must be a multiple of four */
   len = (buf_new_len + 3) & ~3;
-  buf_new = (FT_Byte*)realloc(buf, len);
+  buf_new = (FT_Byte*)ta_mem_realloc(font->memory, buf, len);
   if (!buf_new)
   {
-    free(buf);
+    ta_mem_free(font->memory, buf);
     return FT_Err_Out_Of_Memory;
   }
   buf = buf_new;
@@ -771,12 +907,14 @@ TA_sfnt_build_prep_table(SFNT* sfnt,
   FT_ULong prep_len;
 
 
-  error = TA_sfnt_add_table_info(sfnt);
+  error = TA_sfnt_add_table_info(sfnt, font);
   if (error)
     goto Exit;
 
-  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel */
-  if (glyf_table->processed)
+  /* `glyf', `cvt', `fpgm', and `prep' are always used in parallel; */
+  /* a previous subfont with the same `glyf' table has already */
+  /* created this table */
+  if (data->prep_idx != MISSING)
   {
     sfnt->table_infos[sfnt->num_table_infos - 1] = data->prep_idx;
     goto Exit;
@@ -800,7 +938,7 @@ TA_sfnt_build_prep_table(SFNT* sfnt,
                             &sfnt->table_infos[sfnt->num_table_infos - 1],
                             TTAG_prep, prep_len, prep_buf);
   if (error)
-    free(prep_buf);
+    ta_mem_free(font->memory, prep_buf);
   else
     data->prep_idx = sfnt->table_infos[sfnt->num_table_infos - 1];
 
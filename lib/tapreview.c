@@ -0,0 +1,175 @@
+/* tapreview.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Incremental hinting for previews.
+ *
+ * A call of `TTF_autohint' with option `preview' doesn't unload the font
+ * at the end but hands it over to a `TA_Preview' object.  Subsequent
+ * calls of `TTF_autohint_preview_update' then use the variant machinery
+ * (see `tavariant.c') to build a new output font: split tables, script
+ * coverage, and the global metrics are kept, while the `cvt ', `fpgm',
+ * and `prep' tables (which are cheap to create) get rebuilt with the new
+ * options.  Only the requested glyphs are hinted again.
+ */
+
+#include <stdlib.h>
+
+#include "ta.h"
+
+
+TA_Preview*
+TTF_autohint_preview_new(void)
+{
+  return (TA_Preview*)calloc(1, sizeof (TA_Preview));
+}
+
+
+void
+TTF_autohint_preview_free(TA_Preview* preview)
+{
+  if (!preview)
+    return;
+
+  TA_preview_release(preview);
+  free(preview);
+}
+
+
+void
+TA_preview_release(TA_Preview* preview)
+{
+  if (!preview->font)
+    return;
+
+  TA_font_unload(preview->font, preview->in_buf, NULL);
+
+  preview->font = NULL;
+  preview->in_buf = NULL;
+  preview->glyph_cache = NULL;
+}
+
+
+/* this gets called after the output font of `TTF_autohint' */
+/* has been handed over to the caller */
+
+void
+TA_preview_keep(TA_Preview* preview,
+                FONT* font,
+                const char* in_buf)
+{
+  /* the statistics refer to the main run only */
+  if (font->memory_stats)
+  {
+    *font->memory_stats = font->memory->stats;
+    font->memory_stats = NULL;
+  }
+
+  font->out_buf = NULL;
+  font->out_len = 0;
+  font->out_file = NULL;
+
+  preview->font = font;
+  preview->in_buf = in_buf;
+  preview->glyph_cache = font->glyph_cache;
+}
+
+
+TA_Error
+TTF_autohint_preview_update(TA_Preview* preview,
+                            TA_Variant* variant,
+                            const char* hint_glyphs,
+                            void* progress_callback_data,
+                            const unsigned char** error_string)
+{
+  FONT* font;
+  number_range* hint_glyphs_new = NULL;
+  FT_Error error;
+
+
+  if (!preview
+      || !preview->font
+      || !variant)
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Exit;
+  }
+
+  font = preview->font;
+
+  if (hint_glyphs)
+  {
+    const char* s = number_set_parse(hint_glyphs,
+                                     &hint_glyphs_new,
+                                     0, 0xFFFE);
+    if (*s)
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Exit;
+    }
+  }
+
+  error = TA_font_setup_variant(font, variant);
+  if (error)
+  {
+    number_set_free(hint_glyphs_new);
+    goto Exit;
+  }
+
+  number_set_free(font->hint_glyphs);
+  font->hint_glyphs = hint_glyphs_new;
+  font->progress_data = progress_callback_data;
+
+  /* the glyphs hinted by the previous run are not necessarily */
+  /* the requested ones, so we always hint again (which is cheap */
+  /* for a few glyphs, and even cheaper with the glyph cache) */
+  if (font->reuse_glyph_hints)
+  {
+    TA_font_drop_glyph_hints(font);
+    font->reuse_glyph_hints = 0;
+  }
+  font->glyph_cache = preview->glyph_cache;
+
+  error = TA_font_build_tables(font);
+  if (!error)
+    error = TA_font_build_output(font);
+  if (error)
+  {
+    free(font->out_buf);
+    font->out_buf = NULL;
+    font->out_len = 0;
+
+    /* a canceled run can be simply repeated; */
+    /* after other errors, the state is unusable */
+    if (error != TA_Err_Canceled)
+      TA_preview_release(preview);
+
+    goto Exit;
+  }
+
+  variant->out_buffer = (char*)font->out_buf;
+  variant->out_buffer_len = font->out_len;
+
+  font->out_buf = NULL;
+  font->out_len = 0;
+
+Exit:
+  if (error_string)
+    *error_string = (const unsigned char*)TA_get_error_message(error);
+
+  return error;
+}
+
+/* end of tapreview.c */
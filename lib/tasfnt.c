@@ -32,8 +32,9 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
   if (error)
     return error;
 
-  sfnt->table_infos = (SFNT_Table_Info*)malloc(sfnt->num_table_infos
-                                               * sizeof (SFNT_Table_Info));
+  sfnt->table_infos = (SFNT_Table_Info*)ta_mem_alloc(
+                        font->memory,
+                        sfnt->num_table_infos * sizeof (SFNT_Table_Info));
   if (!sfnt->table_infos)
     return FT_Err_Out_Of_Memory;
 
@@ -91,9 +92,23 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
       continue;
     }
 
+    /* in streaming mode, the glyph records get read one by one */
+    /* while hinting (see `TA_sfnt_stream_glyf_table'); */
+    /* since there is only a single subfont, no other `glyf' table exists */
+    else if (tag == TTAG_glyf
+             && font->streaming)
+    {
+      sfnt->glyf_idx = font->num_tables;
+
+      error = TA_font_add_table(font, table_info, tag, len, NULL);
+      if (error)
+        return error;
+      continue;
+    }
+
     /* make the allocated buffer length a multiple of 4 */
     buf_len = (len + 3) & ~3;
-    buf = (FT_Byte*)malloc(buf_len);
+    buf = (FT_Byte*)ta_mem_alloc(font->memory, buf_len);
     if (!buf)
       return FT_Err_Out_Of_Memory;
 
@@ -155,13 +170,13 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
     else
     {
       /* reuse existing SFNT table */
-      free(buf);
+      ta_mem_free(font->memory, buf);
       *table_info = j;
     }
     continue;
 
   Err:
-    free(buf);
+    ta_mem_free(font->memory, buf);
     return error;
   }
 
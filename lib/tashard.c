@@ -0,0 +1,420 @@
+/* tashard.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * In shard mode, only the glyphs in the range given by `shard-first' and
+ * `shard-last' get hinted, and instead of a font we output a `shard' which
+ * holds the glyphs' bytecode.  Another run in merge mode then takes the
+ * (concatenated) shards to assemble the complete font.  All global tables
+ * (`cvt', `fpgm', and `prep') get computed in every run; we store their
+ * checksums to make sure that all shards are compatible.
+ *
+ * All values are stored in big-endian byte order.
+ *
+ *   shard header:
+ *
+ *     4 bytes   tag `TASH'
+ *     2 bytes   version (currently 1)
+ *     2 bytes   number of subfonts
+ *     4 bytes   length of the shard (including this header)
+ *
+ *   then for each subfont:
+ *
+ *     4 bytes   checksum of `cvt' table
+ *     4 bytes   checksum of `fpgm' table
+ *     4 bytes   checksum of `prep' table
+ *     2 bytes   maximum storage
+ *     2 bytes   maximum stack elements
+ *     2 bytes   maximum twilight points
+ *     2 bytes   number of glyphs
+ *     2 bytes   first glyph index
+ *     2 bytes   last glyph index (exclusive)
+ *
+ *     then for each glyph in the range:
+ *
+ *       2 bytes   length of the glyph's bytecode
+ *       n bytes   bytecode
+ *
+ * If subfonts share a `glyf' table, only the first one of them contains
+ * glyph data.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+
+#define SHARD_VERSION 1
+
+#define SHARD_HEADER_LEN 12
+#define SHARD_SFNT_HEADER_LEN 24
+
+
+static FT_ULong
+TA_get_ulong(const FT_Byte* p)
+{
+  return ((FT_ULong)p[0] << 24)
+         | ((FT_ULong)p[1] << 16)
+         | ((FT_ULong)p[2] << 8)
+         | p[3];
+}
+
+
+static FT_UShort
+TA_get_ushort(const FT_Byte* p)
+{
+  return (FT_UShort)((p[0] << 8) | p[1]);
+}
+
+
+static FT_ULong
+TA_font_get_checksum(FONT* font,
+                     FT_ULong idx)
+{
+  SFNT_Table* table;
+
+
+  if (idx == MISSING)
+    return 0;
+
+  table = &font->tables[idx];
+
+  /* `FT_ULong' might be larger than 32bit */
+  return TA_table_compute_checksum(table->buf, table->len) & 0xFFFFFFFFUL;
+}
+
+
+/* return 1 if `sfnt' is the first subfont which uses its `glyf' table */
+
+static FT_Bool
+TA_sfnt_owns_glyf(SFNT* sfnt,
+                  FONT* font)
+{
+  SFNT* s;
+
+
+  for (s = font->sfnts; s < sfnt; s++)
+    if (s->glyf_idx == sfnt->glyf_idx)
+      return 0;
+
+  return 1;
+}
+
+
+/* in case of success, `font->out_buf' holds the shard */
+
+FT_Error
+TA_font_build_shard(FONT* font)
+{
+  FT_ULong len;
+  FT_Byte* buf;
+  FT_Byte* p;
+  FT_Long i;
+
+
+  /* compute length */
+  len = SHARD_HEADER_LEN;
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+    FT_Long num_glyphs = sfnt->face->num_glyphs;
+    FT_Long idx;
+
+
+    len += SHARD_SFNT_HEADER_LEN;
+
+    if (!TA_sfnt_owns_glyf(sfnt, font))
+      continue;
+
+    for (idx = font->shard_first;
+         idx < (FT_Long)font->shard_last && idx < num_glyphs;
+         idx++)
+      len += 2 + data->glyphs[idx].ins_len;
+  }
+
+  buf = (FT_Byte*)malloc(len);
+  if (!buf)
+    return FT_Err_Out_Of_Memory;
+
+  p = buf;
+
+  *(p++) = 'T';
+  *(p++) = 'A';
+  *(p++) = 'S';
+  *(p++) = 'H';
+  *(p++) = HIGH(SHARD_VERSION);
+  *(p++) = LOW(SHARD_VERSION);
+  *(p++) = HIGH(font->num_sfnts);
+  *(p++) = LOW(font->num_sfnts);
+  *(p++) = BYTE1(len);
+  *(p++) = BYTE2(len);
+  *(p++) = BYTE3(len);
+  *(p++) = BYTE4(len);
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+    FT_Long num_glyphs = sfnt->face->num_glyphs;
+    FT_ULong checksum;
+    FT_Long first, last;
+    FT_Long idx;
+
+
+    checksum = TA_font_get_checksum(font, data->cvt_idx);
+    *(p++) = BYTE1(checksum);
+    *(p++) = BYTE2(checksum);
+    *(p++) = BYTE3(checksum);
+    *(p++) = BYTE4(checksum);
+    checksum = TA_font_get_checksum(font, data->fpgm_idx);
+    *(p++) = BYTE1(checksum);
+    *(p++) = BYTE2(checksum);
+    *(p++) = BYTE3(checksum);
+    *(p++) = BYTE4(checksum);
+    checksum = TA_font_get_checksum(font, data->prep_idx);
+    *(p++) = BYTE1(checksum);
+    *(p++) = BYTE2(checksum);
+    *(p++) = BYTE3(checksum);
+    *(p++) = BYTE4(checksum);
+
+    *(p++) = HIGH(sfnt->max_storage);
+    *(p++) = LOW(sfnt->max_storage);
+    *(p++) = HIGH(sfnt->max_stack_elements);
+    *(p++) = LOW(sfnt->max_stack_elements);
+    *(p++) = HIGH(sfnt->max_twilight_points);
+    *(p++) = LOW(sfnt->max_twilight_points);
+
+    if (TA_sfnt_owns_glyf(sfnt, font))
+    {
+      last = (FT_Long)font->shard_last < num_glyphs ? (FT_Long)font->shard_last
+                                                    : num_glyphs;
+      first = (FT_Long)font->shard_first < last ? (FT_Long)font->shard_first
+                                                : last;
+    }
+    else
+    {
+      first = 0;
+      last = 0;
+    }
+
+    *(p++) = HIGH(num_glyphs);
+    *(p++) = LOW(num_glyphs);
+    *(p++) = HIGH(first);
+    *(p++) = LOW(first);
+    *(p++) = HIGH(last);
+    *(p++) = LOW(last);
+
+    for (idx = first; idx < last; idx++)
+    {
+      GLYPH* glyph = &data->glyphs[idx];
+
+
+      *(p++) = HIGH(glyph->ins_len);
+      *(p++) = LOW(glyph->ins_len);
+      if (glyph->ins_len)
+        memcpy(p, glyph->ins_buf, glyph->ins_len);
+      p += glyph->ins_len;
+    }
+  }
+
+  font->out_buf = buf;
+  font->out_len = len;
+
+  return TA_Err_Ok;
+}
+
+
+/* fill the glyph instructions of `sfnt' with the shards' data */
+
+FT_Error
+TA_sfnt_merge_shards(SFNT* sfnt,
+                     FONT* font)
+{
+  glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+  FT_Long num_glyphs = sfnt->face->num_glyphs;
+  FT_Long sfnt_idx = sfnt - font->sfnts;
+
+  FT_ULong cvt_checksum;
+  FT_ULong fpgm_checksum;
+  FT_ULong prep_checksum;
+
+  const FT_Byte* shard;
+  const FT_Byte* shard_end;
+  FT_Byte* covered;
+  FT_Long idx;
+  FT_Error error;
+
+
+  cvt_checksum = TA_font_get_checksum(font, data->cvt_idx);
+  fpgm_checksum = TA_font_get_checksum(font, data->fpgm_idx);
+  prep_checksum = TA_font_get_checksum(font, data->prep_idx);
+
+  /* we have to check that every glyph is covered exactly once */
+  covered = (FT_Byte*)ta_mem_calloc(font->memory, 1, (size_t)num_glyphs);
+  if (!covered)
+    return FT_Err_Out_Of_Memory;
+
+  shard = font->shard_buf;
+  shard_end = font->shard_buf + font->shard_len;
+
+  while (shard < shard_end)
+  {
+    const FT_Byte* p;
+    const FT_Byte* endp;
+    FT_ULong len;
+    FT_Long first, last;
+    FT_UShort max_storage;
+    FT_UShort max_stack_elements;
+    FT_UShort max_twilight_points;
+    FT_Long i;
+
+
+    if (shard_end - shard < SHARD_HEADER_LEN
+        || memcmp(shard, "TASH", 4)
+        || TA_get_ushort(shard + 4) != SHARD_VERSION
+        || TA_get_ushort(shard + 6) != font->num_sfnts)
+    {
+      error = TA_Err_Invalid_Shard_Data;
+      goto Err;
+    }
+
+    len = TA_get_ulong(shard + 8);
+    if (len < SHARD_HEADER_LEN
+               + (FT_ULong)font->num_sfnts * SHARD_SFNT_HEADER_LEN
+        || len > (FT_ULong)(shard_end - shard))
+    {
+      error = TA_Err_Invalid_Shard_Data;
+      goto Err;
+    }
+
+    p = shard + SHARD_HEADER_LEN;
+    endp = shard + len;
+
+    /* skip preceding subfonts */
+    for (i = 0; i < sfnt_idx; i++)
+    {
+      FT_Long n;
+
+
+      n = TA_get_ushort(p + 22) - TA_get_ushort(p + 20);
+      p += SHARD_SFNT_HEADER_LEN;
+
+      for (; n > 0; n--)
+      {
+        if (p + 2 > endp)
+        {
+          error = TA_Err_Invalid_Shard_Data;
+          goto Err;
+        }
+        p += 2 + TA_get_ushort(p);
+      }
+
+      if (p + SHARD_SFNT_HEADER_LEN > endp)
+      {
+        error = TA_Err_Invalid_Shard_Data;
+        goto Err;
+      }
+    }
+
+    /* all shards must be created with identical global tables */
+    if (TA_get_ulong(p) != cvt_checksum
+        || TA_get_ulong(p + 4) != fpgm_checksum
+        || TA_get_ulong(p + 8) != prep_checksum
+        || TA_get_ushort(p + 18) != num_glyphs)
+    {
+      error = TA_Err_Invalid_Shard_Data;
+      goto Err;
+    }
+
+    max_storage = TA_get_ushort(p + 12);
+    max_stack_elements = TA_get_ushort(p + 14);
+    max_twilight_points = TA_get_ushort(p + 16);
+    first = TA_get_ushort(p + 20);
+    last = TA_get_ushort(p + 22);
+    p += SHARD_SFNT_HEADER_LEN;
+
+    if (first > last || last > num_glyphs)
+    {
+      error = TA_Err_Invalid_Shard_Data;
+      goto Err;
+    }
+
+    if (max_storage > sfnt->max_storage)
+      sfnt->max_storage = max_storage;
+    if (max_stack_elements > sfnt->max_stack_elements)
+      sfnt->max_stack_elements = max_stack_elements;
+    if (max_twilight_points > sfnt->max_twilight_points)
+      sfnt->max_twilight_points = max_twilight_points;
+
+    for (idx = first; idx < last; idx++)
+    {
+      GLYPH* glyph = &data->glyphs[idx];
+      FT_UShort ins_len;
+
+
+      if (p + 2 > endp || covered[idx])
+      {
+        error = TA_Err_Invalid_Shard_Data;
+        goto Err;
+      }
+
+      ins_len = TA_get_ushort(p);
+      p += 2;
+      if (p + ins_len > endp)
+      {
+        error = TA_Err_Invalid_Shard_Data;
+        goto Err;
+      }
+
+      if (ins_len)
+      {
+        glyph->ins_buf = (FT_Byte*)ta_mem_alloc(font->memory, ins_len);
+        if (!glyph->ins_buf)
+        {
+          error = FT_Err_Out_Of_Memory;
+          goto Err;
+        }
+        memcpy(glyph->ins_buf, p, ins_len);
+      }
+      glyph->ins_len = ins_len;
+      p += ins_len;
+
+      if (ins_len > sfnt->max_instructions)
+        sfnt->max_instructions = ins_len;
+
+      covered[idx] = 1;
+    }
+
+    shard += len;
+  }
+
+  for (idx = 0; idx < num_glyphs; idx++)
+    if (!covered[idx])
+    {
+      error = TA_Err_Missing_Shard_Data;
+      goto Err;
+    }
+
+  error = TA_Err_Ok;
+
+Err:
+  ta_mem_free(font->memory, covered);
+
+  return error;
+}
+
+/* end of tashard.c */
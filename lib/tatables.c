@@ -19,15 +19,18 @@
 
 
 FT_Error
-TA_sfnt_add_table_info(SFNT* sfnt)
+TA_sfnt_add_table_info(SFNT* sfnt,
+                       FONT* font)
 {
   SFNT_Table_Info* table_infos_new;
 
 
   sfnt->num_table_infos++;
   table_infos_new =
-    (SFNT_Table_Info*)realloc(sfnt->table_infos, sfnt->num_table_infos
-                                                 * sizeof (SFNT_Table_Info));
+    (SFNT_Table_Info*)ta_mem_realloc(font->memory,
+                                     sfnt->table_infos,
+                                     sfnt->num_table_infos
+                                     * sizeof (SFNT_Table_Info));
   if (!table_infos_new)
   {
     sfnt->num_table_infos--;
@@ -76,8 +79,10 @@ TA_font_add_table(FONT* font,
 
 
   font->num_tables++;
-  tables_new = (SFNT_Table*)realloc(font->tables,
-                                    font->num_tables * sizeof (SFNT_Table));
+  tables_new = (SFNT_Table*)ta_mem_realloc(font->memory,
+                                           font->tables,
+                                           font->num_tables
+                                           * sizeof (SFNT_Table));
   if (!tables_new)
   {
     font->num_tables--;
@@ -91,7 +96,8 @@ TA_font_add_table(FONT* font,
   table_last->tag = tag;
   table_last->len = len;
   table_last->buf = buf;
-  table_last->checksum = TA_table_compute_checksum(buf, len);
+  /* in streaming mode, the `glyf' table doesn't have a buffer */
+  table_last->checksum = buf ? TA_table_compute_checksum(buf, len) : 0;
   table_last->offset = 0; /* set in `TA_font_compute_table_offsets' */
   table_last->data = NULL;
   table_last->processed = 0;
@@ -20,7 +20,8 @@
 
 
 FT_Error
-TA_sfnt_add_table_info(SFNT* sfnt);
+TA_sfnt_add_table_info(SFNT* sfnt,
+                       FONT* font);
 
 FT_ULong
 TA_table_compute_checksum(FT_Byte* buf,
@@ -0,0 +1,598 @@
+/* tathread.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Hinting the `glyf' tables of a TrueType collection in parallel, and
+ * loading pre-hinted glyphs in parallel.
+ *
+ * While hinting glyphs, subfonts with different `glyf' tables are
+ * completely independent of each other.  Each worker thread takes the
+ * next subfont with a `glyf' table not hinted yet and processes it, using
+ * a private copy of the `FONT' structure with its own glyph loader; each
+ * subfont already has its own FreeType face.  Subfonts which share a
+ * `glyf' table with a previous subfont are not scheduled at all; they
+ * simply use the bytecode created for the previous one.
+ *
+ * Before the workers start, all other tables created while hinting
+ * (`gasp', `cvt ', `fpgm', and `prep') have been built, thus the table
+ * array doesn't change while the workers are running.  Memory management
+ * and the callbacks get serialized.
+ *
+ * For pre-hinting, the workers take chunks of consecutive glyphs and
+ * execute the original bytecode.  FreeType faces can't be shared between
+ * threads, and older FreeType versions even share the bytecode
+ * interpreter's execution context between all faces of a library, so
+ * each additional worker gets its own library and face, created in
+ * advance by the main thread.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_MODULE_H
+
+#include "ta.h"
+
+
+static FT_Error
+TA_sfnt_hint_glyf_table(SFNT* sfnt,
+                        FONT* font)
+{
+  FT_Error error;
+
+
+  /* a subfont with the same `glyf' table has been already handled */
+  if (font->tables[sfnt->glyf_idx].processed)
+    return TA_Err_Ok;
+
+  error = ta_loader_init(font);
+  if (error)
+    return error;
+
+  /* the new glyph loader must be in the same state */
+  /* as after creating the `cvt ' table */
+  error = TA_sfnt_compute_global_hints(sfnt, font);
+  if (!error)
+    error = TA_sfnt_build_glyf_table(sfnt, font);
+
+  ta_loader_done(font);
+
+  return error;
+}
+
+
+#ifdef HAVE_PTHREAD
+
+typedef struct Scheduler_
+{
+  FONT* font;
+
+  /* this lock protects the fields below and the user callbacks */
+  pthread_mutex_t lock;
+
+  FT_Long* jobs; /* subfont indices */
+  FT_Long num_jobs;
+  FT_Long next_job;
+
+  FT_Error error; /* the first error reported by a worker */
+} Scheduler;
+
+
+typedef struct Worker_
+{
+  Scheduler* scheduler;
+  pthread_t thread;
+
+  FONT font; /* a copy with its own glyph loader and callbacks */
+} Worker;
+
+
+static int
+TA_worker_progress(long curr_idx,
+                   long num_glyphs,
+                   long curr_sfnt,
+                   long num_sfnts,
+                   void* progress_data)
+{
+  Worker* worker = (Worker*)progress_data;
+  Scheduler* scheduler = worker->scheduler;
+  FONT* font = scheduler->font;
+  int ret = 0;
+
+
+  pthread_mutex_lock(&scheduler->lock);
+
+  /* stop early if another worker has failed */
+  if (scheduler->error)
+    ret = 1;
+  else if (font->progress)
+    ret = font->progress(curr_idx, num_glyphs,
+                         curr_sfnt, num_sfnts,
+                         font->progress_data);
+
+  pthread_mutex_unlock(&scheduler->lock);
+
+  return ret;
+}
+
+
+static void
+TA_worker_limit(long glyph_idx,
+                long curr_sfnt,
+                int limit,
+                void* limit_data)
+{
+  Worker* worker = (Worker*)limit_data;
+  Scheduler* scheduler = worker->scheduler;
+  FONT* font = scheduler->font;
+
+
+  pthread_mutex_lock(&scheduler->lock);
+  font->limit(glyph_idx, curr_sfnt, limit, font->limit_data);
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+
+static void
+TA_worker_bound(long glyph_idx,
+                long curr_sfnt,
+                int bound,
+                void* bound_data)
+{
+  Worker* worker = (Worker*)bound_data;
+  Scheduler* scheduler = worker->scheduler;
+  FONT* font = scheduler->font;
+
+
+  pthread_mutex_lock(&scheduler->lock);
+  font->bound(glyph_idx, curr_sfnt, bound, font->bound_data);
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+
+static void
+TA_worker_budget(long glyph_idx,
+                 long curr_sfnt,
+                 long old_len,
+                 long new_len,
+                 int deviation,
+                 void* budget_data)
+{
+  Worker* worker = (Worker*)budget_data;
+  Scheduler* scheduler = worker->scheduler;
+  FONT* font = scheduler->font;
+
+
+  pthread_mutex_lock(&scheduler->lock);
+  font->budget(glyph_idx, curr_sfnt, old_len, new_len, deviation,
+               font->budget_data);
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+
+static void*
+TA_worker_run(void* arg)
+{
+  Worker* worker = (Worker*)arg;
+  Scheduler* scheduler = worker->scheduler;
+  FONT* font = &worker->font;
+
+
+  for (;;)
+  {
+    FT_Long idx = -1;
+    FT_Error error;
+
+
+    pthread_mutex_lock(&scheduler->lock);
+    if (!scheduler->error
+        && scheduler->next_job < scheduler->num_jobs)
+      idx = scheduler->jobs[scheduler->next_job++];
+    pthread_mutex_unlock(&scheduler->lock);
+
+    if (idx < 0)
+      break;
+
+    error = TA_sfnt_hint_glyf_table(&font->sfnts[idx], font);
+    if (error)
+    {
+      pthread_mutex_lock(&scheduler->lock);
+      if (!scheduler->error)
+        scheduler->error = error;
+      pthread_mutex_unlock(&scheduler->lock);
+    }
+  }
+
+  return NULL;
+}
+
+
+/* return -1 if threads can't be used */
+
+static FT_Error
+TA_font_build_glyf_tables_parallel(FONT* font)
+{
+  Scheduler scheduler;
+  Worker* workers = NULL;
+  FT_UInt num_workers;
+  FT_UInt num_threads;
+
+  FT_Long i, j;
+  FT_UInt k;
+  FT_Error error;
+
+
+  memset(&scheduler, 0, sizeof (Scheduler));
+  scheduler.font = font;
+
+  scheduler.jobs = (FT_Long*)ta_mem_alloc(font->memory,
+                                          font->num_sfnts * sizeof (FT_Long));
+  if (!scheduler.jobs)
+    return FT_Err_Out_Of_Memory;
+
+  /* collect the subfonts which own a `glyf' table */
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    if (font->tables[sfnt->glyf_idx].processed)
+      continue;
+
+    for (j = 0; j < i; j++)
+      if (font->sfnts[j].glyf_idx == sfnt->glyf_idx)
+        break;
+    if (j < i)
+      continue;
+
+    scheduler.jobs[scheduler.num_jobs++] = i;
+  }
+
+  num_workers = font->threads;
+  if ((FT_Long)num_workers > scheduler.num_jobs)
+    num_workers = (FT_UInt)scheduler.num_jobs;
+  if (num_workers < 2)
+  {
+    error = -1;
+    goto Exit;
+  }
+
+  workers = (Worker*)ta_mem_calloc(font->memory,
+                                   num_workers, sizeof (Worker));
+  if (!workers)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  if (pthread_mutex_init(&scheduler.lock, NULL))
+  {
+    error = -1;
+    goto Exit;
+  }
+  if (!ta_memory_enable_lock(font->memory))
+  {
+    pthread_mutex_destroy(&scheduler.lock);
+    error = -1;
+    goto Exit;
+  }
+
+  for (k = 0; k < num_workers; k++)
+  {
+    Worker* worker = &workers[k];
+
+
+    worker->scheduler = &scheduler;
+
+    /* the `memory' field still points to the original memory object */
+    worker->font = *font;
+    worker->font.num_duplicate_glyphs = 0;
+    worker->font.num_cached_glyphs = 0;
+    worker->font.progress = TA_worker_progress;
+    worker->font.progress_data = worker;
+    if (font->limit)
+    {
+      worker->font.limit = TA_worker_limit;
+      worker->font.limit_data = worker;
+    }
+    if (font->bound)
+    {
+      worker->font.bound = TA_worker_bound;
+      worker->font.bound_data = worker;
+    }
+    if (font->budget)
+    {
+      worker->font.budget = TA_worker_budget;
+      worker->font.budget_data = worker;
+    }
+  }
+
+  /* the current thread acts as the first worker; */
+  /* if we can't create more threads, it simply has more to do */
+  num_threads = 1;
+  for (k = 1; k < num_workers; k++)
+  {
+    if (pthread_create(&workers[k].thread, NULL,
+                       TA_worker_run, &workers[k]))
+      break;
+    num_threads++;
+  }
+
+  TA_worker_run(&workers[0]);
+
+  for (k = 1; k < num_threads; k++)
+    pthread_join(workers[k].thread, NULL);
+
+  ta_memory_disable_lock(font->memory);
+  pthread_mutex_destroy(&scheduler.lock);
+
+  for (k = 0; k < num_workers; k++)
+  {
+    font->num_duplicate_glyphs += workers[k].font.num_duplicate_glyphs;
+    font->num_cached_glyphs += workers[k].font.num_cached_glyphs;
+  }
+
+  error = scheduler.error;
+
+Exit:
+  ta_mem_free(font->memory, workers);
+  ta_mem_free(font->memory, scheduler.jobs);
+
+  return error;
+}
+
+
+/* the number of glyphs a pre-hinting worker takes at once */
+#define TA_PRE_HINT_CHUNK 32
+
+
+typedef struct Pre_Hint_Scheduler_
+{
+  FONT* font;
+  SFNT* sfnt;
+
+  /* this lock protects the fields below */
+  pthread_mutex_t lock;
+
+  FT_Long next_glyph;
+  FT_Long num_glyphs;
+
+  FT_Error error; /* the first error reported by a worker */
+} Pre_Hint_Scheduler;
+
+
+typedef struct Pre_Hint_Worker_
+{
+  Pre_Hint_Scheduler* scheduler;
+  pthread_t thread;
+
+  FT_Library lib; /* NULL for the first worker */
+  FT_Face face;
+} Pre_Hint_Worker;
+
+
+static void*
+TA_pre_hint_worker_run(void* arg)
+{
+  Pre_Hint_Worker* worker = (Pre_Hint_Worker*)arg;
+  Pre_Hint_Scheduler* scheduler = worker->scheduler;
+
+
+  for (;;)
+  {
+    FT_Long first = -1;
+    FT_Long last = 0;
+    FT_Error error;
+
+
+    pthread_mutex_lock(&scheduler->lock);
+    if (!scheduler->error
+        && scheduler->next_glyph < scheduler->num_glyphs)
+    {
+      first = scheduler->next_glyph;
+      last = first + TA_PRE_HINT_CHUNK;
+      if (last > scheduler->num_glyphs)
+        last = scheduler->num_glyphs;
+      scheduler->next_glyph = last;
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+
+    if (first < 0)
+      break;
+
+    error = TA_sfnt_pre_hint_glyphs(scheduler->sfnt, scheduler->font,
+                                    worker->face, first, last);
+    if (error)
+    {
+      pthread_mutex_lock(&scheduler->lock);
+      if (!scheduler->error)
+        scheduler->error = error;
+      pthread_mutex_unlock(&scheduler->lock);
+    }
+  }
+
+  return NULL;
+}
+
+
+/* return -1 if threads can't be used */
+
+static FT_Error
+TA_sfnt_pre_hint_glyf_data_parallel(SFNT* sfnt,
+                                    FONT* font)
+{
+  Pre_Hint_Scheduler scheduler;
+  Pre_Hint_Worker* workers;
+  FT_UInt num_workers;
+  FT_UInt num_threads;
+
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+
+  FT_UInt k;
+  FT_Error error;
+
+
+  num_workers = font->threads;
+  if ((FT_Long)num_workers
+        > (data->num_glyphs + TA_PRE_HINT_CHUNK - 1) / TA_PRE_HINT_CHUNK)
+    num_workers = (FT_UInt)((data->num_glyphs + TA_PRE_HINT_CHUNK - 1)
+                            / TA_PRE_HINT_CHUNK);
+  if (num_workers < 2)
+    return -1;
+
+  memset(&scheduler, 0, sizeof (Pre_Hint_Scheduler));
+  scheduler.font = font;
+  scheduler.sfnt = sfnt;
+  scheduler.num_glyphs = data->num_glyphs;
+
+  workers = (Pre_Hint_Worker*)ta_mem_calloc(font->memory,
+                                            num_workers,
+                                            sizeof (Pre_Hint_Worker));
+  if (!workers)
+    return FT_Err_Out_Of_Memory;
+
+  /* the first worker uses the subfont's face */
+  workers[0].scheduler = &scheduler;
+  workers[0].face = sfnt->face;
+
+  error = TA_font_set_pre_hinting_size(font, sfnt->face);
+  if (error)
+    goto Exit;
+
+  /* the other workers get their own library and face; */
+  /* if we can't create them, we simply have fewer workers */
+  for (k = 1; k < num_workers; k++)
+  {
+    Pre_Hint_Worker* worker = &workers[k];
+
+
+    worker->scheduler = &scheduler;
+
+    if (TA_font_new_library(font, &worker->lib))
+      break;
+
+    if (FT_New_Memory_Face(worker->lib, font->in_buf, font->in_len,
+                           sfnt - font->sfnts, &worker->face)
+        || TA_font_set_pre_hinting_size(font, worker->face))
+    {
+      FT_Done_Library(worker->lib);
+      worker->lib = NULL;
+      break;
+    }
+  }
+  num_workers = k;
+
+  if (pthread_mutex_init(&scheduler.lock, NULL))
+  {
+    error = -1;
+    goto Exit;
+  }
+  if (!ta_memory_enable_lock(font->memory))
+  {
+    pthread_mutex_destroy(&scheduler.lock);
+    error = -1;
+    goto Exit;
+  }
+
+  num_threads = 1;
+  for (k = 1; k < num_workers; k++)
+  {
+    if (pthread_create(&workers[k].thread, NULL,
+                       TA_pre_hint_worker_run, &workers[k]))
+      break;
+    num_threads++;
+  }
+
+  TA_pre_hint_worker_run(&workers[0]);
+
+  for (k = 1; k < num_threads; k++)
+    pthread_join(workers[k].thread, NULL);
+
+  ta_memory_disable_lock(font->memory);
+  pthread_mutex_destroy(&scheduler.lock);
+
+  error = scheduler.error;
+
+Exit:
+  /* this also discards the faces */
+  for (k = 1; k < num_workers; k++)
+    FT_Done_Library(workers[k].lib);
+  ta_mem_free(font->memory, workers);
+
+  return error;
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+FT_Error
+TA_sfnt_pre_hint_glyf_data(SFNT* sfnt,
+                           FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  FT_Error error;
+
+
+#ifdef HAVE_PTHREAD
+  if (font->threads > 1)
+  {
+    error = TA_sfnt_pre_hint_glyf_data_parallel(sfnt, font);
+    if (error != -1)
+      return error;
+  }
+#endif
+
+  error = TA_font_set_pre_hinting_size(font, sfnt->face);
+  if (error)
+    return error;
+
+  return TA_sfnt_pre_hint_glyphs(sfnt, font, sfnt->face,
+                                 0, data->num_glyphs);
+}
+
+
+FT_Error
+TA_font_build_glyf_tables(FONT* font)
+{
+  FT_Long i;
+  FT_Error error;
+
+
+#ifdef HAVE_PTHREAD
+  /* the debugging code uses global variables */
+  if (font->threads > 1
+      && font->num_sfnts > 1
+      && !font->debug)
+  {
+    error = TA_font_build_glyf_tables_parallel(font);
+    if (error != -1)
+      return error;
+  }
+#endif
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    error = TA_sfnt_hint_glyf_table(&font->sfnts[i], font);
+    if (error)
+      return error;
+  }
+
+  return TA_Err_Ok;
+}
+
+/* end of tathread.c */
@@ -13,10 +13,13 @@
  */
 
 
+#include <stdlib.h>
 #include <time.h>
 
 #include "ta.h"
 
+#include "gethrxtime.h"
+
 /* we need an unsigned 64bit data type */
 
 /* make `stdint.h' define `uintXX_t' for C++ */
@@ -34,18 +37,59 @@ typedef uint64_t TA_ULongLong;
 #endif
 
 
+/* there have been 24107 days between January 1st, 1904 (the epoch of */
+/* OpenType), and January 1st, 1970 (the epoch of the `time' function) */
+#define SECONDS_TO_1970 ((TA_ULongLong)24107 * 24 * 60 * 60)
+
+
 void
 TA_get_current_time(FT_ULong* high,
                     FT_ULong* low)
 {
-  /* there have been 24107 days between January 1st, 1904 (the epoch of */
-  /* OpenType), and January 1st, 1970 (the epoch of the `time' function) */
-  TA_ULongLong seconds_to_1970 = 24107 * 24 * 60 * 60;
-  TA_ULongLong seconds_to_today = seconds_to_1970 + time(NULL);
+  TA_ULongLong seconds_to_today = SECONDS_TO_1970 + time(NULL);
 
 
   *high = (FT_ULong)(seconds_to_today >> 32);
   *low = (FT_ULong)seconds_to_today;
 }
 
+
+/* get the time stamp given by the `SOURCE_DATE_EPOCH' environment */
+/* variable (as defined by the reproducible builds project); */
+/* return value 0 if the variable is not set or invalid */
+
+FT_Bool
+TA_get_source_date_epoch(FT_ULong* high,
+                         FT_ULong* low)
+{
+  const char* s = getenv("SOURCE_DATE_EPOCH");
+  char* endp;
+  TA_ULongLong seconds;
+
+
+  if (!s || *s < '0' || *s > '9')
+    return 0;
+
+  seconds = strtoul(s, &endp, 10);
+  if (*endp)
+    return 0;
+
+  seconds += SECONDS_TO_1970;
+
+  *high = (FT_ULong)(seconds >> 32);
+  *low = (FT_ULong)seconds;
+
+  return 1;
+}
+
+
+/* return a monotonic time stamp in milliseconds; */
+/* only differences between two values are meaningful */
+
+FT_ULong
+TA_get_milliseconds(void)
+{
+  return (FT_ULong)(gethrxtime() / 1000000);
+}
+
 /* end of tatime.c */
@@ -38,7 +38,7 @@ TA_font_build_TTC_header(FONT* font,
 
 
   len = (font->have_DSIG ? 24 : 12) + 4 * num_sfnts;
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -145,7 +145,7 @@ TA_font_build_TTC(FONT* font)
 
   if (font->have_DSIG)
   {
-    error = TA_table_build_DSIG(&DSIG_buf);
+    error = TA_table_build_DSIG(&DSIG_buf, font);
     if (error)
       return error;
 
@@ -154,7 +154,7 @@ TA_font_build_TTC(FONT* font)
     error = TA_font_add_table(font, &dummy, TTAG_DSIG, DSIG_LEN, DSIG_buf);
     if (error)
     {
-      free(DSIG_buf);
+      ta_mem_free(font->memory, DSIG_buf);
       return error;
     }
   }
@@ -165,11 +165,13 @@ TA_font_build_TTC(FONT* font)
   if (error)
     return error;
 
-  TTF_header_bufs = (FT_Byte**)calloc(1, num_sfnts * sizeof (FT_Byte*));
+  TTF_header_bufs = (FT_Byte**)ta_mem_calloc(font->memory,
+                                             num_sfnts, sizeof (FT_Byte*));
   if (!TTF_header_bufs)
     goto Err;
 
-  TTF_header_lens = (FT_ULong*)malloc(num_sfnts * sizeof (FT_ULong));
+  TTF_header_lens = (FT_ULong*)ta_mem_alloc(font->memory,
+                                            num_sfnts * sizeof (FT_ULong));
   if (!TTF_header_lens)
     goto Err;
 
@@ -222,14 +224,14 @@ TA_font_build_TTC(FONT* font)
   error = TA_Err_Ok;
 
 Err:
-  free(TTC_header_buf);
+  ta_mem_free(font->memory, TTC_header_buf);
   if (TTF_header_bufs)
   {
     for (i = 0; i < font->num_sfnts; i++)
-      free(TTF_header_bufs[i]);
-    free(TTF_header_bufs);
+      ta_mem_free(font->memory, TTF_header_bufs[i]);
+    ta_mem_free(font->memory, TTF_header_bufs);
   }
-  free(TTF_header_lens);
+  ta_mem_free(font->memory, TTF_header_lens);
 
   return error;
 }
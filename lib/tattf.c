@@ -56,7 +56,7 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
     *header_len = len;
     return TA_Err_Ok;
   }
-  buf = (FT_Byte*)malloc(len);
+  buf = (FT_Byte*)ta_mem_alloc(font->memory, len);
   if (!buf)
     return FT_Err_Out_Of_Memory;
 
@@ -113,6 +113,7 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
     {
       FT_ULong date_high;
       FT_ULong date_low;
+      FT_Bool update_time;
 
 
       /* we always reach this IF clause since FreeType would */
@@ -126,18 +127,29 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
       head_buf[10] = 0x00;
       head_buf[11] = 0x00;
 
-      /* update modification time */
-      TA_get_current_time(&date_high, &date_low);
-
-      head_buf[28] = BYTE1(date_high);
-      head_buf[29] = BYTE2(date_high);
-      head_buf[30] = BYTE3(date_high);
-      head_buf[31] = BYTE4(date_high);
-
-      head_buf[32] = BYTE1(date_low);
-      head_buf[33] = BYTE2(date_low);
-      head_buf[34] = BYTE3(date_low);
-      head_buf[35] = BYTE4(date_low);
+      /* update modification time; */
+      /* in reproducible mode we either use `SOURCE_DATE_EPOCH' */
+      /* or keep the value of the input font */
+      if (font->reproducible)
+        update_time = TA_get_source_date_epoch(&date_high, &date_low);
+      else
+      {
+        TA_get_current_time(&date_high, &date_low);
+        update_time = 1;
+      }
+
+      if (update_time)
+      {
+        head_buf[28] = BYTE1(date_high);
+        head_buf[29] = BYTE2(date_high);
+        head_buf[30] = BYTE3(date_high);
+        head_buf[31] = BYTE4(date_high);
+
+        head_buf[32] = BYTE1(date_low);
+        head_buf[33] = BYTE2(date_low);
+        head_buf[34] = BYTE3(date_low);
+        head_buf[35] = BYTE4(date_low);
+      }
 
       table->checksum = TA_table_compute_checksum(table->buf, table->len);
     }
@@ -184,6 +196,42 @@ TA_sfnt_build_TTF_header(SFNT* sfnt,
 }
 
 
+/* replace an existing `DSIG' table with a dummy */
+
+static FT_Error
+TA_sfnt_add_dummy_DSIG(SFNT* sfnt,
+                       FONT* font)
+{
+  FT_Byte* DSIG_buf;
+  FT_Error error;
+
+
+  if (!font->have_DSIG)
+    return TA_Err_Ok;
+
+  error = TA_sfnt_add_table_info(sfnt, font);
+  if (error)
+    return error;
+
+  error = TA_table_build_DSIG(&DSIG_buf, font);
+  if (error)
+    return error;
+
+  /* in case of success, `DSIG_buf' gets linked */
+  /* and is eventually freed in `TA_font_unload' */
+  error = TA_font_add_table(font,
+                            &sfnt->table_infos[sfnt->num_table_infos - 1],
+                            TTAG_DSIG, DSIG_LEN, DSIG_buf);
+  if (error)
+  {
+    ta_mem_free(font->memory, DSIG_buf);
+    return error;
+  }
+
+  return TA_Err_Ok;
+}
+
+
 FT_Error
 TA_font_build_TTF(FONT* font)
 {
@@ -194,8 +242,6 @@ TA_font_build_TTF(FONT* font)
 
   FT_ULong SFNT_offset;
 
-  FT_Byte* DSIG_buf;
-
   FT_Byte* header_buf;
   FT_ULong header_len;
 
@@ -203,29 +249,9 @@ TA_font_build_TTF(FONT* font)
   FT_Error error;
 
 
-  /* replace an existing `DSIG' table with a dummy */
-
-  if (font->have_DSIG)
-  {
-    error = TA_sfnt_add_table_info(sfnt);
-    if (error)
-      return error;
-
-    error = TA_table_build_DSIG(&DSIG_buf);
-    if (error)
-      return error;
-
-    /* in case of success, `DSIG_buf' gets linked */
-    /* and is eventually freed in `TA_font_unload' */
-    error = TA_font_add_table(font,
-                              &sfnt->table_infos[sfnt->num_table_infos - 1],
-                              TTAG_DSIG, DSIG_LEN, DSIG_buf);
-    if (error)
-    {
-      free(DSIG_buf);
-      return error;
-    }
-  }
+  error = TA_sfnt_add_dummy_DSIG(sfnt, font);
+  if (error)
+    return error;
 
   TA_sfnt_sort_table_info(sfnt, font);
 
@@ -268,7 +294,131 @@ TA_font_build_TTF(FONT* font)
   error = TA_Err_Ok;
 
 Err:
-  free(header_buf);
+  ta_mem_free(font->memory, header_buf);
+
+  return error;
+}
+
+
+/*
+ * In streaming mode, the `glyf' table gets written while hinting the
+ * glyphs.  It directly follows the font header, for which we reserve
+ * space in advance.  All other tables are written after the `glyf' table
+ * in `TA_font_finish_TTF_stream'; finally, we go back and write the
+ * header.  Note that the order of the table data is arbitrary, only the
+ * table records in the header must be sorted.
+ */
+
+FT_Error
+TA_font_start_TTF_stream(FONT* font)
+{
+  SFNT* sfnt = &font->sfnts[0];
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+
+  FT_Byte zeros[16];
+  FT_ULong header_len;
+  FT_ULong i;
+  FT_Error error;
+
+
+  /* all tables except the dummy `DSIG' table */
+  /* have already been created at this point */
+  (void)TA_sfnt_build_TTF_header(sfnt, font, NULL, &header_len, 0);
+  if (font->have_DSIG)
+    header_len += 16;
+
+  /* the header length is a multiple of 4 */
+  memset(zeros, 0, sizeof (zeros));
+  for (i = 0; i < header_len; i += 4)
+  {
+    error = TA_font_stream_write(font, zeros, 4);
+    if (error)
+      return error;
+  }
+
+  glyf_table->offset = header_len;
+
+  return TA_Err_Ok;
+}
+
+
+FT_Error
+TA_font_finish_TTF_stream(FONT* font)
+{
+  SFNT* sfnt = &font->sfnts[0];
+  SFNT_Table* glyf_table;
+
+  SFNT_Table* tables;
+  FT_ULong num_tables;
+
+  FT_ULong offset;
+
+  FT_Byte* header_buf;
+  FT_ULong header_len;
+
+  FT_ULong i;
+  FT_Error error;
+
+
+  error = TA_sfnt_add_dummy_DSIG(sfnt, font);
+  if (error)
+    return error;
+
+  TA_sfnt_sort_table_info(sfnt, font);
+
+  /* adding the `DSIG' table might have moved the table array */
+  tables = font->tables;
+  num_tables = font->num_tables;
+  glyf_table = &tables[sfnt->glyf_idx];
+
+  /* the remaining tables follow the `glyf' table */
+  offset = glyf_table->offset + ((glyf_table->len + 3) & ~3);
+  for (i = 0; i < num_tables; i++)
+  {
+    SFNT_Table* table = &tables[i];
+
+
+    if (table == glyf_table)
+      continue;
+
+    table->offset = offset;
+    offset += (table->len + 3) & ~3;
+  }
+
+  /* this also updates the `head' table */
+  error = TA_sfnt_build_TTF_header(sfnt, font,
+                                   &header_buf, &header_len, 1);
+  if (error)
+    return error;
+
+  for (i = 0; i < num_tables; i++)
+  {
+    SFNT_Table* table = &tables[i];
+
+
+    if (table == glyf_table)
+      continue;
+
+    /* buffer length is a multiple of 4 */
+    error = TA_font_stream_write(font, table->buf, (table->len + 3) & ~3);
+    if (error)
+      goto Err;
+  }
+
+  error = TA_font_stream_seek(font, 0);
+  if (error)
+    goto Err;
+  error = TA_font_stream_write(font, header_buf, header_len);
+  if (error)
+    goto Err;
+  error = TA_font_stream_seek(font, offset);
+  if (error)
+    goto Err;
+
+  font->out_len = offset;
+
+Err:
+  ta_mem_free(font->memory, header_buf);
 
   return error;
 }
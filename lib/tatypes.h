@@ -208,7 +208,7 @@ typedef void
 typedef FT_Error
 (*TA_Script_InitHintsFunc)(TA_GlyphHints hints,
                            TA_ScriptMetrics metrics);
-typedef void
+typedef FT_Error
 (*TA_Script_ApplyHintsFunc)(TA_GlyphHints hints,
                             FT_Outline* outline,
                             TA_ScriptMetrics metrics);
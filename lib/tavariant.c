@@ -0,0 +1,248 @@
+/* tavariant.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Building several variants of the output font from a single analysis.
+ *
+ * After the main output font has been created, all tables which are
+ * created while hinting (`gasp', `cvt ', `fpgm', `prep', and the device
+ * tables) get removed, and the modified tables (`glyf', `loca', `maxp',
+ * and `name') are marked as unprocessed.  The caller then runs the
+ * hinting and building stages again with the variant's options.  Split
+ * tables, script coverage, and the global metrics (blue zones and
+ * standard widths) are kept.
+ *
+ * The glyph bytecode only depends on options which influence the
+ * autohinter's scaling (`windows-compatibility', `increase-x-height', and
+ * `x-height-snapping-exceptions'); if none of them changes, the bytecode
+ * of the previous run is reused.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+
+/* check whether two number sets are identical */
+
+static FT_Bool
+TA_number_set_equal(number_range* a,
+                    number_range* b)
+{
+  while (a && b)
+  {
+    if (a->start != b->start
+        || a->end != b->end)
+      return 0;
+
+    a = a->next;
+    b = b->next;
+  }
+
+  return a == b;
+}
+
+
+/* this gets called after the glyphs of the main output font */
+/* have been hinted, but before the `name' table and the `maxp' values */
+/* get updated */
+
+FT_Error
+TA_font_save_variant_state(FONT* font)
+{
+  FT_Long i;
+
+
+  /* the `gasp' table is the first table created while hinting */
+  font->variant_num_tables = font->gasp_idx;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    sfnt->variant_max_storage = sfnt->max_storage;
+    sfnt->variant_max_stack_elements = sfnt->max_stack_elements;
+    sfnt->variant_max_twilight_points = sfnt->max_twilight_points;
+
+    if (sfnt->name_idx != MISSING)
+    {
+      SFNT_Table* name_table = &font->tables[sfnt->name_idx];
+      /* table buffers are always padded to a multiple of 4 */
+      FT_ULong len = (name_table->len + 3) & ~3;
+
+
+      sfnt->variant_name_buf = (FT_Byte*)ta_mem_alloc(font->memory, len);
+      if (!sfnt->variant_name_buf)
+        return FT_Err_Out_Of_Memory;
+      memcpy(sfnt->variant_name_buf, name_table->buf, len);
+      sfnt->variant_name_len = name_table->len;
+    }
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* remove the bytecode of all glyphs so that they get hinted again */
+
+void
+TA_font_drop_glyph_hints(FONT* font)
+{
+  FT_Long i;
+
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+    glyf_Data* data = (glyf_Data*)glyf_table->data;
+    FT_Long j;
+
+
+    /* the artificial `.ttfautohint' glyph (if any) */
+    /* has fixed bytecode which we keep */
+    for (j = 0; j < sfnt->face->num_glyphs; j++)
+    {
+      ta_mem_free(font->memory, data->glyphs[j].ins_buf);
+      data->glyphs[j].ins_buf = NULL;
+      data->glyphs[j].ins_len = 0;
+    }
+  }
+}
+
+
+FT_Error
+TA_font_setup_variant(FONT* font,
+                      TA_Variant* variant)
+{
+  number_range* x_height_snapping_exceptions = NULL;
+  FT_Bool rehint;
+  FT_ULong j;
+  FT_Long i;
+
+
+  if (variant->increase_x_height > 0
+      && variant->increase_x_height < TA_PROP_INCREASE_X_HEIGHT_MIN)
+    return FT_Err_Invalid_Argument;
+
+  if (variant->x_height_snapping_exceptions)
+  {
+    const char* s = number_set_parse(variant->x_height_snapping_exceptions,
+                                     &x_height_snapping_exceptions,
+                                     TA_PROP_INCREASE_X_HEIGHT_MIN,
+                                     0x7FFF);
+    if (*s)
+      return FT_Err_Invalid_Argument;
+  }
+
+  /* we have to hint the glyphs again */
+  /* if the autohinter's scaling changes */
+  rehint = (FT_Bool)variant->windows_compatibility
+             != font->windows_compatibility
+           || variant->increase_x_height != font->increase_x_height
+           || !TA_number_set_equal(x_height_snapping_exceptions,
+                                   font->x_height_snapping_exceptions);
+
+  font->gray_strong_stem_width =
+    (FT_Bool)variant->gray_strong_stem_width;
+  font->gdi_cleartype_strong_stem_width =
+    (FT_Bool)variant->gdi_cleartype_strong_stem_width;
+  font->dw_cleartype_strong_stem_width =
+    (FT_Bool)variant->dw_cleartype_strong_stem_width;
+  font->windows_compatibility = (FT_Bool)variant->windows_compatibility;
+  font->increase_x_height = variant->increase_x_height;
+
+  number_set_free(font->x_height_snapping_exceptions);
+  font->x_height_snapping_exceptions = x_height_snapping_exceptions;
+
+  font->info_data = variant->info_callback_data;
+  font->reuse_glyph_hints = !rehint;
+
+  /* variants would replace the entries of the main run */
+  font->glyph_cache = NULL;
+
+  /* remove all tables created by the previous run */
+  for (j = font->variant_num_tables; j < font->num_tables; j++)
+    ta_mem_free(font->memory, font->tables[j].buf);
+  font->num_tables = font->variant_num_tables;
+  font->gasp_idx = MISSING;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+    SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+    glyf_Data* data = (glyf_Data*)glyf_table->data;
+    FT_ULong k;
+
+
+    /* drop the table infos of removed tables */
+    for (j = 0, k = 0; j < sfnt->num_table_infos; j++)
+      if (sfnt->table_infos[j] == MISSING
+          || sfnt->table_infos[j] < font->variant_num_tables)
+        sfnt->table_infos[k++] = sfnt->table_infos[j];
+    sfnt->num_table_infos = k;
+
+    glyf_table->processed = 0;
+    font->tables[sfnt->loca_idx].processed = 0;
+    font->tables[sfnt->maxp_idx].processed = 0;
+    data->cvt_idx = MISSING;
+    data->fpgm_idx = MISSING;
+    data->prep_idx = MISSING;
+    data->have_limits = 0;
+
+    sfnt->max_storage = sfnt->variant_max_storage;
+    sfnt->max_stack_elements = sfnt->variant_max_stack_elements;
+    sfnt->max_twilight_points = sfnt->variant_max_twilight_points;
+
+    if (sfnt->variant_name_buf)
+    {
+      SFNT_Table* name_table = &font->tables[sfnt->name_idx];
+      FT_ULong len = (sfnt->variant_name_len + 3) & ~3;
+      FT_Byte* buf_new;
+
+
+      buf_new = (FT_Byte*)ta_mem_realloc(font->memory, name_table->buf, len);
+      if (!buf_new)
+        return FT_Err_Out_Of_Memory;
+      memcpy(buf_new, sfnt->variant_name_buf, len);
+
+      name_table->buf = buf_new;
+      name_table->len = sfnt->variant_name_len;
+      name_table->checksum = TA_table_compute_checksum(name_table->buf,
+                                                       name_table->len);
+      name_table->processed = 0;
+    }
+
+    globals->increase_x_height = font->increase_x_height;
+    ta_face_globals_reset_scale(globals);
+
+    /* the cached `maxp' values of the main run */
+    /* don't apply to the variant's `prep' table */
+    for (j = 0; j < data->num_glyphs; j++)
+      data->glyphs[j].cache_entry = NULL;
+  }
+
+  if (rehint)
+    TA_font_drop_glyph_hints(font);
+
+  font->start_time = TA_get_milliseconds();
+
+  return TA_Err_Ok;
+}
+
+/* end of tavariant.c */
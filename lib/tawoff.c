@@ -0,0 +1,2755 @@
+/* tawoff.c */
+
+/*
+ * Copyright (C) 2011-2012 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Support for the WOFF and WOFF2 container formats.  Input data gets
+ * unwrapped to SFNT in memory directly after reading (before FreeType
+ * sees it), and the final SFNT gets wrapped again directly before
+ * writing, thus no intermediate files are necessary.
+ *
+ * For WOFF2 input, we handle the `glyf' and `loca' table transformation
+ * (version 0) and the `hmtx' table transformation (version 1).  For WOFF2
+ * output, we transform `glyf' and `loca' (falling back to the null
+ * transform if the glyph data can't be represented), while all other
+ * tables use the null transform.  WOFF2 font collections are not
+ * supported.
+ *
+ * WOFF extended metadata and private data blocks of the input font are
+ * preserved if the output is WOFF or WOFF2 also.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ta.h"
+
+#ifdef HAVE_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef HAVE_BROTLI
+#  include <brotli/decode.h>
+#  include <brotli/encode.h>
+#endif
+
+
+#define TAG_wOFF FT_MAKE_TAG('w', 'O', 'F', 'F')
+#define TAG_wOF2 FT_MAKE_TAG('w', 'O', 'F', '2')
+#define TAG_ttcf FT_MAKE_TAG('t', 't', 'c', 'f')
+
+#define SFNT_HEADER_LEN 12
+#define SFNT_TABLE_RECORD_LEN 16
+
+#define WOFF_HEADER_LEN 44
+#define WOFF_TABLE_ENTRY_LEN 20
+
+#define WOFF2_HEADER_LEN 48
+#define WOFF2_GLYF_HEADER_LEN 36
+
+/* WOFF2 table directory flags */
+#define WOFF2_ARBITRARY_TAG 0x3F
+#define WOFF2_NULL_TRANSFORM_GLYF 0xC0 /* transform version 3 */
+
+/* WOFF2 `glyf' transform flags */
+#define WOFF2_HAVE_OVERLAP_BITMAP 0x0001
+
+/* WOFF2 `hmtx' transform flags */
+#define WOFF2_NO_PROPORTIONAL_LSBS 0x01
+#define WOFF2_NO_MONOSPACE_LSBS 0x02
+
+/* a flag in simple glyph records not listed in `ta.h' */
+#define OVERLAP_SIMPLE 0x40
+
+/* offsets within the `hhea' and `head' tables */
+#define HHEA_NUM_HMETRICS_OFFSET 34
+#define HEAD_FONT_REVISION_OFFSET 4
+#define HEAD_FLAGS_OFFSET 16
+
+#define PAD4(x) (((x) + 3) & ~3UL)
+
+
+/* a table while converting from or to a container format; */
+/* `buf' either points into other data or has been allocated */
+typedef struct WOFF_Table_
+{
+  FT_ULong tag;
+  FT_ULong len;
+  FT_Byte* buf;
+  FT_Bool allocated;
+
+  FT_ULong checksum;
+
+  /* WOFF2 only: the table's position in the decompressed data stream */
+  FT_ULong stream_offset;
+  FT_ULong stream_len;
+  FT_Bool transformed;
+} WOFF_Table;
+
+
+static FT_ULong
+TA_get_ulong(const FT_Byte* p)
+{
+  return ((FT_ULong)p[0] << 24)
+         | ((FT_ULong)p[1] << 16)
+         | ((FT_ULong)p[2] << 8)
+         | p[3];
+}
+
+
+#if defined(HAVE_ZLIB) || defined(HAVE_BROTLI)
+
+static FT_UShort
+TA_get_ushort(const FT_Byte* p)
+{
+  return (FT_UShort)((p[0] << 8) | p[1]);
+}
+
+
+static FT_Byte*
+TA_put_ulong(FT_Byte* p,
+             FT_ULong val)
+{
+  *(p++) = BYTE1(val);
+  *(p++) = BYTE2(val);
+  *(p++) = BYTE3(val);
+  *(p++) = BYTE4(val);
+
+  return p;
+}
+
+
+static FT_Byte*
+TA_put_ushort(FT_Byte* p,
+              FT_UInt val)
+{
+  *(p++) = HIGH(val);
+  *(p++) = LOW(val);
+
+  return p;
+}
+
+
+static int
+TA_table_compare(const void* a,
+                 const void* b)
+{
+  const WOFF_Table* table_a = (const WOFF_Table*)a;
+  const WOFF_Table* table_b = (const WOFF_Table*)b;
+
+
+  if (table_a->tag < table_b->tag)
+    return -1;
+  else if (table_a->tag > table_b->tag)
+    return 1;
+  else
+    return 0;
+}
+
+
+static WOFF_Table*
+TA_tables_find(WOFF_Table* tables,
+               FT_UShort num_tables,
+               FT_ULong tag)
+{
+  FT_UShort i;
+
+
+  for (i = 0; i < num_tables; i++)
+    if (tables[i].tag == tag)
+      return &tables[i];
+
+  return NULL;
+}
+
+
+static void
+TA_tables_free(WOFF_Table* tables,
+               FT_UShort num_tables)
+{
+  FT_UShort i;
+
+
+  if (!tables)
+    return;
+
+  for (i = 0; i < num_tables; i++)
+    if (tables[i].allocated)
+      free(tables[i].buf);
+  free(tables);
+}
+
+
+/* assemble an SFNT from an array of tables (which gets sorted) */
+
+static FT_Error
+TA_tables_build_SFNT(FT_ULong flavor,
+                     WOFF_Table* tables,
+                     FT_UShort num_tables,
+                     FT_Byte** sfnt_buf,
+                     size_t* sfnt_len)
+{
+  FT_Byte* buf;
+  FT_Byte* p;
+  FT_ULong len;
+  FT_ULong offset;
+  FT_UShort search_range, entry_selector, range_shift;
+  FT_UShort i;
+
+
+  qsort(tables, num_tables, sizeof (WOFF_Table), TA_table_compare);
+
+  len = SFNT_HEADER_LEN + num_tables * SFNT_TABLE_RECORD_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    /* tags must be unique */
+    if (i && tables[i].tag == tables[i - 1].tag)
+      return TA_Err_Invalid_WOFF_Data;
+    if (tables[i].len > 0xFFFFFFFCUL - len)
+      return TA_Err_Invalid_WOFF_Data;
+
+    len += PAD4(tables[i].len);
+  }
+
+  /* we need zeroed padding bytes */
+  buf = (FT_Byte*)calloc(1, len);
+  if (!buf)
+    return FT_Err_Out_Of_Memory;
+
+  search_range = 1;
+  entry_selector = 0;
+  while (search_range * 2 <= num_tables)
+  {
+    search_range *= 2;
+    entry_selector++;
+  }
+  search_range *= SFNT_TABLE_RECORD_LEN;
+  range_shift = num_tables * SFNT_TABLE_RECORD_LEN - search_range;
+
+  p = TA_put_ulong(buf, flavor);
+  p = TA_put_ushort(p, num_tables);
+  p = TA_put_ushort(p, search_range);
+  p = TA_put_ushort(p, entry_selector);
+  p = TA_put_ushort(p, range_shift);
+
+  offset = SFNT_HEADER_LEN + num_tables * SFNT_TABLE_RECORD_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+
+
+    memcpy(buf + offset, table->buf, table->len);
+
+    p = TA_put_ulong(p, table->tag);
+    p = TA_put_ulong(p, TA_table_compute_checksum(buf + offset,
+                                                  PAD4(table->len))
+                        & 0xFFFFFFFFUL);
+    p = TA_put_ulong(p, offset);
+    p = TA_put_ulong(p, table->len);
+
+    offset += PAD4(table->len);
+  }
+
+  *sfnt_buf = buf;
+  *sfnt_len = len;
+
+  return TA_Err_Ok;
+}
+
+
+/* split an SFNT into an array of tables (pointing into `buf') */
+
+static FT_Error
+TA_tables_split_SFNT(const FT_Byte* buf,
+                     size_t len,
+                     FT_ULong* flavor,
+                     WOFF_Table** tablesp,
+                     FT_UShort* num_tablesp)
+{
+  WOFF_Table* tables;
+  FT_UShort num_tables;
+  const FT_Byte* p;
+  FT_UShort i;
+
+
+  if (len < SFNT_HEADER_LEN)
+    return TA_Err_Invalid_Font_Type;
+
+  *flavor = TA_get_ulong(buf);
+  num_tables = TA_get_ushort(buf + 4);
+
+  if (len < SFNT_HEADER_LEN + (size_t)num_tables * SFNT_TABLE_RECORD_LEN)
+    return TA_Err_Invalid_Font_Type;
+
+  tables = (WOFF_Table*)calloc(num_tables ? num_tables : 1,
+                               sizeof (WOFF_Table));
+  if (!tables)
+    return FT_Err_Out_Of_Memory;
+
+  p = buf + SFNT_HEADER_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    FT_ULong offset = TA_get_ulong(p + 8);
+    FT_ULong table_len = TA_get_ulong(p + 12);
+
+
+    if (offset > len || table_len > len - offset)
+    {
+      free(tables);
+      return TA_Err_Invalid_Font_Type;
+    }
+
+    tables[i].tag = TA_get_ulong(p);
+    tables[i].checksum = TA_get_ulong(p + 4);
+    tables[i].buf = (FT_Byte*)buf + offset;
+    tables[i].len = table_len;
+
+    p += SFNT_TABLE_RECORD_LEN;
+  }
+
+  qsort(tables, num_tables, sizeof (WOFF_Table), TA_table_compare);
+
+  *tablesp = tables;
+  *num_tablesp = num_tables;
+
+  return TA_Err_Ok;
+}
+
+
+static void
+TA_font_set_WOFF_info(FONT* font,
+                      FT_UShort major_version,
+                      FT_UShort minor_version,
+                      FT_Byte* meta_buf,
+                      FT_ULong meta_len,
+                      FT_Byte* priv_buf,
+                      FT_ULong priv_len)
+{
+  font->woff_major_version = major_version;
+  font->woff_minor_version = minor_version;
+  font->woff_meta_buf = meta_buf;
+  font->woff_meta_len = meta_len;
+  font->woff_priv_buf = priv_buf;
+  font->woff_priv_len = priv_len;
+}
+
+
+/* if the input font is not in WOFF or WOFF2 format, */
+/* take the WOFF version from the `head' table's font revision */
+
+static void
+TA_font_get_WOFF_version(FONT* font,
+                         WOFF_Table* tables,
+                         FT_UShort num_tables,
+                         FT_UShort* major_version,
+                         FT_UShort* minor_version)
+{
+  WOFF_Table* head_table;
+
+
+  *major_version = font->woff_major_version;
+  *minor_version = font->woff_minor_version;
+
+  if (font->in_format != TA_FORMAT_SFNT)
+    return;
+
+  head_table = TA_tables_find(tables, num_tables, TTAG_head);
+  if (head_table && head_table->len >= HEAD_FONT_REVISION_OFFSET + 4)
+  {
+    *major_version = TA_get_ushort(head_table->buf
+                                   + HEAD_FONT_REVISION_OFFSET);
+    *minor_version = TA_get_ushort(head_table->buf
+                                   + HEAD_FONT_REVISION_OFFSET + 2);
+  }
+}
+
+
+static FT_Error
+TA_copy_private_data(const FT_Byte* buf,
+                     FT_ULong len,
+                     FT_ULong priv_offset,
+                     FT_ULong priv_len,
+                     FT_Byte** priv_buf)
+{
+  *priv_buf = NULL;
+
+  if (!priv_len)
+    return TA_Err_Ok;
+
+  if (priv_offset > len || priv_len > len - priv_offset)
+    return TA_Err_Invalid_WOFF_Data;
+
+  *priv_buf = (FT_Byte*)malloc(priv_len);
+  if (!*priv_buf)
+    return FT_Err_Out_Of_Memory;
+
+  memcpy(*priv_buf, buf + priv_offset, priv_len);
+
+  return TA_Err_Ok;
+}
+
+
+#endif /* HAVE_ZLIB || HAVE_BROTLI */
+
+
+#ifdef HAVE_ZLIB
+
+static FT_Error
+TA_zlib_uncompress(const FT_Byte* buf,
+                   FT_ULong len,
+                   FT_ULong orig_len,
+                   FT_Byte** orig_buf)
+{
+  uLongf dest_len = orig_len;
+
+
+  *orig_buf = (FT_Byte*)malloc(orig_len ? orig_len : 1);
+  if (!*orig_buf)
+    return FT_Err_Out_Of_Memory;
+
+  if (uncompress(*orig_buf, &dest_len, buf, len) != Z_OK
+      || dest_len != orig_len)
+  {
+    free(*orig_buf);
+    *orig_buf = NULL;
+    return TA_Err_Invalid_WOFF_Data;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_font_decode_WOFF(FONT* font,
+                    FT_Byte** sfnt_buf,
+                    size_t* sfnt_len)
+{
+  const FT_Byte* buf = font->in_buf;
+  FT_ULong len;
+
+  FT_ULong flavor;
+  FT_UShort num_tables;
+  FT_UShort major_version, minor_version;
+  FT_ULong meta_offset, meta_len, meta_orig_len;
+  FT_ULong priv_offset, priv_len;
+
+  WOFF_Table* tables = NULL;
+  FT_Byte* meta_buf = NULL;
+  FT_Byte* priv_buf = NULL;
+  const FT_Byte* p;
+  FT_UShort i;
+
+  FT_Error error;
+
+
+  if (font->in_len < WOFF_HEADER_LEN)
+    return TA_Err_Invalid_WOFF_Data;
+
+  flavor = TA_get_ulong(buf + 4);
+  len = TA_get_ulong(buf + 8);
+  num_tables = TA_get_ushort(buf + 12);
+  major_version = TA_get_ushort(buf + 20);
+  minor_version = TA_get_ushort(buf + 22);
+  meta_offset = TA_get_ulong(buf + 24);
+  meta_len = TA_get_ulong(buf + 28);
+  meta_orig_len = TA_get_ulong(buf + 32);
+  priv_offset = TA_get_ulong(buf + 36);
+  priv_len = TA_get_ulong(buf + 40);
+
+  if (len > font->in_len
+      || !num_tables
+      || TA_get_ushort(buf + 14) != 0 /* reserved */
+      || len < WOFF_HEADER_LEN + (FT_ULong)num_tables * WOFF_TABLE_ENTRY_LEN)
+    return TA_Err_Invalid_WOFF_Data;
+
+  tables = (WOFF_Table*)calloc(num_tables, sizeof (WOFF_Table));
+  if (!tables)
+    return FT_Err_Out_Of_Memory;
+
+  p = buf + WOFF_HEADER_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+    FT_ULong offset = TA_get_ulong(p + 4);
+    FT_ULong comp_len = TA_get_ulong(p + 8);
+    FT_ULong orig_len = TA_get_ulong(p + 12);
+
+
+    table->tag = TA_get_ulong(p);
+    table->len = orig_len;
+
+    if (offset > len
+        || comp_len > len - offset
+        || comp_len > orig_len)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+
+    if (comp_len == orig_len)
+      table->buf = (FT_Byte*)buf + offset;
+    else
+    {
+      error = TA_zlib_uncompress(buf + offset, comp_len,
+                                 orig_len, &table->buf);
+      if (error)
+        goto Err;
+      table->allocated = 1;
+    }
+
+    p += WOFF_TABLE_ENTRY_LEN;
+  }
+
+  if (meta_len)
+  {
+    if (meta_offset > len || meta_len > len - meta_offset)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+
+    error = TA_zlib_uncompress(buf + meta_offset, meta_len,
+                               meta_orig_len, &meta_buf);
+    if (error)
+      goto Err;
+  }
+
+  error = TA_copy_private_data(buf, len, priv_offset, priv_len, &priv_buf);
+  if (error)
+    goto Err;
+
+  error = TA_tables_build_SFNT(flavor, tables, num_tables,
+                               sfnt_buf, sfnt_len);
+  if (error)
+    goto Err;
+
+  TA_font_set_WOFF_info(font, major_version, minor_version,
+                        meta_buf, meta_len ? meta_orig_len : 0,
+                        priv_buf, priv_len);
+  TA_tables_free(tables, num_tables);
+
+  return TA_Err_Ok;
+
+Err:
+  TA_tables_free(tables, num_tables);
+  free(meta_buf);
+  free(priv_buf);
+
+  return error;
+}
+
+
+static FT_Error
+TA_font_encode_WOFF(FONT* font,
+                    FT_Byte** woff_buf,
+                    size_t* woff_len)
+{
+  WOFF_Table* tables = NULL;
+  FT_UShort num_tables;
+  FT_ULong flavor;
+
+  FT_Byte** comp_bufs = NULL;
+  FT_ULong* comp_lens = NULL;
+  FT_Byte* meta_buf = NULL;
+  uLongf meta_len = 0;
+
+  FT_Byte* buf;
+  FT_Byte* p;
+  FT_ULong len;
+  FT_ULong sfnt_len;
+  FT_ULong offset;
+  FT_ULong meta_offset = 0;
+  FT_ULong priv_offset = 0;
+  FT_UShort i;
+
+  FT_UShort major_version, minor_version;
+
+  FT_Error error;
+
+
+  error = TA_tables_split_SFNT(font->out_buf, font->out_len,
+                               &flavor, &tables, &num_tables);
+  if (error)
+    return error;
+
+  TA_font_get_WOFF_version(font, tables, num_tables,
+                           &major_version, &minor_version);
+
+  comp_bufs = (FT_Byte**)calloc(num_tables, sizeof (FT_Byte*));
+  comp_lens = (FT_ULong*)calloc(num_tables, sizeof (FT_ULong));
+  if (!comp_bufs || !comp_lens)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  /* compress all tables; */
+  /* if compression doesn't reduce the size, the table is stored as-is */
+  len = WOFF_HEADER_LEN + num_tables * WOFF_TABLE_ENTRY_LEN;
+  sfnt_len = SFNT_HEADER_LEN + num_tables * SFNT_TABLE_RECORD_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+    uLongf comp_len = compressBound(table->len);
+
+
+    comp_bufs[i] = (FT_Byte*)malloc(comp_len);
+    if (!comp_bufs[i])
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+    if (compress2(comp_bufs[i], &comp_len,
+                  table->buf, table->len, Z_BEST_COMPRESSION) == Z_OK
+        && comp_len < table->len)
+      comp_lens[i] = comp_len;
+    else
+    {
+      free(comp_bufs[i]);
+      comp_bufs[i] = NULL;
+      comp_lens[i] = table->len;
+    }
+
+    len = PAD4(len) + comp_lens[i];
+    sfnt_len += PAD4(table->len);
+  }
+  len = PAD4(len);
+
+  if (font->woff_meta_len)
+  {
+    meta_len = compressBound(font->woff_meta_len);
+    meta_buf = (FT_Byte*)malloc(meta_len);
+    if (!meta_buf)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+    if (compress2(meta_buf, &meta_len,
+                  font->woff_meta_buf, font->woff_meta_len,
+                  Z_BEST_COMPRESSION) != Z_OK)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+    meta_offset = len;
+    len = meta_offset + meta_len;
+  }
+
+  if (font->woff_priv_len)
+  {
+    priv_offset = PAD4(len);
+    len = priv_offset + font->woff_priv_len;
+  }
+
+  /* we need zeroed padding bytes */
+  buf = (FT_Byte*)calloc(1, len);
+  if (!buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  p = TA_put_ulong(buf, TAG_wOFF);
+  p = TA_put_ulong(p, flavor);
+  p = TA_put_ulong(p, len);
+  p = TA_put_ushort(p, num_tables);
+  p = TA_put_ushort(p, 0);
+  p = TA_put_ulong(p, sfnt_len);
+  p = TA_put_ushort(p, major_version);
+  p = TA_put_ushort(p, minor_version);
+  p = TA_put_ulong(p, meta_offset);
+  p = TA_put_ulong(p, meta_len);
+  p = TA_put_ulong(p, font->woff_meta_len);
+  p = TA_put_ulong(p, priv_offset);
+  p = TA_put_ulong(p, font->woff_priv_len);
+
+  offset = WOFF_HEADER_LEN + num_tables * WOFF_TABLE_ENTRY_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+
+
+    offset = PAD4(offset);
+
+    p = TA_put_ulong(p, table->tag);
+    p = TA_put_ulong(p, offset);
+    p = TA_put_ulong(p, comp_lens[i]);
+    p = TA_put_ulong(p, table->len);
+    p = TA_put_ulong(p, table->checksum);
+
+    memcpy(buf + offset,
+           comp_bufs[i] ? comp_bufs[i] : table->buf,
+           comp_lens[i]);
+    offset += comp_lens[i];
+  }
+
+  if (meta_len)
+    memcpy(buf + meta_offset, meta_buf, meta_len);
+  if (font->woff_priv_len)
+    memcpy(buf + priv_offset, font->woff_priv_buf, font->woff_priv_len);
+
+  *woff_buf = buf;
+  *woff_len = len;
+
+  error = TA_Err_Ok;
+
+Err:
+  if (comp_bufs)
+    for (i = 0; i < num_tables; i++)
+      free(comp_bufs[i]);
+  free(comp_bufs);
+  free(comp_lens);
+  free(meta_buf);
+  TA_tables_free(tables, num_tables);
+
+  return error;
+}
+
+#endif /* HAVE_ZLIB */
+
+
+#ifdef HAVE_BROTLI
+
+/* the known table tags of WOFF2, indexed by the table directory flags */
+static const FT_ULong woff2_known_tags[63] =
+{
+  FT_MAKE_TAG('c', 'm', 'a', 'p'), FT_MAKE_TAG('h', 'e', 'a', 'd'),
+  FT_MAKE_TAG('h', 'h', 'e', 'a'), FT_MAKE_TAG('h', 'm', 't', 'x'),
+  FT_MAKE_TAG('m', 'a', 'x', 'p'), FT_MAKE_TAG('n', 'a', 'm', 'e'),
+  FT_MAKE_TAG('O', 'S', '/', '2'), FT_MAKE_TAG('p', 'o', 's', 't'),
+  FT_MAKE_TAG('c', 'v', 't', ' '), FT_MAKE_TAG('f', 'p', 'g', 'm'),
+  FT_MAKE_TAG('g', 'l', 'y', 'f'), FT_MAKE_TAG('l', 'o', 'c', 'a'),
+  FT_MAKE_TAG('p', 'r', 'e', 'p'), FT_MAKE_TAG('C', 'F', 'F', ' '),
+  FT_MAKE_TAG('V', 'O', 'R', 'G'), FT_MAKE_TAG('E', 'B', 'D', 'T'),
+  FT_MAKE_TAG('E', 'B', 'L', 'C'), FT_MAKE_TAG('g', 'a', 's', 'p'),
+  FT_MAKE_TAG('h', 'd', 'm', 'x'), FT_MAKE_TAG('k', 'e', 'r', 'n'),
+  FT_MAKE_TAG('L', 'T', 'S', 'H'), FT_MAKE_TAG('P', 'C', 'L', 'T'),
+  FT_MAKE_TAG('V', 'D', 'M', 'X'), FT_MAKE_TAG('v', 'h', 'e', 'a'),
+  FT_MAKE_TAG('v', 'm', 't', 'x'), FT_MAKE_TAG('B', 'A', 'S', 'E'),
+  FT_MAKE_TAG('G', 'D', 'E', 'F'), FT_MAKE_TAG('G', 'P', 'O', 'S'),
+  FT_MAKE_TAG('G', 'S', 'U', 'B'), FT_MAKE_TAG('E', 'B', 'S', 'C'),
+  FT_MAKE_TAG('J', 'S', 'T', 'F'), FT_MAKE_TAG('M', 'A', 'T', 'H'),
+  FT_MAKE_TAG('C', 'B', 'D', 'T'), FT_MAKE_TAG('C', 'B', 'L', 'C'),
+  FT_MAKE_TAG('C', 'O', 'L', 'R'), FT_MAKE_TAG('C', 'P', 'A', 'L'),
+  FT_MAKE_TAG('S', 'V', 'G', ' '), FT_MAKE_TAG('s', 'b', 'i', 'x'),
+  FT_MAKE_TAG('a', 'c', 'n', 't'), FT_MAKE_TAG('a', 'v', 'a', 'r'),
+  FT_MAKE_TAG('b', 'd', 'a', 't'), FT_MAKE_TAG('b', 'l', 'o', 'c'),
+  FT_MAKE_TAG('b', 's', 'l', 'n'), FT_MAKE_TAG('c', 'v', 'a', 'r'),
+  FT_MAKE_TAG('f', 'd', 's', 'c'), FT_MAKE_TAG('f', 'e', 'a', 't'),
+  FT_MAKE_TAG('f', 'm', 't', 'x'), FT_MAKE_TAG('f', 'v', 'a', 'r'),
+  FT_MAKE_TAG('g', 'v', 'a', 'r'), FT_MAKE_TAG('h', 's', 't', 'y'),
+  FT_MAKE_TAG('j', 'u', 's', 't'), FT_MAKE_TAG('l', 'c', 'a', 'r'),
+  FT_MAKE_TAG('m', 'o', 'r', 't'), FT_MAKE_TAG('m', 'o', 'r', 'x'),
+  FT_MAKE_TAG('o', 'p', 'b', 'd'), FT_MAKE_TAG('p', 'r', 'o', 'p'),
+  FT_MAKE_TAG('t', 'r', 'a', 'k'), FT_MAKE_TAG('Z', 'a', 'p', 'f'),
+  FT_MAKE_TAG('S', 'i', 'l', 'f'), FT_MAKE_TAG('G', 'l', 'a', 't'),
+  FT_MAKE_TAG('G', 'l', 'o', 'c'), FT_MAKE_TAG('F', 'e', 'a', 't'),
+  FT_MAKE_TAG('S', 'i', 'l', 'l')
+};
+
+
+/* a bounded input stream; */
+/* reading beyond its end sets `error' and returns zero */
+typedef struct WOFF_Stream_
+{
+  const FT_Byte* p;
+  const FT_Byte* end;
+  FT_Bool error;
+} WOFF_Stream;
+
+/* a growing output buffer; */
+/* a failed allocation sets `error' and discards further data */
+typedef struct WOFF_Buffer_
+{
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_ULong size;
+  FT_Bool error;
+} WOFF_Buffer;
+
+
+static void
+TA_stream_init(WOFF_Stream* s,
+               const FT_Byte* buf,
+               FT_ULong len)
+{
+  s->p = buf;
+  s->end = buf + len;
+  s->error = 0;
+}
+
+
+static const FT_Byte*
+TA_stream_skip(WOFF_Stream* s,
+               FT_ULong len)
+{
+  const FT_Byte* p = s->p;
+
+
+  if ((FT_ULong)(s->end - s->p) < len)
+  {
+    s->p = s->end;
+    s->error = 1;
+    return NULL;
+  }
+
+  s->p += len;
+
+  return p;
+}
+
+
+static FT_Byte
+TA_stream_read_byte(WOFF_Stream* s)
+{
+  const FT_Byte* p = TA_stream_skip(s, 1);
+
+
+  return p ? p[0] : 0;
+}
+
+
+static FT_UShort
+TA_stream_read_ushort(WOFF_Stream* s)
+{
+  const FT_Byte* p = TA_stream_skip(s, 2);
+
+
+  return p ? TA_get_ushort(p) : 0;
+}
+
+
+static FT_ULong
+TA_stream_read_ulong(WOFF_Stream* s)
+{
+  const FT_Byte* p = TA_stream_skip(s, 4);
+
+
+  return p ? TA_get_ulong(p) : 0;
+}
+
+
+/* read a `255UInt16' value (as defined in the WOFF2 specification) */
+
+static FT_UShort
+TA_stream_read_255ushort(WOFF_Stream* s)
+{
+  FT_Byte code = TA_stream_read_byte(s);
+
+
+  if (code == 253)
+    return TA_stream_read_ushort(s);
+  else if (code == 255)
+    return (FT_UShort)(TA_stream_read_byte(s) + 253);
+  else if (code == 254)
+    return (FT_UShort)(TA_stream_read_byte(s) + 506);
+  else
+    return code;
+}
+
+
+/* read a `UIntBase128' value (as defined in the WOFF2 specification) */
+
+static FT_ULong
+TA_stream_read_base128(WOFF_Stream* s)
+{
+  FT_ULong val = 0;
+  FT_Int i;
+
+
+  for (i = 0; i < 5; i++)
+  {
+    FT_Byte b = TA_stream_read_byte(s);
+
+
+    /* no leading zeros, no overflow */
+    if ((i == 0 && b == 0x80)
+        || (val & 0xFE000000UL))
+      break;
+
+    val = (val << 7) | (b & 0x7F);
+    if (!(b & 0x80))
+      return val;
+  }
+
+  s->error = 1;
+  return 0;
+}
+
+
+static void
+TA_buffer_reserve(WOFF_Buffer* b,
+                  FT_ULong len)
+{
+  FT_ULong size;
+  FT_Byte* buf_new;
+
+
+  if (b->error)
+    return;
+  if (b->len + len <= b->size)
+    return;
+
+  size = b->size ? b->size : 1024;
+  while (size < b->len + len)
+    size *= 2;
+
+  buf_new = (FT_Byte*)realloc(b->buf, size);
+  if (!buf_new)
+  {
+    b->error = 1;
+    return;
+  }
+
+  b->buf = buf_new;
+  b->size = size;
+}
+
+
+static void
+TA_buffer_add_bytes(WOFF_Buffer* b,
+                    const FT_Byte* bytes,
+                    FT_ULong len)
+{
+  TA_buffer_reserve(b, len);
+  if (b->error)
+    return;
+
+  memcpy(b->buf + b->len, bytes, len);
+  b->len += len;
+}
+
+
+static void
+TA_buffer_add_byte(WOFF_Buffer* b,
+                   FT_Byte val)
+{
+  TA_buffer_add_bytes(b, &val, 1);
+}
+
+
+static void
+TA_buffer_add_ushort(WOFF_Buffer* b,
+                     FT_UInt val)
+{
+  FT_Byte bytes[2];
+
+
+  TA_put_ushort(bytes, val);
+  TA_buffer_add_bytes(b, bytes, 2);
+}
+
+
+static void
+TA_buffer_pad4(WOFF_Buffer* b)
+{
+  static const FT_Byte zeros[3] = {0, 0, 0};
+
+
+  TA_buffer_add_bytes(b, zeros, PAD4(b->len) - b->len);
+}
+
+
+/* the streams of a transformed `glyf' table */
+
+enum
+{
+  WOFF2_N_CONTOUR_STREAM,
+  WOFF2_N_POINTS_STREAM,
+  WOFF2_FLAG_STREAM,
+  WOFF2_GLYPH_STREAM,
+  WOFF2_COMPOSITE_STREAM,
+  WOFF2_BBOX_STREAM,
+  WOFF2_INSTRUCTION_STREAM,
+
+  WOFF2_NUM_STREAMS
+};
+
+
+typedef struct WOFF2_Point_
+{
+  FT_Long x;
+  FT_Long y;
+  FT_Bool on_curve;
+} WOFF2_Point;
+
+
+static FT_Long
+TA_with_sign(FT_Byte flag,
+             FT_Long val)
+{
+  return (flag & 1) ? val : -val;
+}
+
+
+/* decode the point coordinates of a simple glyph */
+
+static void
+TA_decode_triplets(WOFF_Stream* flags,
+                   WOFF_Stream* glyph,
+                   WOFF2_Point* points,
+                   FT_UInt num_points)
+{
+  FT_Long x = 0;
+  FT_Long y = 0;
+  FT_UInt i;
+
+
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Byte flag = TA_stream_read_byte(flags);
+    FT_Bool on_curve = !(flag >> 7);
+    const FT_Byte* data;
+    FT_Long dx, dy;
+
+
+    flag &= 0x7F;
+
+    if (flag < 84)
+      data = TA_stream_skip(glyph, 1);
+    else if (flag < 120)
+      data = TA_stream_skip(glyph, 2);
+    else if (flag < 124)
+      data = TA_stream_skip(glyph, 3);
+    else
+      data = TA_stream_skip(glyph, 4);
+
+    if (!data)
+      return;
+
+    if (flag < 10)
+    {
+      dx = 0;
+      dy = TA_with_sign(flag, ((flag & 14) << 7) + data[0]);
+    }
+    else if (flag < 20)
+    {
+      dx = TA_with_sign(flag, (((flag - 10) & 14) << 7) + data[0]);
+      dy = 0;
+    }
+    else if (flag < 84)
+    {
+      FT_Int b0 = flag - 20;
+      FT_Int b1 = data[0];
+
+
+      dx = TA_with_sign(flag, 1 + (b0 & 0x30) + (b1 >> 4));
+      dy = TA_with_sign(flag >> 1, 1 + ((b0 & 0x0C) << 2) + (b1 & 0x0F));
+    }
+    else if (flag < 120)
+    {
+      FT_Int b0 = flag - 84;
+
+
+      dx = TA_with_sign(flag, 1 + ((b0 / 12) << 8) + data[0]);
+      dy = TA_with_sign(flag >> 1, 1 + (((b0 % 12) >> 2) << 8) + data[1]);
+    }
+    else if (flag < 124)
+    {
+      FT_Int b2 = data[1];
+
+
+      dx = TA_with_sign(flag, (data[0] << 4) + (b2 >> 4));
+      dy = TA_with_sign(flag >> 1, ((b2 & 0x0F) << 8) + data[2]);
+    }
+    else
+    {
+      dx = TA_with_sign(flag, (data[0] << 8) + data[1]);
+      dy = TA_with_sign(flag >> 1, (data[2] << 8) + data[3]);
+    }
+
+    x += dx;
+    y += dy;
+
+    points[i].x = x;
+    points[i].y = y;
+    points[i].on_curve = on_curve;
+  }
+}
+
+
+/* emit the flags and coordinates of a simple glyph */
+/* in the compact form used by the `glyf' table */
+
+static void
+TA_buffer_add_points(WOFF_Buffer* b,
+                     WOFF2_Point* points,
+                     FT_UInt num_points,
+                     FT_Bool overlap)
+{
+  FT_Byte* flags;
+  FT_UInt i, j;
+  FT_Long last;
+
+
+  /* reserve space for the worst case (no repeats, all words) */
+  TA_buffer_reserve(b, 5 * num_points);
+  if (b->error)
+    return;
+
+  /* compute flags in place, to be compressed afterwards */
+  flags = b->buf + b->len;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Long dx = points[i].x - (i ? points[i - 1].x : 0);
+    FT_Long dy = points[i].y - (i ? points[i - 1].y : 0);
+    FT_Byte flag = points[i].on_curve ? ON_CURVE : 0;
+
+
+    if (dx == 0)
+      flag |= SAME_X;
+    else if (dx >= -255 && dx <= 255)
+      flag |= X_SHORT_VECTOR | (dx > 0 ? SAME_X : 0);
+
+    if (dy == 0)
+      flag |= SAME_Y;
+    else if (dy >= -255 && dy <= 255)
+      flag |= Y_SHORT_VECTOR | (dy > 0 ? SAME_Y : 0);
+
+    if (i == 0 && overlap)
+      flag |= OVERLAP_SIMPLE;
+
+    flags[i] = flag;
+  }
+
+  /* run-length compress the flags; */
+  /* since the output never gets larger, we can do that in place */
+  j = 0;
+  for (i = 0; i < num_points; )
+  {
+    FT_Byte flag = flags[i];
+    FT_UInt repeat = 0;
+
+
+    while (i + repeat + 1 < num_points
+           && flags[i + repeat + 1] == flag
+           && repeat < 255)
+      repeat++;
+
+    if (repeat > 1)
+    {
+      flags[j++] = flag | REPEAT;
+      flags[j++] = (FT_Byte)repeat;
+      i += repeat + 1;
+    }
+    else
+    {
+      flags[j++] = flag;
+      i++;
+    }
+  }
+  b->len += j;
+
+  /* x coordinates */
+  last = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Long dx = points[i].x - last;
+
+
+    last = points[i].x;
+
+    if (dx == 0)
+      continue;
+    else if (dx >= -255 && dx <= 255)
+      b->buf[b->len++] = (FT_Byte)(dx > 0 ? dx : -dx);
+    else
+    {
+      b->buf[b->len++] = HIGH(dx);
+      b->buf[b->len++] = LOW(dx);
+    }
+  }
+
+  /* y coordinates */
+  last = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Long dy = points[i].y - last;
+
+
+    last = points[i].y;
+
+    if (dy == 0)
+      continue;
+    else if (dy >= -255 && dy <= 255)
+      b->buf[b->len++] = (FT_Byte)(dy > 0 ? dy : -dy);
+    else
+    {
+      b->buf[b->len++] = HIGH(dy);
+      b->buf[b->len++] = LOW(dy);
+    }
+  }
+}
+
+
+/* reconstruct the `glyf' and `loca' tables from a transformed `glyf' */
+/* table; we also collect the glyphs' `xMin' values which are needed */
+/* to reconstruct a transformed `hmtx' table */
+
+static FT_Error
+TA_reconstruct_glyf(const FT_Byte* buf,
+                    FT_ULong len,
+                    WOFF_Table* glyf_table,
+                    WOFF_Table* loca_table,
+                    FT_UShort* index_formatp,
+                    FT_Short** x_minsp,
+                    FT_UShort* num_glyphsp)
+{
+  WOFF_Stream header;
+  WOFF_Stream streams[WOFF2_NUM_STREAMS];
+  WOFF_Stream overlap;
+  const FT_Byte* bbox_bitmap;
+  const FT_Byte* overlap_bitmap = NULL;
+
+  FT_UShort option_flags;
+  FT_UShort num_glyphs;
+  FT_UShort index_format;
+
+  WOFF_Buffer glyf = {NULL, 0, 0, 0};
+  FT_Byte* loca_buf = NULL;
+  FT_ULong loca_len;
+  FT_Short* x_mins = NULL;
+
+  FT_UShort* end_points = NULL;
+  FT_UInt end_points_size = 0;
+  WOFF2_Point* points = NULL;
+  FT_UInt points_size = 0;
+
+  const FT_Byte* p;
+  FT_UInt i;
+
+  FT_Error error = TA_Err_Invalid_WOFF_Data;
+
+
+  TA_stream_init(&header, buf, len);
+
+  TA_stream_read_ushort(&header); /* reserved */
+  option_flags = TA_stream_read_ushort(&header);
+  num_glyphs = TA_stream_read_ushort(&header);
+  index_format = TA_stream_read_ushort(&header);
+  if (header.error || index_format > 1)
+    return TA_Err_Invalid_WOFF_Data;
+
+  p = buf + WOFF2_GLYF_HEADER_LEN;
+  for (i = 0; i < WOFF2_NUM_STREAMS; i++)
+  {
+    FT_ULong stream_len = TA_stream_read_ulong(&header);
+
+
+    if (header.error
+        || stream_len > (FT_ULong)(buf + len - p))
+      return TA_Err_Invalid_WOFF_Data;
+
+    TA_stream_init(&streams[i], p, stream_len);
+    p += stream_len;
+  }
+
+  /* the bounding box bitmap precedes the bounding boxes */
+  bbox_bitmap = TA_stream_skip(&streams[WOFF2_BBOX_STREAM],
+                               4 * (((FT_ULong)num_glyphs + 31) >> 5));
+  if (!bbox_bitmap)
+    return TA_Err_Invalid_WOFF_Data;
+
+  if (option_flags & WOFF2_HAVE_OVERLAP_BITMAP)
+  {
+    TA_stream_init(&overlap, p, (FT_ULong)(buf + len - p));
+    overlap_bitmap = TA_stream_skip(&overlap,
+                                    ((FT_ULong)num_glyphs + 7) >> 3);
+    if (!overlap_bitmap)
+      return TA_Err_Invalid_WOFF_Data;
+  }
+
+  loca_len = ((FT_ULong)num_glyphs + 1) * (index_format ? 4 : 2);
+  loca_buf = (FT_Byte*)malloc(loca_len);
+  x_mins = (FT_Short*)calloc(num_glyphs ? num_glyphs : 1,
+                             sizeof (FT_Short));
+  if (!loca_buf || !x_mins)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  for (i = 0; i <= num_glyphs; i++)
+  {
+    FT_ULong offset = glyf.len;
+    FT_Short num_contours;
+    FT_Bool have_bbox;
+
+
+    /* store the glyph's offset in the `loca' table */
+    if (index_format)
+      TA_put_ulong(loca_buf + 4 * i, offset);
+    else
+    {
+      if (offset / 2 > 0xFFFF)
+        goto Err;
+      TA_put_ushort(loca_buf + 2 * i, offset / 2);
+    }
+
+    if (i == num_glyphs)
+      break;
+
+    num_contours = (FT_Short)TA_stream_read_ushort(
+                               &streams[WOFF2_N_CONTOUR_STREAM]);
+    have_bbox = (bbox_bitmap[i >> 3] & (0x80 >> (i & 7))) != 0;
+
+    if (num_contours == 0)
+    {
+      /* an empty glyph */
+      if (have_bbox)
+        goto Err;
+    }
+    else if (num_contours == -1)
+    {
+      /* a composite glyph */
+      WOFF_Stream* composite = &streams[WOFF2_COMPOSITE_STREAM];
+      const FT_Byte* start = composite->p;
+      const FT_Byte* bbox;
+      FT_UShort flags;
+      FT_Bool have_instructions = 0;
+
+
+      bbox = TA_stream_skip(&streams[WOFF2_BBOX_STREAM], 8);
+      if (!have_bbox || !bbox)
+        goto Err;
+
+      x_mins[i] = (FT_Short)TA_get_ushort(bbox);
+
+      do
+      {
+        FT_ULong arg_len;
+
+
+        flags = TA_stream_read_ushort(composite);
+        have_instructions |= (flags & WE_HAVE_INSTR) != 0;
+
+        /* glyph index and arguments */
+        arg_len = 2 + ((flags & ARGS_ARE_WORDS) ? 4 : 2);
+        if (flags & WE_HAVE_A_SCALE)
+          arg_len += 2;
+        else if (flags & WE_HAVE_AN_XY_SCALE)
+          arg_len += 4;
+        else if (flags & WE_HAVE_A_2X2)
+          arg_len += 8;
+
+        TA_stream_skip(composite, arg_len);
+      } while ((flags & MORE_COMPONENTS) && !composite->error);
+
+      TA_buffer_add_ushort(&glyf, 0xFFFF);
+      TA_buffer_add_bytes(&glyf, bbox, 8);
+      TA_buffer_add_bytes(&glyf, start, (FT_ULong)(composite->p - start));
+
+      if (have_instructions)
+      {
+        FT_UShort ins_len = TA_stream_read_255ushort(
+                              &streams[WOFF2_GLYPH_STREAM]);
+        const FT_Byte* ins = TA_stream_skip(
+                               &streams[WOFF2_INSTRUCTION_STREAM], ins_len);
+
+
+        if (!ins)
+          goto Err;
+
+        TA_buffer_add_ushort(&glyf, ins_len);
+        TA_buffer_add_bytes(&glyf, ins, ins_len);
+      }
+    }
+    else if (num_contours > 0)
+    {
+      /* a simple glyph */
+      FT_UInt num_points = 0;
+      FT_UShort ins_len;
+      const FT_Byte* ins;
+      FT_Long x_min, y_min, x_max, y_max;
+      FT_Int j;
+
+
+      if ((FT_UInt)num_contours > end_points_size)
+      {
+        FT_UShort* end_points_new;
+
+
+        end_points_new = (FT_UShort*)realloc(end_points,
+                                             num_contours
+                                             * sizeof (FT_UShort));
+        if (!end_points_new)
+        {
+          error = FT_Err_Out_Of_Memory;
+          goto Err;
+        }
+        end_points = end_points_new;
+        end_points_size = num_contours;
+      }
+
+      for (j = 0; j < num_contours; j++)
+      {
+        FT_UShort n = TA_stream_read_255ushort(
+                        &streams[WOFF2_N_POINTS_STREAM]);
+
+
+        /* empty contours are not allowed */
+        if (!n || num_points + n > 0xFFFF)
+          goto Err;
+
+        num_points += n;
+        end_points[j] = (FT_UShort)(num_points - 1);
+      }
+      if (streams[WOFF2_N_POINTS_STREAM].error)
+        goto Err;
+
+      if (num_points > points_size)
+      {
+        WOFF2_Point* points_new;
+
+
+        points_new = (WOFF2_Point*)realloc(points,
+                                           num_points
+                                           * sizeof (WOFF2_Point));
+        if (!points_new)
+        {
+          error = FT_Err_Out_Of_Memory;
+          goto Err;
+        }
+        points = points_new;
+        points_size = num_points;
+      }
+
+      TA_decode_triplets(&streams[WOFF2_FLAG_STREAM],
+                         &streams[WOFF2_GLYPH_STREAM],
+                         points, num_points);
+      if (streams[WOFF2_FLAG_STREAM].error
+          || streams[WOFF2_GLYPH_STREAM].error)
+        goto Err;
+
+      ins_len = TA_stream_read_255ushort(&streams[WOFF2_GLYPH_STREAM]);
+      ins = TA_stream_skip(&streams[WOFF2_INSTRUCTION_STREAM], ins_len);
+      if (!ins)
+        goto Err;
+
+      if (have_bbox)
+      {
+        WOFF_Stream* bbox = &streams[WOFF2_BBOX_STREAM];
+
+
+        x_min = (FT_Short)TA_stream_read_ushort(bbox);
+        y_min = (FT_Short)TA_stream_read_ushort(bbox);
+        x_max = (FT_Short)TA_stream_read_ushort(bbox);
+        y_max = (FT_Short)TA_stream_read_ushort(bbox);
+        if (bbox->error)
+          goto Err;
+      }
+      else
+      {
+        FT_UInt k;
+
+
+        x_min = x_max = points[0].x;
+        y_min = y_max = points[0].y;
+        for (k = 1; k < num_points; k++)
+        {
+          if (points[k].x < x_min)
+            x_min = points[k].x;
+          if (points[k].x > x_max)
+            x_max = points[k].x;
+          if (points[k].y < y_min)
+            y_min = points[k].y;
+          if (points[k].y > y_max)
+            y_max = points[k].y;
+        }
+      }
+
+      x_mins[i] = (FT_Short)x_min;
+
+      TA_buffer_add_ushort(&glyf, (FT_UShort)num_contours);
+      TA_buffer_add_ushort(&glyf, (FT_UShort)x_min);
+      TA_buffer_add_ushort(&glyf, (FT_UShort)y_min);
+      TA_buffer_add_ushort(&glyf, (FT_UShort)x_max);
+      TA_buffer_add_ushort(&glyf, (FT_UShort)y_max);
+      for (j = 0; j < num_contours; j++)
+        TA_buffer_add_ushort(&glyf, end_points[j]);
+      TA_buffer_add_ushort(&glyf, ins_len);
+      TA_buffer_add_bytes(&glyf, ins, ins_len);
+      TA_buffer_add_points(&glyf, points, num_points,
+                           overlap_bitmap
+                           && (overlap_bitmap[i >> 3] & (0x80 >> (i & 7))));
+    }
+    else
+      goto Err;
+
+    TA_buffer_pad4(&glyf);
+
+    if (glyf.error)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+    if (streams[WOFF2_N_CONTOUR_STREAM].error
+        || streams[WOFF2_GLYPH_STREAM].error
+        || streams[WOFF2_COMPOSITE_STREAM].error
+        || streams[WOFF2_INSTRUCTION_STREAM].error)
+      goto Err;
+  }
+
+  glyf_table->buf = glyf.buf;
+  glyf_table->len = glyf.len;
+  glyf_table->allocated = 1;
+
+  loca_table->buf = loca_buf;
+  loca_table->len = loca_len;
+  loca_table->allocated = 1;
+
+  *index_formatp = index_format;
+  *x_minsp = x_mins;
+  *num_glyphsp = num_glyphs;
+
+  free(end_points);
+  free(points);
+
+  return TA_Err_Ok;
+
+Err:
+  free(glyf.buf);
+  free(loca_buf);
+  free(x_mins);
+  free(end_points);
+  free(points);
+
+  return error;
+}
+
+
+/* reconstruct a transformed `hmtx' table */
+
+static FT_Error
+TA_reconstruct_hmtx(const FT_Byte* buf,
+                    FT_ULong len,
+                    WOFF_Table* hmtx_table,
+                    FT_UShort num_hmetrics,
+                    FT_UShort num_glyphs,
+                    const FT_Short* x_mins)
+{
+  WOFF_Stream s;
+  FT_Byte flags;
+  const FT_Byte* advances;
+  FT_Byte* hmtx_buf;
+  FT_Byte* p;
+  FT_UInt i;
+
+
+  if (num_hmetrics < 1 || num_hmetrics > num_glyphs)
+    return TA_Err_Invalid_WOFF_Data;
+
+  TA_stream_init(&s, buf, len);
+
+  flags = TA_stream_read_byte(&s);
+  advances = TA_stream_skip(&s, 2 * (FT_ULong)num_hmetrics);
+  if (!advances
+      || !(flags & (WOFF2_NO_PROPORTIONAL_LSBS | WOFF2_NO_MONOSPACE_LSBS))
+      || (flags & ~(WOFF2_NO_PROPORTIONAL_LSBS | WOFF2_NO_MONOSPACE_LSBS)))
+    return TA_Err_Invalid_WOFF_Data;
+
+  if (hmtx_table->len != 4 * (FT_ULong)num_hmetrics
+                         + 2 * (FT_ULong)(num_glyphs - num_hmetrics))
+    return TA_Err_Invalid_WOFF_Data;
+
+  hmtx_buf = (FT_Byte*)malloc(hmtx_table->len);
+  if (!hmtx_buf)
+    return FT_Err_Out_Of_Memory;
+
+  p = hmtx_buf;
+  for (i = 0; i < num_glyphs; i++)
+  {
+    FT_Bool have_lsb = (i < num_hmetrics)
+                         ? !(flags & WOFF2_NO_PROPORTIONAL_LSBS)
+                         : !(flags & WOFF2_NO_MONOSPACE_LSBS);
+    FT_UShort lsb;
+
+
+    if (i < num_hmetrics)
+    {
+      *(p++) = advances[2 * i];
+      *(p++) = advances[2 * i + 1];
+    }
+
+    lsb = have_lsb ? TA_stream_read_ushort(&s)
+                   : (FT_UShort)x_mins[i];
+    p = TA_put_ushort(p, lsb);
+  }
+
+  if (s.error)
+  {
+    free(hmtx_buf);
+    return TA_Err_Invalid_WOFF_Data;
+  }
+
+  hmtx_table->buf = hmtx_buf;
+  hmtx_table->allocated = 1;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_brotli_decompress(const FT_Byte* buf,
+                     FT_ULong len,
+                     FT_ULong orig_len,
+                     FT_Byte** orig_buf)
+{
+  size_t dest_len = orig_len;
+
+
+  *orig_buf = (FT_Byte*)malloc(orig_len ? orig_len : 1);
+  if (!*orig_buf)
+    return FT_Err_Out_Of_Memory;
+
+  if (BrotliDecoderDecompress(len, buf, &dest_len, *orig_buf)
+        != BROTLI_DECODER_RESULT_SUCCESS
+      || dest_len != orig_len)
+  {
+    free(*orig_buf);
+    *orig_buf = NULL;
+    return TA_Err_Invalid_WOFF_Data;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_font_decode_WOFF2(FONT* font,
+                     FT_Byte** sfnt_buf,
+                     size_t* sfnt_len)
+{
+  const FT_Byte* buf = font->in_buf;
+  FT_ULong len;
+
+  FT_ULong flavor;
+  FT_UShort num_tables;
+  FT_ULong comp_len;
+  FT_UShort major_version, minor_version;
+  FT_ULong meta_offset, meta_len, meta_orig_len;
+  FT_ULong priv_offset, priv_len;
+
+  WOFF_Stream dir;
+  WOFF_Table* tables = NULL;
+  WOFF_Table* glyf_table;
+  WOFF_Table* loca_table;
+  WOFF_Table* hmtx_table;
+  FT_Byte* stream_buf = NULL;
+  FT_ULong stream_len = 0;
+  FT_Byte* meta_buf = NULL;
+  FT_Byte* priv_buf = NULL;
+  FT_Short* x_mins = NULL;
+  FT_UShort num_glyphs = 0;
+  FT_UShort i;
+
+  FT_Error error;
+
+
+  if (font->in_len < WOFF2_HEADER_LEN)
+    return TA_Err_Invalid_WOFF_Data;
+
+  flavor = TA_get_ulong(buf + 4);
+  len = TA_get_ulong(buf + 8);
+  num_tables = TA_get_ushort(buf + 12);
+  comp_len = TA_get_ulong(buf + 20);
+  major_version = TA_get_ushort(buf + 24);
+  minor_version = TA_get_ushort(buf + 26);
+  meta_offset = TA_get_ulong(buf + 28);
+  meta_len = TA_get_ulong(buf + 32);
+  meta_orig_len = TA_get_ulong(buf + 36);
+  priv_offset = TA_get_ulong(buf + 40);
+  priv_len = TA_get_ulong(buf + 44);
+
+  /* we don't support WOFF2 font collections */
+  if (flavor == TAG_ttcf)
+    return TA_Err_Invalid_Font_Type;
+
+  if (len > font->in_len
+      || !num_tables
+      || TA_get_ushort(buf + 14) != 0) /* reserved */
+    return TA_Err_Invalid_WOFF_Data;
+
+  tables = (WOFF_Table*)calloc(num_tables, sizeof (WOFF_Table));
+  if (!tables)
+    return FT_Err_Out_Of_Memory;
+
+  /* parse the table directory */
+  TA_stream_init(&dir, buf + WOFF2_HEADER_LEN, len - WOFF2_HEADER_LEN);
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+    FT_Byte flags = TA_stream_read_byte(&dir);
+    FT_Byte version = flags >> 6;
+
+
+    if ((flags & WOFF2_ARBITRARY_TAG) == WOFF2_ARBITRARY_TAG)
+      table->tag = TA_stream_read_ulong(&dir);
+    else
+      table->tag = woff2_known_tags[flags & WOFF2_ARBITRARY_TAG];
+
+    table->len = TA_stream_read_base128(&dir);
+    table->stream_len = table->len;
+
+    /* for `glyf' and `loca', version 0 is the transformation, */
+    /* and version 3 the null transform; */
+    /* for all other tables it is the other way round */
+    if (table->tag == TTAG_glyf || table->tag == TTAG_loca)
+      table->transformed = (version == 0);
+    else
+      table->transformed = (version != 0);
+
+    if (table->transformed)
+    {
+      table->stream_len = TA_stream_read_base128(&dir);
+
+      /* we only support the transformations defined in the */
+      /* WOFF2 specification */
+      if (!((table->tag == TTAG_glyf && version == 0)
+            || (table->tag == TTAG_loca && version == 0
+                && table->stream_len == 0)
+            || (table->tag == TTAG_hmtx && version == 1)))
+      {
+        error = TA_Err_Invalid_WOFF_Data;
+        goto Err;
+      }
+    }
+
+    table->stream_offset = stream_len;
+    if (table->stream_len > 0xFFFFFFFFUL - stream_len)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+    stream_len += table->stream_len;
+  }
+
+  if (dir.error
+      || comp_len > (FT_ULong)(dir.end - dir.p))
+  {
+    error = TA_Err_Invalid_WOFF_Data;
+    goto Err;
+  }
+
+  /* all tables are compressed as a single stream */
+  error = TA_brotli_decompress(dir.p, comp_len, stream_len, &stream_buf);
+  if (error)
+    goto Err;
+
+  for (i = 0; i < num_tables; i++)
+    if (!tables[i].transformed)
+      tables[i].buf = stream_buf + tables[i].stream_offset;
+
+  glyf_table = TA_tables_find(tables, num_tables, TTAG_glyf);
+  loca_table = TA_tables_find(tables, num_tables, TTAG_loca);
+  hmtx_table = TA_tables_find(tables, num_tables, TTAG_hmtx);
+
+  /* `glyf' and `loca' get transformed together */
+  if ((glyf_table && glyf_table->transformed)
+      != (loca_table && loca_table->transformed))
+  {
+    error = TA_Err_Invalid_WOFF_Data;
+    goto Err;
+  }
+
+  if (glyf_table && glyf_table->transformed)
+  {
+    WOFF_Table* head_table = TA_tables_find(tables, num_tables, TTAG_head);
+    FT_ULong loca_len = loca_table->len;
+    FT_UShort index_format;
+
+
+    error = TA_reconstruct_glyf(stream_buf + glyf_table->stream_offset,
+                                glyf_table->stream_len,
+                                glyf_table, loca_table,
+                                &index_format, &x_mins, &num_glyphs);
+    if (error)
+      goto Err;
+
+    /* the `loca' format must be consistent with the `head' table */
+    if (loca_table->len != loca_len
+        || !head_table
+        || head_table->transformed
+        || head_table->len < LOCA_FORMAT_OFFSET + 1
+        || head_table->buf[LOCA_FORMAT_OFFSET] != index_format)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+  }
+
+  if (hmtx_table && hmtx_table->transformed)
+  {
+    WOFF_Table* hhea_table = TA_tables_find(tables, num_tables, TTAG_hhea);
+    WOFF_Table* maxp_table = TA_tables_find(tables, num_tables, TTAG_maxp);
+
+
+    /* we need the `xMin' values of a transformed `glyf' table */
+    if (!x_mins
+        || !hhea_table
+        || hhea_table->transformed
+        || hhea_table->len < HHEA_NUM_HMETRICS_OFFSET + 2
+        || !maxp_table
+        || maxp_table->transformed
+        || maxp_table->len < MAXP_NUM_GLYPHS + 2
+        || TA_get_ushort(maxp_table->buf + MAXP_NUM_GLYPHS) != num_glyphs)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+
+    error = TA_reconstruct_hmtx(stream_buf + hmtx_table->stream_offset,
+                                hmtx_table->stream_len,
+                                hmtx_table,
+                                TA_get_ushort(hhea_table->buf
+                                              + HHEA_NUM_HMETRICS_OFFSET),
+                                num_glyphs, x_mins);
+    if (error)
+      goto Err;
+  }
+
+  if (meta_len)
+  {
+    if (meta_offset > len || meta_len > len - meta_offset)
+    {
+      error = TA_Err_Invalid_WOFF_Data;
+      goto Err;
+    }
+
+    error = TA_brotli_decompress(buf + meta_offset, meta_len,
+                                 meta_orig_len, &meta_buf);
+    if (error)
+      goto Err;
+  }
+
+  error = TA_copy_private_data(buf, len, priv_offset, priv_len, &priv_buf);
+  if (error)
+    goto Err;
+
+  error = TA_tables_build_SFNT(flavor, tables, num_tables,
+                               sfnt_buf, sfnt_len);
+  if (error)
+    goto Err;
+
+  TA_font_set_WOFF_info(font, major_version, minor_version,
+                        meta_buf, meta_len ? meta_orig_len : 0,
+                        priv_buf, priv_len);
+  TA_tables_free(tables, num_tables);
+  free(stream_buf);
+  free(x_mins);
+
+  return TA_Err_Ok;
+
+Err:
+  TA_tables_free(tables, num_tables);
+  free(stream_buf);
+  free(x_mins);
+  free(meta_buf);
+  free(priv_buf);
+
+  return error;
+}
+
+
+/* emit a `255UInt16' value (as defined in the WOFF2 specification) */
+
+static void
+TA_buffer_add_255ushort(WOFF_Buffer* b,
+                        FT_UInt val)
+{
+  if (val < 253)
+    TA_buffer_add_byte(b, (FT_Byte)val);
+  else if (val < 506)
+  {
+    TA_buffer_add_byte(b, 255);
+    TA_buffer_add_byte(b, (FT_Byte)(val - 253));
+  }
+  else if (val < 762)
+  {
+    TA_buffer_add_byte(b, 254);
+    TA_buffer_add_byte(b, (FT_Byte)(val - 506));
+  }
+  else
+  {
+    TA_buffer_add_byte(b, 253);
+    TA_buffer_add_ushort(b, val);
+  }
+}
+
+
+/* emit a `UIntBase128' value (as defined in the WOFF2 specification) */
+
+static void
+TA_buffer_add_base128(WOFF_Buffer* b,
+                      FT_ULong val)
+{
+  FT_Byte bytes[5];
+  FT_Int n = 4;
+
+
+  bytes[n] = val & 0x7F;
+  while (val >>= 7)
+    bytes[--n] = (val & 0x7F) | 0x80;
+
+  TA_buffer_add_bytes(b, bytes + n, (FT_ULong)(5 - n));
+}
+
+
+/* parse the flags and coordinates of a simple glyph; */
+/* `flags' must be able to hold `num_points' elements */
+
+static void
+TA_read_points(WOFF_Stream* s,
+               WOFF2_Point* points,
+               FT_Byte* flags,
+               FT_UInt num_points)
+{
+  FT_Long last;
+  FT_UInt i;
+
+
+  for (i = 0; i < num_points; )
+  {
+    FT_Byte flag = TA_stream_read_byte(s);
+    FT_UInt repeat = (flag & REPEAT) ? TA_stream_read_byte(s) : 0;
+
+
+    if (s->error || repeat >= num_points - i)
+    {
+      s->error = 1;
+      return;
+    }
+
+    do
+      flags[i++] = flag;
+    while (repeat--);
+  }
+
+  last = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Byte flag = flags[i];
+
+
+    if (flag & X_SHORT_VECTOR)
+    {
+      FT_Long dx = TA_stream_read_byte(s);
+
+
+      last += (flag & SAME_X) ? dx : -dx;
+    }
+    else if (!(flag & SAME_X))
+      last += (FT_Short)TA_stream_read_ushort(s);
+
+    points[i].x = last;
+    points[i].on_curve = (flag & ON_CURVE) != 0;
+  }
+
+  last = 0;
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Byte flag = flags[i];
+
+
+    if (flag & Y_SHORT_VECTOR)
+    {
+      FT_Long dy = TA_stream_read_byte(s);
+
+
+      last += (flag & SAME_Y) ? dy : -dy;
+    }
+    else if (!(flag & SAME_Y))
+      last += (FT_Short)TA_stream_read_ushort(s);
+
+    points[i].y = last;
+  }
+}
+
+
+/* encode the point coordinates of a simple glyph */
+/* (the inverse of `TA_decode_triplets') */
+
+static void
+TA_encode_triplets(WOFF_Buffer* flags,
+                   WOFF_Buffer* glyph,
+                   WOFF2_Point* points,
+                   FT_UInt num_points)
+{
+  FT_Long x = 0;
+  FT_Long y = 0;
+  FT_UInt i;
+
+
+  for (i = 0; i < num_points; i++)
+  {
+    FT_Long dx = points[i].x - x;
+    FT_Long dy = points[i].y - y;
+    FT_Long abs_x = dx < 0 ? -dx : dx;
+    FT_Long abs_y = dy < 0 ? -dy : dy;
+    FT_Byte flag = points[i].on_curve ? 0 : 0x80;
+    FT_Byte signs = (dx < 0 ? 0 : 1) + (dy < 0 ? 0 : 2);
+    FT_Byte data[4];
+    FT_ULong len;
+
+
+    x = points[i].x;
+    y = points[i].y;
+
+    if (dx == 0 && abs_y < 1280)
+    {
+      flag += ((abs_y & 0xF00) >> 7) + (signs >> 1);
+      data[0] = abs_y & 0xFF;
+      len = 1;
+    }
+    else if (dy == 0 && abs_x < 1280)
+    {
+      flag += 10 + ((abs_x & 0xF00) >> 7) + (signs & 1);
+      data[0] = abs_x & 0xFF;
+      len = 1;
+    }
+    else if (abs_x < 65 && abs_y < 65)
+    {
+      flag += 20 + ((abs_x - 1) & 0x30) + (((abs_y - 1) & 0x30) >> 2)
+              + signs;
+      data[0] = (FT_Byte)((((abs_x - 1) & 0x0F) << 4)
+                          | ((abs_y - 1) & 0x0F));
+      len = 1;
+    }
+    else if (abs_x < 769 && abs_y < 769)
+    {
+      flag += 84 + 12 * (((abs_x - 1) & 0x300) >> 8)
+              + (((abs_y - 1) & 0x300) >> 6) + signs;
+      data[0] = (abs_x - 1) & 0xFF;
+      data[1] = (abs_y - 1) & 0xFF;
+      len = 2;
+    }
+    else if (abs_x < 4096 && abs_y < 4096)
+    {
+      flag += 120 + signs;
+      data[0] = (FT_Byte)(abs_x >> 4);
+      data[1] = (FT_Byte)(((abs_x & 0x0F) << 4) | (abs_y >> 8));
+      data[2] = abs_y & 0xFF;
+      len = 3;
+    }
+    else
+    {
+      flag += 124 + signs;
+      data[0] = HIGH(abs_x);
+      data[1] = LOW(abs_x);
+      data[2] = HIGH(abs_y);
+      data[3] = LOW(abs_y);
+      len = 4;
+    }
+
+    TA_buffer_add_byte(flags, flag);
+    TA_buffer_add_bytes(glyph, data, len);
+  }
+}
+
+
+/* build a transformed `glyf' table (version 0) from the `glyf' and */
+/* `loca' tables; this fails with `TA_Err_Invalid_Font_Type' for glyph */
+/* data the transformation can't represent */
+
+static FT_Error
+TA_transform_glyf(WOFF_Table* glyf_table,
+                  WOFF_Table* loca_table,
+                  FT_UShort index_format,
+                  FT_UShort num_glyphs,
+                  WOFF_Buffer* out)
+{
+  WOFF_Buffer streams[WOFF2_NUM_STREAMS];
+  FT_Byte* bbox_bitmap = NULL;
+  FT_ULong bbox_bitmap_len;
+  FT_Byte* overlap_bitmap = NULL;
+  FT_ULong overlap_bitmap_len;
+  FT_Bool have_overlap = 0;
+
+  WOFF2_Point* points = NULL;
+  FT_Byte* flags = NULL;
+  FT_UInt points_size = 0;
+
+  FT_Byte header[WOFF2_GLYF_HEADER_LEN];
+  FT_Byte* p;
+  FT_UInt i;
+
+  FT_Error error = TA_Err_Invalid_Font_Type;
+
+
+  memset(streams, 0, sizeof (streams));
+
+  if (loca_table->len < ((FT_ULong)num_glyphs + 1) * (index_format ? 4 : 2))
+    return TA_Err_Invalid_Font_Type;
+
+  bbox_bitmap_len = 4 * (((FT_ULong)num_glyphs + 31) >> 5);
+  overlap_bitmap_len = ((FT_ULong)num_glyphs + 7) >> 3;
+  bbox_bitmap = (FT_Byte*)calloc(1, bbox_bitmap_len ? bbox_bitmap_len : 1);
+  overlap_bitmap = (FT_Byte*)calloc(1, overlap_bitmap_len
+                                         ? overlap_bitmap_len : 1);
+  if (!bbox_bitmap || !overlap_bitmap)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  for (i = 0; i < num_glyphs; i++)
+  {
+    FT_ULong offset, next;
+    WOFF_Stream s;
+    FT_Short num_contours;
+    const FT_Byte* bbox;
+    FT_UInt j;
+
+
+    if (index_format)
+    {
+      offset = TA_get_ulong(loca_table->buf + 4 * i);
+      next = TA_get_ulong(loca_table->buf + 4 * i + 4);
+    }
+    else
+    {
+      offset = 2 * (FT_ULong)TA_get_ushort(loca_table->buf + 2 * i);
+      next = 2 * (FT_ULong)TA_get_ushort(loca_table->buf + 2 * i + 2);
+    }
+
+    if (offset > next || next > glyf_table->len)
+      goto Err;
+
+    if (offset == next)
+    {
+      /* an empty glyph */
+      TA_buffer_add_ushort(&streams[WOFF2_N_CONTOUR_STREAM], 0);
+      continue;
+    }
+
+    TA_stream_init(&s, glyf_table->buf + offset, next - offset);
+    num_contours = (FT_Short)TA_stream_read_ushort(&s);
+    bbox = TA_stream_skip(&s, 8);
+    if (!bbox)
+      goto Err;
+
+    TA_buffer_add_ushort(&streams[WOFF2_N_CONTOUR_STREAM],
+                         (FT_UShort)num_contours);
+
+    if (num_contours == -1)
+    {
+      /* a composite glyph; its bounding box is always stored */
+      const FT_Byte* start = s.p;
+      FT_UShort component_flags;
+      FT_Bool have_instructions = 0;
+
+
+      bbox_bitmap[i >> 3] |= 0x80 >> (i & 7);
+      TA_buffer_add_bytes(&streams[WOFF2_BBOX_STREAM], bbox, 8);
+
+      do
+      {
+        FT_ULong arg_len;
+
+
+        component_flags = TA_stream_read_ushort(&s);
+        have_instructions |= (component_flags & WE_HAVE_INSTR) != 0;
+
+        arg_len = 2 + ((component_flags & ARGS_ARE_WORDS) ? 4 : 2);
+        if (component_flags & WE_HAVE_A_SCALE)
+          arg_len += 2;
+        else if (component_flags & WE_HAVE_AN_XY_SCALE)
+          arg_len += 4;
+        else if (component_flags & WE_HAVE_A_2X2)
+          arg_len += 8;
+
+        TA_stream_skip(&s, arg_len);
+      } while ((component_flags & MORE_COMPONENTS) && !s.error);
+
+      if (s.error)
+        goto Err;
+
+      TA_buffer_add_bytes(&streams[WOFF2_COMPOSITE_STREAM],
+                          start, (FT_ULong)(s.p - start));
+
+      if (have_instructions)
+      {
+        FT_UShort ins_len = TA_stream_read_ushort(&s);
+        const FT_Byte* ins = TA_stream_skip(&s, ins_len);
+
+
+        if (!ins)
+          goto Err;
+
+        TA_buffer_add_255ushort(&streams[WOFF2_GLYPH_STREAM], ins_len);
+        TA_buffer_add_bytes(&streams[WOFF2_INSTRUCTION_STREAM],
+                            ins, ins_len);
+      }
+    }
+    else if (num_contours > 0)
+    {
+      /* a simple glyph */
+      FT_UInt num_points = 0;
+      FT_UShort ins_len;
+      const FT_Byte* ins;
+      FT_Long x_min, y_min, x_max, y_max;
+
+
+      for (j = 0; j < (FT_UInt)num_contours; j++)
+      {
+        FT_UInt end_point = TA_stream_read_ushort(&s);
+
+
+        /* empty contours can't be represented */
+        if (end_point < num_points)
+          goto Err;
+
+        TA_buffer_add_255ushort(&streams[WOFF2_N_POINTS_STREAM],
+                                end_point + 1 - num_points);
+        num_points = end_point + 1;
+      }
+
+      ins_len = TA_stream_read_ushort(&s);
+      ins = TA_stream_skip(&s, ins_len);
+      if (!ins)
+        goto Err;
+
+      if (num_points > points_size)
+      {
+        WOFF2_Point* points_new;
+        FT_Byte* flags_new;
+
+
+        points_new = (WOFF2_Point*)realloc(points,
+                                           num_points
+                                           * sizeof (WOFF2_Point));
+        if (points_new)
+          points = points_new;
+        flags_new = (FT_Byte*)realloc(flags, num_points);
+        if (flags_new)
+          flags = flags_new;
+        if (!points_new || !flags_new)
+        {
+          error = FT_Err_Out_Of_Memory;
+          goto Err;
+        }
+        points_size = num_points;
+      }
+
+      TA_read_points(&s, points, flags, num_points);
+      if (s.error)
+        goto Err;
+
+      if (flags[0] & OVERLAP_SIMPLE)
+      {
+        overlap_bitmap[i >> 3] |= 0x80 >> (i & 7);
+        have_overlap = 1;
+      }
+
+      TA_encode_triplets(&streams[WOFF2_FLAG_STREAM],
+                         &streams[WOFF2_GLYPH_STREAM],
+                         points, num_points);
+      TA_buffer_add_255ushort(&streams[WOFF2_GLYPH_STREAM], ins_len);
+      TA_buffer_add_bytes(&streams[WOFF2_INSTRUCTION_STREAM],
+                          ins, ins_len);
+
+      /* the bounding box only gets stored */
+      /* if it differs from the computed one */
+      x_min = x_max = points[0].x;
+      y_min = y_max = points[0].y;
+      for (j = 1; j < num_points; j++)
+      {
+        if (points[j].x < x_min)
+          x_min = points[j].x;
+        if (points[j].x > x_max)
+          x_max = points[j].x;
+        if (points[j].y < y_min)
+          y_min = points[j].y;
+        if (points[j].y > y_max)
+          y_max = points[j].y;
+      }
+
+      if ((FT_Short)TA_get_ushort(bbox) != x_min
+          || (FT_Short)TA_get_ushort(bbox + 2) != y_min
+          || (FT_Short)TA_get_ushort(bbox + 4) != x_max
+          || (FT_Short)TA_get_ushort(bbox + 6) != y_max)
+      {
+        bbox_bitmap[i >> 3] |= 0x80 >> (i & 7);
+        TA_buffer_add_bytes(&streams[WOFF2_BBOX_STREAM], bbox, 8);
+      }
+    }
+    else
+      goto Err;
+  }
+
+  for (i = 0; i < WOFF2_NUM_STREAMS; i++)
+    if (streams[i].error)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+  p = TA_put_ushort(header, 0); /* reserved */
+  p = TA_put_ushort(p, have_overlap ? WOFF2_HAVE_OVERLAP_BITMAP : 0);
+  p = TA_put_ushort(p, num_glyphs);
+  p = TA_put_ushort(p, index_format);
+  for (i = 0; i < WOFF2_NUM_STREAMS; i++)
+    p = TA_put_ulong(p, streams[i].len
+                        + (i == WOFF2_BBOX_STREAM ? bbox_bitmap_len : 0));
+
+  TA_buffer_add_bytes(out, header, WOFF2_GLYF_HEADER_LEN);
+  for (i = 0; i < WOFF2_NUM_STREAMS; i++)
+  {
+    /* the bounding box bitmap precedes the bounding boxes */
+    if (i == WOFF2_BBOX_STREAM)
+      TA_buffer_add_bytes(out, bbox_bitmap, bbox_bitmap_len);
+    TA_buffer_add_bytes(out, streams[i].buf, streams[i].len);
+  }
+  if (have_overlap)
+    TA_buffer_add_bytes(out, overlap_bitmap, overlap_bitmap_len);
+
+  error = out->error ? FT_Err_Out_Of_Memory : TA_Err_Ok;
+
+Err:
+  for (i = 0; i < WOFF2_NUM_STREAMS; i++)
+    free(streams[i].buf);
+  free(bbox_bitmap);
+  free(overlap_bitmap);
+  free(points);
+  free(flags);
+
+  return error;
+}
+
+
+/* replace the `glyf' and `loca' tables with their WOFF2 transformation */
+/* and move `loca' directly after `glyf' as required by the table */
+/* directory; if the transformation is not possible, the tables are */
+/* left untouched and later on get the null transform */
+
+static FT_Error
+TA_tables_transform_glyf(WOFF_Table* tables,
+                         FT_UShort num_tables)
+{
+  WOFF_Table* glyf_table = TA_tables_find(tables, num_tables, TTAG_glyf);
+  WOFF_Table* loca_table = TA_tables_find(tables, num_tables, TTAG_loca);
+  WOFF_Table* head_table = TA_tables_find(tables, num_tables, TTAG_head);
+  WOFF_Table* maxp_table = TA_tables_find(tables, num_tables, TTAG_maxp);
+  WOFF_Table glyf_check;
+  WOFF_Table loca_check;
+  WOFF_Table loca;
+  WOFF_Buffer out = {NULL, 0, 0, 0};
+  FT_UShort index_format;
+  FT_UShort num_glyphs;
+  FT_Short* x_mins = NULL;
+  FT_UShort check_format;
+  FT_UShort check_num_glyphs;
+  FT_Bool lossless;
+
+  FT_Error error;
+
+
+  if (!glyf_table
+      || !loca_table
+      || !head_table
+      || head_table->len < LOCA_FORMAT_OFFSET + 1
+      || !maxp_table
+      || maxp_table->len < MAXP_NUM_GLYPHS + 2)
+    return TA_Err_Ok;
+
+  index_format = head_table->buf[LOCA_FORMAT_OFFSET];
+  num_glyphs = TA_get_ushort(maxp_table->buf + MAXP_NUM_GLYPHS);
+  if (index_format > 1)
+    return TA_Err_Ok;
+
+  error = TA_transform_glyf(glyf_table, loca_table,
+                            index_format, num_glyphs, &out);
+  if (error)
+    return error == FT_Err_Out_Of_Memory ? error : TA_Err_Ok;
+
+  /* make sure that the result can be reconstructed; */
+  /* we need the reconstructed table sizes for the table directory */
+  memset(&glyf_check, 0, sizeof (WOFF_Table));
+  memset(&loca_check, 0, sizeof (WOFF_Table));
+  error = TA_reconstruct_glyf(out.buf, out.len,
+                              &glyf_check, &loca_check,
+                              &check_format, &x_mins, &check_num_glyphs);
+  if (error)
+  {
+    free(out.buf);
+    return error == FT_Err_Out_Of_Memory ? error : TA_Err_Ok;
+  }
+
+  /* if the reconstructed data differs (for example, */
+  /* because of a different compression of the points), */
+  /* set bit 11 of the `head' table's `flags' field */
+  /* as recommended by the OpenType specification */
+  lossless = glyf_check.len == glyf_table->len
+             && loca_check.len == loca_table->len
+             && !memcmp(glyf_check.buf, glyf_table->buf, glyf_table->len)
+             && !memcmp(loca_check.buf, loca_table->buf, loca_table->len);
+
+  free(glyf_check.buf);
+  free(loca_check.buf);
+  free(x_mins);
+
+  if (!lossless && head_table->len >= HEAD_FLAGS_OFFSET + 2)
+  {
+    FT_Byte* head_buf = (FT_Byte*)malloc(head_table->len);
+
+
+    if (!head_buf)
+    {
+      free(out.buf);
+      return FT_Err_Out_Of_Memory;
+    }
+
+    memcpy(head_buf, head_table->buf, head_table->len);
+    head_buf[HEAD_FLAGS_OFFSET] |= 0x08;
+
+    if (head_table->allocated)
+      free(head_table->buf);
+    head_table->buf = head_buf;
+    head_table->allocated = 1;
+  }
+
+  if (glyf_table->allocated)
+    free(glyf_table->buf);
+  glyf_table->buf = out.buf;
+  glyf_table->allocated = 1;
+  glyf_table->len = glyf_check.len;
+  glyf_table->stream_len = out.len;
+  glyf_table->transformed = 1;
+
+  loca_table->len = loca_check.len;
+  loca_table->stream_len = 0;
+  loca_table->transformed = 1;
+
+  /* `glyf' sorts before `loca' */
+  loca = *loca_table;
+  memmove(glyf_table + 2, glyf_table + 1,
+          (size_t)(loca_table - glyf_table - 1) * sizeof (WOFF_Table));
+  glyf_table[1] = loca;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_font_encode_WOFF2(FONT* font,
+                     FT_Byte** woff2_buf,
+                     size_t* woff2_len)
+{
+  WOFF_Table* tables = NULL;
+  FT_UShort num_tables;
+  FT_ULong flavor;
+
+  WOFF_Buffer header = {NULL, 0, 0, 0};
+  FT_Byte* stream_buf = NULL;
+  FT_ULong stream_len = 0;
+  FT_Byte* comp_buf = NULL;
+  size_t comp_len;
+  FT_Byte* meta_buf = NULL;
+  size_t meta_len = 0;
+
+  FT_Byte* buf;
+  FT_Byte* p;
+  FT_ULong len;
+  FT_ULong sfnt_len;
+  FT_ULong meta_offset = 0;
+  FT_ULong priv_offset = 0;
+  FT_UShort i;
+
+  FT_UShort major_version, minor_version;
+
+  FT_Error error;
+
+
+  error = TA_tables_split_SFNT(font->out_buf, font->out_len,
+                               &flavor, &tables, &num_tables);
+  if (error)
+    return error;
+
+  TA_font_get_WOFF_version(font, tables, num_tables,
+                           &major_version, &minor_version);
+
+  error = TA_tables_transform_glyf(tables, num_tables);
+  if (error)
+    goto Err;
+
+  /* the header gets filled in later on */
+  TA_buffer_reserve(&header, WOFF2_HEADER_LEN);
+  header.len = WOFF2_HEADER_LEN;
+
+  /* build the table directory; */
+  /* all tables except `glyf' and `loca' use the null transform */
+  sfnt_len = SFNT_HEADER_LEN + num_tables * SFNT_TABLE_RECORD_LEN;
+  for (i = 0; i < num_tables; i++)
+  {
+    WOFF_Table* table = &tables[i];
+    FT_Byte flags;
+
+
+    for (flags = 0; flags < WOFF2_ARBITRARY_TAG; flags++)
+      if (woff2_known_tags[flags] == table->tag)
+        break;
+
+    if (!table->transformed)
+    {
+      table->stream_len = table->len;
+      if (table->tag == TTAG_glyf || table->tag == TTAG_loca)
+        flags |= WOFF2_NULL_TRANSFORM_GLYF;
+    }
+
+    TA_buffer_add_byte(&header, flags);
+    if ((flags & WOFF2_ARBITRARY_TAG) == WOFF2_ARBITRARY_TAG)
+    {
+      FT_Byte tag[4];
+
+
+      TA_put_ulong(tag, table->tag);
+      TA_buffer_add_bytes(&header, tag, 4);
+    }
+
+    TA_buffer_add_base128(&header, table->len);
+    if (table->transformed)
+      TA_buffer_add_base128(&header, table->stream_len);
+
+    stream_len += table->stream_len;
+    sfnt_len += PAD4(table->len);
+  }
+
+  if (header.error)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  /* concatenate and compress all tables */
+  stream_buf = (FT_Byte*)malloc(stream_len ? stream_len : 1);
+  if (!stream_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  p = stream_buf;
+  for (i = 0; i < num_tables; i++)
+  {
+    memcpy(p, tables[i].buf, tables[i].stream_len);
+    p += tables[i].stream_len;
+  }
+
+  comp_len = BrotliEncoderMaxCompressedSize(stream_len);
+  comp_buf = (FT_Byte*)malloc(comp_len ? comp_len : 1);
+  if (!comp_len || !comp_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW,
+                             BROTLI_MODE_FONT,
+                             stream_len, stream_buf,
+                             &comp_len, comp_buf))
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  len = PAD4(header.len + comp_len);
+
+  if (font->woff_meta_len)
+  {
+    meta_len = BrotliEncoderMaxCompressedSize(font->woff_meta_len);
+    meta_buf = (FT_Byte*)malloc(meta_len ? meta_len : 1);
+    if (!meta_len || !meta_buf)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW,
+                               BROTLI_MODE_TEXT,
+                               font->woff_meta_len, font->woff_meta_buf,
+                               &meta_len, meta_buf))
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Err;
+    }
+
+    meta_offset = len;
+    len = meta_offset + meta_len;
+  }
+
+  if (font->woff_priv_len)
+  {
+    priv_offset = PAD4(len);
+    len = priv_offset + font->woff_priv_len;
+  }
+
+  /* we need zeroed padding bytes */
+  buf = (FT_Byte*)calloc(1, len);
+  if (!buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  p = TA_put_ulong(header.buf, TAG_wOF2);
+  p = TA_put_ulong(p, flavor);
+  p = TA_put_ulong(p, len);
+  p = TA_put_ushort(p, num_tables);
+  p = TA_put_ushort(p, 0);
+  p = TA_put_ulong(p, sfnt_len);
+  p = TA_put_ulong(p, comp_len);
+  p = TA_put_ushort(p, major_version);
+  p = TA_put_ushort(p, minor_version);
+  p = TA_put_ulong(p, meta_offset);
+  p = TA_put_ulong(p, meta_len);
+  p = TA_put_ulong(p, font->woff_meta_len);
+  p = TA_put_ulong(p, priv_offset);
+  p = TA_put_ulong(p, font->woff_priv_len);
+
+  memcpy(buf, header.buf, header.len);
+  memcpy(buf + header.len, comp_buf, comp_len);
+  if (meta_len)
+    memcpy(buf + meta_offset, meta_buf, meta_len);
+  if (font->woff_priv_len)
+    memcpy(buf + priv_offset, font->woff_priv_buf, font->woff_priv_len);
+
+  *woff2_buf = buf;
+  *woff2_len = len;
+
+  error = TA_Err_Ok;
+
+Err:
+  free(header.buf);
+  free(stream_buf);
+  free(comp_buf);
+  free(meta_buf);
+  TA_tables_free(tables, num_tables);
+
+  return error;
+}
+
+#endif /* HAVE_BROTLI */
+
+
+/* if the input font is in WOFF or WOFF2 format, */
+/* replace `font->in_buf' with the unwrapped SFNT data; */
+/* the old buffer gets deallocated if `free_in_buf' is set */
+
+FT_Error
+TA_font_unwrap_WOFF(FONT* font,
+                    FT_Bool free_in_buf)
+{
+  FT_ULong tag;
+  FT_UInt format;
+  FT_Byte* sfnt_buf = NULL;
+  size_t sfnt_len = 0;
+
+  FT_Error error;
+
+
+  if (font->in_len < 4)
+    return TA_Err_Invalid_Font_Type;
+
+  tag = TA_get_ulong(font->in_buf);
+
+  if (tag == TAG_wOFF)
+  {
+    format = TA_FORMAT_WOFF;
+#ifdef HAVE_ZLIB
+    error = TA_font_decode_WOFF(font, &sfnt_buf, &sfnt_len);
+#else
+    error = TA_Err_Missing_WOFF_Support;
+#endif
+  }
+  else if (tag == TAG_wOF2)
+  {
+    format = TA_FORMAT_WOFF2;
+#ifdef HAVE_BROTLI
+    error = TA_font_decode_WOFF2(font, &sfnt_buf, &sfnt_len);
+#else
+    error = TA_Err_Missing_WOFF_Support;
+#endif
+  }
+  else
+  {
+    font->in_format = TA_FORMAT_SFNT;
+    return TA_Err_Ok;
+  }
+
+  if (error)
+    return error;
+
+  if (free_in_buf)
+    ta_mem_free(font->memory, font->in_buf);
+
+  font->in_buf = sfnt_buf;
+  font->in_len = sfnt_len;
+  font->in_format = format;
+
+  return TA_Err_Ok;
+}
+
+
+/* wrap `font->out_buf' into the container format */
+/* given by `font->output_format' (or the input font's format) */
+
+FT_Error
+TA_font_wrap_WOFF(FONT* font)
+{
+  FT_UInt format;
+  FT_Byte* buf = NULL;
+  size_t len = 0;
+
+  FT_Error error;
+
+
+  format = font->output_format ? font->output_format : font->in_format;
+  if (format != TA_FORMAT_WOFF && format != TA_FORMAT_WOFF2)
+    return TA_Err_Ok;
+
+  /* neither WOFF nor (our support of) WOFF2 can hold a TTC */
+  if (font->num_sfnts > 1)
+    return TA_Err_Invalid_Font_Type;
+
+  if (format == TA_FORMAT_WOFF)
+  {
+#ifdef HAVE_ZLIB
+    error = TA_font_encode_WOFF(font, &buf, &len);
+#else
+    error = TA_Err_Missing_WOFF_Support;
+#endif
+  }
+  else
+  {
+#ifdef HAVE_BROTLI
+    error = TA_font_encode_WOFF2(font, &buf, &len);
+#else
+    error = TA_Err_Missing_WOFF_Support;
+#endif
+  }
+
+  if (error)
+    return error;
+
+  free(font->out_buf);
+  font->out_buf = buf;
+  font->out_len = len;
+
+  return TA_Err_Ok;
+}
+
+/* end of tawoff.c */
@@ -69,6 +69,16 @@ TA_ERRORDEF_(Invalid_Font_Type,        0xF6, \
              "not a font with TrueType outlines in SFNT format")
 TA_ERRORDEF_(Unknown_Argument,         0xF7, \
              "unknown argument")
+TA_ERRORDEF_(Maxp_Limits_Exceeded,     0xF8, \
+             "bytecode exceeds limits given in `maxp' table")
+TA_ERRORDEF_(Invalid_Shard_Data,       0xF9, \
+             "invalid or incompatible shard data")
+TA_ERRORDEF_(Missing_Shard_Data,       0xFA, \
+             "shard data doesn't cover all glyphs")
+TA_ERRORDEF_(Missing_WOFF_Support,     0xFB, \
+             "WOFF or WOFF2 support not compiled in")
+TA_ERRORDEF_(Invalid_WOFF_Data,        0xFC, \
+             "invalid WOFF or WOFF2 data")
 
 #ifdef TA_ERROR_END_LIST
   TA_ERROR_END_LIST
@@ -22,6 +22,8 @@
 
 #include "ta.h"
 
+#include "sha256.h"
+
 
 #define COMPARE(str) \
           (len == (sizeof (str) - 1) \
@@ -47,6 +49,144 @@ TA_sfnt_set_properties(SFNT* sfnt,
 }
 
 
+/* hint the glyphs and create the bytecode tables */
+
+FT_Error
+TA_font_build_tables(FONT* font)
+{
+  FT_Long i;
+  FT_Error error;
+
+
+  ta_memory_set_phase(font->memory, TA_PHASE_HINTING);
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = ta_loader_init(font);
+    if (error)
+      return error;
+
+    error = TA_sfnt_build_gasp_table(sfnt, font);
+    if (error)
+      return error;
+    error = TA_sfnt_build_cvt_table(sfnt, font);
+    if (error)
+      return error;
+    error = TA_sfnt_build_fpgm_table(sfnt, font);
+    if (error)
+      return error;
+    error = TA_sfnt_build_prep_table(sfnt, font);
+    if (error)
+      return error;
+
+    if (font->loader)
+      ta_loader_done(font);
+  }
+
+  /* the glyph cache needs the `cvt ' tables */
+  if (font->glyph_cache)
+  {
+    error = TA_font_start_glyph_cache(font);
+    if (error)
+      return error;
+  }
+
+  /* the table array doesn't change after this point, */
+  /* so the `glyf' tables can be hinted in parallel */
+  error = TA_font_build_glyf_tables(font);
+  if (error)
+    return error;
+
+  if (font->glyph_cache)
+    TA_font_finish_glyph_cache(font);
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = TA_sfnt_build_loca_table(sfnt, font);
+    if (error)
+      return error;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* update the remaining tables and create the output font */
+
+FT_Error
+TA_font_build_output(FONT* font)
+{
+  FT_Long i;
+  FT_Error error;
+
+
+  ta_memory_set_phase(font->memory, TA_PHASE_OUTPUT);
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = TA_sfnt_compute_bytecode_limits(sfnt, font);
+    if (error)
+      return error;
+    error = TA_sfnt_update_maxp_table(sfnt, font);
+    if (error)
+      return error;
+
+    /* we add one glyph for composites */
+    if (sfnt->max_components
+        && !font->pre_hinting
+        && font->hint_with_components)
+    {
+      error = TA_sfnt_update_hmtx_table(sfnt, font);
+      if (error)
+        return error;
+      error = TA_sfnt_update_post_table(sfnt, font);
+      if (error)
+        return error;
+      error = TA_sfnt_update_GPOS_table(sfnt, font);
+      if (error)
+        return error;
+    }
+
+    if (font->info)
+    {
+      /* add info about ttfautohint to the version string */
+      error = TA_sfnt_update_name_table(sfnt, font);
+      if (error)
+        return error;
+    }
+  }
+
+  if (font->device_metrics)
+  {
+    error = TA_font_build_device_tables(font);
+    if (error)
+      return error;
+  }
+
+  /* the glyphs have already been written */
+  if (font->streaming)
+    return TA_font_finish_TTF_stream(font);
+
+  if (font->num_sfnts == 1)
+    error = TA_font_build_TTF(font);
+  else
+    error = TA_font_build_TTC(font);
+  if (error)
+    return error;
+
+  return TA_font_wrap_WOFF(font);
+}
+
+
 TA_Error
 TTF_autohint(const char* options,
              ...)
@@ -72,6 +212,12 @@ TTF_autohint(const char* options,
   FT_Long hinting_limit = -1;
   FT_Long increase_x_height = -1;
 
+  const char* hinting_sizes_string = NULL;
+  number_range* hinting_sizes = NULL;
+  FT_UInt hinting_convergence = 0;
+  FT_UInt glyph_size_budget = 0;
+  FT_UInt glyph_size_budget_deviation = TA_GLYPH_SIZE_BUDGET_DEVIATION;
+
   const char* x_height_snapping_exceptions_string = NULL;
   number_range* x_height_snapping_exceptions = NULL;
 
@@ -79,18 +225,60 @@ TTF_autohint(const char* options,
   FT_Bool gdi_cleartype_strong_stem_width = 1;
   FT_Bool dw_cleartype_strong_stem_width = 0;
 
-  TA_Progress_Func progress;
-  void* progress_data;
-  TA_Info_Func info;
-  void* info_data;
+  TA_Progress_Func progress = NULL;
+  void* progress_data = NULL;
+  TA_Info_Func info = NULL;
+  void* info_data = NULL;
+  TA_Limit_Func limit = NULL;
+  void* limit_data = NULL;
+  TA_Bound_Func bound = NULL;
+  void* bound_data = NULL;
+  TA_Budget_Func budget = NULL;
+  void* budget_data = NULL;
+
+  TA_Alloc_Func alloc_func = NULL;
+  TA_Realloc_Func realloc_func = NULL;
+  TA_Free_Func free_func = NULL;
+  void* alloc_data = NULL;
+  FT_Bool memory_pool = 0;
+  size_t memory_limit = 0;
+  TA_Memory_Stats* memory_stats = NULL;
+
+  FT_UInt glyph_max_points = 0;
+  FT_UInt glyph_max_segments = 0;
+  FT_ULong glyph_time_limit = 0;
+  FT_ULong font_time_limit = 0;
 
   FT_Bool windows_compatibility = 0;
   FT_Bool ignore_restrictions = 0;
   FT_Bool pre_hinting = 0;
+  FT_UInt pre_hinting_size = 0;
   FT_Bool hint_with_components = 0;
   FT_UInt fallback_script = TA_SCRIPT_FALLBACK;
   FT_Bool symbol = 0;
 
+  FT_Bool device_metrics = 0;
+  FT_Bool exact_maxp = 0;
+  FT_UInt output_format = 0;
+  FT_Bool reproducible = 0;
+  unsigned char* output_hash = NULL;
+  unsigned long* duplicate_glyphs = NULL;
+  TA_Glyph_Cache* glyph_cache = NULL;
+  unsigned long* cached_glyphs = NULL;
+  FT_Bool streaming = 0;
+  FT_UInt threads = 0;
+
+  TA_Variant* variants = NULL;
+  FT_UInt num_variants = 0;
+  TA_Preview* preview = NULL;
+  TA_Context* context = NULL;
+
+  FT_UInt shard_first = 0;
+  FT_UInt shard_last = 0;
+  const char* shard_buf = NULL;
+  size_t shard_len = 0;
+  const char* hint_glyphs_string = NULL;
+  number_range* hint_glyphs = NULL;
   FT_Bool debug = 0;
 
   const char* op;
@@ -132,24 +320,68 @@ TTF_autohint(const char* options,
     /* the `COMPARE' macro uses `len' and `start' */
 
     /* handle options -- don't forget to update parameter dump below! */
-    if (COMPARE("debug"))
+    if (COMPARE("alloc-callback"))
+      alloc_func = va_arg(ap, TA_Alloc_Func);
+    else if (COMPARE("alloc-callback-data"))
+      alloc_data = va_arg(ap, void*);
+    else if (COMPARE("bound-callback"))
+      bound = va_arg(ap, TA_Bound_Func);
+    else if (COMPARE("bound-callback-data"))
+      bound_data = va_arg(ap, void*);
+    else if (COMPARE("budget-callback"))
+      budget = va_arg(ap, TA_Budget_Func);
+    else if (COMPARE("budget-callback-data"))
+      budget_data = va_arg(ap, void*);
+    else if (COMPARE("cached-glyphs"))
+      cached_glyphs = va_arg(ap, unsigned long*);
+    else if (COMPARE("context"))
+      context = va_arg(ap, TA_Context*);
+    else if (COMPARE("debug"))
       debug = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("device-metrics"))
+      device_metrics = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("duplicate-glyphs"))
+      duplicate_glyphs = va_arg(ap, unsigned long*);
     else if (COMPARE("dw-cleartype-strong-stem-width"))
       dw_cleartype_strong_stem_width = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("error-string"))
       error_stringp = va_arg(ap, const unsigned char**);
+    else if (COMPARE("exact-maxp"))
+      exact_maxp = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("fallback-script"))
       fallback_script = va_arg(ap, FT_UInt);
+    else if (COMPARE("font-time-limit"))
+      font_time_limit = (FT_ULong)va_arg(ap, FT_UInt);
+    else if (COMPARE("free-callback"))
+      free_func = va_arg(ap, TA_Free_Func);
     else if (COMPARE("gdi-cleartype-strong-stem-width"))
       gdi_cleartype_strong_stem_width = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("glyph-cache"))
+      glyph_cache = va_arg(ap, TA_Glyph_Cache*);
+    else if (COMPARE("glyph-max-points"))
+      glyph_max_points = va_arg(ap, FT_UInt);
+    else if (COMPARE("glyph-max-segments"))
+      glyph_max_segments = va_arg(ap, FT_UInt);
+    else if (COMPARE("glyph-size-budget"))
+      glyph_size_budget = va_arg(ap, FT_UInt);
+    else if (COMPARE("glyph-size-budget-deviation"))
+      glyph_size_budget_deviation = va_arg(ap, FT_UInt);
+    else if (COMPARE("glyph-time-limit"))
+      glyph_time_limit = (FT_ULong)va_arg(ap, FT_UInt);
     else if (COMPARE("gray-strong-stem-width"))
       gray_strong_stem_width = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("hinting-convergence"))
+      hinting_convergence = va_arg(ap, FT_UInt);
     else if (COMPARE("hinting-limit"))
       hinting_limit = (FT_Long)va_arg(ap, FT_UInt);
     else if (COMPARE("hinting-range-max"))
       hinting_range_max = (FT_Long)va_arg(ap, FT_UInt);
     else if (COMPARE("hinting-range-min"))
       hinting_range_min = (FT_Long)va_arg(ap, FT_UInt);
+    else if (COMPARE("hinting-sizes"))
+      hinting_sizes_string = va_arg(ap, const char*);
+    else if (COMPARE("hint-glyphs"))
+      hint_glyphs_string = va_arg(ap, const char*);
     else if (COMPARE("hint-with-components"))
       hint_with_components = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("ignore-restrictions"))
@@ -176,6 +408,18 @@ TTF_autohint(const char* options,
       info = va_arg(ap, TA_Info_Func);
     else if (COMPARE("info-callback-data"))
       info_data = va_arg(ap, void*);
+    else if (COMPARE("limit-callback"))
+      limit = va_arg(ap, TA_Limit_Func);
+    else if (COMPARE("limit-callback-data"))
+      limit_data = va_arg(ap, void*);
+    else if (COMPARE("memory-limit"))
+      memory_limit = va_arg(ap, size_t);
+    else if (COMPARE("memory-pool"))
+      memory_pool = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("memory-stats"))
+      memory_stats = va_arg(ap, TA_Memory_Stats*);
+    else if (COMPARE("num-variants"))
+      num_variants = va_arg(ap, FT_UInt);
     else if (COMPARE("out-buffer"))
     {
       out_file = NULL;
@@ -192,14 +436,40 @@ TTF_autohint(const char* options,
       out_bufp = NULL;
       out_lenp = NULL;
     }
+    else if (COMPARE("output-format"))
+      output_format = va_arg(ap, FT_UInt);
+    else if (COMPARE("output-hash"))
+      output_hash = va_arg(ap, unsigned char*);
     else if (COMPARE("pre-hinting"))
       pre_hinting = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("pre-hinting-size"))
+      pre_hinting_size = va_arg(ap, FT_UInt);
+    else if (COMPARE("preview"))
+      preview = va_arg(ap, TA_Preview*);
     else if (COMPARE("progress-callback"))
       progress = va_arg(ap, TA_Progress_Func);
     else if (COMPARE("progress-callback-data"))
       progress_data = va_arg(ap, void*);
+    else if (COMPARE("realloc-callback"))
+      realloc_func = va_arg(ap, TA_Realloc_Func);
+    else if (COMPARE("reproducible"))
+      reproducible = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("shard-buffer"))
+      shard_buf = va_arg(ap, const char*);
+    else if (COMPARE("shard-buffer-len"))
+      shard_len = va_arg(ap, size_t);
+    else if (COMPARE("shard-first"))
+      shard_first = va_arg(ap, FT_UInt);
+    else if (COMPARE("shard-last"))
+      shard_last = va_arg(ap, FT_UInt);
+    else if (COMPARE("streaming"))
+      streaming = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("symbol"))
       symbol = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("threads"))
+      threads = va_arg(ap, FT_UInt);
+    else if (COMPARE("variants"))
+      variants = va_arg(ap, TA_Variant*);
     else if (COMPARE("windows-compatibility"))
       windows_compatibility = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("x-height-snapping-exceptions"))
@@ -218,6 +488,10 @@ TTF_autohint(const char* options,
 
   va_end(ap);
 
+  /* the font of a previous preview run is no longer needed */
+  if (preview)
+    TA_preview_release(preview);
+
   /* check options */
 
   if (!(in_file
@@ -234,6 +508,97 @@ TTF_autohint(const char* options,
     goto Err1;
   }
 
+  if (output_format > TA_FORMAT_WOFF2)
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* shard mode needs a non-empty range; */
+  /* shard and merge mode are mutually exclusive */
+  if ((shard_last && shard_last <= shard_first)
+      || (shard_last && shard_buf)
+      || (shard_buf && !shard_len))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* selecting glyphs with `hint-glyphs' doesn't work for shards */
+  if (hint_glyphs_string && (shard_last || shard_buf))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* variants need the complete hinting process */
+  if ((num_variants && !variants)
+      || (num_variants && (shard_last || shard_buf)))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* a preview keeps a single state for updates */
+  if (preview
+      && (num_variants || shard_last || shard_buf))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* streaming mode writes directly to the output file */
+  /* and needs the complete hinting process */
+  if (streaming
+      && (!out_file
+          || output_hash
+          || device_metrics
+          || num_variants
+          || preview
+          || shard_last
+          || shard_buf
+          || hint_glyphs_string))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* time limits depend on the machine's load, */
+  /* making the output non-reproducible         */
+  if (reproducible
+      && (glyph_time_limit || font_time_limit))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* the maximum value of `unitsPerEm' */
+  if (pre_hinting_size > 16384)
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* custom memory management needs at least */
+  /* an allocation and a deallocation function */
+  if ((alloc_func && !free_func)
+      || (!alloc_func && (free_func || realloc_func)))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* a context has its own memory management, */
+  /* and a preview must not outlive it */
+  if (context
+      && (alloc_func || preview))
+  {
+    error = FT_Err_Invalid_Argument;
+    goto Err1;
+  }
+
+  /* the `FONT' structure itself holds the memory management object, */
+  /* so it is the only structure not allocated by it */
   font = (FONT*)calloc(1, sizeof (FONT));
   if (!font)
   {
@@ -241,6 +606,22 @@ TTF_autohint(const char* options,
     goto Err1;
   }
 
+  if (context)
+  {
+    TA_context_attach(context, font, memory_limit);
+
+    if (!glyph_cache)
+      glyph_cache = context->glyph_cache;
+  }
+  else
+  {
+    font->memory = &font->memory_rec;
+    ta_memory_init(font->memory,
+                   alloc_func, realloc_func, free_func, alloc_data,
+                   memory_pool, memory_limit);
+  }
+  font->memory_stats = memory_stats;
+
   if (hinting_range_min >= 0 && hinting_range_min < 2)
   {
     error = FT_Err_Invalid_Argument;
@@ -288,8 +669,40 @@ TTF_autohint(const char* options,
     }
   }
 
+  if (hinting_sizes_string)
+  {
+    const char* s = number_set_parse(hinting_sizes_string,
+                                     &hinting_sizes,
+                                     (int)hinting_range_min,
+                                     (int)hinting_range_max);
+    if (*s)
+    {
+      number_set_free(x_height_snapping_exceptions);
+      error = FT_Err_Invalid_Argument;
+      goto Err1;
+    }
+  }
+
+  if (hint_glyphs_string)
+  {
+    const char* s = number_set_parse(hint_glyphs_string,
+                                     &hint_glyphs,
+                                     0, 0xFFFE);
+    if (*s)
+    {
+      number_set_free(x_height_snapping_exceptions);
+      number_set_free(hinting_sizes);
+      error = FT_Err_Invalid_Argument;
+      goto Err1;
+    }
+  }
+
   font->hinting_range_min = (FT_UInt)hinting_range_min;
   font->hinting_range_max = (FT_UInt)hinting_range_max;
+  font->hinting_sizes = hinting_sizes;
+  font->hinting_convergence = hinting_convergence;
+  font->glyph_size_budget = glyph_size_budget;
+  font->glyph_size_budget_deviation = glyph_size_budget_deviation;
   font->hinting_limit = (FT_UInt)hinting_limit;
   font->increase_x_height = increase_x_height;
   font->x_height_snapping_exceptions = x_height_snapping_exceptions;
@@ -302,13 +715,48 @@ TTF_autohint(const char* options,
   font->progress_data = progress_data;
   font->info = info;
   font->info_data = info_data;
+  font->limit = limit;
+  font->limit_data = limit_data;
+  font->bound = bound;
+  font->bound_data = bound_data;
+  font->budget = budget;
+  font->budget_data = budget_data;
 
   font->windows_compatibility = windows_compatibility;
   font->ignore_restrictions = ignore_restrictions;
   font->pre_hinting = pre_hinting;
+  font->pre_hinting_size = pre_hinting_size;
   font->hint_with_components = hint_with_components;
   font->fallback_script = fallback_script;
   font->symbol = symbol;
+  font->device_metrics = device_metrics;
+  font->exact_maxp = exact_maxp;
+  font->output_format = output_format;
+  font->reproducible = reproducible;
+  font->shard_first = shard_first;
+  font->shard_last = shard_last;
+  font->shard_buf = (const FT_Byte*)shard_buf;
+  font->shard_len = shard_len;
+  font->hint_glyphs = hint_glyphs;
+  font->streaming = streaming;
+  font->threads = threads;
+  font->glyph_max_points = glyph_max_points;
+  font->glyph_max_segments = glyph_max_segments;
+  font->glyph_time_limit = glyph_time_limit;
+  font->font_time_limit = font_time_limit;
+
+  /* the cached bytecode must only depend on the glyph data, */
+  /* the global metrics, and the options: with pre-hinting, */
+  /* the original bytecode matters, and with time limits, */
+  /* the processing speed; in shard and streaming mode, */
+  /* not all glyph data is available */
+  if (!pre_hinting
+      && !glyph_time_limit
+      && !font_time_limit
+      && !shard_last
+      && !shard_buf
+      && !streaming)
+    font->glyph_cache = glyph_cache;
 
   font->gasp_idx = MISSING;
 
@@ -323,30 +771,81 @@ TTF_autohint(const char* options,
     fprintf(stderr, "TTF_autohint parameters\n"
                     "=======================\n\n");
 
+    DUMPVAL("context",
+            context != NULL);
+    DUMPVAL("device-metrics",
+            font->device_metrics);
     DUMPVAL("dw-cleartype-strong-stem-width",
             font->dw_cleartype_strong_stem_width);
+    DUMPVAL("exact-maxp",
+            font->exact_maxp);
     DUMPVAL("fallback-script",
             font->fallback_script);
+    DUMPVAL("font-time-limit",
+            font->font_time_limit);
     DUMPVAL("gdi-cleartype-strong-stem-width",
             font->gdi_cleartype_strong_stem_width);
+    DUMPVAL("glyph-cache",
+            font->glyph_cache != NULL);
+    DUMPVAL("glyph-max-points",
+            font->glyph_max_points);
+    DUMPVAL("glyph-max-segments",
+            font->glyph_max_segments);
+    DUMPVAL("glyph-size-budget",
+            font->glyph_size_budget);
+    DUMPVAL("glyph-size-budget-deviation",
+            font->glyph_size_budget_deviation);
+    DUMPVAL("glyph-time-limit",
+            font->glyph_time_limit);
     DUMPVAL("gray-strong-stem-width",
             font->gray_strong_stem_width);
+    DUMPVAL("hinting-convergence",
+            font->hinting_convergence);
     DUMPVAL("hinting-limit",
             font->hinting_limit);
     DUMPVAL("hinting-range-max",
             font->hinting_range_max);
     DUMPVAL("hinting-range-min",
             font->hinting_range_min);
+    s = number_set_show(font->hinting_sizes,
+                        font->hinting_range_min, font->hinting_range_max);
+    DUMPSTR("hinting-sizes", s);
+    free(s);
+    s = number_set_show(font->hint_glyphs, 0, 0xFFFE);
+    DUMPSTR("hint-glyphs", s);
+    free(s);
     DUMPVAL("hint-with-components",
             font->hint_with_components);
     DUMPVAL("ignore-restrictions",
             font->ignore_restrictions);
     DUMPVAL("increase-x-height",
             font->increase_x_height);
+    DUMPVAL("memory-limit",
+            font->memory->limit);
+    DUMPVAL("memory-pool",
+            font->memory->use_pool);
+    DUMPVAL("num-variants",
+            num_variants);
+    DUMPVAL("output-format",
+            font->output_format);
     DUMPVAL("pre-hinting",
             font->pre_hinting);
+    DUMPVAL("pre-hinting-size",
+            font->pre_hinting_size);
+    DUMPVAL("preview",
+            preview != NULL);
+    DUMPVAL("reproducible",
+            font->reproducible);
+    DUMPVAL("shard-first",
+            font->shard_first);
+    DUMPVAL("shard-last",
+            font->shard_last);
+    DUMPVAL("streaming",
+            font->streaming);
     DUMPVAL("symbol",
             font->symbol);
+    DUMPVAL("threads",
+            font->threads);
     DUMPVAL("windows-compatibility",
             font->windows_compatibility);
 
@@ -360,6 +859,8 @@ TTF_autohint(const char* options,
 
   /* now start with processing the data */
 
+  font->start_time = TA_get_milliseconds();
+
   if (in_file)
   {
     error = TA_font_file_read(font, in_file);
@@ -378,12 +879,41 @@ TTF_autohint(const char* options,
     font->in_len = in_len;
   }
 
+  /* convert WOFF and WOFF2 input to SFNT; */
+  /* we only own the input buffer if we have read it from a file */
+  error = TA_font_unwrap_WOFF(font, in_buf == NULL);
+  if (error)
+    goto Err;
+
   error = TA_font_init(font);
   if (error)
     goto Err;
 
-  if (font->debug)
-    _ta_debug = 1;
+  if (font->streaming)
+  {
+    FT_UInt format = font->output_format ? font->output_format
+                                         : font->in_format;
+
+
+    if (font->num_sfnts != 1
+        || format != TA_FORMAT_SFNT)
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Err;
+    }
+
+    /* we need a seekable output file to backpatch the table directory */
+    font->out_file = out_file;
+    font->out_start = ftell(out_file);
+    if (font->out_start < 0)
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Err;
+    }
+  }
+
+  /* a long-running program might have set it in a previous call */
+  _ta_debug = font->debug;
 
   /* we do some loops over all subfonts */
   for (i = 0; i < font->num_sfnts; i++)
@@ -466,84 +996,98 @@ TTF_autohint(const char* options,
 #endif
 
   /* loop again over subfonts */
-  for (i = 0; i < font->num_sfnts; i++)
-  {
-    SFNT* sfnt = &font->sfnts[i];
+  error = TA_font_build_tables(font);
+  if (error)
+    goto Err;
 
+  /* variants which hint the glyphs again would increase the values */
+  if (duplicate_glyphs)
+    *duplicate_glyphs = font->num_duplicate_glyphs;
+  if (cached_glyphs)
+    *cached_glyphs = font->num_cached_glyphs;
 
-    error = ta_loader_init(font);
+  /* in shard mode, we only output the glyphs' bytecode */
+  if (font->shard_last)
+  {
+    ta_memory_set_phase(font->memory, TA_PHASE_OUTPUT);
+    error = TA_font_build_shard(font);
     if (error)
       goto Err;
 
-    error = TA_sfnt_build_gasp_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_cvt_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_fpgm_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_prep_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_glyf_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_loca_table(sfnt, font);
+    goto Write;
+  }
+
+  if (num_variants || preview)
+  {
+    error = TA_font_save_variant_state(font);
     if (error)
       goto Err;
-
-    if (font->loader)
-      ta_loader_done(font);
   }
 
-  for (i = 0; i < font->num_sfnts; i++)
+  error = TA_font_build_output(font);
+  if (error)
+    goto Err;
+
+  if (num_variants)
   {
-    SFNT* sfnt = &font->sfnts[i];
+    /* the main output font */
+    FT_Byte* out_buf = font->out_buf;
+    size_t out_len = font->out_len;
+    FT_UInt v;
 
 
-    error = TA_sfnt_update_maxp_table(sfnt, font);
-    if (error)
-      goto Err;
+    font->out_buf = NULL;
+    font->out_len = 0;
 
-    /* we add one glyph for composites */
-    if (sfnt->max_components
-        && !font->pre_hinting
-        && font->hint_with_components)
+    for (v = 0; v < num_variants; v++)
     {
-      error = TA_sfnt_update_hmtx_table(sfnt, font);
-      if (error)
-        goto Err;
-      error = TA_sfnt_update_post_table(sfnt, font);
-      if (error)
-        goto Err;
-      error = TA_sfnt_update_GPOS_table(sfnt, font);
-      if (error)
-        goto Err;
-    }
+      TA_Variant* variant = &variants[v];
 
-    if (font->info)
-    {
-      /* add info about ttfautohint to the version string */
-      error = TA_sfnt_update_name_table(sfnt, font);
+
+      error = TA_font_setup_variant(font, variant);
+      if (!error)
+        error = TA_font_build_tables(font);
+      if (!error)
+        error = TA_font_build_output(font);
       if (error)
+      {
+        /* the caller only gets complete results */
+        for (; v > 0; v--)
+        {
+          free(variants[v - 1].out_buffer);
+          variants[v - 1].out_buffer = NULL;
+          variants[v - 1].out_buffer_len = 0;
+        }
+        free(out_buf);
+        free(font->out_buf);
+        font->out_buf = NULL;
         goto Err;
+      }
+
+      variant->out_buffer = (char*)font->out_buf;
+      variant->out_buffer_len = font->out_len;
+
+      font->out_buf = NULL;
+      font->out_len = 0;
     }
+
+    font->out_buf = out_buf;
+    font->out_len = out_len;
   }
 
-  if (font->num_sfnts == 1)
-    error = TA_font_build_TTF(font);
-  else
-    error = TA_font_build_TTC(font);
-  if (error)
-    goto Err;
+Write:
+  if (output_hash)
+    sha256_buffer((const char*)font->out_buf, font->out_len, output_hash);
 
   if (out_file)
   {
-    error = TA_font_file_write(font, out_file);
-    if (error)
-      goto Err;
+    /* in streaming mode, the output font has already been written */
+    if (!font->streaming)
+    {
+      error = TA_font_file_write(font, out_file);
+      if (error)
+        goto Err;
+    }
   }
   else
   {
@@ -553,6 +1097,16 @@ TTF_autohint(const char* options,
 
   error = TA_Err_Ok;
 
+  if (preview)
+  {
+    /* the output buffer has been handed over to the caller */
+    if (out_file)
+      free(font->out_buf);
+
+    TA_preview_keep(preview, font, in_buf);
+    goto Err1;
+  }
+
 Err:
   TA_font_unload(font, in_buf, out_bufp);
 
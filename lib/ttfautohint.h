@@ -17,6 +17,7 @@
 #define __TTFAUTOHINT_H__
 
 #include <stdarg.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,10 +39,14 @@ extern "C" {
  * The ttfautohint API
  * ===================
  *
- * This section documents the single function of the ttfautohint library,
- * `TTF_autohint`, together with its callback functions, `TA_Progress_Func`
- * and `TA_Info_Func`.  All information has been directly extracted from the
- * `ttfautohint.h` header file.
+ * This section documents the main function of the ttfautohint library,
+ * `TTF_autohint`, together with its callback functions, `TA_Progress_Func`,
+ * `TA_Info_Func`, `TA_Limit_Func`, `TA_Bound_Func`, and the memory
+ * allocation hooks, and the `TA_Variant` and `TA_Memory_Stats` structures.
+ * Additionally, it documents the two functions to manage a glyph cache
+ * and the functions for incremental previews.
+ * All information has been directly extracted from the `ttfautohint.h`
+ * header file.
  *
  */
 
@@ -59,6 +64,29 @@ extern "C" {
 #define TA_HINTING_RANGE_MAX 50
 #define TA_HINTING_LIMIT 200
 #define TA_INCREASE_X_HEIGHT 14
+#define TA_GLYPH_SIZE_BUDGET_DEVIATION 32
+
+/*
+ *```
+ *
+ * The length of the output hash (see option `output-hash`).
+ *
+ * ```C
+ */
+
+#define TA_OUTPUT_HASH_LEN 32
+
+/*
+ *```
+ *
+ * Container formats for option `output-format`.
+ *
+ * ```C
+ */
+
+#define TA_FORMAT_SFNT 1
+#define TA_FORMAT_WOFF 2
+#define TA_FORMAT_WOFF2 3
 
 /*
  *```
@@ -150,6 +178,227 @@ typedef int
  *
  */
 
+
+/*
+ * Callback: `TA_Limit_Func`
+ * -------------------------
+ *
+ * A callback function to get informed about glyphs which exceed a
+ * complexity limit or a time budget (see the `glyph-max-points`,
+ * `glyph-max-segments`, `glyph-time-limit`, and `font-time-limit` options
+ * of `TTF_autohint`).  Such glyphs don't get hinted; instead, they are
+ * simply scaled.
+ *
+ * *glyph_idx* gives the index of the affected glyph, and *curr_sfnt* the
+ * subfont within a TrueType Collection (TTC).  *limit* is one of the
+ * `TA_LIMIT_XXX` values below, giving the limit which has been exceeded.
+ *
+ * *limit_data* is a void pointer to user supplied data.
+ *
+ * ```C
+ */
+
+#define TA_LIMIT_POINTS 1
+#define TA_LIMIT_SEGMENTS 2
+#define TA_LIMIT_GLYPH_TIME 3
+#define TA_LIMIT_FONT_TIME 4
+
+typedef void
+(*TA_Limit_Func)(long glyph_idx,
+                 long curr_sfnt,
+                 int limit,
+                 void* limit_data);
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Callback: `TA_Bound_Func`
+ * -------------------------
+ *
+ * A callback function to get informed about the effective upper bound of
+ * the hinting range for a glyph.  It gets called for each glyph whose
+ * hints are computed (this is, not for empty, scaled, or composite
+ * glyphs).  Glyphs which get their bytecode from an identical glyph or
+ * from the glyph cache (see options `duplicate-glyphs` and `glyph-cache`
+ * of `TTF_autohint`) are reported with the stored value.
+ *
+ * *glyph_idx* gives the index of the glyph, and *curr_sfnt* the subfont
+ * within a TrueType Collection (TTC).  *bound* is the smallest PPEM value
+ * from which on the glyph's hints no longer change within the examined
+ * range; using it as the value of `hinting-range-max` gives the same
+ * bytecode for this glyph.  If `hinting-convergence` has stopped the
+ * examination early, the value refers to the examined sizes only.
+ *
+ * *bound_data* is a void pointer to user supplied data.
+ *
+ * ```C
+ */
+
+typedef void
+(*TA_Bound_Func)(long glyph_idx,
+                 long curr_sfnt,
+                 int bound,
+                 void* bound_data);
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Callback: `TA_Budget_Func`
+ * --------------------------
+ *
+ * A callback function to get informed about glyphs whose bytecode exceeds
+ * the size given by the `glyph-size-budget` option of `TTF_autohint`.
+ *
+ * *glyph_idx* gives the index of the glyph, and *curr_sfnt* the subfont
+ * within a TrueType Collection (TTC).  *old_len* is the size of the
+ * glyph's bytecode (in bytes) before merging hints records, and
+ * *new_len* the size after merging; the latter can still exceed the
+ * budget if no more hints records can be merged without exceeding the
+ * maximum deviation.  *deviation* is the largest change of a point
+ * position caused by merging, in units of 1/64th\ pixel (as estimated
+ * by the autohinter, see option `glyph-size-budget-deviation`).
+ *
+ * *budget_data* is a void pointer to user supplied data.
+ *
+ * ```C
+ */
+
+typedef void
+(*TA_Budget_Func)(long glyph_idx,
+                  long curr_sfnt,
+                  long old_len,
+                  long new_len,
+                  int deviation,
+                  void* budget_data);
+
+/*
+ * ```
+ *
+ */
+
+/*
+ * Callbacks: `TA_Alloc_Func`, `TA_Realloc_Func`, `TA_Free_Func`
+ * -------------------------------------------------------------
+ *
+ * Memory allocation hooks, having the same semantics as the standard C
+ * functions `malloc`, `realloc`, and `free`, respectively (see the
+ * `alloc-callback` option of `TTF_autohint`).  Both the allocations of the
+ * ttfautohint library and of the FreeType library used internally go
+ * through these functions.  Return NULL to signal an out-of-memory
+ * condition; `TTF_autohint` then aborts with `FT_Err_Out_Of_Memory`.
+ *
+ * *alloc_data* is a void pointer to user supplied data.
+ *
+ * ```C
+ */
+
+typedef void*
+(*TA_Alloc_Func)(size_t size,
+                 void* alloc_data);
+
+typedef void*
+(*TA_Realloc_Func)(void* block,
+                   size_t size,
+                   void* alloc_data);
+
+typedef void
+(*TA_Free_Func)(void* block,
+                void* alloc_data);
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Structure: `TA_Memory_Stats`
+ * ----------------------------
+ *
+ * Memory usage statistics (see the `memory-stats` option of
+ * `TTF_autohint`), given separately for the three processing phases:
+ * `TA_PHASE_SETUP` (reading the font, splitting it into tables, and
+ * analyzing the script coverage), `TA_PHASE_HINTING` (hinting the glyphs
+ * and creating the bytecode tables), and `TA_PHASE_OUTPUT` (updating the
+ * remaining tables and building the output font).  If variants are
+ * requested, the last two phases are run again for each variant; `peak`
+ * then holds the maximum and `num_allocs` the sum over all runs.
+ *
+ * `current` holds the number of allocated bytes at the end of a phase,
+ * `peak` the maximum number of allocated bytes during a phase, and
+ * `num_allocs` the number of allocation calls.  The byte values are the
+ * sizes requested by the library and FreeType; they don't include the
+ * overhead of the allocator.
+ *
+ * ```C
+ */
+
+#define TA_PHASE_SETUP 0
+#define TA_PHASE_HINTING 1
+#define TA_PHASE_OUTPUT 2
+#define TA_PHASE_MAX 3
+
+typedef struct TA_Memory_Stats_
+{
+  size_t current[TA_PHASE_MAX];
+  size_t peak[TA_PHASE_MAX];
+  unsigned long num_allocs[TA_PHASE_MAX];
+} TA_Memory_Stats;
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Structure: `TA_Variant`
+ * -----------------------
+ *
+ * An option set for building an additional variant of the output font
+ * (see the `variants` option of `TTF_autohint`).  The first seven fields
+ * are input values with the same meaning as the `TTF_autohint` options
+ * of the same name; note that `increase_x_height` must always be set
+ * (use `TA_INCREASE_X_HEIGHT` to get the default), and a NULL pointer for
+ * `x_height_snapping_exceptions` means no exceptions.  If the info
+ * callback is active, it gets called with `info_callback_data` while
+ * creating the variant's `name` table.
+ *
+ * The remaining two fields are output values: `out_buffer` receives the
+ * variant font, to be deallocated with `free`, and `out_buffer_len` its
+ * length.  The output format of all variants is the same as the one of
+ * the main output font.
+ *
+ * ```C
+ */
+
+typedef struct TA_Variant_
+{
+  int gray_strong_stem_width;
+  int gdi_cleartype_strong_stem_width;
+  int dw_cleartype_strong_stem_width;
+  int windows_compatibility;
+  unsigned int increase_x_height;
+  const char* x_height_snapping_exceptions;
+  void* info_callback_data;
+
+  char* out_buffer;
+  size_t out_buffer_len;
+} TA_Variant;
+
+/*
+ * ```
+ *
+ */
+
 /* pandoc-end */
 
 
@@ -206,6 +455,128 @@ typedef int
  * :   A pointer of type `size_t*` to a value giving the length of the
  *     output buffer.  Needs `out-buffer`.
  *
+ * `output-format`
+ * :   An integer specifying the container format of the output font:
+ *     `TA_FORMAT_SFNT` (a plain TTF or TTC), `TA_FORMAT_WOFF`, or
+ *     `TA_FORMAT_WOFF2`.  The default value\ 0 means that the output uses
+ *     the same format as the input.  WOFF and WOFF2 output can't hold
+ *     a TrueType collection; in this case, error
+ *     `TA_Err_Invalid_Font_Type` is returned.
+ *
+ * `shard-first`
+ * :   An integer giving the index of the first glyph to be hinted in shard
+ *     mode.  The default is\ 0.
+ *
+ * `shard-last`
+ * :   An integer giving the index of the glyph after the last one to be
+ *     hinted in shard mode; it must be larger than `shard-first`.  Setting
+ *     this option to a non-zero value activates shard mode: only glyphs in
+ *     the range [`shard-first`, `shard-last`) get hinted, and instead of a
+ *     font, the output is a *shard*, containing the bytecode of those
+ *     glyphs (together with data to validate and update the `maxp` table).
+ *     For TTCs, the range applies to all subfonts.  This allows the
+ *     distribution of the hinting work for very large fonts over multiple
+ *     processes or machines.  The default is\ 0 (no shard mode).
+ *
+ * `shard-buffer`
+ * :   A pointer of type `const char*` to a buffer which contains one or
+ *     more (concatenated) shards; it activates merge mode.  Instead of
+ *     hinting the glyphs, ttfautohint takes their bytecode from the shards
+ *     and builds the final font.  The shards must cover all glyphs exactly
+ *     once, and they must have been created from the same input font with
+ *     the same options (the font-wide tables get compared), otherwise
+ *     error `TA_Err_Invalid_Shard_Data` or `TA_Err_Missing_Shard_Data` is
+ *     returned.  Needs `shard-buffer-len`.  Mutually exclusive with
+ *     `shard-last`.
+ *
+ * `shard-buffer-len`
+ * :   A value of type `size_t`, giving the length of the shard buffer.
+ *     Needs `shard-buffer`.
+ *
+ * `hint-glyphs`
+ * :   A pointer of type `const char*` to a null-terminated string which
+ *     gives a list of comma separated glyph indices or index ranges (using
+ *     the same syntax as `x-height-snapping-exceptions`).  If set, only
+ *     those glyphs, together with their components, get hinted; all other
+ *     glyphs are output without bytecode.  The global tables (`cvt`,
+ *     `fpgm`, `prep`, etc.) are the same as for the complete font.  This
+ *     is intended for previews, where only the displayed glyphs are
+ *     needed: together with a glyph cache, changing an option which
+ *     affects all glyphs costs only the hinting of those few glyphs, even
+ *     for very large fonts.  For TTCs, the set applies to all subfonts.
+ *     This option can't be used together with `streaming`, `shard-last`,
+ *     and `shard-buffer`.  The default is the empty string (`""`),
+ *     meaning all glyphs.
+ *
+ * `variants`
+ * :   A pointer of type [`TA_Variant*`](#structure-ta_variant) to an
+ *     array of option sets.  For each array element, ttfautohint builds an
+ *     additional output font, reusing the analysis done for the main
+ *     output font (table splitting, script coverage, blue zones and
+ *     standard widths); only the option-dependent parts get recomputed.
+ *     If a variant differs from the previous one in the stem width options
+ *     only, the glyph bytecode is reused also, and just the `cvt `,
+ *     `prep`, and `maxp` tables get rebuilt; otherwise, the glyphs are
+ *     hinted again.  Needs `num-variants`.  Not available in shard and
+ *     merge mode.
+ *
+ * `num-variants`
+ * :   An integer giving the number of elements in the `variants` array.
+ *     The default value\ 0 means no variants.
+ *
+ * `preview`
+ * :   A pointer of type [`TA_Preview*`](#preview), created with
+ *     `TTF_autohint_preview_new`.  After the output font has been built,
+ *     the analyzed font is kept in this object (instead of being
+ *     discarded), so that `TTF_autohint_preview_update` can hint single
+ *     glyphs again with different options.  A state from a previous call
+ *     gets released first.  The memory allocation functions and all
+ *     callbacks together with their user data (except the progress
+ *     callback data, which `TTF_autohint_preview_update` replaces) stay in
+ *     use until the state is released; the same holds for the input
+ *     buffer given with `in-buffer`.  Not available with `variants`,
+ *     `streaming`, and in shard and merge mode.
+ *
+ * `output-hash`
+ * :   A pointer of type `unsigned char*` to a buffer of
+ *     `TA_OUTPUT_HASH_LEN` bytes which receives the SHA-256 digest of the
+ *     output font data.  Together with option `reproducible`, a build
+ *     system can use this value to check whether the output has changed.
+ *     If not set or set to NULL, no hash gets computed.
+ *
+ * `duplicate-glyphs`
+ * :   A pointer of type `unsigned long*` which receives the number of
+ *     glyphs that haven't been hinted on their own: If two glyphs have
+ *     identical data and belong to the same script, the second one simply
+ *     gets a copy of the first one's bytecode (and the bound callback
+ *     gets the first one's value).  Glyph limits (and the limit callback)
+ *     are thus handled for the first glyph only.  This optimization is not
+ *     done for option `pre-hinting`.  For TTCs, the value is the sum over
+ *     all subfonts; for variants, it refers to the main output font.
+ *
+ * `glyph-cache`
+ * :   A pointer of type [`TA_Glyph_Cache*`](#glyph-cache), created with
+ *     `TTF_autohint_glyph_cache_new`.  The bytecode of every hinted glyph
+ *     is stored in the cache, and glyphs which haven't changed since the
+ *     previous call with the same cache are not hinted again but get the
+ *     stored bytecode (together with the results of the `exact-maxp`
+ *     analysis, which thus isn't repeated either).  If the global metrics
+ *     of the font (this is, the blue zones and standard widths) or options
+ *     influencing the bytecode have changed, all glyphs get hinted again.
+ *     After hinting, glyphs not present in the current font are removed
+ *     from the cache (unless `hint-glyphs` is set).  The output is the same
+ *     as without a cache; the bound callback gets the value stored with
+ *     the bytecode.  Note, however, that the limit callback is not called
+ *     for glyphs taken from the cache.  The cache is not used with options
+ *     `pre-hinting`, `glyph-time-limit`, `font-time-limit`, `streaming`,
+ *     `shard-last`, and `shard-buffer`; for variants, it is only used for
+ *     the main output font.  A cache must not be used by two calls of
+ *     `TTF_autohint` at the same time.
+ *
+ * `cached-glyphs`
+ * :   A pointer of type `unsigned long*` which receives the number of
+ *     glyphs whose bytecode has been taken from the glyph cache.
+ *
  * `progress-callback`
  * :   A pointer of type [`TA_Progress_Func`](#callback-ta_progress_func),
  *     specifying a callback function for progress reports.  This function
@@ -232,6 +603,71 @@ typedef int
  *     autohinting.  If this field is not set, it defaults to
  *     `TA_HINTING_RANGE_MAX`.
  *
+ * `hinting-sizes`
+ * :   A pointer of type `const char*` to a null-terminated string which
+ *     gives a list of comma separated PPEM values or value ranges (using
+ *     the same syntax as `x-height-snapping-exceptions`) at which the
+ *     autohinter gets run; all values must lie within the range given by
+ *     `hinting-range-min` and `hinting-range-max`.  For a PPEM value in
+ *     between, the hints of the nearest given value are used.  Evaluating
+ *     only a sparse set of sizes (for example, `"9-16, 18, 20, 24, 32"`)
+ *     reduces both the processing time and the size of the bytecode.  The
+ *     default is the empty string (`""`), meaning all PPEM values of the
+ *     hinting range.
+ *
+ * `hinting-convergence`
+ * :   An unsigned integer\ *n*.  If set to a non-zero value, the autohinter
+ *     stops examining larger PPEM values for a glyph as soon as the glyph's
+ *     hints have been identical for *n*\ consecutive sizes and the global
+ *     scaling doesn't change any more: all blue zones must have become
+ *     inactive (which happens if they are taller than 3/4\ pixel), and no
+ *     larger size may be affected by `increase-x-height` or
+ *     `x-height-snapping-exceptions`.  Right now, this only works for
+ *     glyphs handled by the latin module.  The hints of the last examined
+ *     size get used for all larger sizes, thus the output can differ from
+ *     a complete examination of the hinting range.  Values of about\ 10
+ *     are a good compromise between speed and quality.  The default
+ *     value\ 0 means that the whole hinting range gets examined.
+ *
+ * `bound-callback`
+ * :   A pointer of type [`TA_Bound_Func`](#callback-ta_bound_func),
+ *     specifying a callback function which reports the effective upper
+ *     bound of the hinting range for each hinted glyph.  If this field is
+ *     not set or set to NULL, no bound callback function is used.
+ *
+ * `bound-callback-data`
+ * :   A pointer of type `void*` to user data which is passed to the bound
+ *     callback function.
+ *
+ * `glyph-size-budget`
+ * :   An unsigned integer giving the maximum size (in bytes) of a glyph's
+ *     bytecode.  If a glyph exceeds it, adjacent hints records (this is,
+ *     the hint sets for ranges of PPEM values) get merged by using the
+ *     hints of the smaller PPEM values for the larger ones also, starting
+ *     with the records whose merging changes the point positions least.
+ *     This stops as soon as the bytecode fits into the budget or no more
+ *     records can be merged within the limit given by
+ *     `glyph-size-budget-deviation`.  The default value\ 0 means no limit.
+ *
+ * `glyph-size-budget-deviation`
+ * :   An unsigned integer giving the maximum change (in units of 1/64th
+ *     pixel) of a point position which may be caused by merging hints
+ *     records to satisfy `glyph-size-budget`.  The change is estimated
+ *     from the point positions computed by the autohinter and thus can
+ *     differ slightly from the bytecode's rendering results.  If this
+ *     field is not set, it defaults to
+ *     `TA_GLYPH_SIZE_BUDGET_DEVIATION`.
+ *
+ * `budget-callback`
+ * :   A pointer of type [`TA_Budget_Func`](#callback-ta_budget_func),
+ *     specifying a callback function which gets called for each glyph
+ *     exceeding `glyph-size-budget`.  If this field is not set or set to
+ *     NULL, no budget callback function is used.
+ *
+ * `budget-callback-data`
+ * :   A pointer of type `void*` to user data which is passed to the budget
+ *     callback function.
+ *
  * `hinting-limit`
  * :   An integer (which must be larger than or equal to the value of
  *     `hinting-range-max`) which gives the largest PPEM value at which
@@ -279,9 +715,15 @@ typedef int
  * :   An integer (1\ for 'on' and 0\ for 'off', which is the default) to
  *     specify whether native TrueType hinting shall be applied to all
  *     glyphs before passing them to the (internal) autohinter.  The used
- *     resolution is the em-size in font units; for most fonts this is
- *     2048ppem.  Use this if the hints move or scale subglyphs
- *     independently of the output resolution.
+ *     resolution is given by `pre-hinting-size`.  Use this if the hints
+ *     move or scale subglyphs independently of the output resolution.
+ *
+ * `pre-hinting-size`
+ * :   An unsigned integer giving the PPEM value used for pre-hinting; the
+ *     resulting outlines get scaled back to font units.  The maximum value
+ *     is 16384; larger values make `TTF_autohint` return
+ *     `FT_Err_Invalid_Argument`.  The default value\ 0 means the em-size
+ *     in font units; for most fonts this is 2048ppem.
  *
  * `info-callback`
  * :   A pointer of type [`TA_Info_Func`](#callback-ta_info_func),
@@ -336,6 +778,169 @@ typedef int
  *     (for the latin script, it is character 'o').  The default value
  *     is\ 0.
  *
+ * `device-metrics`
+ * :   If this integer is set to\ 1, ttfautohint recomputes the `hdmx`,
+ *     `LTSH`, and `VDMX` tables by running the generated bytecode (using
+ *     FreeType's TrueType interpreter in B/W mode) for all PPEM values in
+ *     the range given by `hinting-range-min` and `hinting-range-max`
+ *     (limited to 255); for `LTSH`, all sizes from 1\ ppem up to
+ *     `hinting-limit` get examined.  Glyphs which FreeType can't load with
+ *     the bytecode get their unhinted advance widths.  Legacy text layout
+ *     engines like Windows GDI use these tables to get hinted advance
+ *     widths and vertical extents without executing the bytecode.  By
+ *     default (value\ 0), those tables are removed from the output font
+ *     since they are invalid after rehinting.
+ *
+ * `exact-maxp`
+ * :   If this integer is set to\ 1, the values for the stack depth, the
+ *     storage area size, and the number of twilight points in the `maxp`
+ *     table are computed by analyzing the generated bytecode (for a set
+ *     of rasterizer environments).  This gives smaller values, reducing
+ *     the memory rasterizers allocate for the font, but it can more than
+ *     double the processing time (except for glyphs taken from the glyph
+ *     cache, see `glyph-cache`).  If the bytecode needs more than the
+ *     upper bounds, error `TA_Err_Maxp_Limits_Exceeded` is returned.  By
+ *     default (value\ 0), the upper bounds collected while emitting the
+ *     bytecode are used.
+ *
+ * `reproducible`
+ * :   If this integer is set to\ 1, the output doesn't depend on the time
+ *     of processing, this is, identical input and options always give
+ *     identical output.  The modification time stamp in the `head` table
+ *     is then taken from the environment variable `SOURCE_DATE_EPOCH`
+ *     (seconds since January 1st, 1970), or, if this variable is not set,
+ *     the input font's time stamp is kept.  Since time limits make the
+ *     result depend on the speed of the machine, this option can't be
+ *     combined with `glyph-time-limit` or `font-time-limit`.  By default
+ *     (value\ 0), the current time is used.
+ *
+ * `glyph-max-points`
+ * :   An integer giving the maximum number of outline points of a glyph
+ *     (composite glyphs count as a whole if `hint-with-components` is
+ *     set).  Glyphs with more points don't get hinted but simply scaled.
+ *     The default value\ 0 means no limit.
+ *
+ * `glyph-max-segments`
+ * :   An integer giving the maximum number of segments (this is, the
+ *     horizontal outline pieces the autohinter works on) of a glyph.
+ *     Glyphs with more segments don't get hinted but simply scaled.  The
+ *     default value\ 0 means no limit.
+ *
+ * `glyph-time-limit`
+ * :   An integer giving the maximum (wall-clock) time in milliseconds
+ *     which can be spent on hinting a single glyph.  If the limit is
+ *     exceeded, the already computed hints of the glyph are discarded,
+ *     and the glyph gets simply scaled.  The default value\ 0 means no
+ *     limit.
+ *
+ * `font-time-limit`
+ * :   An integer giving the maximum (wall-clock) time in milliseconds for
+ *     processing the whole font.  If the limit is exceeded, the current
+ *     and all remaining glyphs get simply scaled.  Note that the time
+ *     needed for the other tables is not limited.  The default value\ 0
+ *     means no limit.
+ *
+ * `limit-callback`
+ * :   A pointer of type [`TA_Limit_Func`](#callback-ta_limit_func),
+ *     specifying a callback function which gets called for each glyph that
+ *     exceeds one of the limits given above.  If this field is not set or
+ *     set to NULL, no limit callback function is used.
+ *
+ * `limit-callback-data`
+ * :   A pointer of type `void*` to user data which is passed to the limit
+ *     callback function.
+ *
+ * `alloc-callback`
+ * :   A pointer of type [`TA_Alloc_Func`](#callbacks-ta_alloc_func-ta_realloc_func-ta_free_func),
+ *     specifying a function for allocating memory.  Needs `free-callback`.
+ *     If this field is not set or set to NULL, `malloc`, `realloc`, and
+ *     `free` are used.  Buffers handed over to the caller (the output
+ *     font, the variants' output fonts) and the strings passed to the info
+ *     callback (which may reallocate them) are always allocated with
+ *     `malloc`, as are the buffers needed for WOFF and WOFF2 conversion.
+ *     The same holds for the parsed number sets of options like
+ *     `hinting-sizes`, since the number set functions are also used by
+ *     callers without a `TTF_autohint` context.
+ *
+ * `realloc-callback`
+ * :   A pointer of type [`TA_Realloc_Func`](#callbacks-ta_alloc_func-ta_realloc_func-ta_free_func),
+ *     specifying a function for reallocating memory.  If not set or set to
+ *     NULL, reallocation is done by allocating a new block and copying the
+ *     data.
+ *
+ * `free-callback`
+ * :   A pointer of type [`TA_Free_Func`](#callbacks-ta_alloc_func-ta_realloc_func-ta_free_func),
+ *     specifying a function for freeing memory.  Needs `alloc-callback`.
+ *
+ * `alloc-callback-data`
+ * :   A pointer of type `void*` to user data which is passed to the memory
+ *     allocation functions.
+ *
+ * `memory-pool`
+ * :   If this integer is set to\ 1, small memory blocks (up to 4kByte) are
+ *     served from a pool which gets filled in chunks of 64kByte, and which
+ *     is released at the end of `TTF_autohint`.  This reduces the number
+ *     of calls to the allocation functions considerably.  The default
+ *     value is\ 0.
+ *
+ * `memory-limit`
+ * :   A value of type `size_t` giving the maximum number of bytes which
+ *     can be allocated at the same time (as counted for `memory-stats`).
+ *     If the limit is exceeded, `TTF_autohint` aborts with
+ *     `FT_Err_Out_Of_Memory`.  The default value\ 0 means no limit.
+ *
+ * `memory-stats`
+ * :   A pointer of type [`TA_Memory_Stats*`](#structure-ta_memory_stats)
+ *     to a structure which receives memory usage statistics.  If not set
+ *     or set to NULL, no statistics are returned.
+ *
+ * `context`
+ * :   A pointer of type [`TA_Context*`](#context), created with
+ *     `TTF_autohint_context_new`.  The FreeType library, the memory pool,
+ *     and the glyph cache of the context are used instead of creating new
+ *     ones, and they are kept for the next call with the same context.
+ *     The memory pool is always active (option `memory-pool` is ignored);
+ *     the values returned by `memory-stats` include the allocations of
+ *     the FreeType library, which also count for `memory-limit`.  The
+ *     context's glyph cache is only used if option `glyph-cache` isn't
+ *     set.  Can't be used together with `alloc-callback` or `preview`; in
+ *     this case, error `FT_Err_Invalid_Argument` is returned.  A context
+ *     must not be used by two calls of `TTF_autohint` at the same time.
+ *
+ * `streaming`
+ * :   If this integer is set to\ 1, the glyphs are read from the input
+ *     font and written to the output file in chunks of 64kByte while
+ *     hinting, instead of copying the `glyf` table and building the whole
+ *     output font in memory first.  Immediately after a glyph has been
+ *     output, its data and bytecode get discarded; together with
+ *     `memory-limit`, this allows the processing of very large fonts with
+ *     a small memory footprint.  The output file (given with `out-file`)
+ *     must be seekable since the table directory is written at the end.
+ *     Streaming mode is restricted to single TTFs with SFNT output format,
+ *     and it can't be combined with `device-metrics`, `output-hash`,
+ *     `variants`, `preview`, or shard and merge mode; in all those cases,
+ *     error `FT_Err_Invalid_Argument` is returned.  Since the glyphs' bytecode
+ *     is no longer available when the `maxp` table gets updated, the
+ *     upper bounds collected while emitting bytecode are used for its
+ *     values (option `exact-maxp` is ignored).  Identical glyphs
+ *     are hinted separately (see `duplicate-glyphs`).  The default value
+ *     is\ 0.
+ *
+ * `threads`
+ * :   An unsigned integer giving the maximum number of threads which hint
+ *     the glyphs of a TrueType collection in parallel; each thread
+ *     processes a different subfont.  Subfonts which share a `glyf` table
+ *     count as a single subfont, thus single TTFs and collections with a
+ *     single `glyf` table don't benefit from this.  Additionally, if
+ *     `pre-hinting` is set, the glyphs of every subfont get loaded in
+ *     parallel, using a separate FreeType library for each thread.  The
+ *     progress and limit callbacks as well as the memory allocation
+ *     functions are never called concurrently.  The output doesn't depend
+ *     on the number of threads.  If the library has been built without
+ *     thread support, this option is ignored; if `debug` is set, the
+ *     subfonts are always hinted one after another.  The default
+ *     value\ 0 (like value\ 1) means no threads.
+ *
  * `debug`
  * :   If this integer is set to\ 1, lots of debugging information is print
  *     to stderr.  The default value is\ 0.
@@ -355,6 +960,14 @@ typedef int
  *     for standard hinting, and symmetric grid-fitting and symmetric
  *     smoothing for horizontal subpixel hinting (ClearType).
  *
+ *   * The input font can be a plain TTF or TTC, or a WOFF or WOFF2 file
+ *     (WOFF2 font collections are not supported); the conversion is done
+ *     in memory.  WOFF support needs zlib, WOFF2 support needs the brotli
+ *     library; if ttfautohint has been compiled without them, error
+ *     `TA_Err_Missing_WOFF_Support` is returned.  Extended metadata and
+ *     private data of a WOFF or WOFF2 input font is retained if the output
+ *     is WOFF or WOFF2 also.
+ *
  *   * ttfautohint can't process a font a second time (well, it can, if the
  *     font doesn't contain composite glyphs).  Just think of ttfautohint as
  *     being a compiler, a tool which also can't process its created output
@@ -372,6 +985,122 @@ TTF_autohint(const char* options,
  *
  */
 
+
+/*
+ * Glyph Cache
+ * -----------
+ *
+ * A glyph cache keeps the bytecode of hinted glyphs between calls of
+ * `TTF_autohint` (see option `glyph-cache`), which makes hinting a
+ * font again after small modifications much faster.
+ * `TTF_autohint_glyph_cache_new` creates an empty cache; it returns NULL
+ * if there is not enough memory.  `TTF_autohint_glyph_cache_free`
+ * deallocates a cache and all of its entries.  Independently of the
+ * allocation hooks given to `TTF_autohint`, the cache always uses the
+ * standard C functions `malloc` and `free`.
+ *
+ * ```C
+ */
+
+typedef struct TA_Glyph_Cache_ TA_Glyph_Cache;
+
+TA_Glyph_Cache*
+TTF_autohint_glyph_cache_new(void);
+
+void
+TTF_autohint_glyph_cache_free(TA_Glyph_Cache* cache);
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Context
+ * -------
+ *
+ * A program which processes many fonts in a row, for example a server,
+ * can keep the FreeType library, the chunks of the memory pool (see
+ * option `memory-pool`), and a glyph cache between calls of
+ * `TTF_autohint` by passing a context (see option `context`).
+ * `TTF_autohint_context_new` creates a context; it returns NULL if there
+ * is not enough memory or FreeType can't be initialized.
+ * `TTF_autohint_context_free` deallocates a context and everything it
+ * holds.  A context always uses the standard C functions `malloc` and
+ * `free`.
+ *
+ * ```C
+ */
+
+typedef struct TA_Context_ TA_Context;
+
+TA_Context*
+TTF_autohint_context_new(void);
+
+void
+TTF_autohint_context_free(TA_Context* context);
+
+/*
+ * ```
+ *
+ */
+
+
+/*
+ * Preview
+ * -------
+ *
+ * Interactive programs like `ttfautohintGUI` show a few glyphs of a font
+ * while the user modifies the options.  Calling `TTF_autohint` for every
+ * change analyzes the whole font again, which is slow for large fonts
+ * even if only a few glyphs get hinted.  Instead, an application can do
+ * a single call of `TTF_autohint` with option `preview`, followed by
+ * calls of `TTF_autohint_preview_update`, which reuse the split tables,
+ * the script coverage, and the global metrics (blue zones and standard
+ * widths) of the first call.
+ *
+ * `TTF_autohint_preview_new` creates an empty preview object; it returns
+ * NULL if there is not enough memory.  `TTF_autohint_preview_free`
+ * releases the kept font and deallocates the object.
+ *
+ * `TTF_autohint_preview_update` builds a new output font from the kept
+ * font.  The options are taken from `variant` (see
+ * [`TA_Variant`](#structure-ta_variant)), which also receives the output
+ * font, to be deallocated with `free`.  All other options are the same as
+ * in the call of `TTF_autohint`.  `hint_glyphs` has the same meaning as
+ * option `hint-glyphs`; only these glyphs are hinted (with the glyph
+ * cache given to `TTF_autohint`, if any), and all other glyphs are
+ * output without bytecode.  `progress_callback_data` is passed to the
+ * progress callback.  If `error_string` is not NULL, it receives an error
+ * message as with option `error-string`.  If there is no kept font,
+ * `FT_Err_Invalid_Argument` is returned.  After an error other than
+ * `TA_Err_Canceled`, the kept font gets released, and `TTF_autohint` must
+ * be called again.
+ *
+ * ```C
+ */
+
+typedef struct TA_Preview_ TA_Preview;
+
+TA_Preview*
+TTF_autohint_preview_new(void);
+
+void
+TTF_autohint_preview_free(TA_Preview* preview);
+
+TA_Error
+TTF_autohint_preview_update(TA_Preview* preview,
+                            TA_Variant* variant,
+                            const char* hint_glyphs,
+                            void* progress_callback_data,
+                            const unsigned char** error_string);
+
+/*
+ * ```
+ *
+ */
+
 /* pandoc-end */
 
 #ifdef __cplusplus